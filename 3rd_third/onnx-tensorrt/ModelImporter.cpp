@@ -4,6 +4,7 @@
 
 #include "ModelImporter.hpp"
 #include "OnnxAttrs.hpp"
+#include "PluginFusion.hpp"
 #include "onnx2trt_utils.hpp"
 #include "onnx_utils.hpp"
 #include "toposort.hpp"
@@ -89,12 +90,27 @@ Status parseGraph(IImporterContext *ctx, const ::onnx::GraphProto &graph, bool d
     std::vector<size_t> topoOrder;
     ASSERT(toposort(graph.node(), &topoOrder) && "Failed to sort the model topologically.", ErrorCode::kINVALID_GRAPH);
 
+    // 可以融合成插件的子图：被融合的节点跳过，锚点节点换成 Plugin 节点，只融合已经注册的插件
+    FusionPlan fusion;
+    if (!deserializingINetwork) {
+        fusion = planPluginFusion(graph, ctx->getOpsetVersion(), [](const std::string &pluginName) {
+            return getPluginRegistry()->getPluginCreator(pluginName.c_str(), "1", "") != nullptr;
+        });
+        if (!fusion.replaced.empty()) {
+            LOG_INFO("Fused " << fusion.replaced.size() << " subgraphs (" << fusion.removed.size() << " nodes) into plugins.");
+        }
+    }
+
     const string_map<NodeImporter> &opImporters = getBuiltinOpImporterMap();
     for (const auto &nodeIndex : topoOrder) {
         if (currentNode) {
             *currentNode = nodeIndex;
         }
-        const auto &node = graph.node(nodeIndex);
+        if (fusion.removed.count(nodeIndex)) {
+            continue;
+        }
+        auto fused = fusion.replaced.find(nodeIndex);
+        const auto &node = fused != fusion.replaced.end() ? fused->second : graph.node(nodeIndex);
         const std::string &nodeName = getNodeName(node);
         LOG_VERBOSE("Parsing node: " << nodeName << " [" << node.op_type() << "]");
 
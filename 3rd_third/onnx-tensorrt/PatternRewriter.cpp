@@ -0,0 +1,558 @@
+#include "PatternRewriter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <unordered_set>
+
+namespace onnx2trt {
+
+namespace {
+
+const std::string kEmpty;
+
+// 可交换的二元算子，两种输入顺序都尝试
+bool isCommutative(const std::string &opType) {
+    return opType == "Add" || opType == "Mul" || opType == "Max" || opType == "Min" || opType == "Sum" || opType == "Equal";
+}
+
+// opset 升级时从属性改成常数输入的参数
+struct AttributeInput {
+    const char *opType, *name;
+    int input;
+};
+const AttributeInput kAttributeInputs[] = {
+    {"ReduceMean", "axes", 1}, {"ReduceSum", "axes", 1}, {"ReduceMax", "axes", 1}, {"ReduceMin", "axes", 1}, {"ReduceProd", "axes", 1},
+    {"ReduceL2", "axes", 1},   {"Squeeze", "axes", 1},   {"Unsqueeze", "axes", 1}, {"Split", "split", 1},
+};
+
+int attributeInput(const std::string &opType, const std::string &name) {
+    for (const auto &item : kAttributeInputs) {
+        if (opType == item.opType && name == item.name) {
+            return item.input;
+        }
+    }
+    return -1;
+}
+
+bool isAttributeInput(const std::string &opType, int input) {
+    for (const auto &item : kAttributeInputs) {
+        if (opType == item.opType && input == item.input) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool floatEqual(float a, float b) {
+    return std::fabs(a - b) <= 1e-6f * std::max(1.0f, std::fabs(a));
+}
+
+bool attributeEqual(const ::onnx::AttributeProto &a, const ::onnx::AttributeProto &b) {
+    if (a.type() != b.type()) {
+        return false;
+    }
+    switch (a.type()) {
+    case ::onnx::AttributeProto::INT: return a.i() == b.i();
+    case ::onnx::AttributeProto::FLOAT: return floatEqual(a.f(), b.f());
+    case ::onnx::AttributeProto::STRING: return a.s() == b.s();
+    case ::onnx::AttributeProto::INTS:
+        return a.ints_size() == b.ints_size() && std::equal(a.ints().begin(), a.ints().end(), b.ints().begin());
+    case ::onnx::AttributeProto::FLOATS:
+        return a.floats_size() == b.floats_size() && std::equal(a.floats().begin(), a.floats().end(), b.floats().begin(), floatEqual);
+    default: return false;
+    }
+}
+
+// info 中的值：整数、浮点、字符串和整数数组
+std::string attributeJson(const ::onnx::AttributeProto &attr) {
+    char buffer[64];
+    switch (attr.type()) {
+    case ::onnx::AttributeProto::INT: snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(attr.i())); return buffer;
+    case ::onnx::AttributeProto::FLOAT: snprintf(buffer, sizeof(buffer), "%.9g", attr.f()); return buffer;
+    case ::onnx::AttributeProto::STRING: return "\"" + attr.s() + "\"";
+    case ::onnx::AttributeProto::INTS: {
+        std::string json = "[";
+        for (int i = 0; i < attr.ints_size(); ++i) {
+            json += (i ? ", " : "") + std::to_string(attr.ints(i));
+        }
+        return json + "]";
+    }
+    default: return {};
+    }
+}
+
+} // namespace
+
+bool onnxAttributeDefault(const std::string &opType, const std::string &name, int64_t opset, ::onnx::AttributeProto *value) {
+    auto setInt = [&](int64_t v) {
+        value->set_type(::onnx::AttributeProto::INT);
+        value->set_i(v);
+        return true;
+    };
+    auto setFloat = [&](float v) {
+        value->set_type(::onnx::AttributeProto::FLOAT);
+        value->set_f(v);
+        return true;
+    };
+    value->Clear();
+    value->set_name(name);
+
+    // opset 13 之前 Softmax 把 axis 之后的维度展平，默认 axis = 1
+    if ((opType == "Softmax" || opType == "LogSoftmax") && name == "axis") {
+        return setInt(opset < 13 ? 1 : -1);
+    }
+    if (opType.compare(0, 6, "Reduce") == 0 && name == "keepdims") {
+        return setInt(1);
+    }
+    if (opType == "LayerNormalization" && name == "axis") {
+        return setInt(-1);
+    }
+    if ((opType == "LayerNormalization" || opType == "InstanceNormalization" || opType == "BatchNormalization") && name == "epsilon") {
+        return setFloat(1e-5f);
+    }
+    if (opType == "Gemm") {
+        if (name == "alpha" || name == "beta") {
+            return setFloat(1.0f);
+        }
+        if (name == "transA" || name == "transB") {
+            return setInt(0);
+        }
+    }
+    if (opType == "LeakyRelu" && name == "alpha") {
+        return setFloat(0.01f);
+    }
+    if (opType == "Gelu" && name == "approximate") {
+        value->set_type(::onnx::AttributeProto::STRING);
+        value->set_s("none");
+        return true;
+    }
+    return false;
+}
+
+const std::string &PatternMatch::tensor(const std::string &name) const {
+    auto iter = mTensors.find(name);
+    return iter == mTensors.end() ? kEmpty : iter->second;
+}
+
+const ::onnx::NodeProto &PatternMatch::node(const std::string &name) const {
+    return mIndex.graph().node(mNodes.at(name));
+}
+
+const ::onnx::AttributeProto *PatternMatch::attribute(const std::string &nodeName, const std::string &name) const {
+    const auto &target = node(nodeName);
+    if (const auto *attr = findAttribute(target, name)) {
+        return attr;
+    }
+    // 写成常数输入的属性（opset 18 的 axes 等）
+    int input = attributeInput(target.op_type(), name);
+    std::vector<float> values;
+    if (input >= 0 && input < target.input_size() && mIndex.constantTensor(target.input(input), &values)) {
+        mDefault.Clear();
+        mDefault.set_name(name);
+        mDefault.set_type(::onnx::AttributeProto::INTS);
+        for (float v : values) {
+            mDefault.add_ints(static_cast<int64_t>(v));
+        }
+        return &mDefault;
+    }
+    return onnxAttributeDefault(target.op_type(), name, mOpset, &mDefault) ? &mDefault : nullptr;
+}
+
+PatternBuilder::PatternBuilder(const std::string &pluginName) {
+    mPattern.pluginName = pluginName;
+    mPattern.graph.set_name(pluginName + "_pattern");
+}
+
+PatternBuilder &PatternBuilder::input(const std::string &name) {
+    mPattern.graph.add_input()->set_name(name);
+    return *this;
+}
+
+PatternBuilder &PatternBuilder::constant(const std::string &name) {
+    auto *tensor = mPattern.graph.add_initializer();
+    tensor->set_name(name);
+    tensor->set_data_type(::onnx::TensorProto::UNDEFINED);
+    return *this;
+}
+
+PatternBuilder &PatternBuilder::constant(const std::string &name, float value) {
+    auto *tensor = mPattern.graph.add_initializer();
+    tensor->set_name(name);
+    tensor->set_data_type(::onnx::TensorProto::FLOAT);
+    tensor->add_float_data(value);
+    return *this;
+}
+
+PatternBuilder &PatternBuilder::node(const std::string &opType, const std::string &name, const std::vector<std::string> &inputs) {
+    auto *node = mPattern.graph.add_node();
+    node->set_op_type(opType);
+    node->set_name(name);
+    node->add_output(name);
+    for (const auto &input : inputs) {
+        node->add_input(input);
+    }
+    return *this;
+}
+
+PatternBuilder &PatternBuilder::attrInt(const std::string &name, int64_t value) {
+    auto *attr = mPattern.graph.mutable_node(mPattern.graph.node_size() - 1)->add_attribute();
+    attr->set_name(name);
+    attr->set_type(::onnx::AttributeProto::INT);
+    attr->set_i(value);
+    return *this;
+}
+
+PatternBuilder &PatternBuilder::attrFloat(const std::string &name, float value) {
+    auto *attr = mPattern.graph.mutable_node(mPattern.graph.node_size() - 1)->add_attribute();
+    attr->set_name(name);
+    attr->set_type(::onnx::AttributeProto::FLOAT);
+    attr->set_f(value);
+    return *this;
+}
+
+PatternBuilder &PatternBuilder::attrInts(const std::string &name, const std::vector<int64_t> &values) {
+    auto *attr = mPattern.graph.mutable_node(mPattern.graph.node_size() - 1)->add_attribute();
+    attr->set_name(name);
+    attr->set_type(::onnx::AttributeProto::INTS);
+    for (auto value : values) {
+        attr->add_ints(value);
+    }
+    return *this;
+}
+
+PatternBuilder &PatternBuilder::attrString(const std::string &name, const std::string &value) {
+    auto *attr = mPattern.graph.mutable_node(mPattern.graph.node_size() - 1)->add_attribute();
+    attr->set_name(name);
+    attr->set_type(::onnx::AttributeProto::STRING);
+    attr->set_s(value);
+    return *this;
+}
+
+PatternBuilder &PatternBuilder::capture(const std::string &key, const std::string &node, const std::string &attribute) {
+    mPattern.captures.push_back({key, node, attribute});
+    return *this;
+}
+
+PatternBuilder &PatternBuilder::captureConstant(const std::string &key, const std::string &constant) {
+    mPattern.captures.push_back({key, constant, ""});
+    return *this;
+}
+
+PatternBuilder &PatternBuilder::emit(std::function<bool(const PatternMatch &, PluginReplacement *)> fn) {
+    mPattern.emit = std::move(fn);
+    return *this;
+}
+
+SubgraphPattern PatternBuilder::build(const std::string &output) {
+    mPattern.graph.add_output()->set_name(output);
+    return mPattern;
+}
+
+bool loadPattern(const std::string &path, SubgraphPattern *pattern, std::string *error) {
+    // 模板很小，不需要 ModelImporter 中放宽大小限制的读取方式
+    ::onnx::ModelProto model;
+    std::ifstream file(path, std::ios::binary);
+    if (!file || !model.ParseFromIstream(&file)) {
+        if (error) {
+            *error = "failed to read " + path;
+        }
+        return false;
+    }
+    *pattern = SubgraphPattern();
+    pattern->graph = model.graph();
+    for (const auto &prop : model.metadata_props()) {
+        if (prop.key() == "plugin") {
+            pattern->pluginName = prop.value();
+        } else if (prop.key().compare(0, 8, "capture.") == 0) {
+            auto colon = prop.value().find(':');
+            std::string node = prop.value().substr(0, colon);
+            std::string attribute = colon == std::string::npos ? "" : prop.value().substr(colon + 1);
+            pattern->captures.push_back({prop.key().substr(8), node, attribute});
+        }
+    }
+    if (pattern->pluginName.empty()) {
+        if (error) {
+            *error = path + ": metadata_props has no \"plugin\" entry";
+        }
+        return false;
+    }
+    return true;
+}
+
+struct PatternRewriter::State {
+    std::unordered_map<std::string, std::string> tensors; // 模板张量 -> 原图张量
+    std::unordered_map<size_t, size_t> nodes;             // 模板节点 -> 原图节点
+    std::unordered_set<size_t> used;                      // 已经对应的原图节点，不同的模板节点不能对应同一个节点
+};
+
+bool PatternRewriter::add(SubgraphPattern pattern, std::string *error) {
+    auto fail = [&](const std::string &message) {
+        if (error) {
+            *error = pattern.pluginName + ": " + message;
+        }
+        return false;
+    };
+
+    Compiled compiled;
+    const auto &graph = pattern.graph;
+    if (graph.output_size() != 1 || graph.node_size() == 0) {
+        return fail("a pattern needs nodes and exactly one output");
+    }
+    std::unordered_set<std::string> declared;
+    for (const auto &input : graph.input()) {
+        declared.insert(input.name());
+    }
+    for (const auto &initializer : graph.initializer()) {
+        declared.insert(initializer.name());
+    }
+    for (int i = 0; i < graph.node_size(); ++i) {
+        for (int j = 0; j < graph.node(i).output_size(); ++j) {
+            compiled.producers[graph.node(i).output(j)] = {i, j};
+            declared.insert(graph.node(i).output(j));
+        }
+    }
+    for (const auto &node : graph.node()) {
+        for (const auto &input : node.input()) {
+            if (!input.empty() && !declared.count(input)) {
+                return fail("tensor " + input + " is neither an input, a constant nor a node output");
+            }
+        }
+    }
+
+    compiled.output = graph.output(0).name();
+    auto producer = compiled.producers.find(compiled.output);
+    if (producer == compiled.producers.end()) {
+        return fail("the output must be produced by a node");
+    }
+    compiled.anchor = producer->second.first;
+    compiled.anchorSlot = producer->second.second;
+
+    for (int i = 0; i < graph.initializer_size(); ++i) {
+        compiled.constants[graph.initializer(i).name()] = i;
+    }
+    compiled.pattern = std::move(pattern);
+    mPatterns.push_back(std::move(compiled));
+    return true;
+}
+
+bool PatternRewriter::nodeMatches(const ::onnx::NodeProto &pattern, const ::onnx::NodeProto &node, const GraphIndex &index) const {
+    if (pattern.op_type() != node.op_type() || pattern.domain() != node.domain()) {
+        return false;
+    }
+
+    // 原图中多出来的输入只能是空的可选输入，或者是写成常数输入的属性
+    for (int i = pattern.input_size(); i < node.input_size(); ++i) {
+        if (!node.input(i).empty() && !isAttributeInput(node.op_type(), i)) {
+            return false;
+        }
+    }
+    if (node.input_size() < pattern.input_size()) {
+        return false;
+    }
+
+    for (const auto &constraint : pattern.attribute()) {
+        const auto *attr = findAttribute(node, constraint.name());
+        ::onnx::AttributeProto fallback;
+        if (!attr) {
+            int input = attributeInput(node.op_type(), constraint.name());
+            std::vector<float> values;
+            if (input >= 0 && input < node.input_size() && index.constantTensor(node.input(input), &values)) {
+                fallback.set_type(::onnx::AttributeProto::INTS);
+                for (float v : values) {
+                    fallback.add_ints(static_cast<int64_t>(v));
+                }
+            } else if (!onnxAttributeDefault(node.op_type(), constraint.name(), mOpset, &fallback)) {
+                return false;
+            }
+            attr = &fallback;
+        }
+        if (!attributeEqual(constraint, *attr)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * pending 中是待比较的 (模板张量, 原图张量)，每次取一个：已经绑定的检查是否一致，通配张量直接绑定，常数检查数值，
+ * 由模板节点产生的张量找到原图中产生它的节点继续比较输入。可交换的节点两种顺序各复制一份状态递归尝试。
+ */
+bool PatternRewriter::solve(const Compiled &compiled, const GraphIndex &index, std::vector<std::pair<std::string, std::string>> pending,
+                            State state, State *result) const {
+    const auto &graph = compiled.pattern.graph;
+    while (!pending.empty()) {
+        std::string templ = pending.back().first;
+        std::string target = pending.back().second;
+        pending.pop_back();
+        if (target.empty()) {
+            return false;
+        }
+        auto bound = state.tensors.find(templ);
+        if (bound != state.tensors.end()) {
+            if (bound->second != target) {
+                return false;
+            }
+            continue;
+        }
+        state.tensors[templ] = target;
+
+        auto constant = compiled.constants.find(templ);
+        if (constant != compiled.constants.end()) {
+            std::vector<float> expected, actual;
+            if (!index.constantTensor(target, &actual)) {
+                return false;
+            }
+            const auto &initializer = compiled.pattern.graph.initializer(constant->second);
+            if (initializer.data_type() != ::onnx::TensorProto::UNDEFINED) {
+                if (!tensorValues(initializer, &expected) || expected.size() != actual.size()
+                    || !std::equal(expected.begin(), expected.end(), actual.begin(), floatEqual)) {
+                    return false;
+                }
+            }
+            continue;
+        }
+
+        auto producer = compiled.producers.find(templ);
+        if (producer == compiled.producers.end()) {
+            continue; // 通配张量
+        }
+        size_t templIndex = producer->second.first;
+        int slot = producer->second.second;
+        size_t nodeIndex = 0;
+        const auto *node = index.producer(target, &nodeIndex);
+        if (!node || slot >= node->output_size() || node->output(slot) != target) {
+            return false;
+        }
+        auto mapped = state.nodes.find(templIndex);
+        if (mapped != state.nodes.end()) {
+            if (mapped->second != nodeIndex) {
+                return false;
+            }
+            continue;
+        }
+        const auto &templNode = graph.node(templIndex);
+        if (state.used.count(nodeIndex) || !nodeMatches(templNode, *node, index)) {
+            return false;
+        }
+        state.nodes[templIndex] = nodeIndex;
+        state.used.insert(nodeIndex);
+
+        if (isCommutative(templNode.op_type()) && templNode.input_size() == 2 && templNode.input(0) != templNode.input(1)) {
+            for (int swap = 0; swap < 2; ++swap) {
+                auto next = pending;
+                next.emplace_back(templNode.input(0), node->input(swap));
+                next.emplace_back(templNode.input(1), node->input(1 - swap));
+                if (solve(compiled, index, std::move(next), state, result)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        for (int i = 0; i < templNode.input_size(); ++i) {
+            if (!templNode.input(i).empty()) {
+                pending.emplace_back(templNode.input(i), node->input(i));
+            }
+        }
+    }
+    *result = std::move(state);
+    return true;
+}
+
+void PatternRewriter::run(const GraphIndex &index, FusionPlan *plan) const {
+    const auto &graph = index.graph();
+    for (const auto &compiled : mPatterns) {
+        const auto &pattern = compiled.pattern;
+        const auto &anchorTemplate = pattern.graph.node(compiled.anchor);
+        for (size_t anchor : index.nodesOfType(anchorTemplate.op_type())) {
+            const auto &anchorNode = graph.node(anchor);
+            if (plan->claimed(anchor) || compiled.anchorSlot >= anchorNode.output_size()) {
+                continue;
+            }
+            const auto &output = anchorNode.output(compiled.anchorSlot);
+            State state;
+            if (!solve(compiled, index, {{compiled.output, output}}, State(), &state)) {
+                continue;
+            }
+
+            // 插件只有一个输出，锚点的其他输出不能被使用
+            bool extraOutputs = false;
+            for (int i = 0; i < anchorNode.output_size(); ++i) {
+                const auto &other = anchorNode.output(i);
+                extraOutputs = extraOutputs || (i != compiled.anchorSlot && (!index.consumers(other).empty() || index.isGraphOutput(other)));
+            }
+            if (extraOutputs) {
+                continue;
+            }
+
+            PatternMatch match(index, mOpset);
+            match.mTensors = state.tensors;
+            for (const auto &item : state.nodes) {
+                match.mNodes[pattern.graph.node(item.first).name()] = item.second;
+            }
+
+            PluginReplacement replacement;
+            for (const auto &input : pattern.graph.input()) {
+                if (!match.tensor(input.name()).empty()) {
+                    replacement.inputs.push_back(match.tensor(input.name()));
+                }
+            }
+            for (const auto &initializer : pattern.graph.initializer()) {
+                // 带数据的常数是结构的一部分（例如 Pow 的指数），取到 info 中的标量也不再作为权重
+                bool captured = std::any_of(pattern.captures.begin(), pattern.captures.end(), [&](const SubgraphPattern::Capture &capture) {
+                    return capture.attribute.empty() && capture.node == initializer.name();
+                });
+                if (initializer.data_type() == ::onnx::TensorProto::UNDEFINED && !captured && !match.tensor(initializer.name()).empty()) {
+                    replacement.inputs.push_back(match.tensor(initializer.name()));
+                }
+            }
+
+            bool captured = true;
+            std::string info;
+            for (const auto &capture : pattern.captures) {
+                std::string value;
+                float scalar = 0;
+                if (!capture.attribute.empty()) {
+                    const auto *attr = match.mNodes.count(capture.node) ? match.attribute(capture.node, capture.attribute) : nullptr;
+                    value = attr ? attributeJson(*attr) : std::string();
+                } else if (index.constantScalar(match.tensor(capture.node), &scalar)) {
+                    char buffer[32];
+                    snprintf(buffer, sizeof(buffer), "%.9g", scalar);
+                    value = buffer;
+                }
+                captured = captured && !value.empty();
+                info += (info.empty() ? "{" : ", ") + ("\"" + capture.key + "\": ") + value;
+            }
+            replacement.info = info.empty() ? "{}" : info + "}";
+            if (!captured || (pattern.emit && !pattern.emit(match, &replacement))) {
+                continue;
+            }
+
+            std::vector<size_t> interior;
+            for (const auto &item : state.nodes) {
+                if (item.second != anchor) {
+                    interior.push_back(item.second);
+                }
+            }
+            commitMatch(index, interior, anchor, makePluginNode(anchorNode.name(), pattern.pluginName, replacement.info, replacement.inputs, {output}),
+                        plan);
+        }
+    }
+}
+
+static std::vector<SubgraphPattern> &pluginPatterns() {
+    static std::vector<SubgraphPattern> patterns;
+    return patterns;
+}
+
+bool registerPluginPattern(SubgraphPattern pattern) {
+    pluginPatterns().push_back(std::move(pattern));
+    return true;
+}
+
+const std::vector<SubgraphPattern> &registeredPluginPatterns() {
+    return pluginPatterns();
+}
+
+} // namespace onnx2trt
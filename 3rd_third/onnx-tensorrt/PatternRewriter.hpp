@@ -0,0 +1,149 @@
+#pragma once
+
+#include "PluginFusion.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace onnx2trt {
+
+/*
+ * 声明式的子图替换。模式是一个很小的 ONNX GraphProto：
+ *   - graph.input 是通配的张量，可以绑定到原图中任意张量，模板中多次使用时必须绑定到同一个张量；
+ *   - graph.initializer 必须绑定到原图中的常数，带数据时数值也要相同，不带数据（只有名字）时任意常数都可以；
+ *   - 节点的 op_type 必须相同，模板节点上写出的属性是约束，原图节点没有写时按 ONNX 的默认值比较，
+ *     opset 18 起 ReduceMean 等的 axes 改成了常数输入，两种写法都能匹配；
+ *   - Add、Mul 等可交换的节点两种输入顺序都会尝试；
+ *   - graph.output 只有一个，产生它的节点是锚点。
+ * 匹配时通过 GraphIndex 按锚点的 op_type 找到候选节点，再沿输入方向与模板比较，
+ * 每个候选的代价只与模板大小有关，所以整张图上是线性的。
+ *
+ * 匹配到的区域替换为一个 Plugin 节点：输入为绑定的通配张量和常数（按模板中的顺序，常数由 Plugin 导入函数作为权重），
+ * info 由 captures 取出的属性和标量常数组成，例如 {"epsilon": 1e-05}。需要额外检查或者换算时设置 emit。
+ */
+
+// 一次匹配的结果，模板中的名字映射到原图
+class PatternMatch {
+public:
+    PatternMatch(const GraphIndex &index, int64_t opset) :
+        mIndex(index), mOpset(opset) {
+    }
+
+    // 模板张量绑定到的原图张量，没有绑定时返回空串
+    const std::string &tensor(const std::string &name) const;
+    // 模板节点对应的原图节点
+    const ::onnx::NodeProto &node(const std::string &name) const;
+    // 原图节点的属性，没有写时取 ONNX 的默认值，都没有时返回 nullptr
+    const ::onnx::AttributeProto *attribute(const std::string &node, const std::string &name) const;
+
+    const GraphIndex &index() const {
+        return mIndex;
+    }
+    int64_t opset() const {
+        return mOpset;
+    }
+
+private:
+    friend class PatternRewriter;
+    const GraphIndex &mIndex;
+    int64_t mOpset;
+    std::unordered_map<std::string, std::string> mTensors;
+    std::unordered_map<std::string, size_t> mNodes;
+    mutable ::onnx::AttributeProto mDefault;
+};
+
+// 替换成的 Plugin 节点的输入和 info
+struct PluginReplacement {
+    std::vector<std::string> inputs;
+    std::string info;
+};
+
+struct SubgraphPattern {
+    std::string pluginName;
+    ::onnx::GraphProto graph;
+
+    // info 中的一项：attribute 不为空时取节点 node 的属性，否则 node 是一个标量常数的名字
+    struct Capture {
+        std::string key, node, attribute;
+    };
+    std::vector<Capture> captures;
+
+    // 可选，在默认的 inputs、info 生成之后调用，返回 false 表示放弃这次匹配
+    std::function<bool(const PatternMatch &match, PluginReplacement *replacement)> emit;
+};
+
+// 在 C++ 中写模式，节点名同时是它的输出张量名
+class PatternBuilder {
+public:
+    explicit PatternBuilder(const std::string &pluginName);
+
+    PatternBuilder &input(const std::string &name);
+    PatternBuilder &constant(const std::string &name);
+    PatternBuilder &constant(const std::string &name, float value);
+    PatternBuilder &node(const std::string &opType, const std::string &name, const std::vector<std::string> &inputs);
+
+    // 属性约束加在最后一个节点上
+    PatternBuilder &attrInt(const std::string &name, int64_t value);
+    PatternBuilder &attrFloat(const std::string &name, float value);
+    PatternBuilder &attrInts(const std::string &name, const std::vector<int64_t> &values);
+    PatternBuilder &attrString(const std::string &name, const std::string &value);
+
+    PatternBuilder &capture(const std::string &key, const std::string &node, const std::string &attribute);
+    PatternBuilder &captureConstant(const std::string &key, const std::string &constant);
+    PatternBuilder &emit(std::function<bool(const PatternMatch &, PluginReplacement *)> fn);
+
+    SubgraphPattern build(const std::string &output);
+
+private:
+    SubgraphPattern mPattern;
+};
+
+/*
+ * 从 .onnx 文件读取模式，可以在 python 中用 onnx.helper 写好模板保存。
+ * 插件名和 captures 写在 metadata_props 中：plugin = 插件名，capture.<key> = <节点名>:<属性名> 或者 <常数名>。
+ */
+bool loadPattern(const std::string &path, SubgraphPattern *pattern, std::string *error = nullptr);
+
+class PatternRewriter {
+public:
+    explicit PatternRewriter(int64_t opset) :
+        mOpset(opset) {
+    }
+
+    // 检查模板并建立索引，模板不合法时返回 false。先加入的模式优先，较大的模式应该先加入
+    bool add(SubgraphPattern pattern, std::string *error = nullptr);
+    void run(const GraphIndex &index, FusionPlan *plan) const;
+
+    size_t size() const {
+        return mPatterns.size();
+    }
+
+private:
+    struct Compiled {
+        SubgraphPattern pattern;
+        std::string output;
+        size_t anchor = 0;
+        int anchorSlot = 0;
+        std::unordered_map<std::string, std::pair<size_t, int>> producers; // 模板张量 -> (节点, 第几个输出)
+        std::unordered_map<std::string, int> constants;                        // 模板常数 -> graph.initializer 中的下标
+    };
+    struct State;
+
+    bool solve(const Compiled &compiled, const GraphIndex &index, std::vector<std::pair<std::string, std::string>> pending,
+               State state, State *result) const;
+    bool nodeMatches(const ::onnx::NodeProto &pattern, const ::onnx::NodeProto &node, const GraphIndex &index) const;
+
+    int64_t mOpset;
+    std::vector<Compiled> mPatterns;
+};
+
+// 插件在自己的源文件中注册模式（例如 static bool ok = registerPluginPattern(...)），解析时插件已注册才会匹配
+bool registerPluginPattern(SubgraphPattern pattern);
+const std::vector<SubgraphPattern> &registeredPluginPatterns();
+
+// ONNX 中属性的默认值，表中没有时返回 false
+bool onnxAttributeDefault(const std::string &opType, const std::string &name, int64_t opset, ::onnx::AttributeProto *value);
+
+} // namespace onnx2trt
@@ -0,0 +1,610 @@
+#include "PluginFusion.hpp"
+#include "PatternRewriter.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace onnx2trt {
+
+namespace {
+
+const std::vector<size_t> kNoNodes;
+
+// 数据在 typed 字段或者 raw_data 中，外部数据不处理
+template <typename T>
+bool readRawValues(const ::onnx::TensorProto &tensor, int64_t count, std::vector<float> *values) {
+    if (tensor.raw_data().size() != count * sizeof(T)) {
+        return false;
+    }
+    values->resize(count);
+    for (int64_t i = 0; i < count; ++i) {
+        T v;
+        std::memcpy(&v, tensor.raw_data().data() + i * sizeof(T), sizeof(T));
+        (*values)[i] = static_cast<float>(v);
+    }
+    return true;
+}
+
+template <typename Field>
+bool readTypedValues(const Field &field, int64_t count, std::vector<float> *values) {
+    if (field.size() != count) {
+        return false;
+    }
+    values->assign(field.begin(), field.end());
+    return true;
+}
+
+} // namespace
+
+const ::onnx::AttributeProto *findAttribute(const ::onnx::NodeProto &node, const std::string &name) {
+    for (const auto &attr : node.attribute()) {
+        if (attr.name() == name) {
+            return &attr;
+        }
+    }
+    return nullptr;
+}
+
+bool tensorValues(const ::onnx::TensorProto &tensor, std::vector<float> *values) {
+    int64_t count = 1;
+    for (auto dim : tensor.dims()) {
+        count *= dim;
+    }
+
+    switch (tensor.data_type()) {
+    case ::onnx::TensorProto::FLOAT: return readTypedValues(tensor.float_data(), count, values) || readRawValues<float>(tensor, count, values);
+    case ::onnx::TensorProto::DOUBLE: return readTypedValues(tensor.double_data(), count, values) || readRawValues<double>(tensor, count, values);
+    case ::onnx::TensorProto::INT64: return readTypedValues(tensor.int64_data(), count, values) || readRawValues<int64_t>(tensor, count, values);
+    case ::onnx::TensorProto::INT32: return readTypedValues(tensor.int32_data(), count, values) || readRawValues<int32_t>(tensor, count, values);
+    default: return false;
+    }
+}
+
+GraphIndex::GraphIndex(const ::onnx::GraphProto &graph) :
+    mGraph(graph) {
+    for (const auto &initializer : graph.initializer()) {
+        mInitializers[initializer.name()] = &initializer;
+    }
+    for (const auto &output : graph.output()) {
+        mGraphOutputs.insert(output.name());
+    }
+    for (const auto *infos : {&graph.input(), &graph.value_info(), &graph.output()}) {
+        for (const auto &info : *infos) {
+            mValueInfos[info.name()] = &info;
+        }
+    }
+    for (int i = 0; i < graph.node_size(); ++i) {
+        const auto &node = graph.node(i);
+        mNodesOfType[node.op_type()].push_back(i);
+        for (const auto &input : node.input()) {
+            // Mul(x, x) 这样同一个张量用两次时只记一次
+            auto &users = mConsumers[input];
+            if (!input.empty() && (users.empty() || users.back() != static_cast<size_t>(i))) {
+                users.push_back(i);
+            }
+        }
+        for (const auto &output : node.output()) {
+            if (!output.empty()) {
+                mProducers[output] = i;
+            }
+        }
+    }
+}
+
+const ::onnx::NodeProto *GraphIndex::producer(const std::string &tensor, size_t *nodeIndex) const {
+    auto iter = mProducers.find(tensor);
+    if (iter == mProducers.end()) {
+        return nullptr;
+    }
+    if (nodeIndex) {
+        *nodeIndex = iter->second;
+    }
+    return &mGraph.node(iter->second);
+}
+
+const std::vector<size_t> &GraphIndex::consumers(const std::string &tensor) const {
+    auto iter = mConsumers.find(tensor);
+    return iter == mConsumers.end() ? kNoNodes : iter->second;
+}
+
+const std::vector<size_t> &GraphIndex::nodesOfType(const std::string &opType) const {
+    auto iter = mNodesOfType.find(opType);
+    return iter == mNodesOfType.end() ? kNoNodes : iter->second;
+}
+
+bool GraphIndex::isGraphOutput(const std::string &tensor) const {
+    return mGraphOutputs.count(tensor) > 0;
+}
+
+bool GraphIndex::isConstant(const std::string &tensor) const {
+    if (mInitializers.count(tensor)) {
+        return true;
+    }
+    const auto *node = producer(tensor);
+    return node && node->op_type() == "Constant";
+}
+
+bool GraphIndex::constantTensor(const std::string &tensor, std::vector<float> *values, std::vector<int64_t> *dims) const {
+    const ::onnx::TensorProto *proto = nullptr;
+    auto iter = mInitializers.find(tensor);
+    if (iter != mInitializers.end()) {
+        proto = iter->second;
+    } else if (const auto *node = producer(tensor)) {
+        if (node->op_type() != "Constant") {
+            return false;
+        }
+        if (const auto *attr = findAttribute(*node, "value")) {
+            proto = attr->has_t() ? &attr->t() : nullptr;
+        } else if (const auto *attr = findAttribute(*node, "value_float")) {
+            values->assign(1, attr->f());
+            if (dims) {
+                dims->clear();
+            }
+            return true;
+        }
+    }
+    if (!proto || !tensorValues(*proto, values)) {
+        return false;
+    }
+    if (dims) {
+        dims->assign(proto->dims().begin(), proto->dims().end());
+    }
+    return true;
+}
+
+bool GraphIndex::constantScalar(const std::string &tensor, float *value) const {
+    std::vector<float> values;
+    if (!constantTensor(tensor, &values) || values.size() != 1) {
+        return false;
+    }
+    *value = values[0];
+    return true;
+}
+
+bool GraphIndex::tensorShape(const std::string &tensor, std::vector<TensorDim> *shape) const {
+    auto iter = mValueInfos.find(tensor);
+    if (iter == mValueInfos.end() || !iter->second->type().has_tensor_type() || !iter->second->type().tensor_type().has_shape()) {
+        std::vector<float> values;
+        std::vector<int64_t> dims;
+        if (!constantTensor(tensor, &values, &dims)) {
+            return false;
+        }
+        shape->clear();
+        for (int64_t dim : dims) {
+            shape->push_back({dim, ""});
+        }
+        return true;
+    }
+
+    shape->clear();
+    for (const auto &dim : iter->second->type().tensor_type().shape().dim()) {
+        shape->push_back(dim.has_dim_value() ? TensorDim{dim.dim_value(), ""} : TensorDim{-1, dim.dim_param()});
+    }
+    return true;
+}
+
+bool onlyUsedBy(const GraphIndex &index, const std::string &tensor, size_t consumer) {
+    const auto &users = index.consumers(tensor);
+    return users.size() == 1 && users[0] == consumer && !index.isGraphOutput(tensor);
+}
+
+bool usedOnlyWithin(const GraphIndex &index, const std::string &tensor, const std::vector<size_t> &nodes) {
+    if (index.isGraphOutput(tensor)) {
+        return false;
+    }
+    for (size_t user : index.consumers(tensor)) {
+        if (std::find(nodes.begin(), nodes.end(), user) == nodes.end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool commitMatch(const GraphIndex &index, const std::vector<size_t> &interior, size_t anchor, ::onnx::NodeProto pluginNode,
+                 FusionPlan *plan) {
+    std::vector<size_t> nodes(interior);
+    nodes.push_back(anchor);
+    for (size_t i : nodes) {
+        if (plan->claimed(i)) {
+            return false;
+        }
+    }
+    for (size_t i : interior) {
+        for (const auto &output : index.graph().node(i).output()) {
+            if (!output.empty() && !usedOnlyWithin(index, output, nodes)) {
+                return false;
+            }
+        }
+    }
+    plan->replaced[anchor] = std::move(pluginNode);
+    plan->removed.insert(interior.begin(), interior.end());
+    return true;
+}
+
+::onnx::NodeProto makePluginNode(const std::string &nodeName, const std::string &pluginName, const std::string &info,
+                                 const std::vector<std::string> &inputs, const std::vector<std::string> &outputs) {
+    ::onnx::NodeProto node;
+    node.set_name(nodeName);
+    node.set_op_type("Plugin");
+    for (const auto &input : inputs) {
+        node.add_input(input);
+    }
+    for (const auto &output : outputs) {
+        node.add_output(output);
+    }
+
+    auto *name = node.add_attribute();
+    name->set_name("name");
+    name->set_type(::onnx::AttributeProto::STRING);
+    name->set_s(pluginName);
+
+    auto *attr = node.add_attribute();
+    attr->set_name("info");
+    attr->set_type(::onnx::AttributeProto::STRING);
+    attr->set_s(info);
+    return node;
+}
+
+namespace {
+
+// perm 是否只交换最后两维
+bool swapsLastTwoAxes(const ::onnx::NodeProto &transpose) {
+    const auto *perm = findAttribute(transpose, "perm");
+    if (!perm || perm->ints_size() < 2) {
+        return false;
+    }
+    int rank = perm->ints_size();
+    for (int i = 0; i < rank - 2; ++i) {
+        if (perm->ints(i) != i) {
+            return false;
+        }
+    }
+    return perm->ints(rank - 2) == rank - 1 && perm->ints(rank - 1) == rank - 2;
+}
+
+// 两个维度一定相等：长度已知且相同，或者是同一个 dim_param
+bool sameDim(const TensorDim &a, const TensorDim &b) {
+    if (a.value >= 0 || b.value >= 0) {
+        return a.value == b.value;
+    }
+    return !a.param.empty() && a.param == b.param;
+}
+
+// 与 fused-attention.hpp 中的 ATTENTION_MAX_HEAD_DIM 一致
+const int64_t kAttentionMaxHeadDim = 128;
+
+/*
+ * FusedAttention 能处理的形状：Q、K、V 的秩相同且在 2~4 之间，前面的批次维相同，head_dim、value_dim 已知且不超过 128，
+ * 掩码的秩不超过 Q，每一维是 1 或者与 [..., Sq, Sk] 对应的维相同。MatMul 允许广播，这些条件不能由子图本身保证，
+ * 形状没有记录或者不满足时不融合。K 的 head_dim 与 V 的序列长度由两个 MatMul 保证一致。
+ */
+bool attentionShapesFit(const PatternMatch &match, bool keyTransposed, bool masked) {
+    const auto &index = match.index();
+    std::vector<TensorDim> q, k, v;
+    if (!index.tensorShape(match.tensor("q"), &q) || !index.tensorShape(match.tensor("k"), &k) || !index.tensorShape(match.tensor("v"), &v)) {
+        return false;
+    }
+    size_t rank = q.size();
+    if (rank < 2 || rank > 4 || k.size() != rank || v.size() != rank) {
+        return false;
+    }
+    for (size_t i = 0; i + 2 < rank; ++i) {
+        if (!sameDim(q[i], k[i]) || !sameDim(q[i], v[i])) {
+            return false;
+        }
+    }
+    for (int64_t dim : {q[rank - 1].value, v[rank - 1].value}) {
+        if (dim < 1 || dim > kAttentionMaxHeadDim) {
+            return false;
+        }
+    }
+    if (!masked) {
+        return true;
+    }
+
+    std::vector<TensorDim> mask, target(q.begin(), q.end() - 1);
+    target.push_back(keyTransposed ? k[rank - 1] : k[rank - 2]);
+    if (!index.tensorShape(match.tensor("mask"), &mask) || mask.size() > rank) {
+        return false;
+    }
+    for (size_t i = 0; i < mask.size(); ++i) {
+        const auto &dim = mask[mask.size() - 1 - i];
+        if (dim.value != 1 && !sameDim(dim, target[rank - 1 - i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * 仿射变换的常数形状：LayerNorm、RMSNorm 为 [..., 1, D]，GroupNorm 为 [C, 1, ...]，对齐到秩为 rank 的 [N, C, ...] 的通道。
+ * 长度必须等于归一化的那一维，标量或者长度为 1 的常数靠广播作用到整行，插件按逐元素的权重读取，不能融合。
+ */
+bool affineFits(const GraphIndex &index, const std::string &tensor, size_t rank, int64_t length, bool perChannel) {
+    std::vector<float> values;
+    std::vector<int64_t> dims;
+    if (tensor.empty()) {
+        return true;
+    }
+    if (!index.constantTensor(tensor, &values, &dims) || dims.empty() || static_cast<int64_t>(values.size()) != length) {
+        return false;
+    }
+    if (perChannel) {
+        return dims.size() + 1 == rank && std::all_of(dims.begin() + 1, dims.end(), [](int64_t d) { return d == 1; });
+    }
+    return dims.size() <= rank && std::all_of(dims.begin(), dims.end() - 1, [](int64_t d) { return d == 1; });
+}
+
+/*
+ * 归一化结果后面可选的 Mul(gamma) -> Add(beta)，affine 为 0、1、2 时分别没有、只有 gamma、gamma 和 beta，
+ * 返回最后的张量名。没有 gamma 时不接 beta，插件按 [x, gamma, beta] 的顺序取权重。
+ */
+std::string affineTail(PatternBuilder &builder, const std::string &normalized, int affine) {
+    if (affine >= 1) {
+        builder.node("Mul", "scaled", {normalized, "gamma"});
+    }
+    if (affine >= 2) {
+        builder.node("Add", "shifted", {"scaled", "beta"});
+    }
+    return affine == 0 ? normalized : (affine == 1 ? "scaled" : "shifted");
+}
+
+void affineConstants(PatternBuilder &builder, int affine) {
+    if (affine >= 1) {
+        builder.constant("gamma");
+    }
+    if (affine >= 2) {
+        builder.constant("beta");
+    }
+}
+
+// gamma、beta 的长度与 x 的最后一维（GroupNorm 为通道数 C）相同，x 的形状没有记录时不融合
+bool affineMatches(const PatternMatch &match, bool perChannel) {
+    const auto &index = match.index();
+    if (match.tensor("gamma").empty()) {
+        return true;
+    }
+    std::vector<TensorDim> shape;
+    if (!index.tensorShape(match.tensor("x"), &shape) || shape.size() < (perChannel ? 2u : 1u)) {
+        return false;
+    }
+    int64_t length = perChannel ? shape[1].value : shape.back().value;
+    return length > 0 && affineFits(index, match.tensor("gamma"), shape.size(), length, perChannel)
+        && affineFits(index, match.tensor("beta"), shape.size(), length, perChannel);
+}
+
+/*
+ * 注意力：MatMul(Q, K^T) -> [Div/Mul 标量] -> [Add 掩码] -> Softmax(axis=-1) -> MatMul(., V)，
+ * 替换为 FusedAttention，输入为 Q、K、V 和可选的加性掩码。
+ * K^T 来自交换最后两维的 Transpose 时直接使用 Transpose 之前的 K，否则按 [..., D, Sk] 读取（key_transposed = 1）。
+ * opset 13 之前 Softmax 的默认 axis 是 1，会把之后的维度展平，只有写明 axis=-1 时才能融合。
+ */
+std::vector<SubgraphPattern> attentionPatterns() {
+    std::vector<SubgraphPattern> patterns;
+    for (bool masked : {true, false}) {
+        for (std::string scaleOp : {"Div", "Mul", ""}) {
+            for (bool transposed : {true, false}) {
+                PatternBuilder builder("FusedAttention");
+                builder.input("q").input("k").input("v");
+                if (masked) {
+                    builder.input("mask");
+                }
+                if (!scaleOp.empty()) {
+                    builder.constant("scale");
+                }
+                if (transposed) {
+                    builder.node("Transpose", "key", {"k"});
+                }
+                builder.node("MatMul", "scores", {"q", transposed ? "key" : "k"});
+                std::string scores = "scores";
+                if (!scaleOp.empty()) {
+                    builder.node(scaleOp, "scaled", {scores, "scale"});
+                    scores = "scaled";
+                }
+                if (masked) {
+                    builder.node("Add", "masked", {scores, "mask"});
+                    scores = "masked";
+                }
+                builder.node("Softmax", "probs", {scores}).attrInt("axis", -1);
+                builder.node("MatMul", "output", {"probs", "v"});
+
+                builder.emit([=](const PatternMatch &match, PluginReplacement *replacement) {
+                    const auto &index = match.index();
+                    // Plugin 导入时常量会被当作权重，只有掩码可以是常量
+                    for (const char *name : {"q", "k", "v"}) {
+                        if (index.isConstant(match.tensor(name))) {
+                            return false;
+                        }
+                    }
+                    if (transposed && !swapsLastTwoAxes(match.node("key"))) {
+                        return false;
+                    }
+                    if (!attentionShapesFit(match, !transposed, masked)) {
+                        return false;
+                    }
+                    float scale = 1.0f, value = 0;
+                    if (!scaleOp.empty()) {
+                        if (!index.constantScalar(match.tensor("scale"), &value) || (scaleOp == "Div" && value == 0)) {
+                            return false;
+                        }
+                        scale = scaleOp == "Div" ? 1.0f / value : value;
+                    }
+
+                    char info[128];
+                    snprintf(info, sizeof(info), "{\"scale\": %.9g, \"key_transposed\": %d, \"causal\": 0}", scale, transposed ? 0 : 1);
+                    replacement->info = info;
+                    replacement->inputs = {match.tensor("q"), match.tensor("k"), match.tensor("v")};
+                    if (masked) {
+                        replacement->inputs.push_back(match.tensor("mask"));
+                    }
+                    return true;
+                });
+                patterns.push_back(builder.build("output"));
+            }
+        }
+    }
+    return patterns;
+}
+
+/*
+ * LayerNorm：d = x - mean(x)，d / sqrt(mean(d^2) + eps)，再接可选的 gamma、beta，均值在最后一维上求。
+ * opset 17 的 LayerNormalization 没有对应的导入函数，也替换成 FusedLayerNorm。
+ */
+std::vector<SubgraphPattern> layerNormPatterns() {
+    std::vector<SubgraphPattern> patterns;
+    for (bool pow : {true, false}) {
+        for (int affine : {2, 1, 0}) {
+            PatternBuilder builder("FusedLayerNorm");
+            builder.input("x").constant("eps");
+            affineConstants(builder, affine);
+            builder.node("ReduceMean", "mean", {"x"}).attrInts("axes", {-1}).attrInt("keepdims", 1);
+            builder.node("Sub", "centered", {"x", "mean"});
+            if (pow) {
+                builder.constant("two", 2.0f).node("Pow", "square", {"centered", "two"});
+            } else {
+                builder.node("Mul", "square", {"centered", "centered"});
+            }
+            builder.node("ReduceMean", "variance", {"square"}).attrInts("axes", {-1}).attrInt("keepdims", 1);
+            builder.node("Add", "biased", {"variance", "eps"});
+            builder.node("Sqrt", "stddev", {"biased"});
+            builder.node("Div", "normalized", {"centered", "stddev"});
+            std::string output = affineTail(builder, "normalized", affine);
+            builder.captureConstant("epsilon", "eps").emit([](const PatternMatch &match, PluginReplacement *) { return affineMatches(match, false); });
+            patterns.push_back(builder.build(output));
+        }
+    }
+
+    for (bool bias : {true, false}) {
+        PatternBuilder builder("FusedLayerNorm");
+        builder.input("x").constant("gamma");
+        if (bias) {
+            builder.constant("beta");
+        }
+        builder.node("LayerNormalization", "normalized", bias ? std::vector<std::string>{"x", "gamma", "beta"} : std::vector<std::string>{"x", "gamma"})
+            .attrInt("axis", -1);
+        builder.capture("epsilon", "normalized", "epsilon").emit([](const PatternMatch &match, PluginReplacement *) { return affineMatches(match, false); });
+        patterns.push_back(builder.build("normalized"));
+    }
+    return patterns;
+}
+
+// RMSNorm：x / sqrt(mean(x^2) + eps)，或者 x * (1 / sqrt(...))、x * Reciprocal(sqrt(...))，再接可选的 gamma、beta
+std::vector<SubgraphPattern> rmsNormPatterns() {
+    std::vector<SubgraphPattern> patterns;
+    for (bool pow : {true, false}) {
+        for (std::string inverse : {"", "Div", "Reciprocal"}) {
+            for (int affine : {2, 1, 0}) {
+                PatternBuilder builder("FusedRMSNorm");
+                builder.input("x").constant("eps");
+                affineConstants(builder, affine);
+                if (pow) {
+                    builder.constant("two", 2.0f).node("Pow", "square", {"x", "two"});
+                } else {
+                    builder.node("Mul", "square", {"x", "x"});
+                }
+                builder.node("ReduceMean", "variance", {"square"}).attrInts("axes", {-1}).attrInt("keepdims", 1);
+                builder.node("Add", "biased", {"variance", "eps"});
+                builder.node("Sqrt", "stddev", {"biased"});
+                if (inverse.empty()) {
+                    builder.node("Div", "normalized", {"x", "stddev"});
+                } else {
+                    if (inverse == "Div") {
+                        builder.constant("one", 1.0f).node("Div", "inverse", {"one", "stddev"});
+                    } else {
+                        builder.node("Reciprocal", "inverse", {"stddev"});
+                    }
+                    builder.node("Mul", "normalized", {"x", "inverse"});
+                }
+                std::string output = affineTail(builder, "normalized", affine);
+                builder.captureConstant("epsilon", "eps").emit([](const PatternMatch &match, PluginReplacement *) { return affineMatches(match, false); });
+                patterns.push_back(builder.build(output));
+            }
+        }
+    }
+    return patterns;
+}
+
+/*
+ * torch 导出的 GroupNorm：Reshape(x, [0, G, -1]) -> InstanceNormalization(scale=1, bias=0) -> Reshape(., Shape(x)) -> Mul -> Add。
+ * 静态导出时 Shape(x) 被折叠成常数，只能假定它就是 x 的形状。
+ */
+std::vector<SubgraphPattern> groupNormPatterns() {
+    std::vector<SubgraphPattern> patterns;
+    for (bool shapeOfX : {true, false}) {
+        for (int affine : {2, 1, 0}) {
+            PatternBuilder builder("FusedGroupNorm");
+            builder.input("x").constant("group_shape").constant("ones").constant("zeros");
+            affineConstants(builder, affine);
+            if (shapeOfX) {
+                builder.node("Shape", "shape", {"x"});
+            } else {
+                builder.input("shape");
+            }
+            builder.node("Reshape", "grouped", {"x", "group_shape"});
+            builder.node("InstanceNormalization", "instance", {"grouped", "ones", "zeros"});
+            builder.node("Reshape", "restored", {"instance", "shape"});
+            std::string output = affineTail(builder, "restored", affine);
+            builder.capture("epsilon", "instance", "epsilon");
+            builder.emit([shapeOfX](const PatternMatch &match, PluginReplacement *replacement) {
+                const auto &index = match.index();
+                std::vector<float> scale, bias, groupShape;
+                if (!index.constantTensor(match.tensor("ones"), &scale) || !index.constantTensor(match.tensor("zeros"), &bias)
+                    || !index.constantTensor(match.tensor("group_shape"), &groupShape) || scale.empty() || scale.size() != bias.size()) {
+                    return false;
+                }
+                if (!std::all_of(scale.begin(), scale.end(), [](float v) { return v == 1.0f; })
+                    || !std::all_of(bias.begin(), bias.end(), [](float v) { return v == 0.0f; })) {
+                    return false;
+                }
+                int groups = static_cast<int>(scale.size());
+                if (groupShape.size() != 3 || groupShape[1] != groups || !affineMatches(match, true)) {
+                    return false;
+                }
+                if (!shapeOfX && !index.isConstant(match.tensor("shape"))) {
+                    return false;
+                }
+
+                replacement->info.back() = ',';
+                replacement->info += " \"groups\": " + std::to_string(groups) + "}";
+                replacement->inputs = {match.tensor("x")};
+                for (const char *name : {"gamma", "beta"}) {
+                    if (!match.tensor(name).empty()) {
+                        replacement->inputs.push_back(match.tensor(name));
+                    }
+                }
+                return true;
+            });
+            patterns.push_back(builder.build(output));
+        }
+    }
+    return patterns;
+}
+
+} // namespace
+
+FusionPlan planPluginFusion(const ::onnx::GraphProto &graph, int64_t opset, const PluginAvailable &available) {
+    PatternRewriter rewriter(opset);
+    auto addPatterns = [&](const std::vector<SubgraphPattern> &patterns) {
+        for (const auto &pattern : patterns) {
+            std::string error;
+            if (available(pattern.pluginName) && !rewriter.add(pattern, &error)) {
+                printf("Invalid fusion pattern, %s\n", error.c_str());
+            }
+        }
+    };
+
+    // 先加入的模式优先：LayerNorm 在 RMSNorm 之前，RMSNorm 的形状是它的一部分；插件自己注册的模式最后
+    addPatterns(attentionPatterns());
+    addPatterns(layerNormPatterns());
+    addPatterns(rmsNormPatterns());
+    addPatterns(groupNormPatterns());
+    addPatterns(registeredPluginPatterns());
+
+    FusionPlan plan;
+    GraphIndex index(graph);
+    rewriter.run(index, &plan);
+    return plan;
+}
+
+} // namespace onnx2trt
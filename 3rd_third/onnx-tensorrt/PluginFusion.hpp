@@ -0,0 +1,93 @@
+#pragma once
+
+#include <onnx/onnx_pb.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace onnx2trt {
+
+/*
+ * 导出的 ONNX 中，注意力这样的算子会被拆成 MatMul/Softmax/MatMul 等小算子，逐个导入后每一层都要读写一次显存。
+ * parseGraph 分发节点之前先在图上匹配这些子图，把匹配到的区域替换成一个 "Plugin" 节点，
+ * 由 builtin_op_importers.cpp 中的 Plugin 导入函数创建对应的 ONNXPlugin::TRTPlugin。
+ * 要匹配的子图写成 PatternRewriter.hpp 中的模式：内置注意力、LayerNorm、RMSNorm、GroupNorm，插件也可以注册自己的模式。
+ * 这里只依赖 protobuf，不依赖 TensorRT，可以单独测试。
+ */
+
+// 张量形状的一维，长度未知时 value 为 -1，param 为 dim_param 的符号名（可能为空）
+struct TensorDim {
+    int64_t value;
+    std::string param;
+};
+
+// 图的索引：张量由哪个节点产生、被哪些节点使用，节点按 op_type 分组，匹配时不需要遍历整张图
+class GraphIndex {
+public:
+    explicit GraphIndex(const ::onnx::GraphProto &graph);
+
+    // 产生 tensor 的节点，图输入和权重返回 nullptr
+    const ::onnx::NodeProto *producer(const std::string &tensor, size_t *nodeIndex = nullptr) const;
+    const std::vector<size_t> &consumers(const std::string &tensor) const;
+    const std::vector<size_t> &nodesOfType(const std::string &opType) const;
+    bool isGraphOutput(const std::string &tensor) const;
+
+    // 权重或者 Constant 节点的输出
+    bool isConstant(const std::string &tensor) const;
+    // 常数张量的值（float/double/int32/int64 都转成 float）和形状
+    bool constantTensor(const std::string &tensor, std::vector<float> *values, std::vector<int64_t> *dims = nullptr) const;
+    // 只有一个元素的常数
+    bool constantScalar(const std::string &tensor, float *value) const;
+    // 图输入输出、value_info 中记录的形状，常数取自身的 dims，都没有时返回 false
+    bool tensorShape(const std::string &tensor, std::vector<TensorDim> *shape) const;
+
+    const ::onnx::GraphProto &graph() const {
+        return mGraph;
+    }
+
+private:
+    const ::onnx::GraphProto &mGraph;
+    std::unordered_map<std::string, size_t> mProducers;
+    std::unordered_map<std::string, std::vector<size_t>> mConsumers;
+    std::unordered_map<std::string, std::vector<size_t>> mNodesOfType;
+    std::unordered_map<std::string, const ::onnx::TensorProto *> mInitializers;
+    std::unordered_set<std::string> mGraphOutputs;
+    std::unordered_map<std::string, const ::onnx::ValueInfoProto *> mValueInfos;
+};
+
+// 融合结果：removed 中的节点不再导入，replaced 中的节点导入时替换成对应的 Plugin 节点
+struct FusionPlan {
+    std::unordered_set<size_t> removed;
+    std::unordered_map<size_t, ::onnx::NodeProto> replaced;
+
+    // 节点是否已经属于某个匹配，不同的匹配不能共用节点
+    bool claimed(size_t nodeIndex) const {
+        return removed.count(nodeIndex) || replaced.count(nodeIndex);
+    }
+};
+
+// 插件是否已经注册，由调用方提供，测试时可以直接返回 true
+using PluginAvailable = std::function<bool(const std::string &pluginName)>;
+
+FusionPlan planPluginFusion(const ::onnx::GraphProto &graph, int64_t opset, const PluginAvailable &available);
+
+// 节点的属性，没有时返回 nullptr
+const ::onnx::AttributeProto *findAttribute(const ::onnx::NodeProto &node, const std::string &name);
+// 张量的数据（float/double/int32/int64 都转成 float），外部数据不支持
+bool tensorValues(const ::onnx::TensorProto &tensor, std::vector<float> *values);
+
+// 内部张量只能在匹配区域内使用，不能是图的输出，否则不能融合
+bool onlyUsedBy(const GraphIndex &index, const std::string &tensor, size_t consumer);
+bool usedOnlyWithin(const GraphIndex &index, const std::string &tensor, const std::vector<size_t> &nodes);
+
+// 检查 interior 的输出只在匹配区域内使用、节点没有被其他匹配占用，然后记录到 plan 中，anchor 替换为 pluginNode
+bool commitMatch(const GraphIndex &index, const std::vector<size_t> &interior, size_t anchor, ::onnx::NodeProto pluginNode,
+                 FusionPlan *plan);
+
+// 生成 Plugin 节点，name、info 与 Plugin 导入函数读取的属性一致
+::onnx::NodeProto makePluginNode(const std::string &nodeName, const std::string &pluginName, const std::string &info,
+                                 const std::vector<std::string> &inputs, const std::vector<std::string> &outputs);
+
+} // namespace onnx2trt
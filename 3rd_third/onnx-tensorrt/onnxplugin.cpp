@@ -4,6 +4,7 @@
 #include <string>
 #include <assert.h>
 #include <string.h>
+#include <stdlib.h>
 
 using namespace nvinfer1;
 using namespace std;
@@ -254,6 +255,18 @@ void LayerConfig::setup(const std::string &info, const std::vector<std::shared_p
     this->weights_ = weights;
 }
 
+float info_float(const std::string &info, const std::string &key, float default_value) {
+    auto pos = info.find("\"" + key + "\"");
+    if (pos == std::string::npos) { return default_value; }
+    pos = info.find(':', pos + key.size() + 2);
+    if (pos == std::string::npos) { return default_value; }
+
+    const char *begin = info.c_str() + pos + 1;
+    char *end = nullptr;
+    float value = strtof(begin, &end);
+    return end == begin ? default_value : value;
+}
+
 static DataType convert_trt_datatype(nvinfer1::DataType dt) {
     switch (dt) {
     case nvinfer1::DataType::kFLOAT: return DataType::Float32;
@@ -239,6 +239,9 @@ struct LayerConfig {
     }
 };
 
+// 从 info 字符串（json 格式，例如 {"scale": 0.125}）中读取数值属性，没有这个属性时返回 default_value
+float info_float(const std::string &info, const std::string &key, float default_value);
+
 /*
  * class MyPlugin : public nvinfer1::IPluginV2DynamicExt {
  * public:
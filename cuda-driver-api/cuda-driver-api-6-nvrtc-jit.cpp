@@ -0,0 +1,185 @@
+#include "cuda-driver-api.h"
+#include "kernel-jit.h"
+#include "utils.h"
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+/*
+ * 运行时特化核函数（kernel-jit.h）：
+ *   1. 按两个模型（80 类、20 类）的常量生成 decode 核函数，按 tile 16、32 生成矩阵乘法，用 NVRTC 编译；
+ *   2. 第二个 KernelJit（相当于程序重新启动）从磁盘缓存读取，不再编译；架构不同 key 不同；缓存文件损坏时重新编译；
+ *   3. 有 GPU 时用 cuModuleLoadData 加载，cuLaunchKernel 启动，与 CPU 的结果比较。
+ * 编译和缓存不需要 GPU，没有设备时跳过第 3 步。
+ */
+
+static bool check(bool ok, const char *what) {
+    printf("%-60s %s\n", what, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static int cpu_decode(const std::vector<float> &predict, int num_bboxes, const DecodeKernelSpec &spec) {
+    int count = 0;
+    for (int i = 0; i < num_bboxes; ++i) {
+        const float *item = predict.data() + i * (5 + spec.num_classes);
+        if (item[4] < spec.confidence_threshold) { continue; }
+        float confidence = item[5];
+        for (int c = 1; c < spec.num_classes; ++c) { confidence = item[5 + c] > confidence ? item[5 + c] : confidence; }
+        if (confidence * item[4] >= spec.confidence_threshold) { count++; }
+    }
+    return count;
+}
+
+static bool run_decode(const JitImage &image, const DecodeKernelSpec &spec) {
+    CUmodule module = nullptr;
+    CUfunction function = nullptr;
+    if (!load_jit_module(image, "decode_kernel", &module, &function)) { return false; }
+
+    const int num_bboxes = 2000, max_objects = 1024;
+    std::vector<float> predict(num_bboxes * (5 + spec.num_classes));
+    srand(spec.num_classes);
+    for (auto &value : predict) { value = rand() / (float)RAND_MAX; }
+
+    CUdeviceptr predict_device = 0, parray_device = 0;
+    size_t parray_bytes = (1 + max_objects * spec.num_box_element) * sizeof(float);
+    checkDriver(cuMemAlloc(&predict_device, predict.size() * sizeof(float)));
+    checkDriver(cuMemAlloc(&parray_device, parray_bytes));
+    checkDriver(cuMemcpyHtoD(predict_device, predict.data(), predict.size() * sizeof(float)));
+    checkDriver(cuMemsetD8(parray_device, 0, parray_bytes));
+
+    int bboxes = num_bboxes, objects = max_objects;
+    void *args[] = {&predict_device, &bboxes, &parray_device, &objects};
+    checkDriver(cuLaunchKernel(function, (num_bboxes + 255) / 256, 1, 1, 256, 1, 1, 0, nullptr, args, nullptr));
+    checkDriver(cuCtxSynchronize());
+
+    float count = 0;
+    checkDriver(cuMemcpyDtoH(&count, parray_device, sizeof(float)));
+    int expected = cpu_decode(predict, num_bboxes, spec);
+    printf("decode %d classes: %d boxes, cpu %d\n", spec.num_classes, (int)count, expected);
+
+    checkDriver(cuMemFree(parray_device));
+    checkDriver(cuMemFree(predict_device));
+    checkDriver(cuModuleUnload(module));
+    return (int)count == expected;
+}
+
+static bool run_gemm(const JitImage &image, int block_size) {
+    CUmodule module = nullptr;
+    CUfunction function = nullptr;
+    if (!load_jit_module(image, "gemm_tile", &module, &function)) { return false; }
+
+    int m = 100, n = 70, k = 90;
+    std::vector<float> A(m * n), B(n * k), C(m * k), reference(m * k, 0);
+    for (int i = 0; i < m * n; ++i) { A[i] = (i % 13) * 0.1f; }
+    for (int i = 0; i < n * k; ++i) { B[i] = (i % 7) * 0.2f; }
+    for (int r = 0; r < m; ++r) {
+        for (int j = 0; j < n; ++j) {
+            for (int c = 0; c < k; ++c) { reference[r * k + c] += A[r * n + j] * B[j * k + c]; }
+        }
+    }
+
+    CUdeviceptr a = 0, b = 0, c = 0;
+    checkDriver(cuMemAlloc(&a, A.size() * sizeof(float)));
+    checkDriver(cuMemAlloc(&b, B.size() * sizeof(float)));
+    checkDriver(cuMemAlloc(&c, C.size() * sizeof(float)));
+    checkDriver(cuMemcpyHtoD(a, A.data(), A.size() * sizeof(float)));
+    checkDriver(cuMemcpyHtoD(b, B.data(), B.size() * sizeof(float)));
+
+    void *args[] = {&a, &b, &c, &m, &n, &k};
+    checkDriver(cuLaunchKernel(function, (k + block_size - 1) / block_size, (m + block_size - 1) / block_size, 1,
+                               block_size, block_size, 1, 0, nullptr, args, nullptr));
+    checkDriver(cuCtxSynchronize());
+    checkDriver(cuMemcpyDtoH(C.data(), c, C.size() * sizeof(float)));
+
+    float max_error = 0;
+    for (int i = 0; i < m * k; ++i) { max_error = fmaxf(max_error, fabsf(C[i] - reference[i])); }
+    printf("gemm tile %d: max error %g\n", block_size, max_error);
+
+    checkDriver(cuMemFree(c));
+    checkDriver(cuMemFree(b));
+    checkDriver(cuMemFree(a));
+    checkDriver(cuModuleUnload(module));
+    return max_error < 1e-3f;
+}
+
+void cuda_driver_api_6_nvrtc_jit() {
+    bool ok = true;
+    const char *cache_dir = "jit-cache/driver-api-6";
+    printf("NVRTC version %d\n", nvrtc_version());
+
+    // 有设备时按设备的架构编译，否则按 sm_75 演示编译和缓存
+    CUcontext context = nullptr;
+    int arch = 75;
+    bool has_device = cuInit(0) == CUDA_SUCCESS && checkDriver(cuCtxCreate(&context, CU_CTX_SCHED_AUTO, 0));
+    if (has_device) { arch = current_device_arch(); }
+
+    DecodeKernelSpec coco, voc;
+    voc.num_classes = 20;
+    voc.confidence_threshold = 0.4f;
+
+    std::string sources[] = {jit_decode_source(coco), jit_decode_source(voc), jit_gemm_source(16), jit_gemm_source(32)};
+    const char *names[] = {"decode-coco.cu", "decode-voc.cu", "gemm-16.cu", "gemm-32.cu"};
+    JitImage images[4];
+
+    // 1. 第一次：内存和磁盘都没有时编译，有上一次运行留下的缓存时直接读取
+    KernelJit jit(cache_dir);
+    bool built = true;
+    for (int i = 0; i < 4; ++i) {
+        built &= jit.build(sources[i], names[i], arch, &images[i]);
+        printf("%-16s key %s  %s  %zu bytes  %s\n", names[i], images[i].key.c_str(), images[i].is_cubin ? "cubin" : "ptx",
+               images[i].data.size(), images[i].from_disk ? "from disk" : "compiled");
+    }
+    ok &= check(built, "specialized kernels built");
+    ok &= check(images[0].key != images[1].key && images[2].key != images[3].key, "different constants, different keys");
+
+    JitImage again;
+    jit.build(sources[0], names[0], arch, &again);
+    ok &= check(jit.stats().memory_hits == 1 && again.data == images[0].data, "second build hits memory");
+
+    // 2. 新的实例相当于重新启动程序：全部从磁盘读取
+    KernelJit restarted(cache_dir);
+    bool same = true;
+    for (int i = 0; i < 4; ++i) {
+        JitImage image;
+        same &= restarted.build(sources[i], names[i], arch, &image) && image.from_disk && image.data == images[i].data;
+    }
+    ok &= check(same && restarted.stats().disk_hits == 4 && restarted.stats().compiles == 0, "restart loads every kernel from disk");
+
+    JitImage other_arch;
+    if (restarted.build(sources[0], names[0], arch == 86 ? 80 : 86, &other_arch)) {
+        ok &= check(other_arch.key != images[0].key, "different arch, different key");
+    }
+
+    // 改坏缓存文件的最后一个字节，模拟写坏的文件：读取时发现损坏，重新编译并覆盖
+    std::string path = restarted.cache_path(images[2].key, arch, images[2].is_cubin);
+    FILE *f = fopen(path.c_str(), "r+b");
+    if (f != nullptr) {
+        fseek(f, -1, SEEK_END);
+        fputc(0x5a ^ images[2].data.back(), f);
+        fclose(f);
+    }
+    KernelJit recovered(cache_dir);
+    JitImage repaired;
+    ok &= check(recovered.build(sources[2], names[2], arch, &repaired) && !repaired.from_disk && repaired.data == images[2].data &&
+                    recovered.stats().compiles == 1,
+                "corrupted cache file is recompiled");
+    KernelJit reloaded(cache_dir);
+    ok &= check(reloaded.build(sources[2], names[2], arch, &repaired) && repaired.from_disk, "rewritten cache file is valid");
+
+    // 3. 加载并启动
+    if (has_device) {
+        ok &= check(run_decode(images[0], coco), "decode_kernel 80 classes matches cpu");
+        ok &= check(run_decode(images[1], voc), "decode_kernel 20 classes matches cpu");
+        ok &= check(run_gemm(images[2], 16), "gemm_tile 16 matches cpu");
+        ok &= check(run_gemm(images[3], 32), "gemm_tile 32 matches cpu");
+        checkDriver(cuCtxDestroy(context));
+    } else {
+        printf("No CUDA device, kernel launch skipped.\n");
+    }
+
+    if (ok) {
+        printf("Done no error.\n");
+    } else {
+        printf("NVRTC JIT: some checks failed.\n");
+    }
+}
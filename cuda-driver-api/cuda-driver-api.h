@@ -20,4 +20,6 @@ void cuda_driver_api_4_context();
 
 void cuda_driver_api_5_memory_alloc();
 
+void cuda_driver_api_6_nvrtc_jit();
+
 #endif // CUDA_DRIVER_API_H
@@ -0,0 +1,351 @@
+#include "kernel-jit.h"
+#include "utils.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <nvrtc.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define jit_mkdir(path) _mkdir(path)
+#define jit_getpid() _getpid()
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define jit_mkdir(path) mkdir(path, 0755)
+#define jit_getpid() getpid()
+#endif
+
+#define checkNvrtc(op) __check_nvrtc((op), #op, __FILE__, __LINE__)
+
+static bool __check_nvrtc(nvrtcResult code, const char *op, const char *file, int line) {
+    if (code != NVRTC_SUCCESS) {
+        printf("%s:%d  %s failed. \n  message = %s\n", file, line, op, nvrtcGetErrorString(code));
+        return false;
+    }
+    return true;
+}
+
+/*
+ * 缓存文件的格式：JitCacheHeader + 数据。
+ * 读取时检查 magic、key、长度和数据的哈希，写了一半、被截断、内容损坏的文件都当作没有缓存，重新编译后覆盖。
+ */
+struct JitCacheHeader {
+    char magic[4];       // "JIT1"
+    uint32_t is_cubin;
+    uint64_t key;
+    uint64_t bytes;
+    uint64_t data_hash;
+};
+
+uint64_t jit_hash(const void *data, size_t bytes, uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+int nvrtc_version() {
+    int major = 0, minor = 0;
+    if (nvrtcVersion(&major, &minor) != NVRTC_SUCCESS) { return 0; }
+    return major * 1000 + minor * 10;
+}
+
+int current_device_arch() {
+    CUdevice device = 0;
+    int major = 0, minor = 0;
+    if (cuCtxGetDevice(&device) != CUDA_SUCCESS) { return 0; }
+    if (cuDeviceGetAttribute(&major, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR, device) != CUDA_SUCCESS) { return 0; }
+    if (cuDeviceGetAttribute(&minor, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR, device) != CUDA_SUCCESS) { return 0; }
+    return major * 10 + minor;
+}
+
+// 逐级创建目录，已经存在不算错误
+static bool make_dirs(const std::string &dir) {
+    for (size_t i = 1; i <= dir.size(); ++i) {
+        if (i == dir.size() || dir[i] == '/' || dir[i] == '\\') {
+            std::string part = dir.substr(0, i);
+            if (jit_mkdir(part.c_str()) != 0 && errno != EEXIST) { return false; }
+        }
+    }
+    return true;
+}
+
+KernelJit::KernelJit(const std::string &cache_dir, bool prefer_cubin) : cache_dir_(cache_dir), prefer_cubin_(prefer_cubin) {
+#if CUDA_VERSION < 11010
+    // nvrtcGetCUBIN 从 CUDA 11.1 开始提供
+    prefer_cubin_ = false;
+#endif
+}
+
+std::string KernelJit::cache_path(const std::string &key, int arch, bool is_cubin) const {
+    char name[64];
+    snprintf(name, sizeof(name), "%s-sm_%d.%s", key.c_str(), arch, is_cubin ? "cubin" : "ptx");
+    return cache_dir_ + "/" + name;
+}
+
+KernelJit::Stats KernelJit::stats() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return stats_;
+}
+
+bool KernelJit::build(const std::string &source, const std::string &name, int arch, JitImage *image,
+                      const std::vector<std::string> &options) {
+    // 源码、选项、架构、输出格式、NVRTC 版本任何一个不同，生成的代码都可能不同
+    std::string material = source;
+    for (auto &option : options) {
+        material.push_back('\0');
+        material += option;
+    }
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), "|sm_%d|%s|nvrtc %d", arch, prefer_cubin_ ? "cubin" : "ptx", nvrtc_version());
+    material.push_back('\0');
+    material += suffix;
+
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)jit_hash(material.data(), material.size()));
+
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto it = memory_.find(key);
+        if (it != memory_.end()) {
+            stats_.memory_hits++;
+            *image = it->second;
+            return true;
+        }
+    }
+
+    JitImage result;
+    std::string path = cache_dir_.empty() ? std::string() : cache_path(key, arch, prefer_cubin_);
+    if (!path.empty() && read_cache(path, key, &result)) {
+        std::lock_guard<std::mutex> lock(lock_);
+        stats_.disk_hits++;
+    } else {
+        if (!compile(source, name, arch, options, &result)) {
+            std::lock_guard<std::mutex> lock(lock_);
+            stats_.failures++;
+            return false;
+        }
+        result.key = key;
+        if (!path.empty()) { write_cache(path, result); }
+        std::lock_guard<std::mutex> lock(lock_);
+        stats_.compiles++;
+    }
+
+    std::lock_guard<std::mutex> lock(lock_);
+    memory_[key] = result;
+    *image = result;
+    return true;
+}
+
+bool KernelJit::compile(const std::string &source, const std::string &name, int arch,
+                        const std::vector<std::string> &options, JitImage *image) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    nvrtcProgram program = nullptr;
+    if (!checkNvrtc(nvrtcCreateProgram(&program, source.c_str(), name.c_str(), 0, nullptr, nullptr))) { return false; }
+
+    // cubin 对应真实的架构 sm_XX，PTX 对应虚拟架构 compute_XX
+    char arch_option[32];
+    snprintf(arch_option, sizeof(arch_option), "-arch=%s_%d", prefer_cubin_ ? "sm" : "compute", arch);
+    std::vector<const char *> argv;
+    argv.push_back(arch_option);
+    for (auto &option : options) { argv.push_back(option.c_str()); }
+
+    nvrtcResult code = nvrtcCompileProgram(program, (int)argv.size(), argv.data());
+    size_t log_size = 0;
+    nvrtcGetProgramLogSize(program, &log_size);
+    if (code != NVRTC_SUCCESS) {
+        std::string log(log_size, '\0');
+        if (log_size > 0) { nvrtcGetProgramLog(program, &log[0]); }
+        printf("NVRTC compile %s for %s failed: %s\n%s\n", name.c_str(), arch_option, nvrtcGetErrorString(code), log.c_str());
+        nvrtcDestroyProgram(&program);
+        return false;
+    }
+
+    bool ok = true;
+    size_t bytes = 0;
+#if CUDA_VERSION >= 11010
+    if (prefer_cubin_) {
+        ok = checkNvrtc(nvrtcGetCUBINSize(program, &bytes));
+        image->data.resize(bytes);
+        ok = ok && checkNvrtc(nvrtcGetCUBIN(program, &image->data[0]));
+        image->is_cubin = true;
+    } else
+#endif
+    {
+        // PTX 的长度包含结尾的 '\0'，cuModuleLoadData 需要它
+        ok = checkNvrtc(nvrtcGetPTXSize(program, &bytes));
+        image->data.resize(bytes);
+        ok = ok && checkNvrtc(nvrtcGetPTX(program, &image->data[0]));
+        image->is_cubin = false;
+    }
+    nvrtcDestroyProgram(&program);
+
+    image->from_disk = false;
+    image->compile_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+    return ok && bytes > 0;
+}
+
+bool KernelJit::read_cache(const std::string &path, const std::string &key, JitImage *image) const {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == nullptr) { return false; }
+
+    JitCacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 && memcmp(header.magic, "JIT1", 4) == 0 &&
+              header.key == strtoull(key.c_str(), nullptr, 16) && header.bytes > 0 && header.bytes < (1ull << 31);
+    if (ok) {
+        image->data.resize(header.bytes);
+        ok = fread(&image->data[0], 1, header.bytes, f) == header.bytes &&
+             jit_hash(image->data.data(), image->data.size()) == header.data_hash;
+    }
+    fclose(f);
+    if (!ok) {
+        printf("JIT cache %s is invalid, recompiling.\n", path.c_str());
+        image->data.clear();
+        return false;
+    }
+
+    image->key = key;
+    image->is_cubin = header.is_cubin != 0;
+    image->from_disk = true;
+    image->compile_ms = 0;
+    return true;
+}
+
+void KernelJit::write_cache(const std::string &path, const JitImage &image) const {
+    if (!make_dirs(cache_dir_)) {
+        printf("Create JIT cache directory %s failed: %s\n", cache_dir_.c_str(), strerror(errno));
+        return;
+    }
+
+    JitCacheHeader header;
+    memcpy(header.magic, "JIT1", 4);
+    header.is_cubin = image.is_cubin ? 1 : 0;
+    header.key = strtoull(image.key.c_str(), nullptr, 16);
+    header.bytes = image.data.size();
+    header.data_hash = jit_hash(image.data.data(), image.data.size());
+
+    // 先写临时文件再改名，多个进程同时编译同一个核函数时，读到的要么是完整的旧文件，要么是完整的新文件
+    char tmp_suffix[32];
+    snprintf(tmp_suffix, sizeof(tmp_suffix), ".tmp%d", (int)jit_getpid());
+    std::string tmp = path + tmp_suffix;
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (f == nullptr) {
+        printf("Write JIT cache %s failed: %s\n", tmp.c_str(), strerror(errno));
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(image.data.data(), 1, image.data.size(), f) == image.data.size();
+    ok = fclose(f) == 0 && ok;
+#ifdef _WIN32
+    // Windows 上 rename 不覆盖已经存在的文件
+    if (ok) { remove(path.c_str()); }
+#endif
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        printf("Write JIT cache %s failed.\n", path.c_str());
+        remove(tmp.c_str());
+    }
+}
+
+bool load_jit_module(const JitImage &image, const char *kernel_name, CUmodule *module, CUfunction *function) {
+    *module = nullptr;
+    *function = nullptr;
+    if (!checkDriver(cuModuleLoadData(module, image.data.data()))) { return false; }
+    if (!checkDriver(cuModuleGetFunction(function, *module, kernel_name))) {
+        cuModuleUnload(*module);
+        *module = nullptr;
+        return false;
+    }
+    return true;
+}
+
+std::string jit_decode_source(const DecodeKernelSpec &spec) {
+    // 阈值按位写入，源码中的常量与主机端的 float 完全相同
+    uint32_t threshold_bits = 0;
+    memcpy(&threshold_bits, &spec.confidence_threshold, sizeof(threshold_bits));
+    char defines[512];
+    snprintf(defines, sizeof(defines),
+             "#define NUM_CLASSES %d\n"
+             "#define NUM_BOX_ELEMENT %d\n"
+             "#define CONFIDENCE_THRESHOLD __int_as_float(0x%08x) // %.9g\n"
+             "#define CHANNEL_MAJOR %d\n",
+             spec.num_classes, spec.num_box_element, threshold_bits, spec.confidence_threshold, spec.channel_major ? 1 : 0);
+
+    return std::string(defines) + R"(
+// 第 position 个框的第 c 个值：行优先为 [num_bboxes][5 + NUM_CLASSES]，通道优先为 [5 + NUM_CLASSES][num_bboxes]
+#if CHANNEL_MAJOR
+#define ITEM(c) predict[(c) * num_bboxes + position]
+#else
+#define ITEM(c) predict[position * (5 + NUM_CLASSES) + (c)]
+#endif
+
+extern "C" __global__ void decode_kernel(const float *predict, int num_bboxes, float *parray, int max_objects) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= num_bboxes) { return; }
+
+    float objectness = ITEM(4);
+    if (objectness < CONFIDENCE_THRESHOLD) { return; }
+
+    // 类别数是编译期常量，循环可以展开
+    float confidence = ITEM(5);
+    int label = 0;
+#pragma unroll 8
+    for (int i = 1; i < NUM_CLASSES; ++i) {
+        float value = ITEM(5 + i);
+        if (value > confidence) {
+            confidence = value;
+            label = i;
+        }
+    }
+    confidence *= objectness;
+    if (confidence < CONFIDENCE_THRESHOLD) { return; }
+
+    int index = (int)atomicAdd(parray, 1.0f);
+    if (index >= max_objects) { return; }
+
+    float cx = ITEM(0), cy = ITEM(1), width = ITEM(2), height = ITEM(3);
+    float *pout_item = parray + 1 + index * NUM_BOX_ELEMENT;
+    pout_item[0] = cx - width * 0.5f;
+    pout_item[1] = cy - height * 0.5f;
+    pout_item[2] = cx + width * 0.5f;
+    pout_item[3] = cy + height * 0.5f;
+    pout_item[4] = confidence;
+    pout_item[5] = label;
+    pout_item[6] = 1; // 用于nms的标志位，1 = keep, 0 = ignore
+}
+)";
+}
+
+std::string jit_gemm_source(int block_size) {
+    char defines[64];
+    snprintf(defines, sizeof(defines), "#define BLOCK_SIZE %d\n", block_size);
+    return std::string(defines) + R"(
+extern "C" __global__ void gemm_tile(const float *A, const float *B, float *C, int m, int n, int k) {
+    __shared__ float shardM[BLOCK_SIZE][BLOCK_SIZE];
+    __shared__ float shardN[BLOCK_SIZE][BLOCK_SIZE];
+
+    int tx = threadIdx.x;
+    int ty = threadIdx.y;
+    int row = blockIdx.y * BLOCK_SIZE + ty;
+    int col = blockIdx.x * BLOCK_SIZE + tx;
+    float v = 0.0f;
+
+    for (int i = 0; i < (n + BLOCK_SIZE - 1) / BLOCK_SIZE; i++) {
+        shardM[ty][tx] = (i * BLOCK_SIZE + tx < n && row < m) ? A[row * n + i * BLOCK_SIZE + tx] : 0.0f;
+        shardN[ty][tx] = (i * BLOCK_SIZE + ty < n && col < k) ? B[(i * BLOCK_SIZE + ty) * k + col] : 0.0f;
+        __syncthreads();
+
+#pragma unroll
+        for (int j = 0; j < BLOCK_SIZE; j++) { v += shardM[ty][j] * shardN[j][tx]; }
+        __syncthreads();
+    }
+    if (row < m && col < k) { C[row * k + col] = v; }
+}
+)";
+}
@@ -0,0 +1,94 @@
+#ifndef KERNEL_JIT_H
+#define KERNEL_JIT_H
+
+#include <cuda.h>
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * 运行时特化核函数：
+ * decode_kernel 的 num_classes、NUM_BOX_ELEMENT、阈值都是运行时参数，类别循环无法展开；gemm_kernel_1<16> 的 tile 在编译时固定。
+ * 这里按模型的常量生成核函数源码（常量写成 #define），用 NVRTC 编译成 cubin（或 PTX），
+ * 以 源码 + 编译选项 + 架构 + NVRTC 版本 的哈希为 key 缓存到磁盘，下次启动直接读文件，
+ * 最后通过驱动 API cuModuleLoadData 加载（参考 cuda-driver-api-4-context.cpp 的上下文）。
+ * 编译和缓存只依赖 NVRTC，不需要 GPU；只有 load_jit_module 和启动核函数需要上下文。
+ */
+struct JitImage {
+    std::string key;      // 16 位十六进制的哈希
+    std::string data;     // cubin 或者以 '\0' 结尾的 PTX 文本，可以直接交给 cuModuleLoadData
+    bool is_cubin = false;
+    bool from_disk = false;
+    double compile_ms = 0;
+};
+
+class KernelJit {
+public:
+    /*
+     * cache_dir 为空时不使用磁盘缓存。prefer_cubin 为 true 且 NVRTC 支持时（CUDA 11.1 之后）直接生成 cubin，
+     * 加载时不需要驱动再从 PTX 编译；否则生成 PTX，可以在同一大版本更新的架构上运行。
+     */
+    explicit KernelJit(const std::string &cache_dir = "jit-cache", bool prefer_cubin = true);
+
+    /*
+     * 编译 source（或者从内存、磁盘缓存中取），arch 为计算能力 major * 10 + minor，例如 86。
+     * name 只用于编译日志，核函数用 extern "C" 声明，加载后按原名查找。失败时打印编译日志并返回 false。
+     */
+    bool build(const std::string &source, const std::string &name, int arch, JitImage *image,
+               const std::vector<std::string> &options = std::vector<std::string>());
+
+    std::string cache_path(const std::string &key, int arch, bool is_cubin) const;
+
+    struct Stats {
+        int memory_hits = 0, disk_hits = 0, compiles = 0, failures = 0;
+    };
+    Stats stats() const;
+
+private:
+    bool compile(const std::string &source, const std::string &name, int arch,
+                 const std::vector<std::string> &options, JitImage *image);
+    bool read_cache(const std::string &path, const std::string &key, JitImage *image) const;
+    void write_cache(const std::string &path, const JitImage &image) const;
+
+    std::string cache_dir_;
+    bool prefer_cubin_;
+    mutable std::mutex lock_;
+    std::map<std::string, JitImage> memory_; // key -> 已经编译过的
+    Stats stats_;
+};
+
+// 64 位 FNV-1a
+uint64_t jit_hash(const void *data, size_t bytes, uint64_t seed = 14695981039346656037ull);
+
+// NVRTC 的版本（major * 1000 + minor * 10），没有 NVRTC 时为 0
+int nvrtc_version();
+
+// 当前上下文所在设备的计算能力 major * 10 + minor，失败时返回 0
+int current_device_arch();
+
+// 加载到当前上下文并取出 kernel_name 对应的函数
+bool load_jit_module(const JitImage &image, const char *kernel_name, CUmodule *module, CUfunction *function);
+
+// 模型相关的常量，决定生成的 decode 核函数
+struct DecodeKernelSpec {
+    int num_classes = 80;
+    int num_box_element = 7;          // left, top, right, bottom, confidence, label, keepflag
+    float confidence_threshold = 0.25f;
+    bool channel_major = false;       // false: [num_bboxes][5 + num_classes]，true: [5 + num_classes][num_bboxes]（例如 YOLOv8 的输出）
+};
+
+/*
+ * 特化的 decode 核函数：extern "C" __global__ void decode_kernel(const float *predict, int num_bboxes, float *parray, int max_objects)
+ * 输出格式与 gpu-decode.cu 相同（parray[0] 为计数，之后每个框 num_box_element 个 float），没有仿射变换。
+ */
+std::string jit_decode_source(const DecodeKernelSpec &spec);
+
+/*
+ * 特化 tile 的矩阵乘法：extern "C" __global__ void gemm_tile(const float *A, const float *B, float *C, int m, int n, int k)
+ * 与 segemm.cu 的 gemm_kernel_1 相同的共享内存分块，A 为 m x n，B 为 n x k，block 为 block_size x block_size。
+ */
+std::string jit_gemm_source(int block_size);
+
+#endif // KERNEL_JIT_H
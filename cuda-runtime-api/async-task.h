@@ -0,0 +1,324 @@
+#ifndef ASYNC_TASK_H
+#define ASYNC_TASK_H
+
+/*
+ * 基于 C++20 协程的异步推理接口：
+ * 预处理 -> 推理 -> 解码原来要手工用事件、回调串起来，这里每一步都可以 co_await，请求的处理函数按顺序写，但不阻塞任何线程：
+ *   - co_await wait_stream(dispatcher, stream, pool)：流上目前为止的工作完成后恢复，由 CompletionDispatcher 驱动，
+ *     分发线程只把协程交给线程池，在线程池上继续执行；
+ *   - co_await pool.acquire()：从 AsyncPool 中取一个对象（执行上下文、流、缓冲区），没有空闲的就挂起，
+ *     别的请求归还时恢复，Lease 析构时归还；
+ *   - co_await resume_on(thread_pool)：切换到线程池上继续，CPU 上耗时的解码不占用分发线程；
+ *   - co_await 另一个 Task：子过程，异常沿调用链传播。
+ * Task 是惰性的，被 co_await 或者 start 时才开始执行。start 返回 std::future，sync_wait 阻塞等待（只在最外层使用）。
+ * 没有 GPU 时配合 SimulatedStream / SimulatedStreamBackend（completion-dispatcher.h）测试。
+ * 需要 C++20（-std=c++20，MSVC 为 /std:c++latest），否则 ASYNC_TASK_ENABLED 为 0，这里的内容都不可用。
+ */
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define ASYNC_TASK_ENABLED 1
+#endif
+#endif
+#ifndef ASYNC_TASK_ENABLED
+#define ASYNC_TASK_ENABLED 0
+#endif
+
+#if ASYNC_TASK_ENABLED
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "completion-dispatcher.h"
+#include "thread-pool.h"
+
+template <typename T = void>
+class Task;
+
+namespace async_detail {
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    // 结束时转到等待者，没有等待者（start 启动的）时返回到恢复它的线程
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> self) noexcept {
+            auto continuation = self.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    template <typename U>
+    void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+    T result() {
+        if (error) { std::rethrow_exception(error); }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    void result() {
+        if (error) { std::rethrow_exception(error); }
+    }
+};
+
+// start 使用的外层协程：立即开始、结束时自己销毁
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+} // namespace async_detail
+
+template <typename T>
+class Task {
+public:
+    typedef async_detail::Promise<T> promise_type;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (handle_) { handle_.destroy(); }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    // 挂起中的 Task 不能销毁，恢复它的回调还持有句柄
+    ~Task() {
+        if (handle_) { handle_.destroy(); }
+    }
+
+    bool valid() const { return (bool)handle_; }
+
+    // co_await task：记下等待者，转到 task 开始执行（对称转移，不增加栈深度）
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() { return handle.promise().result(); }
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace async_detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+template <typename T>
+Detached run_detached(Task<T> task, std::shared_ptr<std::promise<T>> done) {
+    try {
+        if constexpr (std::is_void<T>::value) {
+            co_await std::move(task);
+            done->set_value();
+        } else {
+            done->set_value(co_await std::move(task));
+        }
+    } catch (...) {
+        done->set_exception(std::current_exception());
+    }
+}
+
+} // namespace async_detail
+
+// 在调用线程上开始执行 task，直到第一次挂起；之后由恢复它的线程（分发线程、线程池）继续
+template <typename T>
+std::future<T> start(Task<T> task) {
+    auto done = std::make_shared<std::promise<T>>();
+    auto future = done->get_future();
+    async_detail::run_detached(std::move(task), done);
+    return future;
+}
+
+// 阻塞当前线程直到 task 完成，只在最外层（main、测试）使用，不能在分发线程或者线程池中调用
+template <typename T>
+T sync_wait(Task<T> task) {
+    return start(std::move(task)).get();
+}
+
+/*
+ * 流上目前为止的工作完成后在线程池上恢复，结果为排入 host func 的错误码。
+ * 协程之后的代码（下一步的 notify、解码……）不在分发线程上执行，不会占住分发线程。
+ * 排入失败时不挂起，立即返回错误码。线程池要比协程活得久。
+ */
+inline auto wait_stream(CompletionDispatcher &dispatcher, cudaStream_t stream, ThreadPool &pool = ThreadPool::global()) {
+    struct Awaiter {
+        CompletionDispatcher &dispatcher;
+        cudaStream_t stream;
+        ThreadPool &pool;
+        cudaError_t code;
+
+        bool await_ready() noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            // 回调可能在 notify 返回之前就恢复了协程，之后不能再访问 this，除非排入失败
+            ThreadPool *target = &pool;
+            cudaError_t result = dispatcher.notify(stream, [handle, target]() {
+                target->post([handle]() { handle.resume(); });
+            });
+            if (result == cudaSuccess) { return true; }
+            code = result;
+            return false;
+        }
+        cudaError_t await_resume() noexcept { return code; }
+    };
+    return Awaiter{dispatcher, stream, pool, cudaSuccess};
+}
+
+// 切换到线程池上继续执行
+inline auto resume_on(ThreadPool &pool) {
+    struct Awaiter {
+        ThreadPool &pool;
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            pool.post([handle]() { handle.resume(); });
+        }
+        void await_resume() noexcept {}
+    };
+    return Awaiter{pool};
+}
+
+/*
+ * 协程使用的对象池：acquire 得到 Lease，没有空闲对象时挂起，归还时把对象直接交给等待最久的协程，
+ * 并通过线程池恢复它（不在归还者的调用栈上恢复）。对象池要比所有使用它的协程活得久。
+ */
+template <typename T>
+class AsyncPool {
+public:
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(AsyncPool *pool, size_t index) : pool_(pool), index_(index) {}
+        Lease(Lease &&other) noexcept : pool_(std::exchange(other.pool_, nullptr)), index_(other.index_) {}
+        Lease &operator=(Lease &&other) noexcept {
+            if (this != &other) {
+                release();
+                pool_ = std::exchange(other.pool_, nullptr);
+                index_ = other.index_;
+            }
+            return *this;
+        }
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        ~Lease() { release(); }
+
+        T &operator*() const { return pool_->items_[index_]; }
+        T *operator->() const { return &pool_->items_[index_]; }
+        size_t index() const { return index_; }
+        void release() {
+            if (pool_ != nullptr) { std::exchange(pool_, nullptr)->give_back(index_); }
+        }
+
+    private:
+        AsyncPool *pool_ = nullptr;
+        size_t index_ = 0;
+    };
+
+    explicit AsyncPool(std::vector<T> items, ThreadPool &pool = ThreadPool::global())
+        : items_(std::move(items)), pool_(pool) {
+        for (size_t i = 0; i < items_.size(); ++i) { free_.push_back(i); }
+    }
+    AsyncPool(const AsyncPool &) = delete;
+    AsyncPool &operator=(const AsyncPool &) = delete;
+
+    // 协程挂起期间 Awaiter 在协程帧中，等待队列里保存它的地址
+    struct AcquireAwaiter {
+        AsyncPool &pool;
+        size_t index = 0;
+        std::coroutine_handle<> handle;
+
+        bool await_ready() noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            std::lock_guard<std::mutex> lock(pool.lock_);
+            if (!pool.free_.empty()) {
+                index = pool.free_.front();
+                pool.free_.pop_front();
+                return false;
+            }
+            handle = h;
+            pool.waiters_.push_back(this);
+            return true;
+        }
+        Lease await_resume() noexcept { return Lease(&pool, index); }
+    };
+
+    AcquireAwaiter acquire() { return AcquireAwaiter{*this, 0, std::coroutine_handle<>()}; }
+
+    size_t size() const { return items_.size(); }
+    size_t available() const {
+        std::lock_guard<std::mutex> lock(lock_);
+        return free_.size();
+    }
+
+private:
+    void give_back(size_t index) {
+        std::coroutine_handle<> handle;
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            if (waiters_.empty()) {
+                free_.push_back(index);
+                return;
+            }
+            auto *waiter = waiters_.front();
+            waiters_.pop_front();
+            waiter->index = index;
+            handle = waiter->handle;
+        }
+        pool_.post([handle]() { handle.resume(); });
+    }
+
+    std::vector<T> items_;
+    ThreadPool &pool_;
+    mutable std::mutex lock_;
+    std::deque<size_t> free_;
+    std::deque<AcquireAwaiter *> waiters_;
+};
+
+#endif // ASYNC_TASK_ENABLED
+
+#endif // ASYNC_TASK_H
@@ -0,0 +1,269 @@
+#include "completion-dispatcher.h"
+#include <stdio.h>
+#include <algorithm>
+
+class CudaCompletionBackend : public CompletionBackend {
+public:
+    cudaError_t launch_host_func(cudaStream_t stream, HostFunc fn, void *arg) override {
+        return cudaLaunchHostFunc(stream, fn, arg);
+    }
+};
+
+CompletionBackend &cuda_completion_backend() {
+    static CudaCompletionBackend backend;
+    return backend;
+}
+
+SimulatedStream::SimulatedStream() {
+    thread_ = std::thread([this]() { run(); });
+}
+
+SimulatedStream::~SimulatedStream() {
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void SimulatedStream::enqueue(std::function<void()> work) {
+    // 在锁内唤醒：解锁之后流线程可能马上执行完这项工作，等待它的线程随即析构这个流
+    std::lock_guard<std::mutex> lock(lock_);
+    queue_.push_back(std::move(work));
+    cv_.notify_one();
+}
+
+void SimulatedStream::synchronize() {
+    std::unique_lock<std::mutex> lock(lock_);
+    idle_cv_.wait(lock, [&]() { return queue_.empty() && !busy_; });
+}
+
+void SimulatedStream::run() {
+    std::unique_lock<std::mutex> lock(lock_);
+    while (true) {
+        cv_.wait(lock, [&]() { return !queue_.empty() || stop_; });
+        if (queue_.empty()) { break; }
+
+        auto work = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        lock.unlock();
+        work();
+        lock.lock();
+        busy_ = false;
+        if (queue_.empty()) { idle_cv_.notify_all(); }
+    }
+}
+
+cudaError_t SimulatedStreamBackend::launch_host_func(cudaStream_t stream, HostFunc fn, void *arg) {
+    if (stream == nullptr || fn == nullptr) { return cudaErrorInvalidValue; }
+    SimulatedStream::from_handle(stream)->enqueue([fn, arg]() { fn(arg); });
+    return cudaSuccess;
+}
+
+// 当前线程是哪个分发器的分发线程，其他线程为 nullptr
+static thread_local CompletionDispatcher *tls_dispatcher = nullptr;
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 2;
+    while (p < n) { p <<= 1; }
+    return p;
+}
+
+CompletionDispatcher::CompletionDispatcher(CompletionBackend &backend, const CompletionDispatcherConfig &config)
+    : backend_(backend), capacity_(round_up_pow2(config.capacity)), cells_(new Cell[capacity_]) {
+    for (size_t i = 0; i < capacity_; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+        cells_[i].record = nullptr;
+    }
+    int num_threads = std::max(1, config.num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+        threads_.emplace_back([this]() { dispatch_loop(); });
+    }
+}
+
+CompletionDispatcher::~CompletionDispatcher() {
+    wait_idle();
+    // 最后一个记录可能已经被处理完，但 host_entry 还没有从唤醒中返回
+    while (entering_.load() > 0) { std::this_thread::yield(); }
+    {
+        std::lock_guard<std::mutex> lock(sleep_lock_);
+        stop_.store(true);
+    }
+    sleep_cv_.notify_all();
+    for (auto &thread : threads_) { thread.join(); }
+}
+
+cudaError_t CompletionDispatcher::notify(cudaStream_t stream, Callback callback) {
+    // 占用一个在途的名额，满了就等分发线程完成一些（队列容量等于名额数，压入时一定有空位）
+    size_t count = in_flight_.load();
+    while (true) {
+        if (count < capacity_) {
+            if (in_flight_.compare_exchange_weak(count, count + 1)) { break; }
+            continue;
+        }
+        backpressure_waits_.fetch_add(1, std::memory_order_relaxed);
+        if (tls_dispatcher == this) {
+            // 回调里的 notify：睡眠等待可能让所有分发线程都停在这里，自己处理一个完成的记录腾出名额
+            Record *record = pop();
+            if (record != nullptr) {
+                finish(record);
+            } else {
+                std::this_thread::yield();
+            }
+            count = in_flight_.load();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(slot_lock_);
+        slot_waiters_.fetch_add(1);
+        slot_cv_.wait(lock, [&]() { return in_flight_.load() < capacity_; });
+        slot_waiters_.fetch_sub(1);
+        count = in_flight_.load();
+    }
+
+    outstanding_.fetch_add(1);
+    size_t peak = peak_in_flight_.load(std::memory_order_relaxed);
+    while (count + 1 > peak && !peak_in_flight_.compare_exchange_weak(peak, count + 1, std::memory_order_relaxed)) {}
+
+    // 提交成功之后回调随时可能完成、分发器随之析构，计数在提交之前更新，成功后不再访问成员
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    Record *record = new Record{this, std::move(callback)};
+    cudaError_t code = backend_.launch_host_func(stream, &CompletionDispatcher::host_entry, record);
+    if (code != cudaSuccess) {
+        delete record;
+        submitted_.fetch_sub(1, std::memory_order_relaxed);
+        in_flight_.fetch_sub(1);
+        outstanding_.fetch_sub(1);
+        wake_slot_waiters();
+    }
+    return code;
+}
+
+void CUDART_CB CompletionDispatcher::host_entry(void *arg) {
+    // 驱动的回调线程：只入队、唤醒，不执行用户代码
+    // 入队之后记录随时可能被处理完、分发器随之析构，entering_ 让析构等这里返回
+    Record *record = static_cast<Record *>(arg);
+    CompletionDispatcher *self = record->owner;
+    self->entering_.fetch_add(1);
+    self->push(record);
+    self->epoch_.fetch_add(1);
+    if (self->sleeping_.load() > 0) {
+        std::lock_guard<std::mutex> lock(self->sleep_lock_);
+        self->sleep_cv_.notify_one();
+    }
+    self->entering_.fetch_sub(1);
+}
+
+void CompletionDispatcher::push(Record *record) {
+    size_t mask = capacity_ - 1;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+        cell = &cells_[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+        } else if (diff < 0) {
+            // 在途数不超过容量，只有消费者取走记录、还没有更新 sequence 的一瞬间才会看到满
+            std::this_thread::yield();
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+    cell->record = record;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+}
+
+CompletionDispatcher::Record *CompletionDispatcher::pop() {
+    size_t mask = capacity_ - 1;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+        cell = &cells_[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+        } else if (diff < 0) {
+            return nullptr;
+        } else {
+            pos = dequeue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+    Record *record = cell->record;
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return record;
+}
+
+void CompletionDispatcher::finish(Record *record) {
+    // 先释放名额再执行回调，回调里的 notify 不会等自己占着的名额
+    in_flight_.fetch_sub(1);
+    wake_slot_waiters();
+
+    try {
+        record->callback();
+    } catch (...) {
+        printf("Completion callback threw an exception, ignored.\n");
+    }
+    delete record;
+    completed_.fetch_add(1, std::memory_order_relaxed);
+    outstanding_.fetch_sub(1);
+    wake_slot_waiters();
+}
+
+void CompletionDispatcher::wake_slot_waiters() {
+    // 与 notify、wait_idle 中的 slot_waiters_ 配合：要么这里看到等待者并唤醒，要么等待者看到新的计数
+    if (slot_waiters_.load() > 0) {
+        std::lock_guard<std::mutex> lock(slot_lock_);
+        slot_cv_.notify_all();
+    }
+}
+
+void CompletionDispatcher::dispatch_loop() {
+    tls_dispatcher = this;
+    int idle = 0;
+    while (!stop_.load(std::memory_order_acquire)) {
+        Record *record = pop();
+        if (record != nullptr) {
+            finish(record);
+            idle = 0;
+            continue;
+        }
+        if (++idle < 64) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_lock_);
+        sleeping_.fetch_add(1);
+        uint64_t epoch = epoch_.load();
+        if (dequeue_pos_.load() == enqueue_pos_.load() && !stop_.load()) {
+            sleeps_.fetch_add(1, std::memory_order_relaxed);
+            sleep_cv_.wait(lock, [&]() { return epoch_.load() != epoch || stop_.load(); });
+        }
+        sleeping_.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+void CompletionDispatcher::wait_idle() {
+    // 回调里 notify 的下一步在回调返回之前已经计入 outstanding_，减到 0 时整条链都结束了
+    if (outstanding_.load() == 0) { return; }
+    std::unique_lock<std::mutex> lock(slot_lock_);
+    slot_waiters_.fetch_add(1);
+    slot_cv_.wait(lock, [&]() { return outstanding_.load() == 0; });
+    slot_waiters_.fetch_sub(1);
+}
+
+CompletionDispatcher::Stats CompletionDispatcher::stats() const {
+    Stats stats;
+    stats.submitted = submitted_.load(std::memory_order_relaxed);
+    stats.completed = completed_.load(std::memory_order_relaxed);
+    stats.backpressure_waits = backpressure_waits_.load(std::memory_order_relaxed);
+    stats.sleeps = sleeps_.load(std::memory_order_relaxed);
+    stats.peak_in_flight = peak_in_flight_.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,178 @@
+#ifndef COMPLETION_DISPATCHER_H
+#define COMPLETION_DISPATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <cuda_runtime.h>
+
+/*
+ * 流上工作完成的通知：
+ * 原来每个请求最后都调用 cudaStreamSynchronize，一个在途的请求就要占住一个主机线程。
+ * 这里在流上排入一个 cudaLaunchHostFunc，流上之前的工作完成时，驱动的回调线程只把完成记录压入一个无锁队列就返回
+ * （host func 里不能调用 CUDA API，也不应该做耗时的事），少数几个分发线程从队列取出记录，执行回调、设置 future。
+ * 成千上万个在途的请求只需要几个线程。
+ *   - 在途的请求数达到队列容量时 notify 等待（反压），压入队列永远不会失败；
+ *   - 回调在分发线程上执行，可以调用 CUDA API（例如在同一个流上排入下一步），但不应该阻塞；
+ *   - 记录取出之后、回调执行之前就释放名额，回调里可以再 notify。分发线程上的 notify 遇到满时不睡眠，
+ *     而是取出其他完成的记录就地执行（否则所有分发线程都等在 notify 里时没有人处理完成的记录），
+ *     这时后面的回调会嵌套在当前回调里执行；
+ *   - 多个分发线程时，同一个流上的完成记录按顺序入队，但回调可能并发执行，需要顺序时使用一个分发线程。
+ * 注意 cudaLaunchHostFunc 在上下文出错（sticky error）之后不再执行，这种错误之后只能重建上下文。
+ * CompletionBackend 抽象了排入 host func 的方式，SimulatedStreamBackend 用 CPU 线程模拟流，没有 GPU 时也能测试。
+ */
+class CompletionBackend {
+public:
+    typedef cudaHostFn_t HostFunc; // Windows 上带有 CUDART_CB（__stdcall）
+    virtual ~CompletionBackend() = default;
+    // stream 上之前的工作完成后调用 fn(arg)，每次排入恰好调用一次
+    virtual cudaError_t launch_host_func(cudaStream_t stream, HostFunc fn, void *arg) = 0;
+};
+
+// cudaLaunchHostFunc
+CompletionBackend &cuda_completion_backend();
+
+/*
+ * 用一个 CPU 线程模拟的流：按入队顺序执行工作（模拟的核函数、拷贝）和 host func。
+ * handle() 得到的句柄只能交给 SimulatedStreamBackend，不能传给 CUDA API。
+ */
+class SimulatedStream {
+public:
+    SimulatedStream();
+    // 执行完已入队的工作之后退出
+    ~SimulatedStream();
+    SimulatedStream(const SimulatedStream &) = delete;
+    SimulatedStream &operator=(const SimulatedStream &) = delete;
+
+    void enqueue(std::function<void()> work);
+    void synchronize();
+    cudaStream_t handle() { return reinterpret_cast<cudaStream_t>(this); }
+    static SimulatedStream *from_handle(cudaStream_t stream) { return reinterpret_cast<SimulatedStream *>(stream); }
+
+private:
+    void run();
+
+    std::mutex lock_;
+    std::condition_variable cv_, idle_cv_;
+    std::deque<std::function<void()>> queue_;
+    bool busy_ = false;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+class SimulatedStreamBackend : public CompletionBackend {
+public:
+    cudaError_t launch_host_func(cudaStream_t stream, HostFunc fn, void *arg) override;
+};
+
+struct CompletionDispatcherConfig {
+    int num_threads = 2;
+    size_t capacity = 4096; // 最多同时在途的请求数，向上取为 2 的幂
+};
+
+class CompletionDispatcher {
+public:
+    typedef std::function<void()> Callback;
+
+    explicit CompletionDispatcher(CompletionBackend &backend = cuda_completion_backend(),
+                                  const CompletionDispatcherConfig &config = CompletionDispatcherConfig());
+    // 等所有已经提交的请求完成，回调都执行完之后再退出分发线程
+    ~CompletionDispatcher();
+    CompletionDispatcher(const CompletionDispatcher &) = delete;
+    CompletionDispatcher &operator=(const CompletionDispatcher &) = delete;
+
+    // stream 上目前为止的工作完成后在分发线程上执行 callback，返回排入 host func 的结果，失败时 callback 不会执行
+    cudaError_t notify(cudaStream_t stream, Callback callback);
+
+    // 完成后在分发线程上执行 fn()，future 得到它的返回值或者抛出的异常；排入失败时 future 抛出 std::runtime_error
+    template <typename Fn>
+    auto then(cudaStream_t stream, Fn &&fn) -> std::future<decltype(fn())>;
+
+    // 完成时就绪的 future
+    std::future<void> completion(cudaStream_t stream) {
+        return then(stream, [] {});
+    }
+
+    // 等待目前所有在途的请求完成、回调执行完（调用线程阻塞，只用于收尾和测试，不能在回调里调用）
+    void wait_idle();
+
+    struct Stats {
+        uint64_t submitted = 0, completed = 0, backpressure_waits = 0, sleeps = 0;
+        size_t peak_in_flight = 0;
+    };
+    Stats stats() const;
+    // 占用名额的请求数，不包括正在执行的回调
+    size_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+    int num_threads() const { return (int)threads_.size(); }
+
+private:
+    struct Record {
+        CompletionDispatcher *owner;
+        Callback callback;
+    };
+
+    // Vyukov 的有界多生产者多消费者队列，每个槽位的 sequence 表示它当前可以被压入还是弹出
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Record *record;
+    };
+
+    static void CUDART_CB host_entry(void *arg);
+    void push(Record *record);
+    Record *pop();
+    void finish(Record *record);
+    void wake_slot_waiters();
+    void dispatch_loop();
+
+    CompletionBackend &backend_;
+    size_t capacity_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+    alignas(64) std::atomic<size_t> in_flight_{0};
+    std::atomic<size_t> outstanding_{0}; // 已经提交、回调还没有执行完的请求数，wait_idle 和析构等它减到 0
+
+    // 分发线程没有活干时休眠，与 ThreadPool 相同的 sleeping_ / epoch_ 配合
+    std::mutex sleep_lock_;
+    std::condition_variable sleep_cv_;
+    std::atomic<int> sleeping_{0};
+    std::atomic<uint64_t> epoch_{0};
+    std::atomic<bool> stop_{false};
+    std::atomic<int> entering_{0}; // 正在执行 host_entry 的回调线程数
+
+    // 反压和 wait_idle 的等待只在在途数达到上限或者 outstanding_ 减到 0 时才用到
+    std::mutex slot_lock_;
+    std::condition_variable slot_cv_;
+    std::atomic<int> slot_waiters_{0};
+
+    std::atomic<uint64_t> submitted_{0}, completed_{0}, backpressure_waits_{0}, sleeps_{0};
+    std::atomic<size_t> peak_in_flight_{0};
+    std::vector<std::thread> threads_;
+};
+
+template <typename Fn>
+auto CompletionDispatcher::then(cudaStream_t stream, Fn &&fn) -> std::future<decltype(fn())> {
+    typedef decltype(fn()) Result;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+    auto future = task->get_future();
+    cudaError_t code = notify(stream, [task] { (*task)(); });
+    if (code != cudaSuccess) {
+        // 回调不会执行，任务的 future 只会得到 broken_promise，换成带错误信息的
+        std::promise<Result> failed;
+        failed.set_exception(std::make_exception_ptr(std::runtime_error(cudaGetErrorString(code))));
+        return failed.get_future();
+    }
+    return future;
+}
+
+#endif // COMPLETION_DISPATCHER_H
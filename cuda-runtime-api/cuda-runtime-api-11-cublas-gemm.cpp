@@ -61,9 +61,11 @@ void cuda_runtime_api_11_cublas_gemm() {
     int Cbytes = m * k * sizeof(float);
 
     // cudaHostRegister 用于注册主机内存，使其成为可通过设备直接访问的页锁定内存。
-    cudaHostRegister(A.data, Abytes, cudaHostRegisterDefault);
-    cudaHostRegister(B.data, Bbytes, cudaHostRegisterDefault);
-    cudaHostRegister(C.data, Cbytes, cudaHostRegisterDefault);
+    // 通过注册缓存注册，函数结束时 cache 析构统一注销（原来注册之后没有注销）；多次调用时复用同一个缓存即可免去重复注册。
+    HostRegisterCache cache;
+    cache.acquire(A);
+    cache.acquire(B);
+    cache.acquire(C);
 
     // 分配 gpu 内存
     float *dA, *dB, *dC;
@@ -115,8 +115,8 @@ std::vector<Box> cpu_decode(float *predict, int rows, int cols, float confidence
 
 std::vector<Box> gpu_decode(float *predict, int rows, int cols, float confidence_threshold, float nms_threshold) {
     std::vector<Box> box_result;
-    cudaStream_t stream = nullptr;
-    checkRuntime(cudaStreamCreate(&stream));
+    // 每次调用都从池中借一个流，返回时归还，不再每次创建销毁
+    PooledStream stream = StreamPool::global().acquire();
 
     float *predict_device = nullptr;
     float *output_device = nullptr;
@@ -152,7 +152,6 @@ std::vector<Box> gpu_decode(float *predict, int rows, int cols, float confidence
     }
 
     // 释放内存
-    checkRuntime(cudaStreamDestroy(stream));
     checkRuntime(cudaFree(predict_device));
     checkRuntime(cudaFree(output_device));
     checkRuntime(cudaFreeHost(output_host));
@@ -0,0 +1,68 @@
+#include "cuda-runtime-api.h"
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+void cuda_runtime_api_15_infer_cache() {
+    auto data = load_file("../src/cuda-runtime-api/static/predict.data");
+    cv::Mat image = cv::imread("../src/cuda-runtime-api/static/12.input-image.jpg");
+    if (data.empty() || image.empty()) {
+        printf("Load predict.data or input image failed.\n");
+        return;
+    }
+    float *ptr = (float *)data.data();
+    int nelem = data.size() / sizeof(float);
+    int ncols = 85;
+    int nrows = nelem / ncols;
+    size_t image_bytes = image.cols * image.rows * 3;
+
+    // ------------------------------ 1. 哈希吞吐量 ----------------------------
+    int ntry = 100;
+    uint64_t checksum = 0;
+    double t0 = now_ms();
+    for (int i = 0; i < ntry; ++i) {
+        checksum ^= hash_bytes_64(image.data, image_bytes, i);
+    }
+    double t1 = now_ms();
+    double hash_ms = (t1 - t0) / ntry;
+    printf("hash %.2f MB frame: %.3f ms, %.2f GB/s, checksum = %llx\n",
+           image_bytes / 1024.0 / 1024.0, hash_ms, image_bytes / hash_ms / 1e6, (unsigned long long)checksum);
+
+    // ------------------------------ 2. 模拟静态摄像头的视频流 ----------------------------
+    /*
+     * 静态摄像头的大部分帧字节完全相同，每 10 帧模拟一次画面变化（修改一个像素），
+     * 变化后的帧第一次出现时未命中，走完整的 gpu_decode，之后的重复帧全部命中缓存。
+     */
+    InferResultCache cache(16 << 20, 8);
+    const uint64_t model_id = hash_bytes_64("yolov5s.trtmodel", 16);
+    const float confidence_threshold = 0.25f;
+    const float nms_threshold = 0.45f;
+    int nframes = 100;
+    int num_boxes = 0;
+
+    t0 = now_ms();
+    for (int i = 0; i < nframes; ++i) {
+        if (i > 0 && i % 10 == 0) { image.data[0] = (uint8_t)(image.data[0] + 1); }
+
+        auto boxes = cached_infer(cache, model_id, image.data, image_bytes, confidence_threshold, nms_threshold, [&]() {
+            return gpu_decode(ptr, nrows, ncols, confidence_threshold, nms_threshold);
+        });
+        num_boxes = boxes.size();
+    }
+    t1 = now_ms();
+
+    auto stats = cache.stats();
+    printf("frames = %d, boxes = %d, total = %.2f ms, avg = %.3f ms/frame\n", nframes, num_boxes, t1 - t0, (t1 - t0) / nframes);
+    printf("cache hits = %llu, misses = %llu, hit rate = %.2f%%, entries = %zu, evictions = %llu, memory = %.2f KB\n",
+           (unsigned long long)stats.hits, (unsigned long long)stats.misses, stats.hit_rate() * 100,
+           stats.entries, (unsigned long long)stats.evictions, stats.memory_bytes / 1024.0);
+
+    // 阈值不同的请求不能共用缓存结果
+    auto boxes = cached_infer(cache, model_id, image.data, image_bytes, 0.5f, nms_threshold, [&]() {
+        return gpu_decode(ptr, nrows, ncols, 0.5f, nms_threshold);
+    });
+    stats = cache.stats();
+    printf("threshold = 0.5: boxes = %d, misses = %llu\n", (int)boxes.size(), (unsigned long long)stats.misses);
+    return;
+}
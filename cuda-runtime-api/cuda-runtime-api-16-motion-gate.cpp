@@ -0,0 +1,147 @@
+#include "cuda-runtime-api.h"
+
+/*
+ * 合成视频序列：灰度渐变背景 + 每帧独立的随机噪声，可选地叠加一个移动的方块和整体亮度偏移，
+ * 用来验证门控在静止、运动、缓慢渐变三种情况下的行为。
+ */
+static void synth_frame(std::vector<uint8_t> &frame, int width, int height, int frame_index,
+                        bool with_square, int square_x, float brightness) {
+    frame.resize(width * height * 3);
+    // 简单的线性同余随机数，保证每次运行结果一致
+    uint32_t seed = 1234567u + frame_index * 7919u;
+    for (int y = 0; y < height; ++y) {
+        uint8_t *row = frame.data() + y * width * 3;
+        for (int x = 0; x < width; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            int noise = (int)(seed >> 29) - 4; // [-4, 3]
+            int value = (x + y) * 200 / (width + height) + 30 + (int)brightness + noise;
+            if (with_square && x >= square_x && x < square_x + 64 && y >= 200 && y < 264) { value = 240 + noise; }
+            value = std::min(std::max(value, 0), 255);
+            row[x * 3 + 0] = (uint8_t)value;
+            row[x * 3 + 1] = (uint8_t)value;
+            row[x * 3 + 2] = (uint8_t)value;
+        }
+    }
+}
+
+static bool check(const char *name, int value, int expect) {
+    bool ok = value == expect;
+    printf("%-40s %4d (expect %4d) %s\n", name, value, expect, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static bool check_range(const char *name, int value, int low, int high) {
+    bool ok = value >= low && value <= high;
+    printf("%-40s %4d (expect %d~%d) %s\n", name, value, low, high, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+void cuda_runtime_api_16_motion_gate() {
+    const int width = 640;
+    const int height = 480;
+    std::vector<uint8_t> frame;
+    int infer_calls = 0;
+    auto fake_infer = [&]() {
+        infer_calls++;
+        return std::vector<Box>{Box(100, 200, 164, 264, 0.9f, 0)};
+    };
+
+    MotionGateConfig config;
+    config.max_skip_frames = 10;
+    bool all_ok = true;
+
+    // ------------------------------ 1. 静止画面：只在最大跳过间隔处推理 ----------------------------
+    {
+        MotionGate gate(config);
+        infer_calls = 0;
+        for (int i = 0; i < 100; ++i) {
+            synth_frame(frame, width, height, i, false, 0, 0);
+            gate.process(frame.data(), width, height, width * 3, fake_infer);
+        }
+        // 每次推理之后最多跳过 10 帧，所以是每 11 帧推理一次：0, 11, 22, ..., 99
+        all_ok &= check("static: inferred frames", infer_calls, 10);
+        all_ok &= check("static: skipped frames", (int)gate.skipped_frames(), 90);
+        printf("static: last mean delta = %.3f, changed ratio = %.5f\n", gate.last_delta().mean_delta, gate.last_delta().changed_ratio);
+    }
+
+    // ------------------------------ 2. 移动的方块：每帧都需要推理 ----------------------------
+    {
+        MotionGate gate(config);
+        infer_calls = 0;
+        for (int i = 0; i < 50; ++i) {
+            synth_frame(frame, width, height, i, true, 40 + i * 8, 0);
+            gate.process(frame.data(), width, height, width * 3, fake_infer);
+        }
+        all_ok &= check("moving square: inferred frames", infer_calls, 50);
+        all_ok &= check("moving square: skipped frames", (int)gate.skipped_frames(), 0);
+    }
+
+    // ------------------------------ 3. 静止 -> 运动 -> 静止 ----------------------------
+    {
+        MotionGate gate(config);
+        infer_calls = 0;
+        int square_x = 100;
+        for (int i = 0; i < 60; ++i) {
+            // 第 20~29 帧方块移动，其余时间方块静止
+            if (i >= 20 && i < 30) { square_x += 8; }
+            synth_frame(frame, width, height, i, true, square_x, 0);
+            gate.process(frame.data(), width, height, width * 3, fake_infer);
+        }
+        // 0, 11 两次（静止段）+ 20~29 十次 + 之后的静止段 40, 51 两次
+        all_ok &= check("static-moving-static: inferred frames", infer_calls, 14);
+    }
+
+    // ------------------------------ 4. 缓慢的整体亮度变化：累积到阈值后推理 ----------------------------
+    {
+        MotionGate gate(config);
+        infer_calls = 0;
+        for (int i = 0; i < 30; ++i) {
+            synth_frame(frame, width, height, i, false, 0, i * 0.75f);
+            gate.process(frame.data(), width, height, width * 3, fake_infer);
+        }
+        /*
+         * 参考帧是上一次推理的帧，亮度差会随帧数累积，几帧之后就会超过阈值触发推理。
+         * 只靠最大跳过间隔的话 30 帧只会推理 3 次，逐帧比较的话一次都不会触发。
+         */
+        all_ok &= check_range("slow brightness drift: inferred frames", infer_calls, 6, 15);
+    }
+
+    // ------------------------------ 5. 跳过的帧交给外推器 ----------------------------
+    {
+        MotionGate gate(config);
+        int extrapolate_calls = 0;
+        gate.set_extrapolator([&](const std::vector<Box> &last_boxes, int frames_since_infer) {
+            extrapolate_calls++;
+            // 这里只是演示，按每帧向右移动 1 个像素外推
+            std::vector<Box> boxes = last_boxes;
+            for (auto &box : boxes) {
+                box.left += frames_since_infer;
+                box.right += frames_since_infer;
+            }
+            return boxes;
+        });
+        std::vector<Box> boxes;
+        for (int i = 0; i < 5; ++i) {
+            synth_frame(frame, width, height, i, false, 0, 0);
+            boxes = gate.process(frame.data(), width, height, width * 3, fake_infer);
+        }
+        all_ok &= check("extrapolator calls", extrapolate_calls, 4);
+        printf("extrapolated box left = %.1f\n", boxes.empty() ? 0.0f : boxes[0].left);
+    }
+
+    // ------------------------------ 6. 门控本身的耗时 ----------------------------
+    {
+        MotionGate gate(config);
+        synth_frame(frame, 1920, 1080, 0, false, 0, 0);
+        int ntry = 100;
+        gate.process(frame.data(), 1920, 1080, 1920 * 3, fake_infer);
+        auto t0 = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+        for (int i = 0; i < ntry; ++i) {
+            gate.need_infer(frame.data(), 1920, 1080, 1920 * 3);
+        }
+        auto t1 = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+        printf("gate cost on 1920x1080: %.4f ms/frame\n", (t1 - t0) / ntry);
+    }
+
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
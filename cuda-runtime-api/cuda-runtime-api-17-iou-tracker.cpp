@@ -0,0 +1,123 @@
+#include "cuda-runtime-api.h"
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+// 合成的匀速运动目标
+struct SynthObject {
+    float cx, cy, vx, vy, w, h;
+    int label;
+};
+
+static std::vector<SynthObject> make_objects(int count) {
+    std::vector<SynthObject> objects;
+    // 线性同余随机数，保证每次运行结果一致
+    uint32_t seed = 20240601u;
+    auto rand01 = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+    // 目标按网格摆放，间距大于目标尺寸加上最大位移，避免不同目标之间互相重叠
+    int cols = 25;
+    for (int i = 0; i < count; ++i) {
+        SynthObject obj;
+        obj.cx = 80 + (i % cols) * 150.0f;
+        obj.cy = 80 + (i / cols) * 150.0f;
+        obj.vx = (rand01() - 0.5f) * 4.0f;
+        obj.vy = (rand01() - 0.5f) * 4.0f;
+        obj.w = 40 + rand01() * 30;
+        obj.h = 40 + rand01() * 30;
+        obj.label = i % 3;
+        objects.push_back(obj);
+    }
+    return objects;
+}
+
+static std::vector<Box> ground_truth(const std::vector<SynthObject> &objects, int frame) {
+    std::vector<Box> boxes;
+    for (auto &obj : objects) {
+        float cx = obj.cx + obj.vx * frame;
+        float cy = obj.cy + obj.vy * frame;
+        boxes.emplace_back(cx - obj.w * 0.5f, cy - obj.h * 0.5f, cx + obj.w * 0.5f, cy + obj.h * 0.5f, 0.9f, obj.label);
+    }
+    return boxes;
+}
+
+static void run_sequence(const char *name, const TrackerConfig &config, const std::vector<SynthObject> &objects, int nframes, int interval) {
+    DetectScheduler scheduler(interval, 0.3f, config);
+    std::vector<float> iou;
+    double update_ms = 0, predict_ms = 0;
+    double skipped_iou_sum = 0;
+    int skipped_iou_count = 0;
+
+    // 每个真实目标第一次匹配到的轨迹 id，之后 id 变化记为一次 id switch
+    std::vector<int> gt_track_id(objects.size(), 0);
+    int id_switches = 0;
+
+    for (int frame = 0; frame < nframes; ++frame) {
+        auto gt = ground_truth(objects, frame);
+        bool detect = scheduler.need_detect();
+
+        double t0 = now_ms();
+        auto boxes = scheduler.process([&]() { return gt; });
+        double t1 = now_ms();
+        (detect ? update_ms : predict_ms) += t1 - t0;
+
+        // 用 IoU 矩阵把轨迹和真实框对应起来，统计外推帧的平均 IoU 和 id switch
+        auto &tracks = scheduler.tracker().tracks();
+        iou_matrix(gt, boxes, true, iou);
+        auto matches = greedy_assign(iou, gt.size(), boxes.size(), 0.1f);
+        for (auto &m : matches) {
+            int id = tracks[m.second].id;
+            if (gt_track_id[m.first] != 0 && gt_track_id[m.first] != id) { id_switches++; }
+            gt_track_id[m.first] = id;
+            if (!detect) {
+                skipped_iou_sum += iou[m.first * boxes.size() + m.second];
+                skipped_iou_count++;
+            }
+        }
+    }
+
+    printf("%-10s tracks = %zu, detect frames = %llu, tracked frames = %llu, id switches = %d, mean IoU on tracked frames = %.4f\n",
+           name, scheduler.tracker().tracks().size(),
+           (unsigned long long)scheduler.detected_frames(), (unsigned long long)scheduler.tracked_frames(),
+           id_switches, skipped_iou_count ? skipped_iou_sum / skipped_iou_count : 0.0);
+    printf("%-10s update = %.4f ms/frame, predict = %.4f ms/frame\n", name,
+           update_ms / std::max<uint64_t>(scheduler.detected_frames(), 1),
+           predict_ms / std::max<uint64_t>(scheduler.tracked_frames(), 1));
+}
+
+void cuda_runtime_api_17_iou_tracker() {
+    const int num_objects = 500;
+    const int nframes = 300;
+    const int interval = 5;
+    auto objects = make_objects(num_objects);
+
+    // ------------------------------ 1. IoU 矩阵 + 匹配的耗时（500 x 500） ----------------------------
+    auto a = ground_truth(objects, 0);
+    auto b = ground_truth(objects, 3);
+    std::vector<float> iou;
+    int ntry = 100;
+    double t0 = now_ms();
+    for (int i = 0; i < ntry; ++i) { iou_matrix(a, b, true, iou); }
+    double t1 = now_ms();
+    printf("iou_matrix %d x %d: %.4f ms\n", num_objects, num_objects, (t1 - t0) / ntry);
+
+    t0 = now_ms();
+    std::vector<std::pair<int, int>> greedy;
+    for (int i = 0; i < ntry; ++i) { greedy = greedy_assign(iou, num_objects, num_objects, 0.3f); }
+    t1 = now_ms();
+    printf("greedy_assign: %.4f ms, matches = %zu\n", (t1 - t0) / ntry, greedy.size());
+
+    t0 = now_ms();
+    auto hungarian = hungarian_assign(iou, num_objects, num_objects, 0.3f);
+    t1 = now_ms();
+    printf("hungarian_assign: %.4f ms, matches = %zu\n", t1 - t0, hungarian.size());
+
+    // ------------------------------ 2. 每 N 帧检测一次，中间帧跟踪外推 ----------------------------
+    TrackerConfig config;
+    run_sequence("greedy", config, objects, nframes, interval);
+    config.use_hungarian = true;
+    run_sequence("hungarian", config, objects, nframes, interval);
+}
@@ -0,0 +1,111 @@
+#include "cuda-runtime-api.h"
+#include <thread>
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+// 标准的贪心 NMS，逐对比较，用来验证网格版本的结果
+static std::vector<Box> greedy_nms(std::vector<Box> boxes, float nms_threshold) {
+    std::stable_sort(boxes.begin(), boxes.end(), [](const Box &a, const Box &b) { return a.confidence > b.confidence; });
+    std::vector<bool> remove_flags(boxes.size());
+    std::vector<Box> box_result;
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        if (remove_flags[i]) { continue; }
+        box_result.emplace_back(boxes[i]);
+        for (size_t j = i + 1; j < boxes.size(); ++j) {
+            if (remove_flags[j] || boxes[i].label != boxes[j].label) { continue; }
+            float iou = grid_box_iou(boxes[i], boxes[j]);
+            if (iou > 0 && iou >= nms_threshold) { remove_flags[j] = true; }
+        }
+    }
+    return box_result;
+}
+
+static bool same_boxes(const std::vector<Box> &a, const std::vector<Box> &b) {
+    if (a.size() != b.size()) { return false; }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].left != b[i].left || a[i].top != b[i].top || a[i].confidence != b[i].confidence || a[i].label != b[i].label) { return false; }
+    }
+    return true;
+}
+
+/*
+ * 模拟 8K 图像切片推理 + 低阈值的输出：目标随机分布，每个目标周围抖动出若干个候选框，
+ * 目标尺寸从 10 到 200 像素不等，另外混入少量大框。
+ */
+static std::vector<Box> synth_boxes(int count, int num_classes) {
+    std::vector<Box> boxes;
+    uint32_t seed = 20240619u;
+    auto rand01 = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+    const float width = 7680, height = 4320;
+    const int candidates_per_object = 8;
+    float cx = 0, cy = 0, w = 0, h = 0;
+    int label = 0;
+    for (int i = 0; i < count; ++i) {
+        if (i % candidates_per_object == 0) {
+            cx = rand01() * width;
+            cy = rand01() * height;
+            float size = rand01() < 0.01f ? 400 + rand01() * 400 : 10 + rand01() * 190;
+            w = size * (0.6f + rand01() * 0.8f);
+            h = size * (0.6f + rand01() * 0.8f);
+            label = (int)(rand01() * num_classes);
+        }
+        float bx = cx + (rand01() - 0.5f) * w * 0.3f;
+        float by = cy + (rand01() - 0.5f) * h * 0.3f;
+        float bw = w * (0.8f + rand01() * 0.4f);
+        float bh = h * (0.8f + rand01() * 0.4f);
+        boxes.emplace_back(bx - bw * 0.5f, by - bh * 0.5f, bx + bw * 0.5f, by + bh * 0.5f, 0.05f + rand01() * 0.95f, label);
+    }
+    return boxes;
+}
+
+void cuda_runtime_api_19_grid_nms() {
+    const float nms_threshold = 0.45f;
+    const int sizes[] = {1000, 5000, 10000, 50000, 100000};
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool all_ok = true;
+
+    printf("%8s %12s %14s %14s %12s %12s\n", "boxes", "greedy(ms)", "grid 1t(ms)", "grid mt(ms)", "gpu(ms)", "keep");
+    for (int n : sizes) {
+        auto boxes = synth_boxes(n, 10);
+
+        // 逐对比较的版本在 5 万以上太慢，只在较小规模上运行并用于验证
+        double greedy_ms = -1;
+        std::vector<Box> reference;
+        if (n <= 10000) {
+            double t0 = now_ms();
+            reference = greedy_nms(boxes, nms_threshold);
+            greedy_ms = now_ms() - t0;
+        }
+
+        auto input = boxes;
+        double t0 = now_ms();
+        auto single = grid_nms(input, nms_threshold, 1);
+        double single_ms = now_ms() - t0;
+
+        input = boxes;
+        t0 = now_ms();
+        auto multi = grid_nms(input, nms_threshold, max_threads);
+        double multi_ms = now_ms() - t0;
+
+        t0 = now_ms();
+        auto gpu = gpu_grid_nms(boxes, nms_threshold);
+        double gpu_ms = now_ms() - t0;
+
+        printf("%8d %12.3f %14.3f %14.3f %12.3f %12zu\n", n, greedy_ms, single_ms, multi_ms, gpu_ms, multi.size());
+
+        bool ok = same_boxes(single, multi) && same_boxes(single, gpu);
+        if (!reference.empty()) { ok &= same_boxes(reference, single); }
+        if (!ok) { printf("%8d keep set mismatch: greedy = %zu, grid = %zu, gpu = %zu\n", n, reference.size(), single.size(), gpu.size()); }
+        all_ok &= ok;
+    }
+
+    // IoU 矩阵在 10 万个框时需要 n * n * 4 字节
+    double matrix_gb = 100000.0 * 100000.0 * sizeof(float) / (1 << 30);
+    printf("iou matrix for 100000 boxes would need %.1f GB\n", matrix_gb);
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
@@ -0,0 +1,379 @@
+#include "cuda-runtime-api.h"
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+// 只 decode 不做 nms，与 decode_kernel 的过滤规则一致
+static std::vector<Box> cpu_decode_candidates(float *predict, int rows, int cols, float confidence_threshold) {
+    std::vector<Box> boxes;
+    int num_classes = cols - 5;
+    for (int i = 0; i < rows; ++i) {
+        float *pitem = predict + i * cols;
+        float objness = pitem[4];
+        if (objness < confidence_threshold) { continue; }
+
+        float *pclass = pitem + 5;
+        int label = std::max_element(pclass, pclass + num_classes) - pclass;
+        float confidence = pclass[label] * objness;
+        if (confidence < confidence_threshold) { continue; }
+
+        float cx = pitem[0], cy = pitem[1], width = pitem[2], height = pitem[3];
+        boxes.emplace_back(cx - width * 0.5f, cy - height * 0.5f, cx + width * 0.5f, cy + height * 0.5f, confidence, label);
+    }
+    return boxes;
+}
+
+std::vector<Box> cpu_decode_soft_nms(float *predict, int rows, int cols, float confidence_threshold, const SoftNMSConfig &config) {
+    return soft_nms(cpu_decode_candidates(predict, rows, cols, confidence_threshold), config);
+}
+
+std::vector<Box> gpu_decode_soft_nms(float *predict, int rows, int cols, float confidence_threshold, const SoftNMSConfig &config) {
+    std::vector<Box> box_result;
+    cudaStream_t stream = nullptr;
+    checkRuntime(cudaStreamCreate(&stream));
+
+    float *predict_device = nullptr;
+    float *output_device = nullptr;
+    float *output_host = nullptr;
+    int max_objects = 1000;
+    int NUM_BOX_ELEMENT = 7;
+    checkRuntime(cudaMalloc(&predict_device, rows * cols * sizeof(float)));
+    checkRuntime(cudaMalloc(&output_device, sizeof(float) + max_objects * NUM_BOX_ELEMENT * sizeof(float)));
+    checkRuntime(cudaMallocHost(&output_host, sizeof(float) + max_objects * NUM_BOX_ELEMENT * sizeof(float)));
+
+    checkRuntime(cudaMemcpyAsync(predict_device, predict, rows * cols * sizeof(float), cudaMemcpyHostToDevice, stream));
+    checkRuntime(cudaMemsetAsync(output_device, 0, sizeof(float), stream));
+    // decode 得到的候选框缓冲与硬 nms 相同，只是把 fast_nms_kernel 换成 soft_nms_kernel
+    decode_candidates_invoker(predict_device, rows, cols - 5, confidence_threshold, nullptr,
+                              output_device, max_objects, NUM_BOX_ELEMENT, stream);
+    soft_nms_kernel_invoker(output_device, max_objects, NUM_BOX_ELEMENT, config, stream);
+
+    checkRuntime(cudaMemcpyAsync(output_host, output_device, sizeof(float) + max_objects * NUM_BOX_ELEMENT * sizeof(float), cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaStreamSynchronize(stream));
+
+    int num_boxes = std::min((int)output_host[0], max_objects);
+    for (int i = 0; i < num_boxes; ++i) {
+        float *ptr = output_host + 1 + NUM_BOX_ELEMENT * i;
+        if (!ptr[6]) { continue; }
+        box_result.emplace_back(ptr[0], ptr[1], ptr[2], ptr[3], ptr[4], (int)ptr[5]);
+    }
+    std::stable_sort(box_result.begin(), box_result.end(), [](const Box &a, const Box &b) { return a.confidence > b.confidence; });
+
+    checkRuntime(cudaStreamDestroy(stream));
+    checkRuntime(cudaFree(predict_device));
+    checkRuntime(cudaFree(output_device));
+    checkRuntime(cudaFreeHost(output_host));
+    return box_result;
+}
+
+static float iou(const Box &a, const Box &b) {
+    float cross_w = std::min(a.right, b.right) - std::max(a.left, b.left);
+    float cross_h = std::min(a.bottom, b.bottom) - std::max(a.top, b.top);
+    if (cross_w <= 0 || cross_h <= 0) { return 0.0f; }
+    float cross_area = cross_w * cross_h;
+    return cross_area / ((a.right - a.left) * (a.bottom - a.top) + (b.right - b.left) * (b.bottom - b.top) - cross_area);
+}
+
+// 朴素的 Soft-NMS：每一轮全量扫描找最大值，再衰减所有剩余的同类别框，用来验证惰性更新的版本
+static std::vector<Box> naive_soft_nms(std::vector<Box> boxes, const SoftNMSConfig &config) {
+    std::vector<Box> box_result;
+    std::vector<int> alive;
+    for (int i = 0; i < (int)boxes.size(); ++i) {
+        if (boxes[i].confidence >= config.score_threshold) { alive.push_back(i); }
+    }
+    while (!alive.empty()) {
+        int best = 0;
+        for (int k = 1; k < (int)alive.size(); ++k) {
+            auto &a = boxes[alive[k]];
+            auto &b = boxes[alive[best]];
+            if (a.confidence > b.confidence || (a.confidence == b.confidence && alive[k] < alive[best])) { best = k; }
+        }
+        Box selected = boxes[alive[best]];
+        box_result.emplace_back(selected);
+        alive.erase(alive.begin() + best);
+
+        std::vector<int> next;
+        for (int index : alive) {
+            auto &box = boxes[index];
+            if (box.label == selected.label) {
+                box.confidence *= soft_nms_decay(config.method, iou(selected, box), config.sigma, config.iou_threshold);
+            }
+            if (box.confidence >= config.score_threshold) { next.push_back(index); }
+        }
+        alive.swap(next);
+    }
+    return box_result;
+}
+
+static bool check_near(const char *name, float value, float expect, float eps = 1e-4f) {
+    bool ok = fabsf(value - expect) < eps;
+    printf("%-44s %.4f (expect %.4f) %s\n", name, value, expect, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static bool check(const char *name, bool ok) {
+    printf("%-44s %s\n", name, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static bool same_boxes(const std::vector<Box> &a, const std::vector<Box> &b, float eps) {
+    if (a.size() != b.size()) { return false; }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].label != b[i].label || fabsf(a[i].left - b[i].left) > eps || fabsf(a[i].top - b[i].top) > eps
+            || fabsf(a[i].right - b[i].right) > eps || fabsf(a[i].bottom - b[i].bottom) > eps
+            || fabsf(a[i].confidence - b[i].confidence) > eps) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 线性同余随机数，保证每次运行结果一致
+struct Lcg {
+    uint32_t seed;
+    float next() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    }
+    // 近似正态分布，均值 0，方差 1
+    float normal() {
+        return (next() + next() + next() + next() - 2.0f) * 1.7320508f;
+    }
+};
+
+// 密集场景：目标之间互相遮挡，每个目标周围有若干个候选框
+static std::vector<Box> synth_candidates(int count, int num_classes, uint32_t seed) {
+    Lcg rng{seed};
+    std::vector<Box> boxes;
+    float cx = 0, cy = 0, w = 0, h = 0;
+    int label = 0;
+    for (int i = 0; i < count; ++i) {
+        if (i % 6 == 0) {
+            cx = rng.next() * 1280;
+            cy = rng.next() * 720;
+            w = 30 + rng.next() * 120;
+            h = 30 + rng.next() * 120;
+            label = (int)(rng.next() * num_classes);
+        }
+        float bx = cx + rng.normal() * w * 0.08f;
+        float by = cy + rng.normal() * h * 0.08f;
+        boxes.emplace_back(bx - w * 0.5f, by - h * 0.5f, bx + w * 0.5f, by + h * 0.5f, 0.1f + rng.next() * 0.9f, label);
+    }
+    return boxes;
+}
+
+// 把主机端的框写成 decode 之后的设备端缓冲 [count, box1, box2, ……]
+static float *upload_candidates(const std::vector<Box> &boxes, int max_objects, int NUM_BOX_ELEMENT) {
+    std::vector<float> host(1 + max_objects * NUM_BOX_ELEMENT, 0.0f);
+    int count = std::min((int)boxes.size(), max_objects);
+    host[0] = count;
+    for (int i = 0; i < count; ++i) {
+        float *ptr = host.data() + 1 + i * NUM_BOX_ELEMENT;
+        ptr[0] = boxes[i].left;
+        ptr[1] = boxes[i].top;
+        ptr[2] = boxes[i].right;
+        ptr[3] = boxes[i].bottom;
+        ptr[4] = boxes[i].confidence;
+        ptr[5] = boxes[i].label;
+        ptr[6] = 1;
+    }
+    float *device = nullptr;
+    checkRuntime(cudaMalloc(&device, host.size() * sizeof(float)));
+    checkRuntime(cudaMemcpy(device, host.data(), host.size() * sizeof(float), cudaMemcpyHostToDevice));
+    return device;
+}
+
+static std::vector<Box> download_candidates(const float *device, int max_objects, int NUM_BOX_ELEMENT) {
+    std::vector<float> host(1 + max_objects * NUM_BOX_ELEMENT);
+    checkRuntime(cudaMemcpy(host.data(), device, host.size() * sizeof(float), cudaMemcpyDeviceToHost));
+    std::vector<Box> boxes;
+    int count = std::min((int)host[0], max_objects);
+    for (int i = 0; i < count; ++i) {
+        float *ptr = host.data() + 1 + i * NUM_BOX_ELEMENT;
+        if (ptr[6]) { boxes.emplace_back(ptr[0], ptr[1], ptr[2], ptr[3], ptr[4], (int)ptr[5]); }
+    }
+    std::stable_sort(boxes.begin(), boxes.end(), [](const Box &a, const Box &b) { return a.confidence > b.confidence; });
+    return boxes;
+}
+
+// 按置信度与 IoU 贪心地把预测框匹配到真实框上，返回匹配上的平均 IoU
+static float mean_matched_iou(const std::vector<Box> &gt, const std::vector<Box> &pred, int *matched) {
+    std::vector<bool> used(gt.size());
+    float sum = 0;
+    *matched = 0;
+    for (auto &box : pred) {
+        int best = -1;
+        float best_iou = 0.5f;
+        for (int g = 0; g < (int)gt.size(); ++g) {
+            float value = iou(gt[g], box);
+            if (!used[g] && gt[g].label == box.label && value > best_iou) {
+                best_iou = value;
+                best = g;
+            }
+        }
+        if (best >= 0) {
+            used[best] = true;
+            sum += best_iou;
+            (*matched)++;
+        }
+    }
+    return *matched ? sum / *matched : 0.0f;
+}
+
+void cuda_runtime_api_20_soft_nms() {
+    bool all_ok = true;
+
+    // ------------------------------ 1. 两个框的解析解 ----------------------------
+    {
+        // IoU = 50 / 150 = 1/3
+        std::vector<Box> boxes = {Box(0, 0, 10, 10, 0.9f, 0), Box(5, 0, 15, 10, 0.8f, 0)};
+        SoftNMSConfig config;
+        config.method = NMSMethod::Gaussian;
+        auto result = soft_nms(boxes, config);
+        all_ok &= check_near("gaussian: decayed score", result.size() == 2 ? result[1].confidence : 0, 0.8f * expf(-(1.0f / 9.0f) / 0.5f));
+
+        config.method = NMSMethod::Linear;
+        result = soft_nms(boxes, config);
+        all_ok &= check_near("linear: decayed score", result.size() == 2 ? result[1].confidence : 0, 0.8f * (1.0f - 1.0f / 3.0f));
+
+        config.method = NMSMethod::Hard;
+        result = soft_nms(boxes, config);
+        all_ok &= check_near("hard: kept boxes", result.size(), 1);
+
+        // 两个模型的框 IoU = 81 / 119 > 0.55，融合为一个框
+        auto fused = weighted_box_fusion({{Box(0, 0, 10, 10, 0.9f, 0)}, {Box(1, 1, 11, 11, 0.6f, 0)}});
+        all_ok &= check_near("wbf: fused boxes", fused.size(), 1);
+        all_ok &= check_near("wbf: fused left", fused.empty() ? 0 : fused[0].left, (0 * 0.9f + 1 * 0.6f) / 1.5f);
+        all_ok &= check_near("wbf: fused confidence", fused.empty() ? 0 : fused[0].confidence, 0.75f);
+    }
+
+    // ------------------------------ 2. 惰性更新与朴素实现逐个一致 ----------------------------
+    auto candidates = synth_candidates(3000, 5, 20240620u);
+    const NMSMethod methods[] = {NMSMethod::Hard, NMSMethod::Linear, NMSMethod::Gaussian};
+    const char *method_names[] = {"hard", "linear", "gaussian"};
+    for (int m = 0; m < 3; ++m) {
+        SoftNMSConfig config;
+        config.method = methods[m];
+        config.score_threshold = 0.05f;
+
+        double t0 = now_ms();
+        auto reference = naive_soft_nms(candidates, config);
+        double t1 = now_ms();
+        auto fast = soft_nms(candidates, config);
+        double t2 = now_ms();
+        char name[64];
+        snprintf(name, sizeof(name), "%s: lazy == naive (%zu boxes)", method_names[m], fast.size());
+        all_ok &= check(name, same_boxes(reference, fast, 0.0f));
+        printf("%s: naive %.3f ms, lazy %.3f ms on %zu candidates\n", method_names[m], t1 - t0, t2 - t1, candidates.size());
+    }
+
+    // ------------------------------ 3. GPU 与 CPU 一致 ----------------------------
+    {
+        SoftNMSConfig config;
+        config.score_threshold = 0.05f;
+        int max_objects = 1000;
+        int NUM_BOX_ELEMENT = 7;
+        std::vector<Box> subset(candidates.begin(), candidates.begin() + max_objects);
+        auto cpu = soft_nms(subset, config);
+        std::stable_sort(cpu.begin(), cpu.end(), [](const Box &a, const Box &b) { return a.confidence > b.confidence; });
+
+        float *parray = upload_candidates(subset, max_objects, NUM_BOX_ELEMENT);
+        cudaEvent_t start, stop;
+        checkRuntime(cudaEventCreate(&start));
+        checkRuntime(cudaEventCreate(&stop));
+        checkRuntime(cudaEventRecord(start));
+        soft_nms_kernel_invoker(parray, max_objects, NUM_BOX_ELEMENT, config, nullptr);
+        checkRuntime(cudaEventRecord(stop));
+        checkRuntime(cudaEventSynchronize(stop));
+        float gpu_ms = 0;
+        checkRuntime(cudaEventElapsedTime(&gpu_ms, start, stop));
+        auto gpu = download_candidates(parray, max_objects, NUM_BOX_ELEMENT);
+        checkRuntime(cudaFree(parray));
+        printf("soft_nms_kernel on %d candidates: %.3f ms\n", max_objects, gpu_ms);
+        // 设备端 expf 与主机端有 ulp 级别的差异
+        all_ok &= check("gpu soft-nms == cpu soft-nms", same_boxes(cpu, gpu, 1e-4f));
+
+        // 真实模型输出：decode 之后分别走 CPU 与 GPU 的 soft-nms
+        auto data = load_file("../src/cuda-runtime-api/static/predict.data");
+        if (!data.empty()) {
+            float *ptr = (float *)data.data();
+            int ncols = 85;
+            int nrows = data.size() / sizeof(float) / ncols;
+            auto cpu_boxes = cpu_decode_soft_nms(ptr, nrows, ncols, 0.25f, config);
+            std::stable_sort(cpu_boxes.begin(), cpu_boxes.end(), [](const Box &a, const Box &b) { return a.confidence > b.confidence; });
+            auto gpu_boxes = gpu_decode_soft_nms(ptr, nrows, ncols, 0.25f, config);
+            all_ok &= check("predict.data: gpu == cpu", same_boxes(cpu_boxes, gpu_boxes, 1e-4f));
+        }
+        checkRuntime(cudaEventDestroy(start));
+        checkRuntime(cudaEventDestroy(stop));
+    }
+
+    // ------------------------------ 4. TTA 场景下 WBF 的定位精度 ----------------------------
+    {
+        // 3 个模型（或 3 种 TTA 变换）对同一组真实框给出带噪声的预测，另有少量误检
+        Lcg rng{20240621u};
+        std::vector<Box> gt;
+        for (int i = 0; i < 200; ++i) {
+            float cx = rng.next() * 1280, cy = rng.next() * 720;
+            float w = 40 + rng.next() * 100, h = 40 + rng.next() * 100;
+            gt.emplace_back(cx - w * 0.5f, cy - h * 0.5f, cx + w * 0.5f, cy + h * 0.5f, 1.0f, (int)(rng.next() * 3));
+        }
+        std::vector<std::vector<Box>> model_boxes(3);
+        std::vector<Box> concat;
+        for (auto &boxes : model_boxes) {
+            for (auto &g : gt) {
+                float w = g.right - g.left, h = g.bottom - g.top;
+                float noise = 0.06f;
+                boxes.emplace_back(g.left + rng.normal() * w * noise, g.top + rng.normal() * h * noise,
+                                   g.right + rng.normal() * w * noise, g.bottom + rng.normal() * h * noise,
+                                   0.5f + rng.next() * 0.5f, g.label);
+            }
+            for (int i = 0; i < 20; ++i) {
+                float x = rng.next() * 1280, y = rng.next() * 720;
+                boxes.emplace_back(x, y, x + 50, y + 50, 0.3f * rng.next(), (int)(rng.next() * 3));
+            }
+            concat.insert(concat.end(), boxes.begin(), boxes.end());
+        }
+
+        SoftNMSConfig hard;
+        hard.method = NMSMethod::Hard;
+        hard.iou_threshold = 0.55f;
+        double t0 = now_ms();
+        auto nms_boxes = soft_nms(concat, hard);
+        double t1 = now_ms();
+        auto wbf_boxes = weighted_box_fusion(model_boxes);
+        double t2 = now_ms();
+
+        int nms_matched = 0, wbf_matched = 0;
+        float nms_iou = mean_matched_iou(gt, nms_boxes, &nms_matched);
+        float wbf_iou = mean_matched_iou(gt, wbf_boxes, &wbf_matched);
+        printf("tta nms: %zu boxes, matched %d, mean IoU %.4f, %.3f ms\n", nms_boxes.size(), nms_matched, nms_iou, t1 - t0);
+        printf("tta wbf: %zu boxes, matched %d, mean IoU %.4f, %.3f ms\n", wbf_boxes.size(), wbf_matched, wbf_iou, t2 - t1);
+        all_ok &= check("wbf localizes better than nms", wbf_iou > nms_iou);
+
+        // GPU 版本：每个模型一个候选框缓冲
+        int max_objects = 1000;
+        int NUM_BOX_ELEMENT = 7;
+        std::vector<float *> parrays;
+        for (auto &boxes : model_boxes) { parrays.push_back(upload_candidates(boxes, max_objects, NUM_BOX_ELEMENT)); }
+        float *output = nullptr;
+        void *workspace = nullptr;
+        checkRuntime(cudaMalloc(&output, sizeof(float) + max_objects * NUM_BOX_ELEMENT * sizeof(float)));
+        checkRuntime(cudaMalloc(&workspace, weighted_box_fusion_workspace_size(parrays.size(), max_objects)));
+        t0 = now_ms();
+        weighted_box_fusion_invoker(parrays.data(), nullptr, parrays.size(), max_objects, NUM_BOX_ELEMENT, WBFConfig(),
+                                    output, max_objects, workspace, nullptr);
+        checkRuntime(cudaDeviceSynchronize());
+        t1 = now_ms();
+        auto gpu_wbf = download_candidates(output, max_objects, NUM_BOX_ELEMENT);
+        printf("weighted_box_fusion_invoker: %zu boxes, %.3f ms\n", gpu_wbf.size(), t1 - t0);
+        all_ok &= check("gpu wbf == cpu wbf", same_boxes(wbf_boxes, gpu_wbf, 1e-3f));
+
+        for (auto ptr : parrays) { checkRuntime(cudaFree(ptr)); }
+        checkRuntime(cudaFree(output));
+        checkRuntime(cudaFree(workspace));
+    }
+
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
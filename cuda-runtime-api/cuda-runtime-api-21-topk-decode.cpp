@@ -0,0 +1,162 @@
+#include "cuda-runtime-api.h"
+
+// 比较候选框集合时与输出顺序无关
+static bool box_less(const Box &a, const Box &b) {
+    if (a.confidence != b.confidence) { return a.confidence > b.confidence; }
+    if (a.label != b.label) { return a.label < b.label; }
+    if (a.left != b.left) { return a.left < b.left; }
+    if (a.top != b.top) { return a.top < b.top; }
+    if (a.right != b.right) { return a.right < b.right; }
+    return a.bottom < b.bottom;
+}
+
+static bool box_equal(const Box &a, const Box &b) {
+    return !box_less(a, b) && !box_less(b, a);
+}
+
+static std::vector<Box> download_candidates(const float *parray, int max_objects, int NUM_BOX_ELEMENT) {
+    std::vector<float> host(1 + max_objects * NUM_BOX_ELEMENT);
+    checkRuntime(cudaMemcpy(host.data(), parray, host.size() * sizeof(float), cudaMemcpyDeviceToHost));
+    std::vector<Box> boxes;
+    int count = std::min((int)host[0], max_objects);
+    for (int i = 0; i < count; ++i) {
+        float *ptr = host.data() + 1 + i * NUM_BOX_ELEMENT;
+        boxes.emplace_back(ptr[0], ptr[1], ptr[2], ptr[3], ptr[4], (int)ptr[5]);
+    }
+    std::sort(boxes.begin(), boxes.end(), box_less);
+    return boxes;
+}
+
+// reference 中有多少个框出现在 boxes 里，两者都已经按 box_less 排好序
+static int count_retained(const std::vector<Box> &reference, const std::vector<Box> &boxes) {
+    std::vector<Box> common;
+    std::set_intersection(reference.begin(), reference.end(), boxes.begin(), boxes.end(), std::back_inserter(common), box_less);
+    return common.size();
+}
+
+/*
+ * 低阈值、密集场景的 yolov5 输出：[cx, cy, width, height, objectness, class1, class2, ……]
+ * 大部分行通过阈值；quantize 不为 0 时把置信度量化到若干个等级，制造大量相同的置信度来检验并列的处理。
+ */
+static std::vector<float> synth_predict(int rows, int num_classes, int quantize, uint32_t seed) {
+    int cols = 5 + num_classes;
+    std::vector<float> predict(rows * cols);
+    auto rand01 = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+    for (int i = 0; i < rows; ++i) {
+        float *pitem = predict.data() + i * cols;
+        pitem[0] = rand01() * 640;
+        pitem[1] = rand01() * 640;
+        pitem[2] = 8 + rand01() * 200;
+        pitem[3] = 8 + rand01() * 200;
+        pitem[4] = rand01();
+        for (int c = 0; c < num_classes; ++c) { pitem[5 + c] = rand01() * 0.2f; }
+        pitem[5 + (int)(rand01() * num_classes)] = 0.5f + rand01() * 0.5f;
+        if (quantize) {
+            pitem[4] = std::ceil(pitem[4] * quantize) / quantize;
+            for (int c = 0; c < num_classes; ++c) { pitem[5 + c] = std::ceil(pitem[5 + c] * quantize) / quantize; }
+        }
+    }
+    return predict;
+}
+
+void cuda_runtime_api_21_topk_decode() {
+    const int rows = 25200, num_classes = 80, cols = 5 + num_classes;
+    const int NUM_BOX_ELEMENT = 7;
+    const float confidence_threshold = 0.05f;
+    bool all_ok = true;
+
+    float *predict_device = nullptr;
+    float *parray = nullptr;
+    void *workspace = nullptr;
+    int max_capacity = 4000;
+    checkRuntime(cudaMalloc(&predict_device, rows * cols * sizeof(float)));
+    checkRuntime(cudaMalloc(&parray, sizeof(float) + max_capacity * NUM_BOX_ELEMENT * sizeof(float)));
+    checkRuntime(cudaMalloc(&workspace, decode_topk_workspace_size(rows)));
+
+    cudaStream_t stream = nullptr;
+    cudaEvent_t start, stop;
+    checkRuntime(cudaStreamCreate(&stream));
+    checkRuntime(cudaEventCreate(&start));
+    checkRuntime(cudaEventCreate(&stop));
+
+    printf("%10s %8s %10s %14s %14s %12s %12s\n", "quantize", "K", "passed", "atomic kept", "topk kept", "atomic(ms)", "topk(ms)");
+    const int quantizes[] = {0, 16};
+    const int capacities[] = {100, 1000, 4000};
+    for (int quantize : quantizes) {
+        auto predict = synth_predict(rows, num_classes, quantize, 20240622u);
+        checkRuntime(cudaMemcpy(predict_device, predict.data(), predict.size() * sizeof(float), cudaMemcpyHostToDevice));
+        int passed = cpu_decode_topk_candidates(predict.data(), rows, cols, confidence_threshold, rows).size();
+
+        for (int max_objects : capacities) {
+            auto reference = cpu_decode_topk_candidates(predict.data(), rows, cols, confidence_threshold, max_objects);
+            std::sort(reference.begin(), reference.end(), box_less);
+
+            // 原来的 decode：谁先抢到 atomicAdd 谁留下
+            checkRuntime(cudaMemsetAsync(parray, 0, sizeof(float), stream));
+            checkRuntime(cudaEventRecord(start, stream));
+            decode_candidates_invoker(predict_device, rows, num_classes, confidence_threshold, nullptr,
+                                      parray, max_objects, NUM_BOX_ELEMENT, stream);
+            checkRuntime(cudaEventRecord(stop, stream));
+            checkRuntime(cudaEventSynchronize(stop));
+            float atomic_ms = 0;
+            checkRuntime(cudaEventElapsedTime(&atomic_ms, start, stop));
+            int atomic_kept = count_retained(reference, download_candidates(parray, max_objects, NUM_BOX_ELEMENT));
+
+            checkRuntime(cudaEventRecord(start, stream));
+            decode_topk_candidates_invoker(predict_device, rows, num_classes, confidence_threshold, nullptr,
+                                           parray, max_objects, NUM_BOX_ELEMENT, workspace, stream);
+            checkRuntime(cudaEventRecord(stop, stream));
+            checkRuntime(cudaEventSynchronize(stop));
+            float topk_ms = 0;
+            checkRuntime(cudaEventElapsedTime(&topk_ms, start, stop));
+            auto topk = download_candidates(parray, max_objects, NUM_BOX_ELEMENT);
+            int topk_kept = count_retained(reference, topk);
+
+            printf("%10d %8d %10d %8d/%-5zu %8d/%-5zu %12.3f %12.3f\n", quantize, max_objects, passed,
+                   atomic_kept, reference.size(), topk_kept, reference.size(), atomic_ms, topk_ms);
+            bool ok = topk.size() == reference.size() && std::equal(topk.begin(), topk.end(), reference.begin(), box_equal);
+            if (!ok) { printf("%10d %8d top-K set mismatch\n", quantize, max_objects); }
+            all_ok &= ok;
+        }
+    }
+
+    // 带逆仿射矩阵时，输出的框是参考结果映射回原图的坐标
+    {
+        const int max_objects = 100;
+        float d2i[6] = {2.0f, 0, 10.0f, 0, 2.0f, 20.0f};
+        float *d2i_device = nullptr;
+        checkRuntime(cudaMalloc(&d2i_device, sizeof(d2i)));
+        checkRuntime(cudaMemcpy(d2i_device, d2i, sizeof(d2i), cudaMemcpyHostToDevice));
+
+        auto predict = synth_predict(rows, num_classes, 0, 20240622u);
+        checkRuntime(cudaMemcpy(predict_device, predict.data(), predict.size() * sizeof(float), cudaMemcpyHostToDevice));
+        auto reference = cpu_decode_topk_candidates(predict.data(), rows, cols, confidence_threshold, max_objects);
+        for (auto &box : reference) {
+            box.left = d2i[0] * box.left + d2i[2];
+            box.top = d2i[4] * box.top + d2i[5];
+            box.right = d2i[0] * box.right + d2i[2];
+            box.bottom = d2i[4] * box.bottom + d2i[5];
+        }
+        std::sort(reference.begin(), reference.end(), box_less);
+
+        decode_topk_candidates_invoker(predict_device, rows, num_classes, confidence_threshold, d2i_device,
+                                       parray, max_objects, NUM_BOX_ELEMENT, workspace, stream);
+        checkRuntime(cudaStreamSynchronize(stream));
+        auto topk = download_candidates(parray, max_objects, NUM_BOX_ELEMENT);
+        bool ok = topk.size() == reference.size() && std::equal(topk.begin(), topk.end(), reference.begin(), box_equal);
+        printf("%-60s %s\n", "top-K boxes mapped back by invert_affine_matrix", ok ? "OK" : "FAILED");
+        all_ok &= ok;
+        checkRuntime(cudaFree(d2i_device));
+    }
+
+    checkRuntime(cudaEventDestroy(start));
+    checkRuntime(cudaEventDestroy(stop));
+    checkRuntime(cudaStreamDestroy(stream));
+    checkRuntime(cudaFree(predict_device));
+    checkRuntime(cudaFree(parray));
+    checkRuntime(cudaFree(workspace));
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
@@ -0,0 +1,235 @@
+#include "cuda-runtime-api.h"
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+// yolov5-seg 的一行：[cx, cy, width, height, objectness, class1, ……, classN, coefficient1, ……, coefficientM]
+struct SegDetection {
+    Box box;
+    int row;
+};
+
+static float box_iou(const Box &a, const Box &b) {
+    float cross_w = std::min(a.right, b.right) - std::max(a.left, b.left);
+    float cross_h = std::min(a.bottom, b.bottom) - std::max(a.top, b.top);
+    if (cross_w <= 0 || cross_h <= 0) { return 0.0f; }
+    float cross_area = cross_w * cross_h;
+    return cross_area / ((a.right - a.left) * (a.bottom - a.top) + (b.right - b.left) * (b.bottom - b.top) - cross_area);
+}
+
+// 与 cpu_decode 相同，只是记录下每个框来自哪一行，用来取出对应的 mask 系数
+static std::vector<SegDetection> cpu_decode_seg(float *predict, int rows, int cols, int num_classes,
+                                                float confidence_threshold, float nms_threshold) {
+    std::vector<SegDetection> detections;
+    for (int i = 0; i < rows; ++i) {
+        float *pitem = predict + i * cols;
+        float objness = pitem[4];
+        if (objness < confidence_threshold) { continue; }
+        float *pclass = pitem + 5;
+        int label = std::max_element(pclass, pclass + num_classes) - pclass;
+        float confidence = pclass[label] * objness;
+        if (confidence < confidence_threshold) { continue; }
+        float cx = pitem[0], cy = pitem[1], width = pitem[2], height = pitem[3];
+        detections.push_back({Box(cx - width * 0.5f, cy - height * 0.5f, cx + width * 0.5f, cy + height * 0.5f, confidence, label), i});
+    }
+    std::stable_sort(detections.begin(), detections.end(), [](const SegDetection &a, const SegDetection &b) { return a.box.confidence > b.box.confidence; });
+
+    std::vector<bool> remove_flags(detections.size());
+    std::vector<SegDetection> result;
+    for (size_t i = 0; i < detections.size(); ++i) {
+        if (remove_flags[i]) { continue; }
+        result.push_back(detections[i]);
+        for (size_t j = i + 1; j < detections.size(); ++j) {
+            if (detections[i].box.label == detections[j].box.label && box_iou(detections[i].box, detections[j].box) >= nms_threshold) {
+                remove_flags[j] = true;
+            }
+        }
+    }
+    return result;
+}
+
+struct SynthObject {
+    float cx, cy, radius; // 网络输入坐标下的圆
+    int label;
+};
+
+/*
+ * 合成的 yolov5-seg 输出：第 0 个原型恒为 1，第 j + 1 个原型在第 j 个目标处为 1 - d^2 / r^2，
+ * 目标 j 的系数只在第 j + 1 个原型上为 8，所以它的 mask 正好是半径为 r 的圆，可以和解析解比较。
+ */
+static void synth_seg_output(int num_objects, int num_classes, int num_protos, int mask_width, int mask_height, int input_size,
+                             float content_top, float content_bottom, std::vector<SynthObject> &objects, std::vector<float> &predict, std::vector<float> &prototypes, int &rows) {
+    uint32_t seed = 20240623u;
+    auto rand01 = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+
+    objects.clear();
+    for (int j = 0; j < num_objects; ++j) {
+        // 目标放在 letterbox 的有效区域内，不落在填充的灰边上
+        float radius = 20 + rand01() * 40;
+        float cx = radius + rand01() * (input_size - 2 * radius);
+        float cy = content_top + radius + rand01() * (content_bottom - content_top - 2 * radius);
+        objects.push_back({cx, cy, radius, (int)(rand01() * num_classes)});
+    }
+
+    int mask_area = mask_width * mask_height;
+    float to_mask = mask_width / (float)input_size;
+    prototypes.assign(num_protos * mask_area, 0.0f);
+    std::fill(prototypes.begin(), prototypes.begin() + mask_area, 1.0f);
+    for (int j = 0; j < num_objects && j + 1 < num_protos; ++j) {
+        float *proto = prototypes.data() + (j + 1) * mask_area;
+        float mcx = (objects[j].cx + 0.5f) * to_mask - 0.5f, mcy = (objects[j].cy + 0.5f) * to_mask - 0.5f, mr = objects[j].radius * to_mask;
+        for (int y = 0; y < mask_height; ++y) {
+            for (int x = 0; x < mask_width; ++x) {
+                float d2 = (x - mcx) * (x - mcx) + (y - mcy) * (y - mcy);
+                proto[y * mask_width + x] = 1.0f - d2 / (mr * mr);
+            }
+        }
+    }
+
+    // 每个目标 6 个抖动的候选框，再加上一些低置信度的行
+    int cols = 5 + num_classes + num_protos;
+    const int candidates = 6, noise_rows = 2000;
+    rows = num_objects * candidates + noise_rows;
+    predict.assign(rows * cols, 0.0f);
+    for (int i = 0; i < rows; ++i) {
+        float *pitem = predict.data() + i * cols;
+        if (i < num_objects * candidates) {
+            auto &object = objects[i / candidates];
+            float jitter = i % candidates == 0 ? 0 : 2.0f;
+            pitem[0] = object.cx + (rand01() - 0.5f) * jitter;
+            pitem[1] = object.cy + (rand01() - 0.5f) * jitter;
+            pitem[2] = object.radius * 2 + 4 + (rand01() - 0.5f) * jitter;
+            pitem[3] = object.radius * 2 + 4 + (rand01() - 0.5f) * jitter;
+            pitem[4] = i % candidates == 0 ? 0.95f : 0.5f + rand01() * 0.3f;
+            pitem[5 + object.label] = 0.9f;
+            float *coefficients = pitem + 5 + num_classes;
+            coefficients[i / candidates + 1] = 8.0f;
+        } else {
+            pitem[0] = rand01() * input_size;
+            pitem[1] = rand01() * input_size;
+            pitem[2] = 10 + rand01() * 50;
+            pitem[3] = 10 + rand01() * 50;
+            pitem[4] = rand01() * 0.2f;
+            pitem[5 + (int)(rand01() * num_classes)] = rand01();
+        }
+    }
+}
+
+// 与原图坐标下的圆比较
+static float disk_iou(const InstanceMask &mask, const SynthObject &object, const AffineMatrix &affine) {
+    float cx = affine.d2i[0] * object.cx + affine.d2i[2];
+    float cy = affine.d2i[4] * object.cy + affine.d2i[5];
+    float r = object.radius * affine.d2i[0];
+    int inter = 0, uni = 0;
+    for (int y = 0; y < mask.height; ++y) {
+        for (int x = 0; x < mask.width; ++x) {
+            float dx = mask.left + x - cx, dy = mask.top + y - cy;
+            bool in_disk = dx * dx + dy * dy < r * r;
+            bool in_mask = mask.at(x, y);
+            inter += in_disk && in_mask;
+            uni += in_disk || in_mask;
+        }
+    }
+    return uni ? inter / (float)uni : 0.0f;
+}
+
+void cuda_runtime_api_22_instance_seg() {
+    const int num_classes = 80, num_protos = 32, mask_width = 160, mask_height = 160, input_size = 640;
+    const int num_objects = 31;
+    bool all_ok = true;
+
+    MaskAssemblyParams params;
+    params.num_protos = num_protos;
+    params.mask_width = mask_width;
+    params.mask_height = mask_height;
+    params.input_width = input_size;
+    params.input_height = input_size;
+    params.image_width = 1280;
+    params.image_height = 720;
+    params.affine.compute(cv::Size(params.image_width, params.image_height), cv::Size(input_size, input_size));
+
+    std::vector<SynthObject> objects;
+    std::vector<float> predict, prototypes;
+    int rows = 0;
+    float content_top = params.affine.i2d[5], content_bottom = params.affine.i2d[4] * params.image_height + params.affine.i2d[5];
+    synth_seg_output(num_objects, num_classes, num_protos, mask_width, mask_height, input_size, content_top, content_bottom,
+                     objects, predict, prototypes, rows);
+    int cols = 5 + num_classes + num_protos;
+
+    auto detections = cpu_decode_seg(predict.data(), rows, cols, num_classes, 0.25f, 0.45f);
+    std::vector<Box> boxes;
+    std::vector<float> coefficients;
+    for (auto &item : detections) {
+        boxes.push_back(item.box);
+        float *pcoef = predict.data() + item.row * cols + 5 + num_classes;
+        coefficients.insert(coefficients.end(), pcoef, pcoef + num_protos);
+    }
+    printf("decode + nms: %zu boxes from %d rows\n", boxes.size(), rows);
+
+    float *prototypes_device = nullptr;
+    checkRuntime(cudaMalloc(&prototypes_device, prototypes.size() * sizeof(float)));
+    checkRuntime(cudaMemcpy(prototypes_device, prototypes.data(), prototypes.size() * sizeof(float), cudaMemcpyHostToDevice));
+
+    double t0 = now_ms();
+    auto cpu_masks = cpu_assemble_masks(boxes, coefficients.data(), prototypes.data(), params);
+    double t1 = now_ms();
+    auto gpu_masks = gpu_assemble_masks(boxes, coefficients.data(), prototypes_device, params);
+    double t2 = now_ms();
+    printf("assemble %zu masks: cpu %.3f ms, gpu %.3f ms\n", boxes.size(), t1 - t0, t2 - t1);
+
+    // 1. 每个 mask 与解析的圆一致（mask 分辨率只有原图的 1/4 左右，边缘有误差）
+    float min_iou = 1;
+    for (auto &mask : cpu_masks) {
+        int best = 0;
+        for (int j = 1; j < num_objects; ++j) {
+            float cx = (mask.box.left + mask.box.right) * 0.5f, cy = (mask.box.top + mask.box.bottom) * 0.5f;
+            auto distance = [&](int k) {
+                float ox = params.affine.d2i[0] * objects[k].cx + params.affine.d2i[2];
+                float oy = params.affine.d2i[4] * objects[k].cy + params.affine.d2i[5];
+                return (ox - cx) * (ox - cx) + (oy - cy) * (oy - cy);
+            };
+            if (distance(j) < distance(best)) { best = j; }
+        }
+        min_iou = std::min(min_iou, disk_iou(mask, objects[best], params.affine));
+    }
+    printf("%-40s %.4f %s\n", "min IoU against analytic disks", min_iou, min_iou > 0.95f ? "OK" : "FAILED");
+    all_ok &= boxes.size() == (size_t)num_objects && min_iou > 0.95f;
+
+    // 2. CPU 与 GPU 一致：GPU 上的 FMA 可能让阈值附近个别像素不同
+    long long total_pixels = 0, diff_pixels = 0;
+    bool same_roi = cpu_masks.size() == gpu_masks.size();
+    for (size_t i = 0; same_roi && i < cpu_masks.size(); ++i) {
+        auto &a = cpu_masks[i];
+        auto &b = gpu_masks[i];
+        same_roi &= a.left == b.left && a.top == b.top && a.width == b.width && a.height == b.height;
+        for (int y = 0; same_roi && y < a.height; ++y) {
+            for (int x = 0; x < a.width; ++x) { diff_pixels += a.at(x, y) != b.at(x, y); }
+        }
+        total_pixels += a.width * a.height;
+    }
+    bool agree = same_roi && diff_pixels <= total_pixels / 1000;
+    printf("%-40s %lld / %lld %s\n", "gpu vs cpu differing pixels", diff_pixels, total_pixels, agree ? "OK" : "FAILED");
+    all_ok &= agree;
+
+    // 3. 输出大小：整图 uint8 mask、裁剪后的位图、游程编码
+    size_t full_bytes = 0, bitmap_bytes = 0, rle_bytes = 0;
+    bool roundtrip = true;
+    for (auto &mask : cpu_masks) {
+        auto rle = mask_to_rle(mask);
+        auto decoded = mask_from_rle(rle, mask.left, mask.top, mask.width, mask.height);
+        roundtrip &= decoded.bits == mask.bits;
+        full_bytes += params.image_width * params.image_height;
+        bitmap_bytes += mask.bits.size() * sizeof(uint32_t);
+        rle_bytes += rle.size() * sizeof(uint32_t);
+    }
+    printf("%-40s %s\n", "rle roundtrip", roundtrip ? "OK" : "FAILED");
+    printf("output bytes: full uint8 %zu, cropped bitmap %zu, rle %zu\n", full_bytes, bitmap_bytes, rle_bytes);
+    all_ok &= roundtrip;
+
+    checkRuntime(cudaFree(prototypes_device));
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
@@ -0,0 +1,140 @@
+#include "cuda-runtime-api.h"
+#include <thread>
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+// 逐像素、逐类别的朴素实现，插值顺序与 cpu_semantic_argmax 相同，用来验证结果
+static void naive_semantic_argmax(const float *logits, const SemanticSegParams &params, uint8_t *labels) {
+    const float *i2d = params.affine.i2d;
+    float scale_x = params.logit_width / (float)params.input_width;
+    float scale_y = params.logit_height / (float)params.input_height;
+    int plane_size = params.logit_width * params.logit_height;
+    for (int y = 0; y < params.image_height; ++y) {
+        for (int x = 0; x < params.image_width; ++x) {
+            int x0, x1, y0, y1;
+            float lx, ly;
+            semantic_axis(i2d[0], i2d[2], x, scale_x, params.logit_width, &x0, &x1, &lx);
+            semantic_axis(i2d[4], i2d[5], y, scale_y, params.logit_height, &y0, &y1, &ly);
+            float best = 0;
+            int label = 0;
+            for (int c = 0; c < params.num_classes; ++c) {
+                const float *plane = logits + c * plane_size;
+                float v0 = (1 - ly) * plane[y0 * params.logit_width + x0] + ly * plane[y1 * params.logit_width + x0];
+                float v1 = (1 - ly) * plane[y0 * params.logit_width + x1] + ly * plane[y1 * params.logit_width + x1];
+                float value = (1 - lx) * v0 + lx * v1;
+                if (c == 0 || value > best) {
+                    best = value;
+                    label = c;
+                }
+            }
+            labels[y * params.image_width + x] = label;
+        }
+    }
+}
+
+/*
+ * 合成的 logits：每个类别一个种子点，logit 为到种子点距离的负数再加一点噪声，
+ * argmax 的结果近似为种子点的 Voronoi 划分，边界附近有大量接近相等的值。
+ */
+static std::vector<float> synth_logits(int num_classes, int width, int height) {
+    uint32_t seed = 20240624u;
+    auto rand01 = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+    std::vector<float> logits(num_classes * width * height);
+    std::vector<float> sx(num_classes), sy(num_classes);
+    for (int c = 0; c < num_classes; ++c) {
+        sx[c] = rand01() * width;
+        sy[c] = rand01() * height;
+    }
+    for (int c = 0; c < num_classes; ++c) {
+        float *plane = logits.data() + c * width * height;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                float distance = sqrtf((x - sx[c]) * (x - sx[c]) + (y - sy[c]) * (y - sy[c]));
+                plane[y * width + x] = -distance * 0.1f + (rand01() - 0.5f) * 0.2f;
+            }
+        }
+    }
+    return logits;
+}
+
+static int count_diff(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) { diff += a[i] != b[i]; }
+    return diff;
+}
+
+void cuda_runtime_api_23_semantic_seg() {
+    SemanticSegParams params;
+    // cityscapes 风格：19 个类别，logits 与网络输入同分辨率，一帧的 logits 约 40 MB
+    params.num_classes = 19;
+    params.logit_width = 1024;
+    params.logit_height = 512;
+    params.input_width = 1024;
+    params.input_height = 512;
+    params.image_width = 1920;
+    params.image_height = 1080;
+    params.affine.compute(cv::Size(params.image_width, params.image_height), cv::Size(params.input_width, params.input_height));
+    bool all_ok = true;
+
+    auto logits = synth_logits(params.num_classes, params.logit_width, params.logit_height);
+    size_t logits_bytes = logits.size() * sizeof(float);
+    size_t labels_bytes = params.image_width * params.image_height;
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<uint8_t> reference(labels_bytes), cpu_1t(labels_bytes), cpu_mt(labels_bytes), gpu_labels(labels_bytes);
+    double t0 = now_ms();
+    naive_semantic_argmax(logits.data(), params, reference.data());
+    double t1 = now_ms();
+    cpu_semantic_argmax(logits.data(), params, cpu_1t.data(), 1);
+    double t2 = now_ms();
+    cpu_semantic_argmax(logits.data(), params, cpu_mt.data(), num_threads);
+    double t3 = now_ms();
+    printf("cpu naive %.3f ms, simd 1 thread %.3f ms, simd %d threads %.3f ms\n", t1 - t0, t2 - t1, num_threads, t3 - t2);
+
+    bool cpu_ok = count_diff(reference, cpu_1t) == 0 && count_diff(reference, cpu_mt) == 0;
+    printf("%-40s %s\n", "simd cpu == naive", cpu_ok ? "OK" : "FAILED");
+    all_ok &= cpu_ok;
+
+    float *logits_device = nullptr;
+    uint8_t *labels_device = nullptr;
+    float *logits_host = nullptr;
+    checkRuntime(cudaMalloc(&logits_device, logits_bytes));
+    checkRuntime(cudaMalloc(&labels_device, labels_bytes));
+    checkRuntime(numa_malloc_host(&logits_host, logits_bytes));
+    checkRuntime(cudaMemcpy(logits_device, logits.data(), logits_bytes, cudaMemcpyHostToDevice));
+
+    cudaStream_t stream = nullptr;
+    checkRuntime(cudaStreamCreate(&stream));
+
+    // 原来的做法：全部 logits 拷回主机再做 argmax
+    t0 = now_ms();
+    checkRuntime(cudaMemcpyAsync(logits_host, logits_device, logits_bytes, cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaStreamSynchronize(stream));
+    cpu_semantic_argmax(logits_host, params, cpu_mt.data(), num_threads);
+    t1 = now_ms();
+
+    // 设备端 argmax + 反变换，只拷回原图分辨率的类别图
+    semantic_argmax_invoker(logits_device, params, labels_device, stream);
+    checkRuntime(cudaMemcpyAsync(gpu_labels.data(), labels_device, labels_bytes, cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaStreamSynchronize(stream));
+    t2 = now_ms();
+    printf("copy logits + cpu argmax: %.3f ms, %zu bytes to host\n", t1 - t0, logits_bytes);
+    printf("gpu argmax + copy labels: %.3f ms, %zu bytes to host\n", t2 - t1, labels_bytes);
+
+    // GPU 上的 FMA 可能让几乎相等的两个类别交换顺序
+    int diff = count_diff(reference, gpu_labels);
+    bool gpu_ok = diff <= (int)(labels_bytes / 1000);
+    printf("%-40s %d / %zu %s\n", "gpu vs cpu differing pixels", diff, labels_bytes, gpu_ok ? "OK" : "FAILED");
+    all_ok &= gpu_ok;
+
+    checkRuntime(cudaStreamDestroy(stream));
+    checkRuntime(cudaFree(logits_device));
+    checkRuntime(cudaFree(labels_device));
+    checkRuntime(numa_free_host(logits_host));
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
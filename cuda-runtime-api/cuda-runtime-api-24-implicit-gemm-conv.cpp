@@ -0,0 +1,127 @@
+#include "cuda-runtime-api.h"
+#include <thread>
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static std::vector<float> random_vector(size_t size, uint32_t seed) {
+    std::vector<float> data(size);
+    for (auto &value : data) {
+        seed = seed * 1664525u + 1013904223u;
+        value = (seed >> 8) / 16777216.0f * 2.0f - 1.0f;
+    }
+    return data;
+}
+
+// 相对误差，累加顺序不同带来的差异随 K 增长
+static float max_relative_error(const std::vector<float> &a, const std::vector<float> &b) {
+    float error = 0;
+    for (size_t i = 0; i < a.size(); ++i) { error = std::max(error, fabsf(a[i] - b[i]) / std::max(1.0f, fabsf(b[i]))); }
+    return error;
+}
+
+struct ConvCase {
+    const char *name;
+    ConvParams params;
+};
+
+static ConvParams make_params(int batch, int in_channels, int in_h, int in_w, int out_channels, int kernel_h, int kernel_w,
+                              int stride, int pad, int dilation, int groups, TensorLayout layout) {
+    ConvParams p;
+    p.batch = batch;
+    p.in_channels = in_channels;
+    p.in_h = in_h;
+    p.in_w = in_w;
+    p.out_channels = out_channels;
+    p.kernel_h = kernel_h;
+    p.kernel_w = kernel_w;
+    p.stride_h = p.stride_w = stride;
+    p.pad_h = p.pad_w = pad;
+    p.dilation_h = p.dilation_w = dilation;
+    p.groups = groups;
+    p.layout = layout;
+    return p;
+}
+
+// 比较 CPU、GPU 版本与参考结果，同时输出耗时
+static bool run_case(const ConvCase &item, bool run_naive, int num_threads) {
+    const ConvParams &p = item.params;
+    auto input = random_vector(p.input_size(), 1u);
+    auto weight = random_vector(p.weight_size(), 2u);
+    auto bias = random_vector(p.out_channels, 3u);
+    std::vector<float> reference(p.output_size()), cpu(p.output_size()), gpu(p.output_size());
+
+    double t0 = now_ms();
+    if (run_naive) { conv2d_naive(input.data(), weight.data(), bias.data(), reference.data(), p); }
+    double t1 = now_ms();
+    conv2d_cpu(input.data(), weight.data(), bias.data(), cpu.data(), p, num_threads);
+    double t2 = now_ms();
+
+    float *input_device = nullptr, *weight_device = nullptr, *bias_device = nullptr, *output_device = nullptr;
+    checkRuntime(cudaMalloc(&input_device, input.size() * sizeof(float)));
+    checkRuntime(cudaMalloc(&weight_device, weight.size() * sizeof(float)));
+    checkRuntime(cudaMalloc(&bias_device, bias.size() * sizeof(float)));
+    checkRuntime(cudaMalloc(&output_device, gpu.size() * sizeof(float)));
+    checkRuntime(cudaMemcpy(input_device, input.data(), input.size() * sizeof(float), cudaMemcpyHostToDevice));
+    checkRuntime(cudaMemcpy(weight_device, weight.data(), weight.size() * sizeof(float), cudaMemcpyHostToDevice));
+    checkRuntime(cudaMemcpy(bias_device, bias.data(), bias.size() * sizeof(float), cudaMemcpyHostToDevice));
+
+    cudaEvent_t start, stop;
+    checkRuntime(cudaEventCreate(&start));
+    checkRuntime(cudaEventCreate(&stop));
+    checkRuntime(cudaEventRecord(start));
+    conv2d_implicit_gemm(input_device, weight_device, bias_device, output_device, p, nullptr);
+    checkRuntime(cudaEventRecord(stop));
+    checkRuntime(cudaEventSynchronize(stop));
+    float gpu_ms = 0;
+    checkRuntime(cudaEventElapsedTime(&gpu_ms, start, stop));
+    checkRuntime(cudaMemcpy(gpu.data(), output_device, gpu.size() * sizeof(float), cudaMemcpyDeviceToHost));
+
+    // 太大的卷积不跑朴素版本，以 CPU 分块版本为参考
+    const auto &expect = run_naive ? reference : cpu;
+    float cpu_error = run_naive ? max_relative_error(cpu, reference) : 0.0f;
+    float gpu_error = max_relative_error(gpu, expect);
+    bool ok = cpu_error < 1e-4f && gpu_error < 1e-4f;
+    double gflop = 2.0 * p.gemm_m() * p.gemm_k() * p.gemm_n() * p.groups / 1e9;
+    printf("%-28s %10.3f %10.3f %10.3f %8.2f %10.2e %10.2e %s\n", item.name, run_naive ? t1 - t0 : -1.0, t2 - t1, gpu_ms,
+           gflop / ((t2 - t1) / 1000), cpu_error, gpu_error, ok ? "OK" : "FAILED");
+
+    checkRuntime(cudaEventDestroy(start));
+    checkRuntime(cudaEventDestroy(stop));
+    checkRuntime(cudaFree(input_device));
+    checkRuntime(cudaFree(weight_device));
+    checkRuntime(cudaFree(bias_device));
+    checkRuntime(cudaFree(output_device));
+    return ok;
+}
+
+void cuda_runtime_api_24_implicit_gemm_conv() {
+    const auto NCHW = TensorLayout::NCHW;
+    const auto NHWC = TensorLayout::NHWC;
+    const ConvCase cases[] = {
+        {"3x3 s1 p1", make_params(2, 16, 32, 32, 32, 3, 3, 1, 1, 1, 1, NCHW)},
+        {"3x3 s1 p1 nhwc", make_params(2, 16, 32, 32, 32, 3, 3, 1, 1, 1, 1, NHWC)},
+        {"3x3 s2 p1", make_params(1, 24, 33, 31, 48, 3, 3, 2, 1, 1, 1, NCHW)},
+        {"3x3 dilation 2", make_params(1, 8, 29, 29, 16, 3, 3, 1, 2, 2, 1, NCHW)},
+        {"5x3 groups 3, odd shapes", [] {
+             auto p = make_params(3, 9, 17, 13, 6, 5, 3, 1, 2, 1, 3, NHWC);
+             p.stride_h = 2;
+             p.pad_w = 1;
+             return p;
+         }()},
+        {"depthwise 3x3", make_params(1, 32, 28, 28, 32, 3, 3, 1, 1, 1, 32, NCHW)},
+        {"1x1 nhwc", make_params(4, 64, 14, 14, 128, 1, 1, 1, 0, 1, 1, NHWC)},
+        {"7x7 s2 p3 stem", make_params(1, 3, 64, 64, 16, 7, 7, 2, 3, 1, 1, NCHW)},
+    };
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool all_ok = true;
+
+    printf("%-28s %10s %10s %10s %8s %10s %10s\n", "case", "naive(ms)", "cpu(ms)", "gpu(ms)", "GFLOPS", "cpu err", "gpu err");
+    for (auto &item : cases) { all_ok &= run_case(item, true, num_threads); }
+
+    // resnet 中间层的规模，用来看分块版本与朴素版本的差距
+    all_ok &= run_case({"resnet 64x56x56 3x3", make_params(1, 64, 56, 56, 64, 3, 3, 1, 1, 1, 1, NCHW)}, true, num_threads);
+    all_ok &= run_case({"resnet 256x14x14 3x3 b8", make_params(8, 256, 14, 14, 256, 3, 3, 1, 1, 1, 1, NHWC)}, false, num_threads);
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
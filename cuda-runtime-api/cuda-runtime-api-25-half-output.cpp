@@ -0,0 +1,237 @@
+#include "cuda-runtime-api.h"
+#include <string.h>
+#include <thread>
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static const char *output_type_name(OutputType type) {
+    switch (type) {
+    case OutputType::Float16: return "fp16";
+    case OutputType::Int8: return "int8";
+    default: return "fp32";
+    }
+}
+
+// 所有 65536 个半精度值的 SIMD 转换与逐个转换一致，能精确表示的 float 转回去也一致；int8 的 256 个值
+static bool check_conversion() {
+    std::vector<uint16_t> halfs(65536);
+    std::vector<float> widened(halfs.size());
+    for (size_t i = 0; i < halfs.size(); ++i) { halfs[i] = (uint16_t)i; }
+    widen_half(halfs.data(), widened.data(), halfs.size(), 1);
+
+    int errors = 0;
+    for (size_t i = 0; i < halfs.size(); ++i) {
+        float value = half_to_float(halfs[i]);
+        bool same = memcmp(&value, &widened[i], sizeof(float)) == 0 || (value != value && widened[i] != widened[i]);
+        bool round_trip = value != value || float_to_half(value) == halfs[i];
+        errors += !same || !round_trip;
+    }
+
+    // 就近舍入到偶数：1 + 2^-11 正好在 1 和 1 + 2^-10 中间，舍入到 1；再大一点舍入到 1 + 2^-10
+    errors += float_to_half(1.0f + 1.0f / 2048) != 0x3c00;
+    errors += float_to_half(1.0f + 1.0f / 2048 + 1.0f / 65536) != 0x3c01;
+    errors += float_to_half(65519.0f) != 0x7bff || float_to_half(65520.0f) != 0x7c00;
+
+    std::vector<int8_t> int8s(256);
+    std::vector<float> int8_widened(int8s.size());
+    for (int i = 0; i < 256; ++i) { int8s[i] = (int8_t)(i - 128); }
+    widen_int8(int8s.data(), 0.05f, int8_widened.data(), int8s.size(), 1);
+    for (int i = 0; i < 256; ++i) { errors += int8_widened[i] != int8s[i] * 0.05f; }
+
+    bool ok = errors == 0;
+    printf("%-40s %s, %d errors  %s\n", "fp16 / int8 widening", widen_simd_name(), errors, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+// 与 23.cpp 相同的合成 logits，每个类别一个种子点，logit 为到种子点距离的负数加噪声
+static std::vector<float> synth_logits(int num_classes, int width, int height) {
+    uint32_t seed = 20240624u;
+    auto rand01 = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+    std::vector<float> logits((size_t)num_classes * width * height);
+    for (int c = 0; c < num_classes; ++c) {
+        float sx = rand01() * width, sy = rand01() * height;
+        float *plane = logits.data() + (size_t)c * width * height;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                float distance = sqrtf((x - sx) * (x - sx) + (y - sy) * (y - sy));
+                plane[y * width + x] = -distance * 0.1f + (rand01() - 0.5f) * 0.2f;
+            }
+        }
+    }
+    return logits;
+}
+
+static int count_diff(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) { diff += a[i] != b[i]; }
+    return diff;
+}
+
+/*
+ * 语义分割的 logits 分别以 fp32、fp16、int8 输出：
+ *   主机路径：拷回 binding.bytes() 字节，widen_output 转成 float 后 cpu_semantic_argmax；
+ *   设备路径：semantic_argmax_invoker 直接读对应类型的 logits，只拷回类别图。
+ * 两条路径读到的是同样的量化值，结果应该一致（GPU 上的 FMA 只会让极少数几乎相等的像素不同）；
+ * 与 fp32 的差别来自量化，只统计不检查 int8。
+ */
+static bool check_segmentation() {
+    SemanticSegParams params;
+    params.num_classes = 19;
+    params.logit_width = 1024;
+    params.logit_height = 512;
+    params.input_width = 1024;
+    params.input_height = 512;
+    params.image_width = 1920;
+    params.image_height = 1080;
+    params.affine.compute(cv::Size(params.image_width, params.image_height), cv::Size(params.input_width, params.input_height));
+
+    auto logits = synth_logits(params.num_classes, params.logit_width, params.logit_height);
+    float max_abs = 0;
+    for (float value : logits) { max_abs = std::max(max_abs, fabsf(value)); }
+    size_t labels_bytes = (size_t)params.image_width * params.image_height;
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    float *logits_device = nullptr, *widened = nullptr;
+    void *binding_device = nullptr, *binding_host = nullptr;
+    uint8_t *labels_device = nullptr;
+    checkRuntime(cudaMalloc(&logits_device, logits.size() * sizeof(float)));
+    checkRuntime(cudaMalloc(&binding_device, logits.size() * sizeof(float)));
+    checkRuntime(numa_malloc_host(&binding_host, logits.size() * sizeof(float)));
+    checkRuntime(numa_malloc_host(&widened, logits.size() * sizeof(float)));
+    checkRuntime(cudaMalloc(&labels_device, labels_bytes));
+    checkRuntime(cudaMemcpy(logits_device, logits.data(), logits.size() * sizeof(float), cudaMemcpyHostToDevice));
+
+    cudaStream_t stream = nullptr;
+    checkRuntime(cudaStreamCreate(&stream));
+
+    printf("%-6s %12s %10s %10s %10s %12s %12s %s\n", "type", "D2H bytes", "copy ms", "widen ms", "gpu ms", "host vs gpu", "vs fp32", "");
+    bool all_ok = true;
+    std::vector<uint8_t> fp32_labels(labels_bytes), host_labels(labels_bytes), gpu_labels(labels_bytes);
+    for (OutputType type : {OutputType::Float32, OutputType::Float16, OutputType::Int8}) {
+        OutputBinding binding;
+        binding.type = type;
+        binding.count = logits.size();
+        binding.scale = max_abs / 127.0f;
+        narrow_output_invoker(logits_device, binding_device, binding, stream);
+        checkRuntime(cudaStreamSynchronize(stream));
+
+        double t0 = now_ms();
+        checkRuntime(cudaMemcpyAsync(binding_host, binding_device, binding.bytes(), cudaMemcpyDeviceToHost, stream));
+        checkRuntime(cudaStreamSynchronize(stream));
+        double t1 = now_ms();
+        widen_output(binding_host, binding, widened, num_threads);
+        double t2 = now_ms();
+        cpu_semantic_argmax(widened, params, host_labels.data(), num_threads);
+
+        double t3 = now_ms();
+        switch (type) {
+        case OutputType::Float16: semantic_argmax_invoker((const __half *)binding_device, params, labels_device, stream); break;
+        case OutputType::Int8: semantic_argmax_invoker((const int8_t *)binding_device, params, labels_device, stream); break;
+        default: semantic_argmax_invoker((const float *)binding_device, params, labels_device, stream); break;
+        }
+        checkRuntime(cudaMemcpyAsync(gpu_labels.data(), labels_device, labels_bytes, cudaMemcpyDeviceToHost, stream));
+        checkRuntime(cudaStreamSynchronize(stream));
+        double t4 = now_ms();
+
+        if (type == OutputType::Float32) { fp32_labels = host_labels; }
+        int host_gpu_diff = count_diff(host_labels, gpu_labels);
+        int fp32_diff = count_diff(host_labels, fp32_labels);
+        bool ok = host_gpu_diff <= (int)(labels_bytes / 1000) && (type == OutputType::Int8 || fp32_diff <= (int)(labels_bytes / 100));
+        printf("%-6s %12zu %10.3f %10.3f %10.3f %12d %12d %s\n", output_type_name(type), binding.bytes(), t1 - t0, t2 - t1, t4 - t3,
+               host_gpu_diff, fp32_diff, ok ? "OK" : "FAILED");
+        all_ok &= ok;
+    }
+
+    checkRuntime(cudaStreamDestroy(stream));
+    checkRuntime(cudaFree(logits_device));
+    checkRuntime(cudaFree(binding_device));
+    checkRuntime(numa_free_host(binding_host));
+    checkRuntime(numa_free_host(widened));
+    checkRuntime(cudaFree(labels_device));
+    return all_ok;
+}
+
+// 12.cpp 的 gpu_decode，predict 已经在设备端，类型为 T
+template <typename T>
+static std::vector<Box> decode_on_device(T *predict_device, int rows, int cols, cudaStream_t stream) {
+    const int max_objects = 1000, NUM_BOX_ELEMENT = 7;
+    size_t output_size = 1 + max_objects * NUM_BOX_ELEMENT;
+    float *output_device = nullptr;
+    std::vector<float> output_host(output_size);
+    checkRuntime(cudaMalloc(&output_device, output_size * sizeof(float)));
+    checkRuntime(cudaMemsetAsync(output_device, 0, sizeof(float), stream));
+    decode_kernel_invoker(predict_device, rows, cols - 5, 0.25f, 0.45f, nullptr, output_device, max_objects, NUM_BOX_ELEMENT, stream);
+    checkRuntime(cudaMemcpyAsync(output_host.data(), output_device, output_size * sizeof(float), cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaStreamSynchronize(stream));
+    checkRuntime(cudaFree(output_device));
+
+    std::vector<Box> boxes;
+    int count = std::min((int)output_host[0], max_objects);
+    for (int i = 0; i < count; ++i) {
+        float *ptr = output_host.data() + 1 + NUM_BOX_ELEMENT * i;
+        if (ptr[6]) { boxes.emplace_back(ptr[0], ptr[1], ptr[2], ptr[3], ptr[4], (int)ptr[5]); }
+    }
+    std::sort(boxes.begin(), boxes.end(), [](const Box &a, const Box &b) { return a.confidence > b.confidence; });
+    return boxes;
+}
+
+/*
+ * 12.cpp 的 predict.data 以 fp16 输出：decode 直接读 half，与 fp32 的结果比较，
+ * fp16 在 640 附近的精度为 0.5 像素，置信度的相对误差约 1e-3。
+ */
+static bool check_yolo_decode() {
+    auto data = load_file("../src/cuda-runtime-api/static/predict.data");
+    const int cols = 85;
+    int rows = (int)(data.size() / sizeof(float) / cols);
+    if (rows == 0) {
+        printf("Failed to load predict.data\n");
+        return false;
+    }
+
+    OutputBinding binding;
+    binding.type = OutputType::Float16;
+    binding.count = (size_t)rows * cols;
+    float *predict_device = nullptr;
+    __half *predict_half = nullptr;
+    cudaStream_t stream = nullptr;
+    checkRuntime(cudaStreamCreate(&stream));
+    checkRuntime(cudaMalloc(&predict_device, binding.count * sizeof(float)));
+    checkRuntime(cudaMalloc(&predict_half, binding.bytes()));
+    checkRuntime(cudaMemcpy(predict_device, data.data(), binding.count * sizeof(float), cudaMemcpyHostToDevice));
+    narrow_output_invoker(predict_device, predict_half, binding, stream);
+
+    auto fp32_boxes = decode_on_device(predict_device, rows, cols, stream);
+    auto fp16_boxes = decode_on_device((const __half *)predict_half, rows, cols, stream);
+
+    // 每个 fp16 的框在 fp32 的结果中都有同类别、坐标差不超过 1 像素的框
+    int matched = 0;
+    for (const auto &a : fp16_boxes) {
+        for (const auto &b : fp32_boxes) {
+            if (a.label == b.label && fabsf(a.left - b.left) <= 1 && fabsf(a.top - b.top) <= 1 && fabsf(a.right - b.right) <= 1
+                && fabsf(a.bottom - b.bottom) <= 1 && fabsf(a.confidence - b.confidence) <= 5e-3f) {
+                ++matched;
+                break;
+            }
+        }
+    }
+    bool ok = !fp32_boxes.empty() && fp16_boxes.size() == fp32_boxes.size() && matched == (int)fp16_boxes.size();
+    printf("%-40s fp32 %zu boxes, fp16 %zu boxes, %d matched, predict %zu -> %zu bytes  %s\n", "yolo decode on fp16 predict",
+           fp32_boxes.size(), fp16_boxes.size(), matched, binding.count * sizeof(float), binding.bytes(), ok ? "OK" : "FAILED");
+
+    checkRuntime(cudaStreamDestroy(stream));
+    checkRuntime(cudaFree(predict_device));
+    checkRuntime(cudaFree(predict_half));
+    return ok;
+}
+
+void cuda_runtime_api_25_half_output() {
+    bool all_ok = check_conversion();
+    all_ok &= check_segmentation();
+    all_ok &= check_yolo_decode();
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
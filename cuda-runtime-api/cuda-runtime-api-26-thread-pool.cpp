@@ -0,0 +1,387 @@
+#include "cuda-runtime-api.h"
+#include <atomic>
+#include <stdexcept>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * 工作窃取线程池（thread-pool.h）与 OpenMP 的对比，工作负载是 YOLO 的 CPU 解码和 letterbox 预处理。
+ * 嵌套的版本外层按图像并行、内层按行并行：线程池只是把内层的子任务压入当前线程的队列，
+ * 同时执行的任务数不超过线程池的并发数；OpenMP 打开嵌套后每个外层线程再开一组线程，线程数是 T x T。
+ * OpenMP 的结果需要编译时打开 -fopenmp（MSVC 为 /openmp），没有打开时只打印线程池的结果。
+ */
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+// 同时在执行的叶子任务数的峰值
+struct ConcurrencyMeter {
+    std::atomic<int> running{0}, peak{0};
+
+    void enter() {
+        int now = ++running;
+        int old = peak.load();
+        while (now > old && !peak.compare_exchange_weak(old, now)) {}
+    }
+    void leave() { --running; }
+};
+
+// 运行 repeat 次取最快的一次
+template <typename Fn>
+static double best_ms(int repeat, Fn &&fn) {
+    double best = 1e30;
+    for (int i = 0; i < repeat; ++i) {
+        double t0 = now_ms();
+        fn();
+        best = std::min(best, now_ms() - t0);
+    }
+    return best;
+}
+
+/* ------------------------------------------ 解码 ------------------------------------------ */
+
+// 与 cpu_decode 的第一步相同：通过两次置信度过滤时写出框
+static bool decode_row(const float *pitem, int num_classes, float confidence_threshold, Box *box) {
+    float objness = pitem[4];
+    if (objness < confidence_threshold) { return false; }
+
+    const float *pclass = pitem + 5;
+    int label = std::max_element(pclass, pclass + num_classes) - pclass;
+    float confidence = pclass[label] * objness;
+    if (confidence < confidence_threshold) { return false; }
+
+    float cx = pitem[0], cy = pitem[1], width = pitem[2], height = pitem[3];
+    *box = Box(cx - width * 0.5f, cy - height * 0.5f, cx + width * 0.5f, cy + height * 0.5f, confidence, label);
+    return true;
+}
+
+// 一个 batch 的输出 [batch, rows, cols]，每行的结果写到固定的位置，收集时按行的顺序，所以与串行的结果完全一致
+struct DecodeBatch {
+    std::vector<float> predict;
+    int batch = 0, rows = 0, cols = 0;
+    float confidence_threshold = 0.25f;
+    std::vector<Box> boxes;
+    std::vector<uint8_t> valid;
+
+    void reset() {
+        boxes.assign((size_t)batch * rows, Box());
+        valid.assign((size_t)batch * rows, 0);
+    }
+
+    // 全局行号 [begin, end)
+    void decode(int64_t begin, int64_t end) {
+        for (int64_t r = begin; r < end; ++r) {
+            valid[r] = decode_row(predict.data() + r * cols, cols - 5, confidence_threshold, &boxes[r]);
+        }
+    }
+
+    std::vector<Box> collect() const {
+        std::vector<Box> result;
+        for (size_t r = 0; r < valid.size(); ++r) {
+            if (valid[r]) { result.push_back(boxes[r]); }
+        }
+        return result;
+    }
+};
+
+static bool same_boxes(const std::vector<Box> &a, const std::vector<Box> &b) {
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(Box)) == 0);
+}
+
+/* ------------------------------------------ 预处理 ------------------------------------------ */
+
+// letterbox 到 dst_width x dst_height，双线性插值，填充 114，BGR -> RGB，除以 255，HWC -> CHW
+struct PreprocessBatch {
+    std::vector<cv::Mat> images;
+    int dst_width = 640, dst_height = 640;
+    std::vector<AffineMatrix> affines;
+    std::vector<float> output;
+
+    void setup() {
+        affines.resize(images.size());
+        for (size_t i = 0; i < images.size(); ++i) { affines[i].compute(images[i].size(), cv::Size(dst_width, dst_height)); }
+    }
+
+    void reset() { output.assign(images.size() * 3 * dst_width * dst_height, 0.0f); }
+
+    // 全局行号 [begin, end)，第 row 行属于第 row / dst_height 张图像
+    void preprocess(int64_t begin, int64_t end) {
+        const float fill = 114.0f;
+        size_t area = (size_t)dst_width * dst_height;
+        for (int64_t row = begin; row < end; ++row) {
+            int n = (int)(row / dst_height), dy = (int)(row % dst_height);
+            const cv::Mat &image = images[n];
+            const float *d2i = affines[n].d2i;
+            float *pr = output.data() + n * 3 * area + (size_t)dy * dst_width;
+            float *pg = pr + area, *pb = pg + area;
+            for (int dx = 0; dx < dst_width; ++dx) {
+                float src_x = d2i[0] * dx + d2i[1] * dy + d2i[2];
+                float src_y = d2i[3] * dx + d2i[4] * dy + d2i[5];
+                float c0 = fill, c1 = fill, c2 = fill;
+                if (src_x > -1 && src_x < image.cols && src_y > -1 && src_y < image.rows) {
+                    int x_low = (int)floorf(src_x), y_low = (int)floorf(src_y);
+                    float lx = src_x - x_low, ly = src_y - y_low, hx = 1 - lx, hy = 1 - ly;
+                    float w[4] = {hy * hx, hy * lx, ly * hx, ly * lx};
+                    int xs[4] = {x_low, x_low + 1, x_low, x_low + 1};
+                    int ys[4] = {y_low, y_low, y_low + 1, y_low + 1};
+                    c0 = c1 = c2 = 0;
+                    for (int k = 0; k < 4; ++k) {
+                        bool inside = xs[k] >= 0 && xs[k] < image.cols && ys[k] >= 0 && ys[k] < image.rows;
+                        const uint8_t *v = inside ? image.ptr<uint8_t>(ys[k]) + xs[k] * 3 : nullptr;
+                        c0 += w[k] * (v ? v[0] : fill);
+                        c1 += w[k] * (v ? v[1] : fill);
+                        c2 += w[k] * (v ? v[2] : fill);
+                    }
+                }
+                pr[dx] = c2 / 255.0f;
+                pg[dx] = c1 / 255.0f;
+                pb[dx] = c0 / 255.0f;
+            }
+        }
+    }
+};
+
+/* ------------------------------------------ 对比 ------------------------------------------ */
+
+static void print_row(const char *name, double ms, double serial_ms, const char *extra, bool ok) {
+    printf("%-28s %9.3f ms  x%5.2f  %-16s %s\n", name, ms, serial_ms / ms, extra, ok ? "OK" : "FAILED");
+}
+
+static bool benchmark_decode(DecodeBatch &d, int concurrency) {
+    printf("\n-- yolo decode, batch %d x %d rows x %d cols --\n", d.batch, d.rows, d.cols);
+    int64_t total = (int64_t)d.batch * d.rows;
+    d.reset();
+    double serial_ms = best_ms(3, [&]() { d.decode(0, total); });
+    auto expected = d.collect();
+    print_row("serial", serial_ms, serial_ms, "", true);
+
+    bool all_ok = true;
+    d.reset();
+    double ms = best_ms(3, [&]() { parallel_for(0, total, [&](int64_t b, int64_t e) { d.decode(b, e); }); });
+    bool ok = same_boxes(d.collect(), expected);
+    print_row("pool parallel_for", ms, serial_ms, "", ok);
+    all_ok &= ok;
+
+    // 外层按图像，内层按行，只统计内层的任务
+    ConcurrencyMeter meter;
+    d.reset();
+    ms = best_ms(3, [&]() {
+        parallel_for(0, d.batch, [&](int64_t b0, int64_t b1) {
+            for (int64_t n = b0; n < b1; ++n) {
+                parallel_for(n * d.rows, (n + 1) * d.rows, [&](int64_t b, int64_t e) {
+                    meter.enter();
+                    d.decode(b, e);
+                    meter.leave();
+                });
+            }
+        }, 1);
+    });
+    ok = same_boxes(d.collect(), expected) && meter.peak.load() <= concurrency;
+    all_ok &= ok;
+    print_row("pool nested", ms, serial_ms, cv::format("peak %d/%d", meter.peak.load(), concurrency).c_str(), ok);
+
+#ifdef _OPENMP
+    d.reset();
+    ms = best_ms(3, [&]() {
+#pragma omp parallel for schedule(dynamic, 256)
+        for (int64_t r = 0; r < total; ++r) { d.decode(r, r + 1); }
+    });
+    ok = same_boxes(d.collect(), expected);
+    print_row("openmp parallel for", ms, serial_ms, "", ok);
+    all_ok &= ok;
+
+    // 打开嵌套：外层的每个线程再开一组线程，峰值会超过核心数
+    ConcurrencyMeter omp_meter;
+    int old_levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+    d.reset();
+    ms = best_ms(3, [&]() {
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int n = 0; n < d.batch; ++n) {
+#pragma omp parallel
+            {
+                omp_meter.enter();
+#pragma omp for schedule(dynamic, 256)
+                for (int64_t r = (int64_t)n * d.rows; r < (int64_t)(n + 1) * d.rows; ++r) { d.decode(r, r + 1); }
+                omp_meter.leave();
+            }
+        }
+    });
+    omp_set_max_active_levels(old_levels);
+    ok = same_boxes(d.collect(), expected);
+    all_ok &= ok;
+    print_row("openmp nested", ms, serial_ms, cv::format("peak %d/%d", omp_meter.peak.load(), concurrency).c_str(), ok);
+#else
+    printf("%-28s not compiled with OpenMP\n", "openmp");
+#endif
+    return all_ok;
+}
+
+static bool benchmark_preprocess(PreprocessBatch &p, int concurrency) {
+    int batch = (int)p.images.size();
+    printf("\n-- letterbox preprocess, batch %d x %dx%d -> %dx%d --\n", batch, p.images[0].cols, p.images[0].rows, p.dst_width, p.dst_height);
+    int64_t total = (int64_t)batch * p.dst_height;
+    p.reset();
+    double serial_ms = best_ms(3, [&]() { p.preprocess(0, total); });
+    std::vector<float> expected = p.output;
+    print_row("serial", serial_ms, serial_ms, "", true);
+
+    bool all_ok = true;
+    p.reset();
+    double ms = best_ms(3, [&]() { parallel_for(0, total, [&](int64_t b, int64_t e) { p.preprocess(b, e); }); });
+    bool ok = p.output == expected;
+    print_row("pool parallel_for", ms, serial_ms, "", ok);
+    all_ok &= ok;
+
+    ConcurrencyMeter meter;
+    p.reset();
+    ms = best_ms(3, [&]() {
+        parallel_for(0, batch, [&](int64_t b0, int64_t b1) {
+            for (int64_t n = b0; n < b1; ++n) {
+                parallel_for(n * p.dst_height, (n + 1) * p.dst_height, [&](int64_t b, int64_t e) {
+                    meter.enter();
+                    p.preprocess(b, e);
+                    meter.leave();
+                });
+            }
+        }, 1);
+    });
+    ok = p.output == expected && meter.peak.load() <= concurrency;
+    all_ok &= ok;
+    print_row("pool nested", ms, serial_ms, cv::format("peak %d/%d", meter.peak.load(), concurrency).c_str(), ok);
+
+#ifdef _OPENMP
+    p.reset();
+    ms = best_ms(3, [&]() {
+#pragma omp parallel for schedule(static)
+        for (int64_t row = 0; row < total; ++row) { p.preprocess(row, row + 1); }
+    });
+    ok = p.output == expected;
+    print_row("openmp parallel for", ms, serial_ms, "", ok);
+    all_ok &= ok;
+#endif
+    return all_ok;
+}
+
+/* ------------------------------------------ 任务图 ------------------------------------------ */
+
+/*
+ * 每张图像的预处理、解码是独立的节点（节点内部再用 parallel_for），最后一个节点依赖所有节点，
+ * 检查它执行时其他节点都已完成；菱形图的执行顺序；有环的图拒绝执行；任务中的异常在等待处重新抛出。
+ */
+static bool check_task_graph(DecodeBatch &d, PreprocessBatch &p) {
+    bool all_ok = true;
+    int batch = std::min(d.batch, (int)p.images.size());
+    d.reset();
+    p.reset();
+
+    TaskGraph graph;
+    std::atomic<int> finished(0);
+    int finished_before_merge = -1;
+    std::vector<TaskGraph::Node> stages;
+    for (int n = 0; n < batch; ++n) {
+        stages.push_back(graph.add([&, n]() {
+            parallel_for((int64_t)n * p.dst_height, (int64_t)(n + 1) * p.dst_height, [&](int64_t b, int64_t e) { p.preprocess(b, e); });
+            ++finished;
+        }));
+        stages.push_back(graph.add([&, n]() {
+            parallel_for((int64_t)n * d.rows, (int64_t)(n + 1) * d.rows, [&](int64_t b, int64_t e) { d.decode(b, e); });
+            ++finished;
+        }));
+    }
+    auto merge = graph.add([&]() { finished_before_merge = finished.load(); });
+    for (auto stage : stages) { graph.precede(stage, merge); }
+
+    double t0 = now_ms();
+    bool ran = graph.run();
+    double t1 = now_ms();
+    bool ok = ran && finished_before_merge == (int)stages.size();
+    printf("%-40s %zu nodes, %.3f ms  %s\n", "task graph: per-image stages -> merge", graph.size(), t1 - t0, ok ? "OK" : "FAILED");
+    all_ok &= ok;
+
+    // a -> (b, c) -> d，重复执行检查顺序
+    TaskGraph diamond;
+    std::atomic<int> step(0);
+    int at[4];
+    TaskGraph::Node nodes[4];
+    for (int i = 0; i < 4; ++i) { nodes[i] = diamond.add([&, i]() { at[i] = step++; }); }
+    diamond.precede(nodes[0], nodes[1]);
+    diamond.precede(nodes[0], nodes[2]);
+    diamond.precede(nodes[1], nodes[3]);
+    diamond.precede(nodes[2], nodes[3]);
+    ok = true;
+    for (int iter = 0; iter < 1000 && ok; ++iter) {
+        step = 0;
+        ok = diamond.run() && at[0] < at[1] && at[0] < at[2] && at[1] < at[3] && at[2] < at[3];
+    }
+    printf("%-40s %s\n", "task graph: diamond order x1000", ok ? "OK" : "FAILED");
+    all_ok &= ok;
+
+    TaskGraph cycle;
+    bool cycle_ran = false;
+    auto x = cycle.add([&]() { cycle_ran = true; });
+    auto y = cycle.add([&]() { cycle_ran = true; });
+    cycle.precede(x, y);
+    cycle.precede(y, x);
+    ok = !cycle.run() && !cycle_ran;
+    printf("%-40s %s\n", "task graph: cycle rejected", ok ? "OK" : "FAILED");
+    all_ok &= ok;
+
+    bool caught = false;
+    try {
+        parallel_for(0, 1 << 16, [](int64_t b, int64_t e) {
+            if (b <= 40000 && 40000 < e) { throw std::runtime_error("row 40000"); }
+        }, 64);
+    } catch (const std::exception &e) {
+        caught = strcmp(e.what(), "row 40000") == 0;
+    }
+    printf("%-40s %s\n", "exception propagates to caller", caught ? "OK" : "FAILED");
+    all_ok &= caught;
+    return all_ok;
+}
+
+void cuda_runtime_api_26_thread_pool() {
+    auto &pool = ThreadPool::global();
+    int concurrency = pool.concurrency();
+    printf("thread pool: %d workers + caller, hardware threads %u", pool.num_workers(), std::thread::hardware_concurrency());
+#ifdef _OPENMP
+    printf(", openmp max threads %d", omp_get_max_threads());
+#endif
+    printf("\n");
+
+    auto data = load_file("../src/cuda-runtime-api/static/predict.data");
+    cv::Mat image = cv::imread("../src/cuda-runtime-api/static/12.input-image.jpg");
+    if (data.empty() || image.empty()) {
+        printf("load predict.data / 12.input-image.jpg failed.\n");
+        return;
+    }
+
+    // 同一份输出复制成 batch 张图像，每张图像的数据都在不同的内存中
+    const int batch = 8;
+    DecodeBatch d;
+    d.batch = batch;
+    d.cols = 85;
+    d.rows = data.size() / sizeof(float) / d.cols;
+    d.predict.resize((size_t)batch * d.rows * d.cols);
+    for (int n = 0; n < batch; ++n) { memcpy(d.predict.data() + (size_t)n * d.rows * d.cols, data.data(), (size_t)d.rows * d.cols * sizeof(float)); }
+
+    // 横竖两种图像交替，letterbox 的填充区域不同
+    PreprocessBatch p;
+    cv::Mat portrait;
+    cv::transpose(image, portrait);
+    for (int n = 0; n < batch; ++n) { p.images.push_back(n % 2 ? portrait : image); }
+    p.setup();
+
+    bool all_ok = benchmark_decode(d, concurrency);
+    all_ok &= benchmark_preprocess(p, concurrency);
+    printf("\n");
+    all_ok &= check_task_graph(d, p);
+
+    auto stats = pool.stats();
+    printf("pool stats: executed %llu, stolen %llu, injected %llu, sleeps %llu\n", (unsigned long long)stats.executed,
+           (unsigned long long)stats.stolen, (unsigned long long)stats.injected, (unsigned long long)stats.sleeps);
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
@@ -0,0 +1,229 @@
+#include "cuda-runtime-api.h"
+#include <string.h>
+#include <thread>
+#ifdef __linux__
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * NUMA 拓扑与本地锁页内存：
+ *   1. 在临时目录中搭一个假的双路 sysfs，检查 CPU、GPU、网卡到节点的映射；
+ *   2. 打印本机的拓扑和线程池各工作线程绑定的节点；
+ *   3. 每个节点上分配锁页内存，比较 H2D 带宽和绑定在 GPU 所在节点的线程读取的带宽。
+ * 单节点的机器上第 3 步只有 cudaMallocHost 和 numa auto 两行。
+ */
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+#ifdef __linux__
+// 假的 sysfs 目录树，析构时删除创建过的文件和目录
+class FakeSysfs {
+public:
+    FakeSysfs() {
+        char path[] = "/tmp/fake-sysfs-XXXXXX";
+        if (mkdtemp(path) != nullptr) { root_ = path; }
+    }
+    ~FakeSysfs() {
+        for (auto it = created_.rbegin(); it != created_.rend(); ++it) { remove(it->c_str()); }
+        if (!root_.empty()) { rmdir(root_.c_str()); }
+    }
+
+    const std::string &root() const { return root_; }
+
+    void write(const std::string &relative, const std::string &text) {
+        make_parents(relative);
+        std::string path = root_ + "/" + relative;
+        FILE *f = fopen(path.c_str(), "wb");
+        if (f == nullptr) { return; }
+        fwrite(text.data(), 1, text.size(), f);
+        fclose(f);
+        created_.push_back(path);
+    }
+
+    void link(const std::string &relative, const std::string &target) {
+        make_parents(relative);
+        std::string path = root_ + "/" + relative;
+        if (symlink(target.c_str(), path.c_str()) == 0) { created_.push_back(path); }
+    }
+
+private:
+    void make_parents(const std::string &relative) {
+        for (size_t pos = relative.find('/'); pos != std::string::npos; pos = relative.find('/', pos + 1)) {
+            std::string dir = root_ + "/" + relative.substr(0, pos);
+            if (mkdir(dir.c_str(), 0755) == 0) { created_.push_back(dir); }
+        }
+    }
+
+    std::string root_;
+    std::vector<std::string> created_;
+};
+
+static void add_pci(FakeSysfs &sysfs, const char *bus_id, const char *cls, const char *vendor, const char *numa_node) {
+    std::string dir = std::string("bus/pci/devices/") + bus_id;
+    sysfs.write(dir + "/class", std::string(cls) + "\n");
+    sysfs.write(dir + "/vendor", std::string(vendor) + "\n");
+    sysfs.write(dir + "/numa_node", std::string(numa_node) + "\n");
+}
+#endif
+
+static bool check(const char *name, bool ok) {
+    printf("%-52s %s\n", name, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static bool check_parsing() {
+    bool all_ok = true;
+    std::vector<int> cpus;
+    all_ok &= check("cpulist \"0-3,8-11\"", parse_cpu_list("0-3,8-11\n", &cpus) && cpus.size() == 8 && cpus[4] == 8);
+    all_ok &= check("cpulist \"5\"", parse_cpu_list("5", &cpus) && cpus.size() == 1 && cpus[0] == 5);
+    all_ok &= check("cpulist \"\" (memory-only node)", parse_cpu_list("", &cpus) && cpus.empty());
+    all_ok &= check("cpulist \"3-1\" / \"1-3x\" rejected", !parse_cpu_list("3-1", &cpus) && !parse_cpu_list("1-3x", &cpus));
+    all_ok &= check("bus id 00000000:AF:00.0 -> 0000:af:00.0", normalize_pci_bus_id("00000000:AF:00.0") == "0000:af:00.0");
+    all_ok &= check("bus id 3B:00.0 -> 0000:3b:00.0", normalize_pci_bus_id("3B:00.0") == "0000:3b:00.0");
+    return all_ok;
+}
+
+// 双路：node0 = 0-3,8-11，node1 = 4-7,12-15，node2 只有内存；两块 GPU、一块网卡、BMC 的 VGA
+static bool check_fake_sysfs() {
+#ifdef __linux__
+    FakeSysfs sysfs;
+    if (sysfs.root().empty()) { return check("fake sysfs: mkdtemp", false); }
+    sysfs.write("devices/system/node/node0/cpulist", "0-3,8-11\n");
+    sysfs.write("devices/system/node/node1/cpulist", "4-7,12-15\n");
+    sysfs.write("devices/system/node/node2/cpulist", "\n");
+    sysfs.write("devices/system/node/online", "0-2\n");
+    add_pci(sysfs, "0000:3b:00.0", "0x030200", "0x10de", "0");
+    add_pci(sysfs, "0000:af:00.0", "0x030000", "0x10de", "1");
+    add_pci(sysfs, "0000:5e:00.0", "0x020000", "0x15b3", "0");
+    add_pci(sysfs, "0000:d8:00.0", "0x020000", "0x8086", "-1");
+    add_pci(sysfs, "0000:03:00.0", "0x030000", "0x1a03", "0");
+    add_pci(sysfs, "0000:00:1f.2", "0x010601", "0x8086", "0");
+    sysfs.link("class/net/eth0/device", "../../../bus/pci/devices/0000:5e:00.0");
+    sysfs.link("class/net/eth1/device", "../../../bus/pci/devices/0000:d8:00.0");
+    sysfs.write("class/net/lo/address", "00:00:00:00:00:00\n");
+
+    auto topology = NumaTopology::discover(sysfs.root());
+    bool all_ok = true;
+    all_ok &= check("fake sysfs: 3 nodes, 8 + 8 + 0 cpus", topology.nodes().size() == 3 && topology.nodes()[0].cpus.size() == 8
+                                                             && topology.nodes()[1].cpus.size() == 8 && topology.nodes()[2].cpus.empty());
+    all_ok &= check("fake sysfs: cpu 9 -> node 0, cpu 12 -> node 1", topology.node_of_cpu(9) == 0 && topology.node_of_cpu(12) == 1);
+    all_ok &= check("fake sysfs: 2 gpus + 2 nics, bmc vga / sata skipped", topology.devices().size() == 4);
+    all_ok &= check("fake sysfs: gpu 3b -> node 0, gpu af -> node 1",
+                    topology.node_of_pci("0000:3B:00.0") == 0 && topology.node_of_pci("00000000:AF:00.0") == 1);
+    all_ok &= check("fake sysfs: eth0 -> node 0, eth1 unknown, lo absent",
+                    topology.node_of_nic("eth0") == 0 && topology.node_of_nic("eth1") == -1 && topology.node_of_nic("lo") == -1);
+    return all_ok;
+#else
+    printf("%-52s skipped (sysfs is linux only)\n", "fake sysfs");
+    return true;
+#endif
+}
+
+static void print_system(const NumaTopology &topology) {
+    printf("\nsystem: %zu numa node(s)\n", topology.nodes().size());
+    for (auto &node : topology.nodes()) { printf("  node %d: %zu cpus\n", node.id, node.cpus.size()); }
+    for (auto &device : topology.devices()) {
+        printf("  %-3s %s %-8s node %d\n", device.kind.c_str(), device.bus_id.c_str(), device.net_name.c_str(), device.numa_node);
+    }
+    int count = 0;
+    if (cudaGetDeviceCount(&count) != cudaSuccess) {
+        cudaGetLastError();
+        count = 0;
+    }
+    for (int i = 0; i < count; ++i) { printf("  cuda device %d -> node %d\n", i, topology.node_of_gpu(i)); }
+
+    auto &pool = ThreadPool::global();
+    printf("  thread pool workers:");
+    for (int i = 0; i < pool.num_workers(); ++i) { printf(" %d", pool.worker_node(i)); }
+    printf("%s\n", pool.num_workers() == 0 ? " none" : "");
+}
+
+// 把 bytes 读一遍（按 64 位求和，防止被优化掉），返回 GB/s
+static double read_bandwidth(const void *ptr, size_t bytes, int reader_node, const NumaTopology &topology) {
+    double gbps = 0;
+    std::thread reader([&]() {
+        if (reader_node >= 0) { pin_current_thread_to_node(topology, reader_node); }
+        const uint64_t *p = (const uint64_t *)ptr;
+        size_t n = bytes / sizeof(uint64_t);
+        volatile uint64_t sink = 0;
+        double best = 1e30;
+        for (int repeat = 0; repeat < 3; ++repeat) {
+            double t0 = now_ms();
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n; ++i) { sum += p[i]; }
+            sink = sink + sum;
+            best = std::min(best, now_ms() - t0);
+        }
+        gbps = bytes / best / 1e6;
+    });
+    reader.join();
+    return gbps;
+}
+
+static bool check_placement(const NumaTopology &topology) {
+    const size_t bytes = 128 << 20;
+    int device = 0;
+    checkRuntime(cudaGetDevice(&device));
+    int gpu_node = topology.node_of_gpu(device);
+    printf("\n%zu MB pinned buffers, gpu %d on node %d\n", bytes >> 20, device, gpu_node);
+    printf("%-22s %12s %12s %16s\n", "buffer", "actual node", "H2D GB/s", "cpu read GB/s");
+
+    void *device_buffer = nullptr;
+    checkRuntime(cudaMalloc(&device_buffer, bytes));
+    cudaStream_t stream = nullptr;
+    checkRuntime(cudaStreamCreate(&stream));
+    auto h2d_gbps = [&](void *host) {
+        checkRuntime(cudaMemcpyAsync(device_buffer, host, bytes, cudaMemcpyHostToDevice, stream));
+        checkRuntime(cudaStreamSynchronize(stream));
+        double t0 = now_ms();
+        for (int i = 0; i < 5; ++i) { checkRuntime(cudaMemcpyAsync(device_buffer, host, bytes, cudaMemcpyHostToDevice, stream)); }
+        checkRuntime(cudaStreamSynchronize(stream));
+        return 5.0 * bytes / (now_ms() - t0) / 1e6;
+    };
+
+    // 读取的线程绑定在 GPU 所在的节点上，模拟预处理线程
+    int reader_node = gpu_node >= 0 ? gpu_node : -1;
+    bool all_ok = true;
+    void *host = nullptr;
+    checkRuntime(cudaMallocHost(&host, bytes));
+    memset(host, 1, bytes);
+    printf("%-22s %12d %12.2f %16.2f\n", "cudaMallocHost", numa_node_of_address(host), h2d_gbps(host),
+           read_bandwidth(host, bytes, reader_node, topology));
+    checkRuntime(cudaFreeHost(host));
+
+    std::vector<int> targets = {NUMA_NODE_AUTO};
+    if (topology.is_numa()) {
+        for (auto &node : topology.nodes()) { targets.push_back(node.id); }
+    }
+    for (int target : targets) {
+        checkRuntime(numa_malloc_host(&host, bytes, target));
+        memset(host, 1, bytes);
+        int actual = numa_node_of_address(host);
+        int expected = target == NUMA_NODE_AUTO ? gpu_node : target;
+        // 只有多节点、并且节点已知时才检查实际位置
+        bool ok = !topology.is_numa() || expected < 0 || actual == expected;
+        std::string name = target == NUMA_NODE_AUTO ? "numa auto" : cv::format("numa node %d", target);
+        printf("%-22s %12d %12.2f %16.2f %s\n", name.c_str(), actual, h2d_gbps(host), read_bandwidth(host, bytes, reader_node, topology),
+               ok ? "OK" : "FAILED");
+        all_ok &= ok;
+        checkRuntime(numa_free_host(host));
+    }
+    all_ok &= check("numa_free_host(unknown pointer) rejected", numa_free_host(&device) == cudaErrorInvalidValue);
+
+    checkRuntime(cudaStreamDestroy(stream));
+    checkRuntime(cudaFree(device_buffer));
+    return all_ok;
+}
+
+void cuda_runtime_api_27_numa_topology() {
+    bool all_ok = check_parsing();
+    all_ok &= check_fake_sysfs();
+
+    const NumaTopology &topology = NumaTopology::system();
+    print_system(topology);
+    all_ok &= check_placement(topology);
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
@@ -0,0 +1,250 @@
+#include "cuda-runtime-api.h"
+#include <string.h>
+
+/*
+ * 大页内存：
+ *   1. 各种模式下 huge_page_alloc 实际得到的页（/proc/self/smaps 中的 AnonHugePages 确认 THP 是否生效）；
+ *   2. HostArena 的对齐、扩容和 reset 之后的复用，MappedFile 与 load_file 读到的内容一致；
+ *   3. 4 KB 页与大页上的 cpu_decode（16 张图的 predict）和三种权重转换的耗时对比，结果必须逐位相同。
+ * 没有预留 hugetlbfs 大页（vm.nr_hugepages = 0）时 Explicit 不可用，Auto 退化为 THP。
+ */
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static bool check(const char *name, bool ok) {
+    printf("%-52s %s\n", name, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+// huge_page_alloc 的结果，析构时释放
+struct HugeBuffer {
+    void *ptr = nullptr;
+    size_t mapped = 0;
+    HugePageBacking backing = HugePageBacking::Normal;
+
+    HugeBuffer(size_t bytes, HugePageMode mode) {
+        ptr = huge_page_alloc(bytes, mode, &backing, &mapped);
+    }
+    ~HugeBuffer() {
+        huge_page_free(ptr, mapped);
+    }
+    HugeBuffer(const HugeBuffer &) = delete;
+    HugeBuffer &operator=(const HugeBuffer &) = delete;
+
+    template <typename T>
+    T *as() const { return (T *)ptr; }
+};
+
+static const char *mode_name(HugePageMode mode) {
+    switch (mode) {
+    case HugePageMode::Off: return "off";
+    case HugePageMode::Transparent: return "transparent";
+    case HugePageMode::Explicit: return "explicit";
+    default: return "auto";
+    }
+}
+
+static bool check_allocation() {
+    printf("huge page size %zu KB, transparent_hugepage = %s\n", huge_page_size() >> 10, transparent_huge_page_mode().c_str());
+
+    const size_t bytes = 64 << 20;
+    bool all_ok = true;
+    for (auto mode : {HugePageMode::Off, HugePageMode::Transparent, HugePageMode::Explicit, HugePageMode::Auto}) {
+        HugeBuffer buffer(bytes, mode);
+        if (buffer.ptr == nullptr) {
+            // 只有 Explicit 允许失败（没有预留大页）
+            bool ok = mode == HugePageMode::Explicit;
+            printf("  %-12s unavailable%s\n", mode_name(mode), ok ? "" : " FAILED");
+            all_ok &= ok;
+            continue;
+        }
+        memset(buffer.ptr, 1, bytes);
+        size_t thp = transparent_huge_page_bytes(buffer.ptr, bytes);
+        bool ok = buffer.mapped >= bytes && (mode != HugePageMode::Off || (buffer.backing == HugePageBacking::Normal && thp == 0));
+        printf("  %-12s backing %-8s mapped %4zu MB, thp %4zu MB %s\n", mode_name(mode), huge_page_backing_name(buffer.backing),
+               buffer.mapped >> 20, thp >> 20, ok ? "OK" : "FAILED");
+        all_ok &= ok;
+    }
+    return all_ok;
+}
+
+static bool check_arena() {
+    bool all_ok = true;
+    HostArena arena(4 << 20);
+    void *a = arena.allocate(100);
+    void *b = arena.allocate(1000, 4096);
+    all_ok &= check("arena: alignment 256 / 4096", a != nullptr && b != nullptr && (uintptr_t)a % 256 == 0 && (uintptr_t)b % 4096 == 0);
+
+    // 超过块大小的申请单独一块
+    float *c = arena.allocate_array<float>(10 << 20 >> 2);
+    all_ok &= check("arena: oversized allocation gets its own block", c != nullptr && arena.capacity() >= (14 << 20));
+    all_ok &= check("arena: non power of two alignment rejected", arena.allocate(16, 48) == nullptr);
+
+    size_t capacity = arena.capacity();
+    arena.reset();
+    all_ok &= check("arena: reset reuses blocks", arena.used() == 0 && arena.allocate(100) == a && arena.capacity() == capacity);
+    printf("  arena backing %s, capacity %zu MB\n", huge_page_backing_name(arena.backing()), arena.capacity() >> 20);
+    return all_ok;
+}
+
+static bool check_mapped_file(const char *file) {
+    bool all_ok = true;
+    auto data = load_file(file);
+    MappedFile plain, huge;
+    all_ok &= check("mapped file: mode off maps the file", plain.open(file, HugePageMode::Off) && plain.is_file_mapping());
+    all_ok &= check("mapped file: mode off matches load_file",
+                    plain.size() == data.size() && memcmp(plain.data(), data.data(), data.size()) == 0);
+    all_ok &= check("mapped file: mode auto matches load_file",
+                    huge.open(file) && huge.size() == data.size() && memcmp(huge.data(), data.data(), data.size()) == 0);
+    printf("  %s: %zu bytes, %s, backing %s\n", file, huge.size(), huge.is_file_mapping() ? "file mapping" : "copied",
+           huge_page_backing_name(huge.backing()));
+
+    MappedFile moved = std::move(huge);
+    all_ok &= check("mapped file: move leaves source empty", huge.empty() && huge.data() == nullptr && moved.size() == data.size());
+    MappedFile missing;
+    all_ok &= check("mapped file: missing file", !missing.open("../src/cuda-runtime-api/static/not-exists.data") && missing.empty());
+    return all_ok;
+}
+
+// 重复 3 次取最快的一次
+template <typename Fn>
+static double best_ms(Fn &&fn) {
+    double best = 1e30;
+    for (int i = 0; i < 3; ++i) {
+        double t0 = now_ms();
+        fn();
+        best = std::min(best, now_ms() - t0);
+    }
+    return best;
+}
+
+static bool same_boxes(const std::vector<std::vector<Box>> &a, const std::vector<std::vector<Box>> &b) {
+    if (a.size() != b.size()) { return false; }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].size() != b[i].size()) { return false; }
+        if (!a[i].empty() && memcmp(a[i].data(), b[i].data(), a[i].size() * sizeof(Box)) != 0) { return false; }
+    }
+    return true;
+}
+
+static bool benchmark_decode(const std::vector<uint8_t> &predict) {
+    const int batch = 16, ncols = 85;
+    const size_t image_bytes = predict.size();
+    int nrows = (int)(image_bytes / sizeof(float) / ncols);
+    printf("\ncpu_decode, %d x %d x %d (%zu MB)\n", batch, nrows, ncols, batch * image_bytes >> 20);
+
+    std::vector<std::vector<Box>> results[2];
+    double times[2] = {0, 0};
+    HugePageMode modes[2] = {HugePageMode::Off, HugePageMode::Auto};
+    for (int m = 0; m < 2; ++m) {
+        HugeBuffer buffer(batch * image_bytes, modes[m]);
+        if (buffer.ptr == nullptr) { return check("decode: allocate", false); }
+        for (int i = 0; i < batch; ++i) { memcpy(buffer.as<uint8_t>() + i * image_bytes, predict.data(), image_bytes); }
+        times[m] = best_ms([&]() {
+            results[m].resize(batch);
+            for (int i = 0; i < batch; ++i) { results[m][i] = cpu_decode((float *)(buffer.as<uint8_t>() + i * image_bytes), nrows, ncols); }
+        });
+        printf("  %-4s pages %-8s %8.2f ms\n", modes[m] == HugePageMode::Off ? "4k" : "huge", huge_page_backing_name(buffer.backing), times[m]);
+    }
+    printf("  speedup %.2fx\n", times[0] / times[1]);
+    return check("decode: identical boxes", same_boxes(results[0], results[1]) && !results[0].empty());
+}
+
+/*
+ * 三种常见的权重转换：
+ *   - narrow：FP32 -> FP16（float_to_half），顺序读写；
+ *   - OIHW -> OHWI：卷积权重换成通道在最后的布局，读的步长为 kernel 大小；
+ *   - transpose：全连接权重 [out, in] -> [in, out] 并转 FP16，写的步长是一整行，4 KB 页上几乎每次写都换一页。
+ */
+struct WeightTimes {
+    double narrow = 0, ohwi = 0, transpose = 0;
+};
+
+static WeightTimes convert_weights(HugePageMode mode, const std::vector<float> &conv, int O, int I, int K, const std::vector<float> &fc, int rows,
+                                   int cols, std::vector<uint16_t> *checksum) {
+    size_t conv_count = conv.size(), fc_count = fc.size();
+    HugeBuffer conv_src(conv_count * sizeof(float), mode), conv_half(conv_count * sizeof(uint16_t), mode);
+    HugeBuffer conv_ohwi(conv_count * sizeof(float), mode);
+    HugeBuffer fc_src(fc_count * sizeof(float), mode), fc_t(fc_count * sizeof(uint16_t), mode);
+    memcpy(conv_src.ptr, conv.data(), conv_count * sizeof(float));
+    memcpy(fc_src.ptr, fc.data(), fc_count * sizeof(float));
+
+    // 目标缓冲区先写一遍，计时中不包含缺页
+    memset(conv_half.ptr, 0, conv_count * sizeof(uint16_t));
+    memset(conv_ohwi.ptr, 0, conv_count * sizeof(float));
+    memset(fc_t.ptr, 0, fc_count * sizeof(uint16_t));
+
+    WeightTimes times;
+    const float *src = conv_src.as<float>();
+    times.narrow = best_ms([&]() {
+        uint16_t *dst = conv_half.as<uint16_t>();
+        for (size_t i = 0; i < conv_count; ++i) { dst[i] = float_to_half(src[i]); }
+    });
+
+    int area = K * K;
+    times.ohwi = best_ms([&]() {
+        float *dst = conv_ohwi.as<float>();
+        for (int o = 0; o < O; ++o) {
+            const float *po = src + (size_t)o * I * area;
+            for (int p = 0; p < area; ++p) {
+                for (int i = 0; i < I; ++i) { *dst++ = po[(size_t)i * area + p]; }
+            }
+        }
+    });
+
+    times.transpose = best_ms([&]() {
+        const float *s = fc_src.as<float>();
+        uint16_t *dst = fc_t.as<uint16_t>();
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) { dst[(size_t)c * rows + r] = float_to_half(s[(size_t)r * cols + c]); }
+        }
+    });
+
+    // 三个结果放在一起，用于比较两种页的输出是否逐位相同
+    checksum->assign(conv_half.as<uint16_t>(), conv_half.as<uint16_t>() + conv_count);
+    const uint16_t *ohwi_bits = conv_ohwi.as<uint16_t>();
+    checksum->insert(checksum->end(), ohwi_bits, ohwi_bits + conv_count * 2);
+    checksum->insert(checksum->end(), fc_t.as<uint16_t>(), fc_t.as<uint16_t>() + fc_count);
+    return times;
+}
+
+static bool benchmark_weights() {
+    const int O = 1024, I = 1024, K = 3, rows = 4096, cols = 4096;
+    std::vector<float> conv((size_t)O * I * K * K), fc((size_t)rows * cols);
+    uint32_t seed = 1;
+    auto next = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (int)(seed >> 8) / 8388608.0f - 1.0f;
+    };
+    for (auto &x : conv) { x = next(); }
+    for (auto &x : fc) { x = next(); }
+    printf("\nweight conversion, conv %dx%dx%dx%d (%zu MB), fc %dx%d (%zu MB)\n", O, I, K, K, conv.size() * 4 >> 20, rows, cols,
+           fc.size() * 4 >> 20);
+
+    std::vector<uint16_t> checksum[2];
+    WeightTimes small = convert_weights(HugePageMode::Off, conv, O, I, K, fc, rows, cols, &checksum[0]);
+    WeightTimes huge = convert_weights(HugePageMode::Auto, conv, O, I, K, fc, rows, cols, &checksum[1]);
+    printf("  %-22s %10s %10s %8s\n", "", "4k ms", "huge ms", "speedup");
+    printf("  %-22s %10.2f %10.2f %7.2fx\n", "fp32 -> fp16", small.narrow, huge.narrow, small.narrow / huge.narrow);
+    printf("  %-22s %10.2f %10.2f %7.2fx\n", "OIHW -> OHWI", small.ohwi, huge.ohwi, small.ohwi / huge.ohwi);
+    printf("  %-22s %10.2f %10.2f %7.2fx\n", "fc transpose + fp16", small.transpose, huge.transpose, small.transpose / huge.transpose);
+    return check("weights: identical results", checksum[0] == checksum[1]);
+}
+
+void cuda_runtime_api_28_huge_page() {
+    const char *file = "../src/cuda-runtime-api/static/predict.data";
+    auto predict = load_file(file);
+    if (predict.empty()) {
+        printf("Load %s failed.\n", file);
+        return;
+    }
+
+    bool all_ok = check_allocation();
+    all_ok &= check_arena();
+    all_ok &= check_mapped_file(file);
+    all_ok &= benchmark_decode(predict);
+    all_ok &= benchmark_weights();
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
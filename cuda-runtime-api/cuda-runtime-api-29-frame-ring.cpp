@@ -0,0 +1,368 @@
+#include "cuda-runtime-api.h"
+#include <string.h>
+#include <thread>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/*
+ * 进程间的帧环形缓冲区，fork 出一个采集进程作为写端，当前进程作为读端（推理进程）：
+ *   1. 不覆盖的模式：采集进程写 240 帧，逐帧校验内容，序号连续、没有丢帧；
+ *   2. 覆盖的模式 + 慢读端：由序号的间隔检出丢帧，received + dropped 等于写入的帧数，通过 still_valid 的帧内容都完整；
+ *   3. 1280x720 的帧送到 warp_affine_bilinear（640x640）：
+ *      socket 读入可分页内存再 cudaMemcpy，对比共享内存 register 之后直接 cudaMemcpyAsync，
+ *      以及 cudaHostRegisterMapped 之后核函数直接读共享内存，比较吞吐、延迟和结果。
+ * 采集进程只访问共享内存和 socket，不调用 CUDA（fork 出的子进程不能使用父进程的 CUDA 上下文）。
+ */
+
+#ifdef __linux__
+// 帧的内容由序号决定，开头 8 个字节是序号，读端据此校验
+static void fill_frame(uint8_t *data, int width, int height, uint64_t sequence) {
+    int line_size = width * 3;
+    for (int y = 0; y < height; ++y) {
+        uint8_t *row = data + (size_t)y * line_size;
+        uint8_t base = (uint8_t)(y * 7 + sequence * 13);
+        for (int x = 0; x < line_size; ++x) { row[x] = (uint8_t)(base + x); }
+    }
+    memcpy(data, &sequence, sizeof(sequence));
+}
+
+static bool verify_frame(const uint8_t *data, int width, int height, uint64_t sequence) {
+    uint64_t stored = 0;
+    memcpy(&stored, data, sizeof(stored));
+    if (stored != sequence) { return false; }
+    int line_size = width * 3;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *row = data + (size_t)y * line_size;
+        uint8_t base = (uint8_t)(y * 7 + sequence * 13);
+        for (int x = y == 0 ? (int)sizeof(sequence) : 0; x < line_size; ++x) {
+            if (row[x] != (uint8_t)(base + x)) { return false; }
+        }
+    }
+    return true;
+}
+
+static bool write_all(int fd, const void *data, size_t bytes) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (bytes > 0) {
+        ssize_t n = ::write(fd, p, bytes);
+        if (n <= 0) { return false; }
+        p += n;
+        bytes -= (size_t)n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void *data, size_t bytes) {
+    uint8_t *p = (uint8_t *)data;
+    while (bytes > 0) {
+        ssize_t n = ::read(fd, p, bytes);
+        if (n <= 0) { return false; }
+        p += n;
+        bytes -= (size_t)n;
+    }
+    return true;
+}
+
+struct ProducerPlan {
+    std::string name;
+    FrameRingConfig config;
+    int frames = 0;
+    int width = 0, height = 0;
+    int interval_us = 0; // 两帧之间的间隔，0 表示尽快写
+};
+
+/*
+ * 在子进程中创建环并写入 plan.frames 帧。sync 是一对 socket 中子进程的一端：
+ * 创建好之后通知父进程去 open，等父进程回复之后再开始写，保证读端不会错过第一帧。
+ */
+static pid_t spawn_ring_producer(const ProducerPlan &plan, int *sync_fd) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) { return -1; }
+    pid_t pid = fork();
+    if (pid != 0) {
+        ::close(fds[1]);
+        *sync_fd = fds[0];
+        return pid;
+    }
+
+    ::close(fds[0]);
+    FrameRingWriter writer;
+    char token = writer.create(plan.name, plan.config) ? 1 : 0;
+    if (!write_all(fds[1], &token, 1) || !token || !read_all(fds[1], &token, 1)) { _exit(1); }
+
+    FrameInfo info;
+    info.width = plan.width;
+    info.height = plan.height;
+    info.line_size = plan.width * 3;
+    info.bytes = (size_t)info.line_size * plan.height;
+    for (int i = 1; i <= plan.frames; ++i) {
+        uint8_t *slot = writer.begin_frame(5000);
+        if (slot == nullptr) { _exit(2); }
+        fill_frame(slot, plan.width, plan.height, (uint64_t)i);
+        info.timestamp_ns = frame_ring_now_ns();
+        writer.commit(info);
+        if (plan.interval_us > 0) { usleep(plan.interval_us); }
+    }
+    // 读端还在用最后几个槽位，关闭只是标记并 unlink 名字，映射由读端自己释放
+    writer.close();
+    _exit(0);
+}
+
+// 父进程一端：等待子进程创建好环，open 之后让子进程开始写
+static bool connect_reader(FrameRingReader &reader, const std::string &name, int sync_fd) {
+    char token = 0;
+    if (!read_all(sync_fd, &token, 1) || !token) { return false; }
+    bool ok = reader.open(name);
+    token = 1;
+    write_all(sync_fd, &token, 1);
+    return ok;
+}
+
+static bool join_producer(pid_t pid, int sync_fd) {
+    ::close(sync_fd);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool test_lossless() {
+    ProducerPlan plan;
+    plan.name = "/cuda-runtime-api-29-lossless";
+    plan.config.slot_count = 4;
+    plan.config.slot_bytes = 640 * 480 * 3;
+    plan.config.overwrite = false;
+    plan.frames = 240;
+    plan.width = 640;
+    plan.height = 480;
+
+    int sync_fd = -1;
+    pid_t pid = spawn_ring_producer(plan, &sync_fd);
+    if (pid < 0) { return false; }
+    FrameRingReader reader;
+    bool ok = connect_reader(reader, plan.name, sync_fd);
+
+    uint64_t expect = 1;
+    int bad = 0;
+    FrameView view;
+    while (ok && reader.next(&view, 5000)) {
+        if (view.info.sequence != expect++ || !verify_frame(view.data, view.info.width, view.info.height, view.info.sequence)) { bad++; }
+        reader.release(view);
+    }
+    ok &= join_producer(pid, sync_fd);
+    auto stats = reader.stats();
+    printf("lossless:  received %3lu, dropped %3lu, bad %d, writer closed %d\n", (unsigned long)stats.received,
+           (unsigned long)stats.dropped, bad, (int)reader.writer_closed());
+    ok &= stats.received == (uint64_t)plan.frames && stats.dropped == 0 && bad == 0 && reader.writer_closed();
+    printf("%-52s %s\n", "lossless ring: every frame, in order, intact", ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static bool test_overwrite() {
+    ProducerPlan plan;
+    plan.name = "/cuda-runtime-api-29-overwrite";
+    plan.config.slot_count = 4;
+    plan.config.slot_bytes = 640 * 480 * 3;
+    plan.frames = 240;
+    plan.width = 640;
+    plan.height = 480;
+    plan.interval_us = 200;
+
+    int sync_fd = -1;
+    pid_t pid = spawn_ring_producer(plan, &sync_fd);
+    if (pid < 0) { return false; }
+    FrameRingReader reader;
+    bool ok = connect_reader(reader, plan.name, sync_fd);
+
+    // 读端每帧多花 2 ms，比写端慢得多
+    uint64_t last = 0, intact = 0, corrupted = 0;
+    bool ordered = true;
+    FrameView view;
+    while (ok && reader.next(&view, 5000)) {
+        ordered &= view.info.sequence > last;
+        last = view.info.sequence;
+        bool content = verify_frame(view.data, view.info.width, view.info.height, view.info.sequence);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        // 内容校验失败只允许发生在被覆盖的帧上
+        if (reader.still_valid(view)) {
+            if (content) {
+                intact++;
+            } else {
+                corrupted++;
+            }
+        }
+    }
+    ok &= join_producer(pid, sync_fd);
+    auto stats = reader.stats();
+    printf("overwrite: received %3lu, dropped %3lu, torn %3lu, intact %3lu\n", (unsigned long)stats.received, (unsigned long)stats.dropped,
+           (unsigned long)stats.torn, (unsigned long)intact);
+    ok &= ordered && corrupted == 0 && stats.dropped > 0 && last == (uint64_t)plan.frames
+          && stats.received + stats.dropped == (uint64_t)plan.frames && intact + stats.torn == stats.received;
+    printf("%-52s %s\n", "overwrite ring: drops counted, no corrupted frame", ok ? "OK" : "FAILED");
+    return ok;
+}
+
+/* ------------------------------------------ 与 socket 的对比 ------------------------------------------ */
+
+struct IngestResult {
+    double fps = 0;
+    double latency_ms = 0; // 采集时间戳到 warp_affine_bilinear 完成
+    std::vector<uint8_t> last_output;
+    bool ok = false;
+};
+
+static const int BENCH_WIDTH = 1280, BENCH_HEIGHT = 720, BENCH_FRAMES = 120, BENCH_OUTPUT = 640;
+
+// socket 的采集进程：每帧先写帧头（序号、时间戳），再写像素
+static pid_t spawn_socket_producer(int *fd) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) { return -1; }
+    pid_t pid = fork();
+    if (pid != 0) {
+        ::close(fds[1]);
+        *fd = fds[0];
+        return pid;
+    }
+    ::close(fds[0]);
+    size_t bytes = (size_t)BENCH_WIDTH * BENCH_HEIGHT * 3;
+    std::vector<uint8_t> frame(bytes);
+    for (uint64_t i = 1; i <= (uint64_t)BENCH_FRAMES; ++i) {
+        fill_frame(frame.data(), BENCH_WIDTH, BENCH_HEIGHT, i);
+        int64_t header[2] = {(int64_t)i, frame_ring_now_ns()};
+        if (!write_all(fds[1], header, sizeof(header)) || !write_all(fds[1], frame.data(), bytes)) { _exit(1); }
+    }
+    _exit(0);
+}
+
+// warp_affine_bilinear 在默认流上启动，会等待之前 stream 上的拷贝
+static void warp_frame(const uint8_t *src_device, uint8_t *dst_device) {
+    warp_affine_bilinear((uint8_t *)src_device, BENCH_WIDTH * 3, BENCH_WIDTH, BENCH_HEIGHT, dst_device, BENCH_OUTPUT * 3, BENCH_OUTPUT,
+                         BENCH_OUTPUT, 114);
+    checkRuntime(cudaPeekAtLastError());
+    checkRuntime(cudaDeviceSynchronize());
+}
+
+static IngestResult ingest_socket(uint8_t *src_device, uint8_t *dst_device) {
+    IngestResult result;
+    int fd = -1;
+    pid_t pid = spawn_socket_producer(&fd);
+    if (pid < 0) { return result; }
+
+    size_t bytes = (size_t)BENCH_WIDTH * BENCH_HEIGHT * 3;
+    std::vector<uint8_t> frame(bytes);
+    double latency = 0;
+    int received = 0;
+    int64_t start = frame_ring_now_ns();
+    int64_t header[2];
+    while (read_all(fd, header, sizeof(header)) && read_all(fd, frame.data(), bytes)) {
+        // 可分页内存，驱动先拷到内部的锁页缓冲区再 DMA
+        checkRuntime(cudaMemcpy(src_device, frame.data(), bytes, cudaMemcpyHostToDevice));
+        warp_frame(src_device, dst_device);
+        latency += (frame_ring_now_ns() - header[1]) / 1e6;
+        received++;
+    }
+    double seconds = (frame_ring_now_ns() - start) / 1e9;
+    bool exited = join_producer(pid, fd);
+
+    result.fps = received / seconds;
+    result.latency_ms = received ? latency / received : 0;
+    result.ok = exited && received == BENCH_FRAMES;
+    return result;
+}
+
+// mapped 为 true 时核函数直接读共享内存，否则 cudaMemcpyAsync 从注册过的共享内存 DMA
+static IngestResult ingest_ring(bool mapped, uint8_t *src_device, uint8_t *dst_device, cudaStream_t stream) {
+    IngestResult result;
+    ProducerPlan plan;
+    plan.name = mapped ? "/cuda-runtime-api-29-mapped" : "/cuda-runtime-api-29-dma";
+    plan.config.slot_count = 4;
+    plan.config.slot_bytes = (size_t)BENCH_WIDTH * BENCH_HEIGHT * 3;
+    plan.config.overwrite = false;
+    plan.frames = BENCH_FRAMES;
+    plan.width = BENCH_WIDTH;
+    plan.height = BENCH_HEIGHT;
+
+    int sync_fd = -1;
+    pid_t pid = spawn_ring_producer(plan, &sync_fd);
+    if (pid < 0) { return result; }
+    FrameRingReader reader;
+    bool ok = connect_reader(reader, plan.name, sync_fd);
+    if (ok) {
+        unsigned int flags = cudaHostRegisterPortable | (mapped ? cudaHostRegisterMapped : 0);
+        ok = checkRuntime(reader.register_host(flags));
+    }
+
+    double latency = 0;
+    int received = 0;
+    int64_t start = frame_ring_now_ns();
+    FrameView view;
+    while (ok && reader.next(&view, 5000)) {
+        if (mapped) {
+            warp_frame(reader.device_pointer(view), dst_device);
+        } else {
+            checkRuntime(cudaMemcpyAsync(src_device, view.data, view.info.bytes, cudaMemcpyHostToDevice, stream));
+            warp_frame(src_device, dst_device);
+        }
+        latency += (frame_ring_now_ns() - view.info.timestamp_ns) / 1e6;
+        received++;
+        reader.release(view);
+    }
+    double seconds = (frame_ring_now_ns() - start) / 1e9;
+    ok &= join_producer(pid, sync_fd);
+
+    result.fps = received / seconds;
+    result.latency_ms = received ? latency / received : 0;
+    result.ok = ok && received == BENCH_FRAMES && reader.stats().dropped == 0;
+    return result;
+}
+
+static bool benchmark_ingest() {
+    size_t src_bytes = (size_t)BENCH_WIDTH * BENCH_HEIGHT * 3, dst_bytes = (size_t)BENCH_OUTPUT * BENCH_OUTPUT * 3;
+    uint8_t *src_device = nullptr, *dst_device = nullptr;
+    cudaStream_t stream = nullptr;
+    checkRuntime(cudaMalloc(&src_device, src_bytes));
+    checkRuntime(cudaMalloc(&dst_device, dst_bytes));
+    checkRuntime(cudaStreamCreate(&stream));
+
+    int device = 0, can_map = 0;
+    checkRuntime(cudaGetDevice(&device));
+    checkRuntime(cudaDeviceGetAttribute(&can_map, cudaDevAttrCanMapHostMemory, device));
+
+    const char *names[3] = {"socket + cudaMemcpy", "shm ring, registered", "shm ring, mapped"};
+    IngestResult results[3];
+    printf("\n%d frames %dx%d -> warp_affine_bilinear %dx%d\n", BENCH_FRAMES, BENCH_WIDTH, BENCH_HEIGHT, BENCH_OUTPUT, BENCH_OUTPUT);
+    printf("%-22s %10s %14s\n", "ingest", "fps", "latency ms");
+    bool all_ok = true;
+    for (int i = 0; i < 3; ++i) {
+        if (i == 2 && !can_map) {
+            printf("%-22s %10s\n", names[i], "skipped (device cannot map host memory)");
+            continue;
+        }
+        results[i] = i == 0 ? ingest_socket(src_device, dst_device) : ingest_ring(i == 2, src_device, dst_device, stream);
+        results[i].last_output.resize(dst_bytes);
+        checkRuntime(cudaMemcpy(results[i].last_output.data(), dst_device, dst_bytes, cudaMemcpyDeviceToHost));
+        printf("%-22s %10.1f %14.3f %s\n", names[i], results[i].fps, results[i].latency_ms, results[i].ok ? "OK" : "FAILED");
+        all_ok &= results[i].ok;
+        if (i > 0) { all_ok &= results[i].last_output == results[0].last_output; }
+    }
+    printf("%-52s %s\n", "same warp output for the last frame", all_ok ? "OK" : "FAILED");
+
+    checkRuntime(cudaStreamDestroy(stream));
+    checkRuntime(cudaFree(src_device));
+    checkRuntime(cudaFree(dst_device));
+    return all_ok;
+}
+#endif
+
+void cuda_runtime_api_29_frame_ring() {
+#ifdef __linux__
+    bool all_ok = test_lossless();
+    all_ok &= test_overwrite();
+    all_ok &= benchmark_ingest();
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+#else
+    printf("frame ring needs POSIX shared memory and futex, linux only.\n");
+#endif
+}
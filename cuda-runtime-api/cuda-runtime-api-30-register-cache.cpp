@@ -0,0 +1,218 @@
+#include "cuda-runtime-api.h"
+#include <string.h>
+
+/*
+ * 用户内存的注册缓存：
+ *   1. 命中、子范围、重叠范围的合并、共用一页的相邻缓冲区、forget、LRU 淘汰、超出预算、太小的缓冲区；
+ *   2. owner 的生命周期：注册期间持有，注销之后才释放；同一个 Mat 反复 acquire 只持有一份引用；
+ *   3. 每帧都是同一批 1080p 的 cv::Mat 送到 GPU，对比
+ *        - 可分页内存直接 cudaMemcpyAsync（驱动先拷到内部的锁页缓冲区）；
+ *        - 每次拷贝之前 cudaHostRegister、之后 cudaHostUnregister；
+ *        - 注册缓存（只有第一次注册）。
+ */
+
+static bool check(bool ok, const char *what) {
+    printf("%-60s %s\n", what, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static uint8_t *align_up(uint8_t *p, size_t alignment) {
+    return (uint8_t *)(((uintptr_t)p + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+static bool check_ranges() {
+    const size_t MB = 1 << 20;
+    const size_t page = 4096;
+    bool ok = true;
+
+    HostRegisterCacheConfig config;
+    config.min_bytes = 64 << 10;
+    config.budget_bytes = 16 * MB;
+    HostRegisterCache cache(config);
+
+    // 按 64 KB 对齐，页大小是 4 KB 或 64 KB 时下面的偏移都落在预期的页上
+    std::vector<uint8_t> storage(8 * MB + (64 << 10));
+    uint8_t *buffer = align_up(storage.data(), 64 << 10);
+
+    ok &= check(cache.acquire(buffer, MB) && cache.stats().misses == 1, "first acquire registers");
+    ok &= check(cache.acquire(buffer, MB) && cache.stats().hits == 1, "same range hits");
+    ok &= check(cache.acquire(buffer + 128 * 1024, 256 * 1024) && cache.stats().hits == 2, "sub-range hits");
+
+    // 与已注册区间部分重叠，合并成 [buffer, buffer + 2 MB)
+    cache.acquire(buffer + MB / 2, 3 * MB / 2);
+    auto stats = cache.stats();
+    ok &= check(stats.entries == 1 && stats.merges == 1 && cache.contains(buffer, 2 * MB), "overlap merges into one range");
+
+    // 紧跟在后面、与最后一页共用一页的缓冲区（malloc 出的相邻小块常见）
+    cache.acquire(buffer + 2 * MB - 100, MB);
+    stats = cache.stats();
+    ok &= check(stats.entries == 1 && cache.contains(buffer, 3 * MB - 100), "buffer sharing a page merges");
+
+    // 不相交的区间单独注册
+    cache.acquire(buffer + 4 * MB, MB);
+    ok &= check(cache.stats().entries == 2, "disjoint range adds an entry");
+
+    // 与两个区间都重叠、并集超过预算：请求失败，已有的区间保持注册
+    ok &= check(!cache.acquire(buffer + 2 * MB, 15 * MB) && cache.stats().failures == 1, "overlapping range over budget is rejected");
+    ok &= check(cache.stats().entries == 2 && cache.contains(buffer, 3 * MB - 100) && cache.contains(buffer + 4 * MB, MB),
+                "rejected merge keeps the existing ranges");
+
+    cache.forget(buffer + MB, 1);
+    stats = cache.stats();
+    ok &= check(stats.entries == 1 && !cache.contains(buffer, page) && cache.contains(buffer + 4 * MB, MB),
+                "forget unregisters the overlapping range only");
+
+    ok &= check(!cache.acquire(buffer, 1024) && cache.stats().entries == 1, "small buffer left pageable");
+    ok &= check(!cache.acquire(buffer, 32 * MB) && cache.stats().failures == 2, "range over budget is rejected");
+
+    cache.clear();
+    stats = cache.stats();
+    ok &= check(stats.entries == 0 && stats.registered_bytes == 0, "clear unregisters everything");
+    return ok;
+}
+
+static bool check_lru() {
+    bool ok = true;
+    std::vector<cv::Mat> mats(4);
+    for (auto &m : mats) { m.create(1024, 1024, CV_8U); }
+
+    // 预算只够 3 个 Mat（起始地址不一定按页对齐，每个区间最多多出两页）
+    HostRegisterCacheConfig config;
+    config.min_bytes = 64 << 10;
+    config.budget_bytes = 3 * ((1 << 20) + 2 * 65536);
+    HostRegisterCache cache(config);
+
+    cache.acquire(mats[0]);
+    cache.acquire(mats[1]);
+    cache.acquire(mats[2]);
+    cache.acquire(mats[0]); // mats[1] 变成最久没用的
+    cache.acquire(mats[3]);
+
+    auto stats = cache.stats();
+    size_t bytes = mats[0].total();
+    ok &= check(stats.evictions == 1 && stats.entries == 3, "budget evicts one range");
+    ok &= check(!cache.contains(mats[1].data, bytes) && cache.contains(mats[0].data, bytes) &&
+                cache.contains(mats[2].data, bytes) && cache.contains(mats[3].data, bytes),
+                "least recently used range is the one evicted");
+    ok &= check(stats.registered_bytes <= config.budget_bytes, "registered bytes within budget");
+    return ok;
+}
+
+static bool check_owners() {
+    bool ok = true;
+    const size_t bytes = 1 << 20;
+    HostRegisterCacheConfig config;
+    config.min_bytes = 64 << 10;
+    HostRegisterCache cache(config);
+
+    // 用户释放了自己的引用，内存要等注销之后才真正释放
+    bool freed = false;
+    uint8_t *raw = new uint8_t[bytes];
+    std::shared_ptr<void> owner(raw, [&](void *p) { delete[] (uint8_t *)p; freed = true; });
+    cache.acquire(raw, bytes, owner);
+    owner.reset();
+    ok &= check(!freed, "owner kept alive while registered");
+    cache.forget(raw, bytes);
+    ok &= check(freed, "owner released after unregister");
+
+    // 每帧 acquire 同一个 Mat，缓存里只有一份引用
+    cv::Mat mat(1080, 1920, CV_8UC3);
+    for (int i = 0; i < 10; ++i) { cache.acquire(mat); }
+    ok &= check(mat.u->refcount == 2, "repeated Mat acquire holds a single reference");
+
+    // 用户重新 create 之后旧的内存仍被缓存持有，新的内存单独注册
+    const uint8_t *old_data = mat.data;
+    mat.create(1080, 1920, CV_8UC3);
+    mat.release();
+    ok &= check(cache.contains(old_data, 1080 * 1920 * 3), "released Mat stays registered and alive");
+    cache.clear();
+    ok &= check(cache.stats().entries == 0, "clear drops the Mat reference");
+    return ok;
+}
+
+static bool benchmark_frames() {
+    const int width = 1920, height = 1080, frames = 4, iters = 60;
+    const size_t bytes = (size_t)width * height * 3;
+    bool ok = true;
+
+    std::vector<cv::Mat> images(frames);
+    for (int i = 0; i < frames; ++i) {
+        images[i] = cv::Mat(height, width, CV_8UC3, cv::Scalar(i * 40, 255 - i * 40, i * 20));
+    }
+
+    cudaStream_t stream = nullptr;
+    uint8_t *device = nullptr;
+    checkRuntime(cudaStreamCreate(&stream));
+    checkRuntime(cudaMalloc(&device, bytes));
+    std::vector<uint8_t> readback(bytes);
+
+    auto verify = [&](int i) {
+        checkRuntime(cudaMemcpy(readback.data(), device, bytes, cudaMemcpyDeviceToHost));
+        return memcmp(readback.data(), images[i].data, bytes) == 0;
+    };
+
+    // 1. 可分页内存
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iters; ++i) {
+        checkRuntime(cudaMemcpyAsync(device, images[i % frames].data, bytes, cudaMemcpyHostToDevice, stream));
+        checkRuntime(cudaStreamSynchronize(stream));
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    ok &= verify((iters - 1) % frames);
+
+    // 2. 每次拷贝都注册、注销
+    for (int i = 0; i < iters; ++i) {
+        cv::Mat &image = images[i % frames];
+        checkRuntime(cudaHostRegister(image.data, bytes, cudaHostRegisterPortable));
+        checkRuntime(cudaMemcpyAsync(device, image.data, bytes, cudaMemcpyHostToDevice, stream));
+        checkRuntime(cudaStreamSynchronize(stream));
+        checkRuntime(cudaHostUnregister(image.data));
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    ok &= verify((iters - 1) % frames);
+
+    // 3. 注册缓存
+    HostRegisterCache cache;
+    for (int i = 0; i < iters; ++i) {
+        checkRuntime(cache.memcpy_async(device, images[i % frames], stream));
+        checkRuntime(cudaStreamSynchronize(stream));
+    }
+    auto t3 = std::chrono::high_resolution_clock::now();
+    ok &= verify((iters - 1) % frames);
+
+    auto ms = [&](std::chrono::high_resolution_clock::time_point a, std::chrono::high_resolution_clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count() / iters;
+    };
+    double gb = bytes / 1e9;
+    double pageable = ms(t0, t1), adhoc = ms(t1, t2), cached = ms(t2, t3);
+    printf("%d x %dx%d frames, %d copies:\n", frames, width, height, iters);
+    printf("  pageable            %8.3f ms/frame  %6.2f GB/s\n", pageable, gb / (pageable / 1e3));
+    printf("  register per copy   %8.3f ms/frame  %6.2f GB/s\n", adhoc, gb / (adhoc / 1e3));
+    printf("  register cache      %8.3f ms/frame  %6.2f GB/s\n", cached, gb / (cached / 1e3));
+
+    auto stats = cache.stats();
+    printf("  cache: hits = %llu, misses = %llu, entries = %zu, registered = %.1f MB\n",
+           (unsigned long long)stats.hits, (unsigned long long)stats.misses, stats.entries,
+           stats.registered_bytes / 1048576.0);
+    ok &= check(stats.misses == (uint64_t)frames && stats.hits == (uint64_t)(iters - frames),
+                "each frame buffer registered once");
+
+    cache.clear();
+    checkRuntime(cudaFree(device));
+    checkRuntime(cudaStreamDestroy(stream));
+    return ok;
+}
+
+void cuda_runtime_api_30_register_cache() {
+    bool ok = true;
+    ok &= check_ranges();
+    ok &= check_lru();
+    ok &= check_owners();
+    ok &= check(benchmark_frames(), "copied frames match");
+
+    if (ok) {
+        printf("Done no error.\n");
+    } else {
+        printf("Register cache: some checks failed.\n");
+    }
+}
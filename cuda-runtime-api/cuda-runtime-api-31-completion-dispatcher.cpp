@@ -0,0 +1,298 @@
+#include "cuda-runtime-api.h"
+#include <string.h>
+#include <atomic>
+#include <stdexcept>
+
+/*
+ * 完成通知的分发器（completion-dispatcher.h）：
+ *   1. 模拟的流（没有 GPU 也能运行）：8 个流上 4000 个请求同时在途，两个分发线程完成所有 future，
+ *      对比每个请求占一个线程阻塞等待的做法（64 个线程，同时在途的请求最多 64 个）；
+ *   2. 回调中在同一个流上排入下一步，三个阶段串起来，全程没有线程阻塞；
+ *   3. 反压、异常、排入失败、一个分发线程时同一个流上回调的顺序；
+ *   4. 真实的流：每个请求 H2D + D2H，对比 cudaStreamSynchronize 与分发器。
+ */
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static bool check(bool ok, const char *what) {
+    printf("%-60s %s\n", what, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+// 模拟的核函数：忙等 us 微秒，返回与请求号相关的值
+static uint64_t fake_kernel(int request, int us) {
+    double until = now_ms() + us / 1000.0;
+    uint64_t value = (uint64_t)request * 2654435761u;
+    while (now_ms() < until) { value = value * 6364136223846793005ull + 1442695040888963407ull; }
+    return (uint64_t)request * 3 + 1;
+}
+
+static bool simulated_throughput() {
+    const int num_streams = 8, num_requests = 4000, kernel_us = 20, blocking_threads = 64;
+    bool ok = true;
+    std::vector<std::unique_ptr<SimulatedStream>> streams;
+    for (int i = 0; i < num_streams; ++i) { streams.emplace_back(new SimulatedStream()); }
+
+    // 1. 阻塞：每个线程提交一个请求后等它完成，再提交下一个
+    double t0 = now_ms();
+    std::atomic<int> next{0}, wrong{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < blocking_threads; ++t) {
+        threads.emplace_back([&]() {
+            int i;
+            while ((i = next.fetch_add(1)) < num_requests) {
+                auto result = std::make_shared<uint64_t>(0);
+                auto done = std::make_shared<std::promise<void>>();
+                auto future = done->get_future();
+                streams[i % num_streams]->enqueue([=]() { *result = fake_kernel(i, kernel_us); done->set_value(); });
+                future.wait(); // 相当于 cudaStreamSynchronize
+                if (*result != (uint64_t)i * 3 + 1) { wrong++; }
+            }
+        });
+    }
+    for (auto &t : threads) { t.join(); }
+    double blocking_ms = now_ms() - t0;
+    ok &= wrong == 0;
+
+    // 2. 分发器：全部提交，两个线程完成所有 future
+    SimulatedStreamBackend backend;
+    CompletionDispatcherConfig config;
+    config.num_threads = 2;
+    CompletionDispatcher dispatcher(backend, config);
+
+    t0 = now_ms();
+    std::vector<std::shared_ptr<uint64_t>> results(num_requests);
+    std::vector<std::future<uint64_t>> futures;
+    futures.reserve(num_requests);
+    for (int i = 0; i < num_requests; ++i) {
+        auto result = results[i] = std::make_shared<uint64_t>(0);
+        SimulatedStream &stream = *streams[i % num_streams];
+        stream.enqueue([=]() { *result = fake_kernel(i, kernel_us); });
+        futures.push_back(dispatcher.then(stream.handle(), [=]() { return *result; }));
+    }
+    double submit_ms = now_ms() - t0;
+    for (int i = 0; i < num_requests; ++i) {
+        if (futures[i].get() != (uint64_t)i * 3 + 1) { wrong++; }
+    }
+    double dispatcher_ms = now_ms() - t0;
+
+    // future 就绪时回调还没有返回，completed 要等 wait_idle 之后才是最终的
+    dispatcher.wait_idle();
+    auto stats = dispatcher.stats();
+    printf("%d requests on %d simulated streams, %d us each:\n", num_requests, num_streams, kernel_us);
+    printf("  blocking     %8.2f ms  %5d host threads waiting\n", blocking_ms, blocking_threads);
+    printf("  dispatcher   %8.2f ms  %5d dispatcher threads, submit %.2f ms, peak in flight %zu\n",
+           dispatcher_ms, dispatcher.num_threads(), submit_ms, stats.peak_in_flight);
+    ok &= check(wrong == 0, "every future resolved with its own result");
+    ok &= check(stats.submitted == (uint64_t)num_requests && stats.completed == (uint64_t)num_requests,
+                "submitted and completed counts match");
+    ok &= check(stats.peak_in_flight > (size_t)blocking_threads, "more requests in flight than blocking threads");
+    return ok;
+}
+
+// 三个阶段：预处理 -> 推理 -> 后处理，每个阶段完成后在分发线程上排入下一个阶段
+static bool chained_stages() {
+    const int num_streams = 4, num_requests = 500;
+    std::vector<std::unique_ptr<SimulatedStream>> streams;
+    for (int i = 0; i < num_streams; ++i) { streams.emplace_back(new SimulatedStream()); }
+    SimulatedStreamBackend backend;
+    CompletionDispatcher dispatcher(backend);
+
+    struct Request {
+        int id;
+        SimulatedStream *stream;
+        uint64_t value = 0;
+        std::promise<uint64_t> done;
+    };
+    std::vector<std::unique_ptr<Request>> requests;
+    std::vector<std::future<uint64_t>> futures;
+    for (int i = 0; i < num_requests; ++i) {
+        Request *r = new Request();
+        r->id = i;
+        r->stream = streams[i % num_streams].get();
+        requests.emplace_back(r);
+        futures.push_back(r->done.get_future());
+
+        r->stream->enqueue([r]() { r->value = fake_kernel(r->id, 5); });
+        dispatcher.notify(r->stream->handle(), [r, &dispatcher]() {
+            r->stream->enqueue([r]() { r->value = r->value * 2; });
+            dispatcher.notify(r->stream->handle(), [r, &dispatcher]() {
+                r->stream->enqueue([r]() { r->value += 7; });
+                dispatcher.notify(r->stream->handle(), [r]() { r->done.set_value(r->value); });
+            });
+        });
+    }
+
+    bool ok = true;
+    for (int i = 0; i < num_requests; ++i) {
+        ok &= futures[i].get() == ((uint64_t)i * 3 + 1) * 2 + 7;
+    }
+    dispatcher.wait_idle();
+    auto stats = dispatcher.stats();
+    return check(ok && stats.completed == (uint64_t)num_requests * 3, "three stages chained from callbacks");
+}
+
+static bool edge_cases() {
+    bool ok = true;
+    SimulatedStream stream;
+    SimulatedStreamBackend backend;
+
+    // 容量 16，提交 1000 个：notify 等待在途的请求完成，在途数不超过容量
+    {
+        CompletionDispatcherConfig config;
+        config.capacity = 16;
+        CompletionDispatcher dispatcher(backend, config);
+        std::atomic<int> done{0};
+        for (int i = 0; i < 1000; ++i) {
+            stream.enqueue([i]() { fake_kernel(i, 2); });
+            dispatcher.notify(stream.handle(), [&]() { done++; });
+        }
+        dispatcher.wait_idle();
+        auto stats = dispatcher.stats();
+        ok &= check(done == 1000 && stats.peak_in_flight <= 16 && stats.backpressure_waits > 0,
+                    "backpressure bounds requests in flight");
+    }
+
+    // 容量 4，回调里再 notify 下一步，同时主线程不断提交：回调执行前已经释放名额，
+    // 分发线程上的 notify 遇到满时自己处理完成的记录，两个分发线程不会都停在 notify 里
+    {
+        CompletionDispatcherConfig config;
+        config.capacity = 4;
+        config.num_threads = 2;
+        CompletionDispatcher dispatcher(backend, config);
+        std::atomic<int> done{0};
+        for (int i = 0; i < 500; ++i) {
+            stream.enqueue([i]() { fake_kernel(i, 2); });
+            dispatcher.notify(stream.handle(), [&]() {
+                dispatcher.notify(stream.handle(), [&]() {
+                    dispatcher.notify(stream.handle(), [&]() { done++; });
+                });
+            });
+        }
+        dispatcher.wait_idle();
+        auto stats = dispatcher.stats();
+        ok &= check(done == 500 && stats.completed == 1500 && stats.peak_in_flight <= 4,
+                    "chained notify with small capacity does not deadlock");
+    }
+
+    // 一个分发线程时，同一个流上的回调按提交顺序执行
+    {
+        CompletionDispatcherConfig config;
+        config.num_threads = 1;
+        CompletionDispatcher dispatcher(backend, config);
+        std::vector<int> order;
+        for (int i = 0; i < 200; ++i) {
+            dispatcher.notify(stream.handle(), [&order, i]() { order.push_back(i); });
+        }
+        dispatcher.wait_idle();
+        bool in_order = order.size() == 200;
+        for (size_t i = 0; in_order && i < order.size(); ++i) { in_order = order[i] == (int)i; }
+        ok &= check(in_order, "single dispatcher thread keeps stream order");
+    }
+
+    CompletionDispatcher dispatcher(backend);
+    auto thrown = dispatcher.then(stream.handle(), []() -> int { throw std::runtime_error("postprocess failed"); });
+    try {
+        thrown.get();
+        ok &= check(false, "exception from callback reaches the future");
+    } catch (const std::runtime_error &e) {
+        ok &= check(strcmp(e.what(), "postprocess failed") == 0, "exception from callback reaches the future");
+    }
+
+    // 模拟的后端拒绝空的流，相当于 cudaLaunchHostFunc 失败
+    bool called = false;
+    cudaError_t code = dispatcher.notify(nullptr, [&]() { called = true; });
+    auto failed = dispatcher.then(nullptr, []() { return 1; });
+    bool failed_throws = false;
+    try {
+        failed.get();
+    } catch (const std::runtime_error &) {
+        failed_throws = true;
+    }
+    dispatcher.wait_idle();
+    ok &= check(code == cudaErrorInvalidValue && !called && failed_throws && dispatcher.in_flight() == 0,
+                "launch failure reported without leaking a slot");
+
+    // 析构时等待还在途的请求
+    std::atomic<bool> finished{false};
+    {
+        CompletionDispatcher scoped(backend);
+        stream.enqueue([]() { fake_kernel(0, 20000); });
+        scoped.notify(stream.handle(), [&]() { finished = true; });
+    }
+    ok &= check(finished, "destructor waits for outstanding requests");
+    return ok;
+}
+
+static bool gpu_copies() {
+    const int num_streams = 4, num_requests = 256;
+    const size_t bytes = 256 << 10;
+    bool ok = true;
+
+    std::vector<cudaStream_t> streams(num_streams);
+    for (auto &s : streams) { checkRuntime(cudaStreamCreate(&s)); }
+    uint8_t *host_in = nullptr, *host_out = nullptr, *device = nullptr;
+    checkRuntime(cudaMallocHost(&host_in, bytes * num_requests));
+    checkRuntime(cudaMallocHost(&host_out, bytes * num_requests));
+    checkRuntime(cudaMalloc(&device, bytes * num_requests));
+    for (size_t i = 0; i < bytes * num_requests; ++i) { host_in[i] = (uint8_t)(i * 31 + i / bytes); }
+
+    auto enqueue = [&](int i) {
+        cudaStream_t stream = streams[i % num_streams];
+        checkRuntime(cudaMemcpyAsync(device + i * bytes, host_in + i * bytes, bytes, cudaMemcpyHostToDevice, stream));
+        checkRuntime(cudaMemcpyAsync(host_out + i * bytes, device + i * bytes, bytes, cudaMemcpyDeviceToHost, stream));
+        return stream;
+    };
+    auto verify = [&](int i) { return memcmp(host_out + i * bytes, host_in + i * bytes, bytes) == 0; };
+
+    // 1. 每个请求之后 cudaStreamSynchronize
+    memset(host_out, 0, bytes * num_requests);
+    double t0 = now_ms();
+    int correct = 0;
+    for (int i = 0; i < num_requests; ++i) {
+        checkRuntime(cudaStreamSynchronize(enqueue(i)));
+        correct += verify(i);
+    }
+    double sync_ms = now_ms() - t0;
+    ok &= correct == num_requests;
+
+    // 2. 分发器，校验在分发线程上进行
+    memset(host_out, 0, bytes * num_requests);
+    std::atomic<int> verified{0};
+    t0 = now_ms();
+    {
+        CompletionDispatcher dispatcher;
+        for (int i = 0; i < num_requests; ++i) {
+            checkRuntime(dispatcher.notify(enqueue(i), [&, i]() { verified += verify(i); }));
+        }
+        dispatcher.wait_idle();
+    }
+    double dispatcher_ms = now_ms() - t0;
+
+    printf("%d requests of H2D + D2H %zu KB on %d streams:\n", num_requests, bytes >> 10, num_streams);
+    printf("  cudaStreamSynchronize  %8.2f ms\n", sync_ms);
+    printf("  dispatcher             %8.2f ms\n", dispatcher_ms);
+    ok &= check(verified == num_requests, "dispatcher verified every copy");
+
+    checkRuntime(cudaFree(device));
+    checkRuntime(cudaFreeHost(host_out));
+    checkRuntime(cudaFreeHost(host_in));
+    for (auto &s : streams) { checkRuntime(cudaStreamDestroy(s)); }
+    return ok;
+}
+
+void cuda_runtime_api_31_completion_dispatcher() {
+    bool ok = true;
+    ok &= check(simulated_throughput(), "simulated streams");
+    ok &= chained_stages();
+    ok &= edge_cases();
+    ok &= check(gpu_copies(), "cuda streams");
+
+    if (ok) {
+        printf("Done no error.\n");
+    } else {
+        printf("Completion dispatcher: some checks failed.\n");
+    }
+}
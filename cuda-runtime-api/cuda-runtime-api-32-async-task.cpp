@@ -0,0 +1,192 @@
+#include "cuda-runtime-api.h"
+#include <string.h>
+#include <atomic>
+#include <stdexcept>
+
+/*
+ * 协程版本的异步推理（async-task.h）：
+ *   1. 模拟的流（没有 GPU 也能运行）：300 个请求共用 4 个"执行上下文"（各带一个 SimulatedStream），
+ *      每个请求 acquire 上下文 -> 预处理 -> 推理（子协程）-> 归还上下文 -> 在线程池上解码，代码按顺序写，没有线程阻塞；
+ *   2. 异常沿协程链传到 future，排入失败时 wait_stream 立即返回错误码；
+ *   3. 真实的流：4 个流组成的池，每个请求 H2D + D2H，等待完成后在线程池上校验。
+ * 需要 C++20 编译（-std=c++20），否则只打印提示。
+ */
+
+#if ASYNC_TASK_ENABLED
+
+static bool check(bool ok, const char *what) {
+    printf("%-60s %s\n", what, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+// 模拟的核函数：忙等 us 微秒
+static void busy_wait(int us) {
+    double until = now_ms() + us / 1000.0;
+    while (now_ms() < until) {}
+}
+
+struct SimContext {
+    std::unique_ptr<SimulatedStream> stream;
+};
+
+struct PipelineState {
+    AsyncPool<SimContext> &contexts;
+    CompletionDispatcher &dispatcher;
+    ThreadPool &pool;
+    std::atomic<int> active{0}, peak{0};
+};
+
+// 推理：排入流上的工作，等它完成
+static Task<uint64_t> infer(PipelineState &state, SimContext &context, uint64_t input) {
+    uint64_t output = 0;
+    context.stream->enqueue([&output, input]() {
+        busy_wait(30);
+        output = input * 2;
+    });
+    cudaError_t code = co_await wait_stream(state.dispatcher, context.stream->handle(), state.pool);
+    if (code != cudaSuccess) { throw std::runtime_error("infer failed"); }
+    co_return output;
+}
+
+static Task<uint64_t> handle_request(PipelineState &state, int id) {
+    auto context = co_await state.contexts.acquire();
+    int active = ++state.active;
+    int peak = state.peak.load();
+    while (active > peak && !state.peak.compare_exchange_weak(peak, active)) {}
+
+    // 预处理
+    uint64_t input = 0;
+    context->stream->enqueue([&input, id]() {
+        busy_wait(10);
+        input = (uint64_t)id * 3 + 1;
+    });
+    co_await wait_stream(state.dispatcher, context->stream->handle(), state.pool);
+
+    uint64_t output = co_await infer(state, *context, input);
+
+    // 上下文用完马上归还，解码在线程池上进行，不占用上下文和分发线程
+    --state.active;
+    context.release();
+    co_await resume_on(state.pool);
+    busy_wait(5);
+    co_return output + 7;
+}
+
+static Task<int> failing_request(CompletionDispatcher &dispatcher, SimulatedStream &stream) {
+    stream.enqueue([]() { busy_wait(10); });
+    co_await wait_stream(dispatcher, stream.handle());
+    throw std::runtime_error("decode failed");
+}
+
+static bool simulated_pipeline() {
+    const int num_contexts = 4, num_requests = 300;
+    bool ok = true;
+
+    ThreadPool pool(2);
+    SimulatedStreamBackend backend;
+    CompletionDispatcher dispatcher(backend);
+    std::vector<SimContext> items(num_contexts);
+    for (auto &item : items) { item.stream.reset(new SimulatedStream()); }
+    AsyncPool<SimContext> contexts(std::move(items), pool);
+    PipelineState state{contexts, dispatcher, pool};
+
+    double t0 = now_ms();
+    std::vector<std::future<uint64_t>> futures;
+    for (int i = 0; i < num_requests; ++i) { futures.push_back(start(handle_request(state, i))); }
+    int wrong = 0;
+    for (int i = 0; i < num_requests; ++i) {
+        if (futures[i].get() != ((uint64_t)i * 3 + 1) * 2 + 7) { wrong++; }
+    }
+    double elapsed = now_ms() - t0;
+
+    printf("%d coroutine requests on %d simulated contexts: %.2f ms, peak active %d, dispatcher threads %d, pool workers %d\n",
+           num_requests, num_contexts, elapsed, state.peak.load(), dispatcher.num_threads(), pool.num_workers());
+    ok &= check(wrong == 0, "every request returned its own result");
+    ok &= check(state.peak.load() <= num_contexts, "contexts never shared between requests");
+    ok &= check(contexts.available() == (size_t)num_contexts, "all contexts returned to the pool");
+
+    SimulatedStream stream;
+    auto failed = start(failing_request(dispatcher, stream));
+    try {
+        failed.get();
+        ok &= check(false, "exception propagates through co_await");
+    } catch (const std::runtime_error &e) {
+        ok &= check(strcmp(e.what(), "decode failed") == 0, "exception propagates through co_await");
+    }
+
+    // 模拟的后端拒绝空的流：不挂起，直接得到错误码
+    auto rejected = [&]() -> Task<cudaError_t> { co_return co_await wait_stream(dispatcher, nullptr); };
+    ok &= check(sync_wait(rejected()) == cudaErrorInvalidValue, "failed launch resumes with the error code");
+
+    dispatcher.wait_idle();
+    return ok;
+}
+
+static Task<bool> copy_request(CompletionDispatcher &dispatcher, AsyncPool<cudaStream_t> &streams, ThreadPool &pool,
+                               const uint8_t *in, uint8_t *out, uint8_t *device, size_t bytes) {
+    auto stream = co_await streams.acquire();
+    checkRuntime(cudaMemcpyAsync(device, in, bytes, cudaMemcpyHostToDevice, *stream));
+    checkRuntime(cudaMemcpyAsync(out, device, bytes, cudaMemcpyDeviceToHost, *stream));
+    cudaError_t code = co_await wait_stream(dispatcher, *stream, pool);
+    stream.release();
+
+    co_await resume_on(pool);
+    co_return code == cudaSuccess && memcmp(in, out, bytes) == 0;
+}
+
+static bool gpu_pipeline() {
+    const int num_streams = 4, num_requests = 128;
+    const size_t bytes = 256 << 10;
+
+    std::vector<cudaStream_t> handles(num_streams);
+    for (auto &s : handles) { checkRuntime(cudaStreamCreate(&s)); }
+    uint8_t *host_in = nullptr, *host_out = nullptr, *device = nullptr;
+    checkRuntime(cudaMallocHost(&host_in, bytes * num_requests));
+    checkRuntime(cudaMallocHost(&host_out, bytes * num_requests));
+    checkRuntime(cudaMalloc(&device, bytes * num_requests));
+    for (size_t i = 0; i < bytes * num_requests; ++i) { host_in[i] = (uint8_t)(i * 131 + i / bytes); }
+
+    int verified = 0;
+    {
+        ThreadPool pool(2);
+        CompletionDispatcher dispatcher;
+        AsyncPool<cudaStream_t> streams(handles, pool);
+        std::vector<std::future<bool>> futures;
+        for (int i = 0; i < num_requests; ++i) {
+            size_t offset = i * bytes;
+            futures.push_back(start(copy_request(dispatcher, streams, pool, host_in + offset, host_out + offset,
+                                                 device + offset, bytes)));
+        }
+        for (auto &f : futures) { verified += f.get(); }
+    }
+
+    checkRuntime(cudaFree(device));
+    checkRuntime(cudaFreeHost(host_out));
+    checkRuntime(cudaFreeHost(host_in));
+    for (auto &s : handles) { checkRuntime(cudaStreamDestroy(s)); }
+    return check(verified == num_requests, "coroutine copies verified on real streams");
+}
+
+void cuda_runtime_api_32_async_task() {
+    bool ok = true;
+    ok &= simulated_pipeline();
+    ok &= gpu_pipeline();
+
+    if (ok) {
+        printf("Done no error.\n");
+    } else {
+        printf("Async task: some checks failed.\n");
+    }
+}
+
+#else
+
+void cuda_runtime_api_32_async_task() {
+    printf("Async task: coroutines need C++20 (-std=c++20), skipped.\n");
+}
+
+#endif // ASYNC_TASK_ENABLED
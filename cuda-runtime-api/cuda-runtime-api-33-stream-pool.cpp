@@ -0,0 +1,177 @@
+#include "cuda-runtime-api.h"
+#include <atomic>
+#include <thread>
+
+/*
+ * 流和事件的回收池（stream-pool.h）：
+ *   1. 归还之后再借出的是同一个流，不同优先级、计时与不计时的事件分开存放；
+ *   2. 借出未还的数量（泄漏）、空闲数量的上限、多线程借还；
+ *   3. 每次创建销毁与从池中借还的耗时对比。
+ */
+
+static bool check(bool ok, const char *what) {
+    printf("%-60s %s\n", what, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static bool reuse() {
+    bool ok = true;
+    StreamPool streams;
+    EventPool events;
+
+    cudaStream_t first = nullptr;
+    {
+        PooledStream stream = streams.acquire();
+        first = stream;
+        ok &= check(stream.valid() && first != nullptr, "acquire creates a stream");
+    }
+    PooledStream again = streams.acquire();
+    ok &= check(again.get() == first && streams.stats().created == 1 && streams.stats().reuses == 1, "released stream is reused");
+
+    // 超出范围的优先级按边界处理：-100 与 -99 都是最高优先级，共用同一个流
+    int least = 0, greatest = 0;
+    checkRuntime(cudaDeviceGetStreamPriorityRange(&least, &greatest));
+    cudaStream_t high_stream = nullptr;
+    {
+        PooledStream high = streams.acquire(-100);
+        high_stream = high;
+        int priority = 0;
+        checkRuntime(cudaStreamGetPriority(high, &priority));
+        ok &= check(high.get() != again.get() && priority == greatest, "high priority stream is separate and clamped");
+    }
+    PooledStream high_again = streams.acquire(-99);
+    ok &= check(least == greatest || high_again.get() == high_stream, "same clamped priority reuses the stream");
+
+    // 计时的事件可以 ElapsedTime，不计时的只能用于同步
+    PooledEvent start = events.acquire(true), stop = events.acquire(true), sync = events.acquire();
+    checkRuntime(cudaEventRecord(start, again));
+    checkRuntime(cudaEventRecord(stop, again));
+    checkRuntime(cudaEventRecord(sync, again));
+    checkRuntime(cudaStreamWaitEvent(high_again, sync, 0));
+    checkRuntime(cudaEventSynchronize(stop));
+    float ms = -1;
+    bool timing_ok = cudaEventElapsedTime(&ms, start, stop) == cudaSuccess && ms >= 0;
+    bool no_timing = cudaEventElapsedTime(&ms, start, sync) != cudaSuccess;
+    cudaGetLastError();
+    ok &= check(timing_ok && no_timing && events.stats().created == 3, "timing and non-timing events kept apart");
+
+    cudaEvent_t sync_event = sync;
+    sync.release();
+    PooledEvent timing_again = events.acquire(true);
+    PooledEvent sync_again = events.acquire(false);
+    ok &= check(timing_again.get() != sync_event && sync_again.get() == sync_event && events.stats().created == 4,
+                "non-timing event reused only as non-timing");
+    return ok;
+}
+
+static bool accounting() {
+    bool ok = true;
+
+    // 借出未还的句柄计入 in_use，池析构时会报告
+    {
+        StreamPool streams;
+        PooledStream *leaked = new PooledStream(streams.acquire());
+        { PooledStream used = streams.acquire(); }
+        auto stats = streams.stats();
+        printf("outstanding streams: %zu, idle %zu\n", stats.in_use, stats.idle);
+        ok &= check(stats.in_use == 1 && stats.acquires == 2 && stats.releases == 1, "leaked handle shows up in in_use");
+        delete leaked;
+        ok &= check(streams.stats().in_use == 0, "returned handle clears in_use");
+    }
+
+    // 每种最多空闲 2 个，多出的归还时销毁
+    {
+        EventPool events(2);
+        std::vector<PooledEvent> held;
+        for (int i = 0; i < 5; ++i) { held.push_back(events.acquire()); }
+        held.clear();
+        auto stats = events.stats();
+        ok &= check(stats.created == 5 && stats.idle == 2 && stats.destroyed == 3 && stats.peak_in_use == 5, "idle objects capped by max_idle");
+        events.trim();
+        ok &= check(events.stats().idle == 0 && events.stats().destroyed == 5, "trim destroys idle objects");
+    }
+
+    // 多线程同时借还，借出的流不会同时给两个线程
+    {
+        const int num_threads = 4, iterations = 20000;
+        StreamPool streams;
+        std::mutex lock;
+        std::map<cudaStream_t, int> owners;
+        std::atomic<int> conflicts{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < iterations; ++i) {
+                    PooledStream stream = streams.acquire();
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        int &owner = owners[stream.get()];
+                        if (owner != 0) { conflicts++; }
+                        owner = t + 1;
+                    }
+                    std::lock_guard<std::mutex> guard(lock);
+                    owners[stream.get()] = 0;
+                }
+            });
+        }
+        for (auto &t : threads) { t.join(); }
+        auto stats = streams.stats();
+        printf("%d threads x %d acquires: %llu streams created, peak in use %zu\n", num_threads, iterations,
+               (unsigned long long)stats.created, stats.peak_in_use);
+        ok &= check(conflicts == 0 && stats.in_use == 0 && stats.created <= (uint64_t)num_threads, "concurrent acquire and release");
+    }
+    return ok;
+}
+
+static void benchmark() {
+    const int create_count = 2000, pool_count = 200000;
+
+    double t0 = now_ms();
+    for (int i = 0; i < create_count; ++i) {
+        cudaStream_t stream = nullptr;
+        checkRuntime(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
+        checkRuntime(cudaStreamDestroy(stream));
+    }
+    double stream_create = (now_ms() - t0) * 1e6 / create_count;
+
+    t0 = now_ms();
+    for (int i = 0; i < create_count; ++i) {
+        cudaEvent_t event = nullptr;
+        checkRuntime(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+        checkRuntime(cudaEventDestroy(event));
+    }
+    double event_create = (now_ms() - t0) * 1e6 / create_count;
+
+    StreamPool streams;
+    EventPool events;
+    { PooledStream warm = streams.acquire(); }
+    { PooledEvent warm = events.acquire(); }
+
+    t0 = now_ms();
+    for (int i = 0; i < pool_count; ++i) { PooledStream stream = streams.acquire(); }
+    double stream_pool = (now_ms() - t0) * 1e6 / pool_count;
+
+    t0 = now_ms();
+    for (int i = 0; i < pool_count; ++i) { PooledEvent event = events.acquire(); }
+    double event_pool = (now_ms() - t0) * 1e6 / pool_count;
+
+    printf("per stream:  create + destroy %9.1f ns   pool acquire + release %7.1f ns\n", stream_create, stream_pool);
+    printf("per event:   create + destroy %9.1f ns   pool acquire + release %7.1f ns\n", event_create, event_pool);
+}
+
+void cuda_runtime_api_33_stream_pool() {
+    bool ok = true;
+    ok &= reuse();
+    ok &= accounting();
+    benchmark();
+
+    if (ok) {
+        printf("Done no error.\n");
+    } else {
+        printf("Stream pool: some checks failed.\n");
+    }
+}
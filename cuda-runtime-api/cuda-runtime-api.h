@@ -17,6 +17,26 @@
 #include <thrust/device_vector.h>
 #include <thrust/sort.h>
 #include "utils.h"
+#include "affine-matrix.h"
+#include "infer-cache.h"
+#include "motion-gate.h"
+#include "iou-tracker.h"
+#include "rotated-box.h"
+#include "grid-nms.h"
+#include "soft-nms.h"
+#include "topk-decode.h"
+#include "instance-seg.h"
+#include "semantic-seg.h"
+#include "implicit-gemm-conv.h"
+#include "half-output.h"
+#include "thread-pool.h"
+#include "numa-topology.h"
+#include "huge-page.h"
+#include "frame-ring.h"
+#include "host-register-cache.h"
+#include "completion-dispatcher.h"
+#include "async-task.h"
+#include "stream-pool.h"
 
 void cuda_runtime_api_1_hello_runtime();
 
@@ -46,6 +66,44 @@ void cuda_runtime_api_13_thrust();
 
 void cuda_runtime_api_14_error();
 
+void cuda_runtime_api_15_infer_cache();
+
+void cuda_runtime_api_16_motion_gate();
+
+void cuda_runtime_api_17_iou_tracker();
+
+void cuda_runtime_api_18_obb_nms();
+
+void cuda_runtime_api_19_grid_nms();
+
+void cuda_runtime_api_20_soft_nms();
+
+void cuda_runtime_api_21_topk_decode();
+
+void cuda_runtime_api_22_instance_seg();
+
+void cuda_runtime_api_23_semantic_seg();
+
+void cuda_runtime_api_24_implicit_gemm_conv();
+
+void cuda_runtime_api_25_half_output();
+
+void cuda_runtime_api_26_thread_pool();
+
+void cuda_runtime_api_27_numa_topology();
+
+void cuda_runtime_api_28_huge_page();
+
+void cuda_runtime_api_29_frame_ring();
+
+void cuda_runtime_api_30_register_cache();
+
+void cuda_runtime_api_31_completion_dispatcher();
+
+void cuda_runtime_api_32_async_task();
+
+void cuda_runtime_api_33_stream_pool();
+
 void test_print(const float *pdata, int ndata); // 4.cpp
 
 void print_layout(int *girds, int *blocks); // 5.cpp
@@ -70,6 +128,8 @@ void gemm_0(const float *A, const float *B, float *C,
 void gemm_1(const float *A, const float *B, float *C,
             int m, int n, int k, cudaStream_t stream); // 11.cpp
 
+void gemm_cpu(const float *A, const float *B, float *C, int m, int n, int k); // 22.cpp
+
 std::vector<uint8_t> load_file(const std::string &file); // 12,cpp
 
 std::vector<Box> cpu_decode(float *predict, int rows, int cols, float confidence_threshold = 0.25f, float nms_threshold = 0.45f); // 12,cpp
@@ -81,8 +141,38 @@ void decode_kernel_invoker(
     float nms_threshold, float *invert_affine_matrix, float *parray, int max_objects,
     int NUM_BOX_ELEMENT, cudaStream_t stream); // 12.cpp
 
+void decode_candidates_invoker(
+    float *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float *invert_affine_matrix, float *parray, int max_objects,
+    int NUM_BOX_ELEMENT, cudaStream_t stream); // 12.cpp, 只 decode 不做 nms
+
+// FP16 输出的 predict，25.cpp
+void decode_kernel_invoker(
+    const __half *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float nms_threshold, float *invert_affine_matrix, float *parray, int max_objects,
+    int NUM_BOX_ELEMENT, cudaStream_t stream);
+
+void decode_candidates_invoker(
+    const __half *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float *invert_affine_matrix, float *parray, int max_objects,
+    int NUM_BOX_ELEMENT, cudaStream_t stream);
+
 void thrust_demo(); // 13.cpp
 
 void error_demo(); // 14.cpp
 
+std::vector<RotatedBox> obb_nms(std::vector<RotatedBox> &boxes, float nms_threshold, int num_threads = 0); // 18.cpp
+
+std::vector<RotatedBox> cpu_decode_obb(float *predict, int rows, int cols, float confidence_threshold = 0.25f, float nms_threshold = 0.45f, int num_threads = 0); // 18.cpp
+
+std::vector<RotatedBox> gpu_decode_obb(float *predict, int rows, int cols, float confidence_threshold = 0.25f, float nms_threshold = 0.45f, int max_objects = 1000); // 18.cpp
+
+void decode_obb_kernel_invoker(
+    float *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float nms_threshold, float *parray, int max_objects, int NUM_BOX_ELEMENT, cudaStream_t stream); // 18.cpp
+
+std::vector<Box> cpu_decode_soft_nms(float *predict, int rows, int cols, float confidence_threshold = 0.25f, const SoftNMSConfig &config = SoftNMSConfig()); // 20.cpp
+
+std::vector<Box> gpu_decode_soft_nms(float *predict, int rows, int cols, float confidence_threshold = 0.25f, const SoftNMSConfig &config = SoftNMSConfig()); // 20.cpp
+
 #endif // CUDA_RUNTIME_API_H
@@ -0,0 +1,415 @@
+#include "frame-ring.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * 共享内存的布局：
+ *   [FrameRingHeader][FrameSlotHeader x slot_count] 按页对齐
+ *   [槽位 0 的数据][槽位 1 的数据]...               每个槽位按页对齐，长度为 slot_stride
+ * 槽位的 sequence 在写入期间带有 FRAME_SLOT_WRITING 标记，读端两次读到相同的 sequence 才认为数据完整。
+ */
+#define FRAME_RING_MAGIC 0x474E4952u // "RING"
+#define FRAME_RING_VERSION 1u
+#define FRAME_SLOT_WRITING (1ull << 63)
+
+struct FrameSlotHeader {
+    std::atomic<uint64_t> sequence;
+    int32_t width;
+    int32_t height;
+    int32_t line_size;
+    int32_t reserved;
+    uint64_t bytes;
+    int64_t timestamp_ns;
+};
+
+struct FrameRingHeader {
+    std::atomic<uint32_t> magic; // 最后写入，读端看到 magic 时其余字段都已经初始化
+    uint32_t version;
+    int32_t slot_count;
+    int32_t overwrite;
+    uint64_t slot_bytes;
+    uint64_t slot_stride;
+    uint64_t data_offset;
+    uint64_t total_bytes;
+
+    std::atomic<uint64_t> write_sequence; // 最后 commit 的帧
+    std::atomic<uint64_t> read_sequence;  // 读端最后 release 的帧，只用于不覆盖的模式
+    std::atomic<uint32_t> frame_event;    // futex，每次 commit 加 1
+    std::atomic<uint32_t> release_event;  // futex，每次 release 加 1
+    std::atomic<uint32_t> readers_waiting;
+    std::atomic<uint32_t> writer_waiting;
+    std::atomic<uint32_t> closed;
+
+    FrameSlotHeader *slots() { return (FrameSlotHeader *)(this + 1); }
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain 32-bit word");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && sizeof(uint64_t) == sizeof(long long), "shared memory atomics must be lock free");
+
+int64_t frame_ring_now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static int64_t deadline_after(int timeout_ms) {
+    return timeout_ms < 0 ? -1 : frame_ring_now_ns() + (int64_t)timeout_ms * 1000000ll;
+}
+
+#ifdef __linux__
+static size_t round_up_page(size_t value) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (value + page - 1) / page * page;
+}
+
+// 跨进程的 futex，不能用 FUTEX_PRIVATE_FLAG；word 仍然是 expected 时睡眠，直到被唤醒或者超过 deadline
+static bool futex_wait(std::atomic<uint32_t> *word, uint32_t expected, int64_t deadline_ns) {
+    timespec timeout, *ptimeout = nullptr;
+    if (deadline_ns >= 0) {
+        int64_t remain = deadline_ns - frame_ring_now_ns();
+        if (remain <= 0) { return false; }
+        timeout.tv_sec = remain / 1000000000ll;
+        timeout.tv_nsec = remain % 1000000000ll;
+        ptimeout = &timeout;
+    }
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, expected, ptimeout, nullptr, 0);
+    return true;
+}
+
+static void futex_wake(std::atomic<uint32_t> *word) {
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+#endif
+
+/* ------------------------------------------ FrameRingWriter ------------------------------------------ */
+
+FrameRingWriter::~FrameRingWriter() {
+    close();
+}
+
+bool FrameRingWriter::create(const std::string &name, const FrameRingConfig &config) {
+    close();
+#ifdef __linux__
+    if (config.slot_count <= 0 || config.slot_bytes == 0) { return false; }
+
+    size_t header_bytes = sizeof(FrameRingHeader) + config.slot_count * sizeof(FrameSlotHeader);
+    size_t data_offset = round_up_page(header_bytes);
+    size_t slot_stride = round_up_page(config.slot_bytes);
+    size_t total = data_offset + slot_stride * config.slot_count;
+
+    // 上一次异常退出时留下的同名段直接删掉，已经打开它的读端仍然可以用旧的映射
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        printf("shm_open %s failed: %s\n", name.c_str(), strerror(errno));
+        return false;
+    }
+    if (ftruncate(fd, (off_t)total) != 0) {
+        printf("ftruncate %s to %zu bytes failed: %s\n", name.c_str(), total, strerror(errno));
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void *mem = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    // ftruncate 之后的内容全为 0，atomic 的初始值就是 0
+    header_ = (FrameRingHeader *)mem;
+    header_->version = FRAME_RING_VERSION;
+    header_->slot_count = config.slot_count;
+    header_->overwrite = config.overwrite ? 1 : 0;
+    header_->slot_bytes = config.slot_bytes;
+    header_->slot_stride = slot_stride;
+    header_->data_offset = data_offset;
+    header_->total_bytes = total;
+    header_->magic.store(FRAME_RING_MAGIC, std::memory_order_release);
+
+    base_ = (uint8_t *)mem;
+    mapped_bytes_ = total;
+    name_ = name;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FrameRingWriter::close(bool unlink) {
+#ifdef __linux__
+    if (header_ == nullptr) { return; }
+    header_->closed.store(1, std::memory_order_seq_cst);
+    header_->frame_event.fetch_add(1, std::memory_order_seq_cst);
+    futex_wake(&header_->frame_event);
+    munmap(base_, mapped_bytes_);
+    if (unlink) { shm_unlink(name_.c_str()); }
+#endif
+    header_ = nullptr;
+    base_ = nullptr;
+    mapped_bytes_ = 0;
+    writing_ = false;
+}
+
+size_t FrameRingWriter::slot_bytes() const {
+    return header_ ? header_->slot_bytes : 0;
+}
+
+uint8_t *FrameRingWriter::begin_frame(int timeout_ms) {
+#ifdef __linux__
+    if (header_ == nullptr) { return nullptr; }
+    uint64_t sequence = header_->write_sequence.load(std::memory_order_relaxed) + 1;
+    int slot_count = header_->slot_count;
+
+    // 不覆盖的模式下，环中未 release 的帧不能超过 slot_count
+    if (!header_->overwrite) {
+        int64_t deadline = deadline_after(timeout_ms);
+        for (;;) {
+            uint32_t event = header_->release_event.load(std::memory_order_seq_cst);
+            if (sequence - header_->read_sequence.load(std::memory_order_seq_cst) <= (uint64_t)slot_count) { break; }
+            header_->writer_waiting.fetch_add(1, std::memory_order_seq_cst);
+            bool waited = futex_wait(&header_->release_event, event, deadline);
+            header_->writer_waiting.fetch_sub(1, std::memory_order_seq_cst);
+            if (!waited) { return nullptr; }
+        }
+    }
+
+    // 先打上写入中的标记，读端看到标记或者序号变化就知道这个槽位中的旧帧已经失效
+    int slot = (int)((sequence - 1) % slot_count);
+    header_->slots()[slot].sequence.store(sequence | FRAME_SLOT_WRITING, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    writing_ = true;
+    return base_ + header_->data_offset + slot * header_->slot_stride;
+#else
+    return nullptr;
+#endif
+}
+
+uint64_t FrameRingWriter::commit(const FrameInfo &info) {
+#ifdef __linux__
+    if (header_ == nullptr || !writing_) { return 0; }
+    uint64_t sequence = header_->write_sequence.load(std::memory_order_relaxed) + 1;
+    FrameSlotHeader &slot = header_->slots()[(sequence - 1) % header_->slot_count];
+    slot.width = info.width;
+    slot.height = info.height;
+    slot.line_size = info.line_size;
+    slot.bytes = std::min<uint64_t>(info.bytes, header_->slot_bytes);
+    slot.timestamp_ns = info.timestamp_ns;
+    slot.sequence.store(sequence, std::memory_order_release);
+    writing_ = false;
+
+    // 与读端的 readers_waiting 构成 Dekker 式的握手：要么读端看到新的序号，要么这里看到等待者
+    header_->write_sequence.store(sequence, std::memory_order_seq_cst);
+    header_->frame_event.fetch_add(1, std::memory_order_seq_cst);
+    if (header_->readers_waiting.load(std::memory_order_seq_cst) > 0) { futex_wake(&header_->frame_event); }
+    return sequence;
+#else
+    return 0;
+#endif
+}
+
+uint64_t FrameRingWriter::write(const void *data, const FrameInfo &info, int timeout_ms) {
+    if (header_ == nullptr || info.bytes > header_->slot_bytes) { return 0; }
+    uint8_t *slot = begin_frame(timeout_ms);
+    if (slot == nullptr) { return 0; }
+    memcpy(slot, data, info.bytes);
+    return commit(info);
+}
+
+/* ------------------------------------------ FrameRingReader ------------------------------------------ */
+
+FrameRingReader::~FrameRingReader() {
+    close();
+}
+
+bool FrameRingReader::open(const std::string &name) {
+    close();
+#ifdef __linux__
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) { return false; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FrameRingHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *mem = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) { return false; }
+
+    FrameRingHeader *header = (FrameRingHeader *)mem;
+    if (header->magic.load(std::memory_order_acquire) != FRAME_RING_MAGIC || header->version != FRAME_RING_VERSION
+        || header->total_bytes != (uint64_t)st.st_size) {
+        munmap(mem, (size_t)st.st_size);
+        return false;
+    }
+    header_ = header;
+    base_ = (uint8_t *)mem;
+    mapped_bytes_ = (size_t)st.st_size;
+
+    // 覆盖的模式从下一帧开始；不覆盖的模式从最早没有 release 的帧开始，写端在等的帧一帧也不丢
+    if (header_->overwrite) {
+        next_sequence_ = header_->write_sequence.load(std::memory_order_acquire) + 1;
+    } else {
+        next_sequence_ = header_->read_sequence.load(std::memory_order_acquire) + 1;
+    }
+    stats_ = FrameRingStats();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FrameRingReader::close() {
+    if (header_ == nullptr) { return; }
+    if (registered_) {
+        cudaHostUnregister(base_ + header_->data_offset);
+        cudaGetLastError();
+    }
+#ifdef __linux__
+    munmap(base_, mapped_bytes_);
+#endif
+    header_ = nullptr;
+    base_ = nullptr;
+    mapped_bytes_ = 0;
+    device_base_ = nullptr;
+    registered_ = false;
+}
+
+int FrameRingReader::slot_count() const {
+    return header_ ? header_->slot_count : 0;
+}
+
+size_t FrameRingReader::slot_bytes() const {
+    return header_ ? header_->slot_bytes : 0;
+}
+
+bool FrameRingReader::writer_closed() const {
+    return header_ == nullptr || header_->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool FrameRingReader::wait_for(uint64_t sequence, int64_t deadline_ns) {
+#ifdef __linux__
+    for (;;) {
+        uint32_t event = header_->frame_event.load(std::memory_order_seq_cst);
+        if (header_->write_sequence.load(std::memory_order_seq_cst) >= sequence) { return true; }
+        if (header_->closed.load(std::memory_order_seq_cst)) { return false; }
+        header_->readers_waiting.fetch_add(1, std::memory_order_seq_cst);
+        bool waited = futex_wait(&header_->frame_event, event, deadline_ns);
+        header_->readers_waiting.fetch_sub(1, std::memory_order_seq_cst);
+        if (!waited) { return header_->write_sequence.load(std::memory_order_seq_cst) >= sequence; }
+    }
+#else
+    return false;
+#endif
+}
+
+bool FrameRingReader::read_slot(uint64_t sequence, FrameView *view) {
+    int slot = (int)((sequence - 1) % header_->slot_count);
+    FrameSlotHeader &header = header_->slots()[slot];
+    if (header.sequence.load(std::memory_order_acquire) != sequence) { return false; }
+
+    view->info.sequence = sequence;
+    view->info.width = header.width;
+    view->info.height = header.height;
+    view->info.line_size = header.line_size;
+    view->info.bytes = header.bytes;
+    view->info.timestamp_ns = header.timestamp_ns;
+    view->data = base_ + header_->data_offset + slot * header_->slot_stride;
+    view->slot = slot;
+
+    // 读完元数据之后序号没有变化，才说明读到的是同一帧
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header.sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+bool FrameRingReader::next(FrameView *view, int timeout_ms) {
+    if (header_ == nullptr) { return false; }
+    int64_t deadline = deadline_after(timeout_ms);
+    uint64_t slot_count = (uint64_t)header_->slot_count;
+    for (;;) {
+        if (!wait_for(next_sequence_, deadline)) { return false; }
+
+        // 落后超过一圈时，next_sequence_ 所在的槽位已经被覆盖，跳到最旧的还在环中的帧
+        uint64_t written = header_->write_sequence.load(std::memory_order_acquire);
+        if (written >= next_sequence_ + slot_count) {
+            uint64_t oldest = written - slot_count + 1;
+            stats_.dropped += oldest - next_sequence_;
+            next_sequence_ = oldest;
+        }
+        uint64_t sequence = next_sequence_++;
+        if (read_slot(sequence, view)) {
+            stats_.received++;
+            return true;
+        }
+        // 读的过程中被覆盖了
+        stats_.dropped++;
+    }
+}
+
+bool FrameRingReader::latest(FrameView *view, int timeout_ms) {
+    if (header_ == nullptr) { return false; }
+    int64_t deadline = deadline_after(timeout_ms);
+    for (;;) {
+        if (!wait_for(next_sequence_, deadline)) { return false; }
+        uint64_t written = header_->write_sequence.load(std::memory_order_acquire);
+        stats_.dropped += written - next_sequence_;
+        next_sequence_ = written + 1;
+        if (read_slot(written, view)) {
+            stats_.received++;
+            return true;
+        }
+        stats_.dropped++;
+    }
+}
+
+bool FrameRingReader::still_valid(const FrameView &view) {
+    if (header_ == nullptr || view.slot < 0) { return false; }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bool valid = header_->slots()[view.slot].sequence.load(std::memory_order_relaxed) == view.info.sequence;
+    if (!valid) { stats_.torn++; }
+    return valid;
+}
+
+void FrameRingReader::release(const FrameView &view) {
+#ifdef __linux__
+    if (header_ == nullptr || header_->overwrite) { return; }
+    header_->read_sequence.store(view.info.sequence, std::memory_order_seq_cst);
+    header_->release_event.fetch_add(1, std::memory_order_seq_cst);
+    if (header_->writer_waiting.load(std::memory_order_seq_cst) > 0) { futex_wake(&header_->release_event); }
+#endif
+}
+
+cudaError_t FrameRingReader::register_host(unsigned int flags) {
+    if (header_ == nullptr) { return cudaErrorInvalidValue; }
+    if (registered_) { return cudaSuccess; }
+    uint8_t *data = base_ + header_->data_offset;
+    cudaError_t error = cudaHostRegister(data, header_->slot_stride * header_->slot_count, flags);
+    if (error != cudaSuccess) { return error; }
+    registered_ = true;
+    if (flags & cudaHostRegisterMapped) {
+        void *device = nullptr;
+        error = cudaHostGetDevicePointer(&device, data, 0);
+        device_base_ = (uint8_t *)device;
+    }
+    return error;
+}
+
+const uint8_t *FrameRingReader::device_pointer(const FrameView &view) const {
+    if (device_base_ == nullptr || view.slot < 0) { return nullptr; }
+    return device_base_ + view.slot * header_->slot_stride;
+}
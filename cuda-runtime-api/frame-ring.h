@@ -0,0 +1,139 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <cuda_runtime.h>
+
+/*
+ * 进程间的帧环形缓冲区：
+ * 采集进程和推理进程分开时，原来每帧都要经过 socket 拷贝（采集进程 write 一次，内核拷一次，推理进程 read 一次），
+ * 推理进程拿到的还是可分页内存，H2D 时驱动还要再拷到内部的锁页缓冲区。
+ * 这里用 POSIX 共享内存（shm_open）放一个固定槽位的环：
+ *   - 写端（采集进程）begin_frame 拿到下一个槽位直接写入，commit 发布；
+ *   - 读端（推理进程）next 得到指向槽位的指针，不拷贝；可以用 register_host 把整个段 cudaHostRegister，
+ *     cudaMemcpyAsync 直接从共享内存 DMA，或者用 cudaHostRegisterMapped 让核函数直接读；
+ *   - 帧带有从 1 开始的序号，读端由序号的间隔得知丢了多少帧；
+ *   - 等待和唤醒用共享内存上的 futex，没有等待者时写端不做系统调用。
+ * 两种满载策略：
+ *   - overwrite = true（默认）：写端从不等待，覆盖最旧的帧，适合实时视频，读端太慢时丢帧；
+ *   - overwrite = false：写端等待读端 release，不丢帧，只支持一个读端。
+ * 覆盖模式下，读端使用完槽位中的数据之后要用 still_valid 确认期间没有被覆盖（槽位的序号相当于 seqlock）。
+ * 只支持 Linux（futex），其他系统上 create / open 返回 false。
+ */
+struct FrameRingConfig {
+    int slot_count = 8;
+    size_t slot_bytes = 1920 * 1080 * 3; // 每个槽位最多容纳的字节数
+    bool overwrite = true;
+};
+
+struct FrameInfo {
+    uint64_t sequence = 0;   // 从 1 开始，由 commit 分配
+    int width = 0;
+    int height = 0;
+    int line_size = 0;
+    size_t bytes = 0;
+    int64_t timestamp_ns = 0; // 写端填写的采集时间（CLOCK_MONOTONIC，进程之间可以比较）
+};
+
+// 读端得到的帧，data 指向共享内存中的槽位
+struct FrameView {
+    FrameInfo info;
+    const uint8_t *data = nullptr;
+    int slot = -1;
+};
+
+struct FrameRingStats {
+    uint64_t received = 0;
+    uint64_t dropped = 0; // 被写端覆盖、没有读到的帧
+    uint64_t torn = 0;    // 读到了（计入 received），但 still_valid 发现使用期间被覆盖的帧
+};
+
+// 单调时钟，纳秒
+int64_t frame_ring_now_ns();
+
+class FrameRingWriter {
+public:
+    FrameRingWriter() = default;
+    ~FrameRingWriter();
+    FrameRingWriter(const FrameRingWriter &) = delete;
+    FrameRingWriter &operator=(const FrameRingWriter &) = delete;
+
+    // name 为 shm_open 的名字（"/camera0"），已经存在时先删除旧的段
+    bool create(const std::string &name, const FrameRingConfig &config = FrameRingConfig());
+    // 标记关闭并唤醒读端，unlink 为 true 时删除共享内存的名字（已经打开的读端不受影响）
+    void close(bool unlink = true);
+
+    /*
+     * 返回下一个槽位的地址，写满 FrameInfo::bytes 字节后调用 commit。
+     * 不覆盖的模式下环满时等待读端 release，超时（timeout_ms < 0 表示一直等）返回 nullptr。
+     */
+    uint8_t *begin_frame(int timeout_ms = -1);
+    // 发布 begin_frame 得到的帧，返回分配的序号；info 中的 sequence 被忽略
+    uint64_t commit(const FrameInfo &info);
+    // begin_frame + memcpy + commit
+    uint64_t write(const void *data, const FrameInfo &info, int timeout_ms = -1);
+
+    size_t slot_bytes() const;
+    bool is_open() const { return header_ != nullptr; }
+
+private:
+    struct FrameRingHeader *header_ = nullptr;
+    uint8_t *base_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    std::string name_;
+    bool writing_ = false;
+};
+
+class FrameRingReader {
+public:
+    FrameRingReader() = default;
+    ~FrameRingReader();
+    FrameRingReader(const FrameRingReader &) = delete;
+    FrameRingReader &operator=(const FrameRingReader &) = delete;
+
+    // 打开写端创建的段。覆盖的模式从打开之后 commit 的第一帧开始读，不覆盖的模式从最早没有 release 的帧开始
+    bool open(const std::string &name);
+    void close();
+
+    /*
+     * 等待下一帧，按序号顺序返回；读端落后超过一圈时跳到最旧的还在环中的帧，跳过的计入 dropped。
+     * 超时或者写端已经关闭（并且所有帧都已读完）时返回 false。
+     */
+    bool next(FrameView *view, int timeout_ms = -1);
+    // 只要最新的一帧，之前没读的都算丢弃（低延迟的场景）
+    bool latest(FrameView *view, int timeout_ms = -1);
+    // 槽位中的数据仍然是 view 这一帧，使用完数据之后调用，返回 false 时数据可能已经被覆盖（计入 torn）
+    bool still_valid(const FrameView &view);
+    // 不覆盖的模式下通知写端 view 及之前的槽位可以重用，覆盖的模式下什么也不做
+    void release(const FrameView &view);
+
+    /*
+     * 把数据区 cudaHostRegister 为锁页内存。flags 包含 cudaHostRegisterMapped 时可以用 device_pointer
+     * 得到核函数能直接访问的地址。close 时自动 unregister。
+     */
+    cudaError_t register_host(unsigned int flags = cudaHostRegisterPortable);
+    const uint8_t *device_pointer(const FrameView &view) const;
+
+    bool writer_closed() const;
+    const FrameRingStats &stats() const { return stats_; }
+    int slot_count() const;
+    size_t slot_bytes() const;
+    bool is_open() const { return header_ != nullptr; }
+
+private:
+    // deadline_ns < 0 表示一直等
+    bool wait_for(uint64_t sequence, int64_t deadline_ns);
+    bool read_slot(uint64_t sequence, FrameView *view);
+
+    struct FrameRingHeader *header_ = nullptr;
+    uint8_t *base_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    uint64_t next_sequence_ = 1;
+    uint8_t *device_base_ = nullptr;
+    bool registered_ = false;
+    FrameRingStats stats_;
+};
+
+#endif // FRAME_RING_H
@@ -5,32 +5,35 @@ __device__ void affine_project(float *matrix, float x, float y, float *ox, float
     *oy = matrix[3] * x + matrix[4] * y + matrix[5];
 }
 
-__global__ void decode_kernel(float *predict, int num_bboxes, int num_classes, float confidence_threshold,
+// T 为 float 或 __half，FP16 输出的 engine 不需要先转成 float
+template <typename T>
+__global__ void decode_kernel(const T *predict, int num_bboxes, int num_classes, float confidence_threshold,
                               float *invert_affine_matrix, float *parray, int max_objects, int NUM_BOX_ELEMENT) {
     int position = blockDim.x * blockIdx.x + threadIdx.x;
     if (position >= num_bboxes) { return; }
 
     // pitem 是指向每一行结果的首地址
-    float *pitem = predict + (5 + num_classes) * position;
+    const T *pitem = predict + (5 + num_classes) * position;
     // 置信度，表示该预测框中是否有对象的置信度。
-    float objectness = pitem[4];
+    float objectness = load_as_float(pitem[4]);
     if (objectness < confidence_threshold) { return; }
 
     // 当前行的 label 指针，指向类别概率的起始位置。
-    float *class_confidence = pitem + 5;
+    const T *class_confidence = pitem + 5;
     // 获取 class_confidence 所指向的浮点数的值，将其赋值给 confidence，然后将 class_confidence 指针递增到下一个位置。
-    float confidence = *class_confidence++; // *ptr 解引用指针;
+    float confidence = load_as_float(*class_confidence++); // *ptr 解引用指针;
     int label = 0;
 
     // 此处的 for 循环相当于 std::max_element 的作用；
     for (int i = 1; i < num_classes; ++i, ++class_confidence) {
-        if (*class_confidence > confidence) {
-            confidence = *class_confidence;
+        float value = load_as_float(*class_confidence);
+        if (value > confidence) {
+            confidence = value;
             label = i;
         }
     }
     confidence *= objectness;
-    if (objectness < confidence_threshold) { return; }
+    if (confidence < confidence_threshold) { return; }
 
     // 使用原子操作 atomicAdd 递增并获取当前输出索引 output_index。
     /*
@@ -41,10 +44,10 @@ __global__ void decode_kernel(float *predict, int num_bboxes, int num_classes, f
     if (index >= max_objects) { return; }
 
     // 获取 left, top, width, height 的值
-    float cx = *pitem++;
-    float cy = *pitem++;
-    float width = *pitem++;
-    float height = *pitem++;
+    float cx = load_as_float(*pitem++);
+    float cy = load_as_float(*pitem++);
+    float width = load_as_float(*pitem++);
+    float height = load_as_float(*pitem++);
 
     // xywh to xyxy
     float left = cx - width * 0.5;
@@ -111,9 +114,10 @@ __global__ void fast_nms_kernel(float *bboxes, int max_objects, float threshold,
     }
 }
 
-void decode_kernel_invoker(
-    float *predict, int num_bboxes, int num_classes, float confidence_threshold,
-    float nms_threshold, float *invert_affine_matrix, float *parray, int max_objects,
+template <typename T>
+static void launch_decode_candidates(
+    const T *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float *invert_affine_matrix, float *parray, int max_objects,
     int NUM_BOX_ELEMENT, cudaStream_t stream) {
     auto block = num_bboxes > 512 ? 512 : num_bboxes;
     auto grid = (num_bboxes + block - 1) / block;
@@ -122,8 +126,49 @@ void decode_kernel_invoker(
     decode_kernel<<<grid, block, 0, stream>>>(
         predict, num_bboxes, num_classes, confidence_threshold,
         invert_affine_matrix, parray, max_objects, NUM_BOX_ELEMENT);
+}
+
+void decode_candidates_invoker(
+    float *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float *invert_affine_matrix, float *parray, int max_objects,
+    int NUM_BOX_ELEMENT, cudaStream_t stream) {
+    launch_decode_candidates(predict, num_bboxes, num_classes, confidence_threshold,
+                             invert_affine_matrix, parray, max_objects, NUM_BOX_ELEMENT, stream);
+}
 
-    block = max_objects > 512 ? 512 : max_objects;
-    grid = (max_objects + block - 1) / block;
+void decode_candidates_invoker(
+    const __half *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float *invert_affine_matrix, float *parray, int max_objects,
+    int NUM_BOX_ELEMENT, cudaStream_t stream) {
+    launch_decode_candidates(predict, num_bboxes, num_classes, confidence_threshold,
+                             invert_affine_matrix, parray, max_objects, NUM_BOX_ELEMENT, stream);
+}
+
+template <typename T>
+static void launch_decode(
+    const T *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float nms_threshold, float *invert_affine_matrix, float *parray, int max_objects,
+    int NUM_BOX_ELEMENT, cudaStream_t stream) {
+    launch_decode_candidates(predict, num_bboxes, num_classes, confidence_threshold,
+                             invert_affine_matrix, parray, max_objects, NUM_BOX_ELEMENT, stream);
+
+    auto block = max_objects > 512 ? 512 : max_objects;
+    auto grid = (max_objects + block - 1) / block;
     fast_nms_kernel<<<grid, block, 0, stream>>>(parray, max_objects, nms_threshold, NUM_BOX_ELEMENT);
-}
\ No newline at end of file
+}
+
+void decode_kernel_invoker(
+    float *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float nms_threshold, float *invert_affine_matrix, float *parray, int max_objects,
+    int NUM_BOX_ELEMENT, cudaStream_t stream) {
+    launch_decode(predict, num_bboxes, num_classes, confidence_threshold, nms_threshold,
+                  invert_affine_matrix, parray, max_objects, NUM_BOX_ELEMENT, stream);
+}
+
+void decode_kernel_invoker(
+    const __half *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float nms_threshold, float *invert_affine_matrix, float *parray, int max_objects,
+    int NUM_BOX_ELEMENT, cudaStream_t stream) {
+    launch_decode(predict, num_bboxes, num_classes, confidence_threshold, nms_threshold,
+                  invert_affine_matrix, parray, max_objects, NUM_BOX_ELEMENT, stream);
+}
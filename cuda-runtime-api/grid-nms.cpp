@@ -0,0 +1,112 @@
+#include "grid-nms.h"
+#include <algorithm>
+#include "thread-pool.h"
+
+GridParams make_grid_params(const Box *boxes, int n) {
+    GridParams params;
+    if (n <= 0) { return params; }
+
+    float min_x = boxes[0].left, min_y = boxes[0].top;
+    float max_x = boxes[0].right, max_y = boxes[0].bottom;
+    int max_label = 0;
+    std::vector<float> sizes(n);
+    for (int i = 0; i < n; ++i) {
+        auto &box = boxes[i];
+        min_x = std::min(min_x, box.left);
+        min_y = std::min(min_y, box.top);
+        max_x = std::max(max_x, box.right);
+        max_y = std::max(max_y, box.bottom);
+        max_label = std::max(max_label, box.label);
+        sizes[i] = std::max(box.right - box.left, box.bottom - box.top);
+    }
+    std::nth_element(sizes.begin(), sizes.begin() + n / 2, sizes.end());
+    float median_size = sizes[n / 2];
+
+    float width = std::max(max_x - min_x, 1.0f);
+    float height = std::max(max_y - min_y, 1.0f);
+    float cell_size = std::max(median_size * 0.5f, sqrtf(width * height / n));
+    cell_size = std::max(cell_size, 1e-3f);
+
+    params.origin_x = min_x;
+    params.origin_y = min_y;
+    params.labels = max_label + 1;
+    params.cell_size = cell_size;
+    params.cols = (int)(width / cell_size) + 1;
+    params.rows = (int)(height / cell_size) + 1;
+    double buckets = (double)params.cols * params.rows * params.labels;
+    if (buckets > GRID_NMS_MAX_BUCKETS) {
+        params.cell_size = cell_size * sqrtf((float)(buckets / GRID_NMS_MAX_BUCKETS)) * 1.01f;
+        params.cols = (int)(width / params.cell_size) + 1;
+        params.rows = (int)(height / params.cell_size) + 1;
+    }
+    return params;
+}
+
+std::vector<Box> grid_nms(std::vector<Box> &boxes, float nms_threshold, int num_threads) {
+    // 稳定排序，置信度相同的框保持输入顺序，保证和标准贪心 NMS 的结果逐个一致
+    std::stable_sort(boxes.begin(), boxes.end(), [](const Box &a, const Box &b) { return a.confidence > b.confidence; });
+    int n = boxes.size();
+    if (n == 0) { return {}; }
+
+    GridParams params = make_grid_params(boxes.data(), n);
+    int num_buckets = params.num_buckets();
+
+    // 每个框覆盖的单元范围 [x0, x1] x [y0, y1]
+    std::vector<int> ranges(n * 4);
+    for (int i = 0; i < n; ++i) {
+        ranges[i * 4 + 0] = params.cell_x(boxes[i].left);
+        ranges[i * 4 + 1] = params.cell_y(boxes[i].top);
+        ranges[i * 4 + 2] = params.cell_x(boxes[i].right);
+        ranges[i * 4 + 3] = params.cell_y(boxes[i].bottom);
+    }
+
+    // CSR 格式的网格：bucket_start[k] ~ bucket_start[k + 1] 是桶 k 中的框，按置信度排名升序
+    std::vector<int> bucket_start(num_buckets + 1, 0);
+    for (int i = 0; i < n; ++i) {
+        const int *r = &ranges[i * 4];
+        for (int cy = r[1]; cy <= r[3]; ++cy) {
+            for (int cx = r[0]; cx <= r[2]; ++cx) { bucket_start[params.bucket(cx, cy, boxes[i].label) + 1]++; }
+        }
+    }
+    for (int k = 0; k < num_buckets; ++k) { bucket_start[k + 1] += bucket_start[k]; }
+    std::vector<int> bucket_items(bucket_start[num_buckets]);
+    std::vector<int> cursor(bucket_start.begin(), bucket_start.end() - 1);
+    for (int i = 0; i < n; ++i) {
+        const int *r = &ranges[i * 4];
+        for (int cy = r[1]; cy <= r[3]; ++cy) {
+            for (int cx = r[0]; cx <= r[2]; ++cx) { bucket_items[cursor[params.bucket(cx, cy, boxes[i].label)]++] = i; }
+        }
+    }
+
+    // 并行地为每个框找出排在它后面、需要被它删除的框
+    std::vector<std::vector<int>> overlaps(n);
+    parallel_for(0, n, [&](int64_t begin, int64_t end) {
+        for (int i = (int)begin; i < (int)end; ++i) {
+            const Box &a = boxes[i];
+            const int *r = &ranges[i * 4];
+            for (int cy = r[1]; cy <= r[3]; ++cy) {
+                for (int cx = r[0]; cx <= r[2]; ++cx) {
+                    int bucket = params.bucket(cx, cy, a.label);
+                    const int *first = bucket_items.data() + bucket_start[bucket];
+                    const int *last = bucket_items.data() + bucket_start[bucket + 1];
+                    // 桶内按排名升序，只需要看排在 i 后面的框
+                    for (const int *p = std::upper_bound(first, last, i); p != last; ++p) {
+                        const Box &b = boxes[*p];
+                        if (!grid_is_reference_cell(r, &ranges[*p * 4], cx, cy)) { continue; }
+                        float iou = grid_box_iou(a, b);
+                        if (iou > 0 && iou >= nms_threshold) { overlaps[i].push_back(*p); }
+                    }
+                }
+            }
+        }
+    }, 64, num_threads);
+
+    std::vector<bool> remove_flags(n);
+    std::vector<Box> box_result;
+    for (int i = 0; i < n; ++i) {
+        if (remove_flags[i]) { continue; }
+        box_result.emplace_back(boxes[i]);
+        for (int j : overlaps[i]) { remove_flags[j] = true; }
+    }
+    return box_result;
+}
@@ -0,0 +1,228 @@
+#include "cuda-runtime-api.h"
+#include <thrust/execution_policy.h>
+#include <thrust/functional.h>
+#include <thrust/scan.h>
+#include <thrust/sort.h>
+
+// 每个框的状态，按轮次从 UNDECIDED 变为 KEEP 或 REMOVE，之后不再改变
+enum { GRID_UNDECIDED = 0, GRID_KEEP = 1, GRID_REMOVE = 2 };
+
+__global__ void grid_score_kernel(const Box *boxes, int n, float *scores, int *order) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= n) { return; }
+    scores[position] = boxes[position].confidence;
+    order[position] = position;
+}
+
+// 按排序后的顺序重排框，同时算出每个框覆盖的单元范围并统计每个桶的框数
+__global__ void grid_gather_kernel(const Box *boxes, const int *order, int n, GridParams params,
+                                   Box *sorted, int *ranges, int *bucket_count) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= n) { return; }
+    Box box = boxes[order[position]];
+    sorted[position] = box;
+
+    int x0 = params.cell_x(box.left);
+    int y0 = params.cell_y(box.top);
+    int x1 = params.cell_x(box.right);
+    int y1 = params.cell_y(box.bottom);
+    ranges[position * 4 + 0] = x0;
+    ranges[position * 4 + 1] = y0;
+    ranges[position * 4 + 2] = x1;
+    ranges[position * 4 + 3] = y1;
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) { atomicAdd(&bucket_count[params.bucket(cx, cy, box.label)], 1); }
+    }
+}
+
+// 桶内的顺序由 atomicAdd 决定，是不确定的，所以找重叠对时需要扫描整个桶
+__global__ void grid_fill_kernel(const Box *sorted, const int *ranges, int n, GridParams params, int *bucket_cursor, int *bucket_items) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= n) { return; }
+    int label = sorted[position].label;
+    const int *r = ranges + position * 4;
+    for (int cy = r[1]; cy <= r[3]; ++cy) {
+        for (int cx = r[0]; cx <= r[2]; ++cx) {
+            int index = atomicAdd(&bucket_cursor[params.bucket(cx, cy, label)], 1);
+            bucket_items[index] = position;
+        }
+    }
+}
+
+/*
+ * 每个线程负责排名为 position 的框，找出所有排在它后面、同类别且 IoU 达到阈值的框，
+ * 记为 (suppressor, victim) 对，同时统计每个框的 suppressor 数量。
+ * 重叠对的数量超过 capacity 时只计数不写入，由调用方扩容后重新运行。
+ */
+__global__ void grid_pair_kernel(const Box *sorted, const int *ranges, int n, GridParams params,
+                                 const int *bucket_start, const int *bucket_items, float threshold,
+                                 int *pairs, int capacity, int *pair_count, int *pending) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= n) { return; }
+    Box a = sorted[position];
+    const int *r = ranges + position * 4;
+    for (int cy = r[1]; cy <= r[3]; ++cy) {
+        for (int cx = r[0]; cx <= r[2]; ++cx) {
+            int bucket = params.bucket(cx, cy, a.label);
+            for (int k = bucket_start[bucket]; k < bucket_start[bucket + 1]; ++k) {
+                int j = bucket_items[k];
+                if (j <= position) { continue; }
+                Box b = sorted[j];
+                if (!grid_is_reference_cell(r, ranges + j * 4, cx, cy)) { continue; }
+                float iou = grid_box_iou(a, b);
+                if (iou > 0 && iou >= threshold) {
+                    int index = atomicAdd(pair_count, 1);
+                    if (index < capacity) {
+                        pairs[index * 2 + 0] = position;
+                        pairs[index * 2 + 1] = j;
+                    }
+                    atomicAdd(&pending[j], 1);
+                }
+            }
+        }
+    }
+}
+
+// suppressor 已保留则删除 victim；suppressor 已删除则 victim 少了一个需要等待的 suppressor
+__global__ void grid_resolve_pairs_kernel(const int *pairs, int npairs, unsigned char *state,
+                                          unsigned char *pair_done, int *pending) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= npairs || pair_done[position]) { return; }
+    int suppressor = pairs[position * 2 + 0];
+    int victim = pairs[position * 2 + 1];
+    unsigned char s = state[suppressor];
+    if (s == GRID_KEEP) {
+        state[victim] = GRID_REMOVE;
+        pair_done[position] = 1;
+    } else if (s == GRID_REMOVE) {
+        atomicSub(&pending[victim], 1);
+        pair_done[position] = 1;
+    }
+}
+
+// 所有 suppressor 都被删除（或者根本没有 suppressor）的框保留
+__global__ void grid_resolve_boxes_kernel(unsigned char *state, const int *pending, int n, int *undecided) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= n || state[position] != GRID_UNDECIDED) { return; }
+    if (pending[position] == 0) {
+        state[position] = GRID_KEEP;
+    } else {
+        atomicAdd(undecided, 1);
+    }
+}
+
+/*
+ * 贪心 NMS 的结果等价于：一个框被保留，当且仅当所有删除它的候选（排名更高且 IoU 达到阈值）都没有被保留。
+ * 每一轮里排名最高的未确定框一定能确定下来，实际的轮数等于重叠链的最大长度，通常只有个位数。
+ */
+std::vector<Box> gpu_grid_nms(const std::vector<Box> &boxes, float nms_threshold, cudaStream_t stream) {
+    std::vector<Box> box_result;
+    int n = boxes.size();
+    if (n == 0) { return box_result; }
+
+    GridParams params = make_grid_params(boxes.data(), n);
+    int num_buckets = params.num_buckets();
+    auto block = n > 512 ? 512 : n;
+    auto grid = (n + block - 1) / block;
+    auto policy = thrust::cuda::par.on(stream);
+
+    Box *boxes_device = nullptr;
+    Box *sorted_device = nullptr;
+    float *scores_device = nullptr;
+    int *order_device = nullptr;
+    int *ranges_device = nullptr;
+    int *bucket_count_device = nullptr;
+    int *bucket_start_device = nullptr;
+    int *bucket_items_device = nullptr;
+    int *pending_device = nullptr;
+    int *counter_device = nullptr; // [pair_count, undecided]
+    unsigned char *state_device = nullptr;
+    checkRuntime(cudaMalloc(&boxes_device, n * sizeof(Box)));
+    checkRuntime(cudaMalloc(&sorted_device, n * sizeof(Box)));
+    checkRuntime(cudaMalloc(&scores_device, n * sizeof(float)));
+    checkRuntime(cudaMalloc(&order_device, n * sizeof(int)));
+    checkRuntime(cudaMalloc(&ranges_device, n * 4 * sizeof(int)));
+    checkRuntime(cudaMalloc(&bucket_count_device, (num_buckets + 1) * sizeof(int)));
+    checkRuntime(cudaMalloc(&bucket_start_device, (num_buckets + 1) * sizeof(int)));
+    checkRuntime(cudaMalloc(&pending_device, n * sizeof(int)));
+    checkRuntime(cudaMalloc(&counter_device, 2 * sizeof(int)));
+    checkRuntime(cudaMalloc(&state_device, n * sizeof(unsigned char)));
+
+    // 1. 按置信度稳定排序，置信度相同的框保持输入顺序，与 CPU 的 std::stable_sort 一致
+    checkRuntime(cudaMemcpyAsync(boxes_device, boxes.data(), n * sizeof(Box), cudaMemcpyHostToDevice, stream));
+    grid_score_kernel<<<grid, block, 0, stream>>>(boxes_device, n, scores_device, order_device);
+    thrust::stable_sort_by_key(policy, scores_device, scores_device + n, order_device, thrust::greater<float>());
+
+    // 2. 分桶：统计每个桶的框数，前缀和得到每个桶的起始位置，再填入框的排名
+    checkRuntime(cudaMemsetAsync(bucket_count_device, 0, (num_buckets + 1) * sizeof(int), stream));
+    grid_gather_kernel<<<grid, block, 0, stream>>>(boxes_device, order_device, n, params, sorted_device, ranges_device, bucket_count_device);
+    thrust::exclusive_scan(policy, bucket_count_device, bucket_count_device + num_buckets + 1, bucket_start_device);
+
+    int total_items = 0;
+    checkRuntime(cudaMemcpyAsync(&total_items, bucket_start_device + num_buckets, sizeof(int), cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaStreamSynchronize(stream));
+    checkRuntime(cudaMalloc(&bucket_items_device, std::max(total_items, 1) * sizeof(int)));
+    // bucket_count 已经不再需要，复用为填充时的游标
+    checkRuntime(cudaMemcpyAsync(bucket_count_device, bucket_start_device, num_buckets * sizeof(int), cudaMemcpyDeviceToDevice, stream));
+    grid_fill_kernel<<<grid, block, 0, stream>>>(sorted_device, ranges_device, n, params, bucket_count_device, bucket_items_device);
+
+    // 3. 找出所有重叠对，容量不够时扩容重跑
+    int capacity = n * 4;
+    int npairs = 0;
+    int *pairs_device = nullptr;
+    for (;;) {
+        checkRuntime(cudaMalloc(&pairs_device, capacity * 2 * sizeof(int)));
+        checkRuntime(cudaMemsetAsync(counter_device, 0, 2 * sizeof(int), stream));
+        checkRuntime(cudaMemsetAsync(pending_device, 0, n * sizeof(int), stream));
+        grid_pair_kernel<<<grid, block, 0, stream>>>(sorted_device, ranges_device, n, params, bucket_start_device, bucket_items_device,
+                                                     nms_threshold, pairs_device, capacity, counter_device, pending_device);
+        checkRuntime(cudaMemcpyAsync(&npairs, counter_device, sizeof(int), cudaMemcpyDeviceToHost, stream));
+        checkRuntime(cudaStreamSynchronize(stream));
+        if (npairs <= capacity) { break; }
+        checkRuntime(cudaFree(pairs_device));
+        capacity = npairs;
+    }
+
+    // 4. 按轮次确定每个框的保留与删除
+    unsigned char *pair_done_device = nullptr;
+    checkRuntime(cudaMalloc(&pair_done_device, std::max(npairs, 1) * sizeof(unsigned char)));
+    checkRuntime(cudaMemsetAsync(pair_done_device, 0, std::max(npairs, 1) * sizeof(unsigned char), stream));
+    checkRuntime(cudaMemsetAsync(state_device, GRID_UNDECIDED, n * sizeof(unsigned char), stream));
+    auto pair_block = npairs > 512 ? 512 : std::max(npairs, 1);
+    auto pair_grid = (npairs + pair_block - 1) / pair_block;
+    int undecided = 0;
+    for (int round = 0;; ++round) {
+        if (round > 0 && npairs > 0) {
+            grid_resolve_pairs_kernel<<<pair_grid, pair_block, 0, stream>>>(pairs_device, npairs, state_device, pair_done_device, pending_device);
+        }
+        checkRuntime(cudaMemsetAsync(counter_device + 1, 0, sizeof(int), stream));
+        grid_resolve_boxes_kernel<<<grid, block, 0, stream>>>(state_device, pending_device, n, counter_device + 1);
+        checkRuntime(cudaMemcpyAsync(&undecided, counter_device + 1, sizeof(int), cudaMemcpyDeviceToHost, stream));
+        checkRuntime(cudaStreamSynchronize(stream));
+        if (undecided == 0) { break; }
+    }
+
+    std::vector<Box> sorted(n);
+    std::vector<unsigned char> state(n);
+    checkRuntime(cudaMemcpyAsync(sorted.data(), sorted_device, n * sizeof(Box), cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaMemcpyAsync(state.data(), state_device, n * sizeof(unsigned char), cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaStreamSynchronize(stream));
+    for (int i = 0; i < n; ++i) {
+        if (state[i] == GRID_KEEP) { box_result.emplace_back(sorted[i]); }
+    }
+
+    checkRuntime(cudaFree(boxes_device));
+    checkRuntime(cudaFree(sorted_device));
+    checkRuntime(cudaFree(scores_device));
+    checkRuntime(cudaFree(order_device));
+    checkRuntime(cudaFree(ranges_device));
+    checkRuntime(cudaFree(bucket_count_device));
+    checkRuntime(cudaFree(bucket_start_device));
+    checkRuntime(cudaFree(bucket_items_device));
+    checkRuntime(cudaFree(pending_device));
+    checkRuntime(cudaFree(counter_device));
+    checkRuntime(cudaFree(state_device));
+    checkRuntime(cudaFree(pairs_device));
+    checkRuntime(cudaFree(pair_done_device));
+    return box_result;
+}
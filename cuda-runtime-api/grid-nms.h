@@ -0,0 +1,85 @@
+#ifndef GRID_NMS_H
+#define GRID_NMS_H
+
+#include <math.h>
+#include <vector>
+#include "utils.h"
+
+/*
+ * 基于均匀网格的 NMS：
+ * 切片推理、低阈值的 8K 图像会产生 5 万以上的候选框，逐对比较或者 IoU 矩阵在这个规模下都是平方级的。
+ * 把框按覆盖到的网格单元分桶，每个框只与同一单元里的框比较，IoU > 0 的两个框一定至少共享一个单元。
+ * 结果与标准的贪心 NMS（按置信度排序，同类别，IoU >= 阈值则删除）完全一致。
+ */
+#ifdef __CUDACC__
+#define GRID_HOST_DEVICE __host__ __device__
+#else
+#define GRID_HOST_DEVICE
+#endif
+
+// 网格的总桶数（单元数 x 类别数）上限，避免框很小、分布很散时网格本身占用过多内存
+#define GRID_NMS_MAX_BUCKETS (1 << 22)
+
+struct GridParams {
+    float origin_x = 0, origin_y = 0;
+    float cell_size = 1;
+    int cols = 1, rows = 1;
+    int labels = 1; // 每个单元按类别再分桶，不同类别的框不需要比较
+
+    GRID_HOST_DEVICE int bucket(int cx, int cy, int label) const {
+        return (cy * cols + cx) * labels + label;
+    }
+    GRID_HOST_DEVICE int num_buckets() const {
+        return cols * rows * labels;
+    }
+
+    GRID_HOST_DEVICE int cell_x(float x) const {
+        int c = (int)floorf((x - origin_x) / cell_size);
+        return c < 0 ? 0 : (c >= cols ? cols - 1 : c);
+    }
+    GRID_HOST_DEVICE int cell_y(float y) const {
+        int r = (int)floorf((y - origin_y) / cell_size);
+        return r < 0 ? 0 : (r >= rows ? rows - 1 : r);
+    }
+};
+
+/*
+ * 单元边长取框的长边中位数的一半和 sqrt(面积 / 框数) 中较大的一个：
+ * 前者让大部分框只覆盖 4~9 个单元，同时单元内不相交的框不会太多；后者保证单元数与框数同一个量级。
+ */
+GridParams make_grid_params(const Box *boxes, int n);
+
+/*
+ * 两个框在多个单元里相遇时只在一个单元里处理：
+ * 交集的左上角 (max(left), max(top)) 同时落在两个框覆盖的单元范围内，只在这个点所在的单元里计算 IoU。
+ * cell_x / cell_y 是单调的，所以这个单元就是两个框起始单元的较大者，用预先算好的单元范围比较即可，不需要再做除法。
+ * ra、rb 为两个框覆盖的单元范围 [x0, y0, x1, y1]。
+ */
+GRID_HOST_DEVICE inline bool grid_is_reference_cell(const int *ra, const int *rb, int cx, int cy) {
+    int x = ra[0] > rb[0] ? ra[0] : rb[0];
+    int y = ra[1] > rb[1] ? ra[1] : rb[1];
+    return x == cx && y == cy;
+}
+
+GRID_HOST_DEVICE inline float grid_box_iou(const Box &a, const Box &b) {
+    float cross_left = a.left > b.left ? a.left : b.left;
+    float cross_top = a.top > b.top ? a.top : b.top;
+    float cross_right = a.right < b.right ? a.right : b.right;
+    float cross_bottom = a.bottom < b.bottom ? a.bottom : b.bottom;
+    float cross_w = cross_right - cross_left;
+    float cross_h = cross_bottom - cross_top;
+    if (cross_w <= 0 || cross_h <= 0) { return 0.0f; }
+    float cross_area = cross_w * cross_h;
+    float a_area = (a.right - a.left) * (a.bottom - a.top);
+    float b_area = (b.right - b.left) * (b.bottom - b.top);
+    float union_area = a_area + b_area - cross_area;
+    return union_area > 0 ? cross_area / union_area : 0.0f;
+}
+
+// CPU 版本，num_threads <= 0 时使用全部核心；boxes 会被按置信度排序
+std::vector<Box> grid_nms(std::vector<Box> &boxes, float nms_threshold, int num_threads = 0);
+
+// GPU 版本，排序、分桶、找重叠对、按轮次确定保留与删除都在设备上完成
+std::vector<Box> gpu_grid_nms(const std::vector<Box> &boxes, float nms_threshold, cudaStream_t stream = nullptr);
+
+#endif // GRID_NMS_H
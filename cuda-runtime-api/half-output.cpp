@@ -0,0 +1,172 @@
+#include "half-output.h"
+#include <algorithm>
+#include <string.h>
+#include <vector>
+#include "thread-pool.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HALF_OUTPUT_USE_X86 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define HALF_OUTPUT_USE_NEON 1
+#endif
+
+static uint32_t float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bits_float(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint16_t float_to_half(float value) {
+    uint32_t bits = float_bits(value);
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    if (magnitude >= 0x7f800000) { // inf、nan，nan 保留高位的尾数并置静默位
+        return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 | ((magnitude >> 13) & 0x3ff) : 0);
+    }
+    if (magnitude >= 0x477ff000) { return sign | 0x7c00; } // >= 65520 舍入后溢出为 inf
+    if (magnitude < 0x38800000) {
+        // 结果是非规格化数：加上 0.5 之后 float 的最低位正好是 2^-24，由 FPU 完成就近舍入
+        return sign | (uint16_t)(float_bits(bits_float(magnitude) + 0.5f) - 0x3f000000);
+    }
+    // 规格化数：指数减去 112，尾数低 13 位就近舍入到偶数
+    magnitude += 0xc8000fff + ((magnitude >> 13) & 1);
+    return sign | (uint16_t)(magnitude >> 13);
+}
+
+float half_to_float(uint16_t value) {
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    if (exponent == 0) {
+        if (mantissa == 0) { return bits_float(sign); }
+        // 非规格化数，移到最高位为 1 后按规格化数表示
+        exponent = 113;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        return bits_float(sign | (exponent << 23) | ((mantissa & 0x3ff) << 13));
+    }
+    if (exponent == 31) { return bits_float(sign | 0x7f800000 | (mantissa << 13)); }
+    return bits_float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+#if defined(HALF_OUTPUT_USE_X86)
+// 编译时不需要 -mf16c，运行时确认 CPU 支持之后才调用
+__attribute__((target("avx,f16c"))) static size_t widen_half_simd(const uint16_t *src, float *dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) { _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i)))); }
+    return i;
+}
+
+__attribute__((target("avx2"))) static size_t widen_int8_simd(const int8_t *src, float scale, float *dst, size_t count) {
+    __m256 vscale = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i value = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(value), vscale));
+    }
+    return i;
+}
+
+static bool has_f16c() {
+    static bool supported = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    return supported;
+}
+
+static bool has_avx2() {
+    static bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#elif defined(HALF_OUTPUT_USE_NEON)
+static size_t widen_half_simd(const uint16_t *src, float *dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        float16x8_t value = vreinterpretq_f16_u16(vld1q_u16(src + i));
+        vst1q_f32(dst + i, vcvt_f32_f16(vget_low_f16(value)));
+        vst1q_f32(dst + i + 4, vcvt_high_f32_f16(value));
+    }
+    return i;
+}
+
+static size_t widen_int8_simd(const int8_t *src, float scale, float *dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t value = vmovl_s8(vld1_s8(src + i));
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(value))), scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(value))), scale));
+    }
+    return i;
+}
+
+static bool has_f16c() { return true; }
+static bool has_avx2() { return true; }
+#else
+static size_t widen_half_simd(const uint16_t *, float *, size_t) { return 0; }
+static size_t widen_int8_simd(const int8_t *, float, float *, size_t) { return 0; }
+static bool has_f16c() { return false; }
+static bool has_avx2() { return false; }
+#endif
+
+const char *widen_simd_name() {
+#if defined(HALF_OUTPUT_USE_X86)
+    return has_f16c() ? "F16C" : "scalar";
+#elif defined(HALF_OUTPUT_USE_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+static void widen_half_block(const uint16_t *src, float *dst, size_t count) {
+    size_t i = has_f16c() ? widen_half_simd(src, dst, count) : 0;
+    for (; i < count; ++i) { dst[i] = half_to_float(src[i]); }
+}
+
+static void widen_int8_block(const int8_t *src, float scale, float *dst, size_t count) {
+    size_t i = has_avx2() ? widen_int8_simd(src, scale, dst, count) : 0;
+    for (; i < count; ++i) { dst[i] = src[i] * scale; }
+}
+
+// 按 block_size 个元素一块交给线程池，数据少于 4 块时在当前线程完成
+template <typename Fn>
+static void parallel_blocks(size_t count, int num_threads, Fn &&fn) {
+    const size_t block_size = 64 * 1024;
+    size_t num_blocks = (count + block_size - 1) / block_size;
+    if (num_threads <= 0) { num_threads = ThreadPool::global().concurrency(); }
+    num_threads = (int)std::min<size_t>(num_threads, num_blocks / 4);
+    if (num_threads <= 1) {
+        fn(0, count);
+        return;
+    }
+
+    parallel_for(0, (int64_t)num_blocks, [&](int64_t first, int64_t last) {
+        size_t begin = first * block_size;
+        fn(begin, std::min(last * block_size, count) - begin);
+    }, 1, num_threads);
+}
+
+void widen_half(const uint16_t *src, float *dst, size_t count, int num_threads) {
+    parallel_blocks(count, num_threads, [&](size_t begin, size_t size) { widen_half_block(src + begin, dst + begin, size); });
+}
+
+void widen_int8(const int8_t *src, float scale, float *dst, size_t count, int num_threads) {
+    parallel_blocks(count, num_threads, [&](size_t begin, size_t size) { widen_int8_block(src + begin, scale, dst + begin, size); });
+}
+
+void widen_output(const void *src, const OutputBinding &binding, float *dst, int num_threads) {
+    switch (binding.type) {
+    case OutputType::Float16: widen_half((const uint16_t *)src, dst, binding.count, num_threads); break;
+    case OutputType::Int8: widen_int8((const int8_t *)src, binding.scale, dst, binding.count, num_threads); break;
+    default: memcpy(dst, src, binding.count * sizeof(float)); break;
+    }
+}
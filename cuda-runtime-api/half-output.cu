@@ -0,0 +1,24 @@
+#include "cuda-runtime-api.h"
+
+__global__ void narrow_half_kernel(const float *src, __half *dst, size_t count) {
+    size_t i = (size_t)blockDim.x * blockIdx.x + threadIdx.x;
+    if (i < count) { dst[i] = __float2half_rn(src[i]); }
+}
+
+__global__ void narrow_int8_kernel(const float *src, int8_t *dst, float inv_scale, size_t count) {
+    size_t i = (size_t)blockDim.x * blockIdx.x + threadIdx.x;
+    if (i >= count) { return; }
+    float value = rintf(src[i] * inv_scale);
+    dst[i] = (int8_t)fminf(fmaxf(value, -127.0f), 127.0f);
+}
+
+void narrow_output_invoker(const float *src, void *dst, const OutputBinding &binding, cudaStream_t stream) {
+    if (binding.count == 0) { return; }
+    int block = 256;
+    size_t grid = (binding.count + block - 1) / block;
+    switch (binding.type) {
+    case OutputType::Float16: narrow_half_kernel<<<grid, block, 0, stream>>>(src, (__half *)dst, binding.count); break;
+    case OutputType::Int8: narrow_int8_kernel<<<grid, block, 0, stream>>>(src, (int8_t *)dst, 1.0f / binding.scale, binding.count); break;
+    default: cudaMemcpyAsync(dst, src, binding.count * sizeof(float), cudaMemcpyDeviceToDevice, stream); break;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef HALF_OUTPUT_H
+#define HALF_OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cuda_runtime.h>
+#include <cuda_fp16.h>
+
+/*
+ * FP16、INT8 的输出 binding。FP16 的 engine 输出仍然是 FP32 时，拷回主机的字节数由 sizeof(float) 决定，
+ * 分割的 logits 这类原始输出很大，改成 FP16 输出可以少拷一半，INT8（带 scale）少拷四分之三。
+ *   - 设备端的后处理直接读 half / int8（semantic_argmax_invoker、decode_kernel_invoker 的重载），不需要先转成 float；
+ *   - 主机需要 float 时用 widen_output 转换：x86 上用 F16C 的 _mm256_cvtph_ps（运行时检测 CPU 是否支持），
+ *     ARM 上用 NEON 的 vcvt_f32_f16，都没有时逐个转换，按块分给多个线程。
+ * TensorRT 中用 network->getOutput(i)->setType(nvinfer1::DataType::kHALF) 指定输出为 FP16。
+ */
+enum class OutputType : int {
+    Float32 = 0,
+    Float16 = 1,
+    Int8 = 2 // value = int8 * scale
+};
+
+struct OutputBinding {
+    OutputType type = OutputType::Float32;
+    float scale = 1.0f; // 只用于 Int8
+    size_t count = 0;   // 元素个数
+
+    size_t element_size() const {
+        return type == OutputType::Float32 ? 4 : (type == OutputType::Float16 ? 2 : 1);
+    }
+    size_t bytes() const {
+        return count * element_size();
+    }
+};
+
+// IEEE 754 半精度与单精度之间的转换，就近舍入到偶数，与 __float2half / __half2float 相同
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t value);
+
+// num_threads <= 0 时使用全部核心，数据量小时只用一个线程
+void widen_half(const uint16_t *src, float *dst, size_t count, int num_threads = 0);
+void widen_int8(const int8_t *src, float scale, float *dst, size_t count, int num_threads = 0);
+void widen_output(const void *src, const OutputBinding &binding, float *dst, int num_threads = 0);
+
+// 当前使用的 SIMD 指令集，"F16C"、"NEON" 或者 "scalar"
+const char *widen_simd_name();
+
+// 把设备端的 float 转成 binding 的类型，模拟 engine 的 FP16 / INT8 输出（int8 = round(value / scale) 截断到 [-127, 127]）
+void narrow_output_invoker(const float *src, void *dst, const OutputBinding &binding, cudaStream_t stream);
+
+#ifdef __CUDACC__
+// 设备端读取任意输出类型的元素，int8 的 scale 由调用方乘
+__device__ inline float load_as_float(float value) { return value; }
+__device__ inline float load_as_float(__half value) { return __half2float(value); }
+__device__ inline float load_as_float(int8_t value) { return (float)value; }
+#endif
+
+#endif // HALF_OUTPUT_H
@@ -0,0 +1,248 @@
+#include "host-register-cache.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static uintptr_t host_page_size() {
+    static const uintptr_t page = [] {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (uintptr_t)info.dwPageSize;
+#else
+        long size = sysconf(_SC_PAGESIZE);
+        return (uintptr_t)(size > 0 ? size : 4096);
+#endif
+    }();
+    return page;
+}
+
+// Mat 的 owner：别名构造让 get() 返回 UMatData，同一块内存的多次 acquire 得到相同的 key，区间里不会重复持有
+static std::shared_ptr<void> mat_owner(const cv::Mat &mat) {
+    if (mat.u == nullptr) { return nullptr; }
+    auto keep = std::make_shared<cv::Mat>(mat);
+    return std::shared_ptr<void>(keep, (void *)mat.u);
+}
+
+static size_t mat_bytes(const cv::Mat &mat) {
+    return mat.empty() ? 0 : (size_t)(mat.dataend - mat.datastart);
+}
+
+HostRegisterCache::HostRegisterCache(const HostRegisterCacheConfig &config) : config_(config) {}
+
+HostRegisterCache::~HostRegisterCache() {
+    clear();
+}
+
+HostRegisterCache &HostRegisterCache::global() {
+    static HostRegisterCache *cache = new HostRegisterCache();
+    return *cache;
+}
+
+std::map<uintptr_t, HostRegisterCache::Range>::iterator HostRegisterCache::find_locked(uintptr_t begin, uintptr_t end) {
+    // 区间互不重叠，只有起始地址不大于 begin 的最后一个区间可能包含 [begin, end)
+    auto it = ranges_.upper_bound(begin);
+    if (it == ranges_.begin()) { return ranges_.end(); }
+    --it;
+    return end <= it->second.end ? it : ranges_.end();
+}
+
+std::map<uintptr_t, HostRegisterCache::Range>::iterator HostRegisterCache::unregister_locked(
+    std::map<uintptr_t, Range>::iterator it) {
+    Range &range = it->second;
+    if (range.last_use) {
+        // 还有拷贝在使用这段内存，注销之前等它完成
+        cudaEventSynchronize(range.last_use);
+        cudaEventDestroy(range.last_use);
+    }
+    if (cudaHostUnregister((void *)it->first) != cudaSuccess) { cudaGetLastError(); }
+    stats_.registered_bytes -= range.end - it->first;
+    lru_.erase(range.lru);
+    // owners 在 erase 时释放，此时已经注销
+    return ranges_.erase(it);
+}
+
+bool HostRegisterCache::acquire_locked(const void *ptr, size_t bytes, std::shared_ptr<void> owner) {
+    if (ptr == nullptr || bytes == 0 || bytes < config_.min_bytes) { return false; }
+
+    uintptr_t page = host_page_size();
+    uintptr_t begin = (uintptr_t)ptr & ~(page - 1);
+    uintptr_t end = ((uintptr_t)ptr + bytes + page - 1) & ~(page - 1);
+
+    auto hit = find_locked(begin, end);
+    if (hit != ranges_.end()) {
+        Range &range = hit->second;
+        lru_.splice(lru_.begin(), lru_, range.lru);
+        if (owner) {
+            auto same = [&](const std::shared_ptr<void> &o) { return o.get() == owner.get(); };
+            if (std::none_of(range.owners.begin(), range.owners.end(), same)) { range.owners.push_back(std::move(owner)); }
+        }
+        stats_.hits++;
+        return true;
+    }
+
+    // 与新范围重叠的区间合并成一个更大的区间重新注册（同一页不能注册两次），先算出并集、检查预算，这时还不改动任何区间
+    std::vector<std::map<uintptr_t, Range>::iterator> overlaps;
+    size_t overlap_bytes = 0;
+    auto it = ranges_.upper_bound(begin);
+    if (it != ranges_.begin() && std::prev(it)->second.end > begin) { --it; }
+    for (; it != ranges_.end() && it->first < end; ++it) {
+        overlaps.push_back(it);
+        overlap_bytes += it->second.end - it->first;
+    }
+    if (!overlaps.empty()) {
+        begin = std::min(begin, overlaps.front()->first);
+        end = std::max(end, overlaps.back()->second.end);
+    }
+
+    size_t range_bytes = end - begin;
+    if (range_bytes > config_.budget_bytes) {
+        stats_.failures++;
+        return false;
+    }
+    // 只淘汰不重叠的区间，重叠的区间会被并集替换，不占额外的预算；起始地址落在并集内的就是重叠的区间
+    auto victim = lru_.end();
+    while (victim != lru_.begin() && stats_.registered_bytes - overlap_bytes + range_bytes > config_.budget_bytes) {
+        --victim;
+        if (*victim >= begin && *victim < end) { continue; }
+        auto next = std::next(victim);
+        unregister_locked(ranges_.find(*victim));
+        stats_.evictions++;
+        victim = next;
+    }
+
+    // 注销重叠的区间，记录先保留，注册失败时按原样注册回去
+    for (auto &range : overlaps) {
+        if (range->second.last_use) { cudaEventSynchronize(range->second.last_use); }
+        if (cudaHostUnregister((void *)range->first) != cudaSuccess) { cudaGetLastError(); }
+    }
+
+    stats_.misses++;
+    cudaError_t code = cudaHostRegister((void *)begin, range_bytes, config_.flags);
+    if (code != cudaSuccess) {
+        cudaGetLastError();
+        for (auto &range : overlaps) {
+            if (cudaHostRegister((void *)range->first, range->second.end - range->first, config_.flags) != cudaSuccess) {
+                // 恢复不了的区间已经不是锁页的，删掉记录
+                cudaGetLastError();
+                unregister_locked(range);
+            }
+        }
+        // 用户自己注册过的内存已经是锁页的，不归缓存管理
+        if (code == cudaErrorHostMemoryAlreadyRegistered) { return true; }
+        stats_.failures++;
+        return false;
+    }
+
+    std::vector<std::shared_ptr<void>> owners;
+    if (owner) { owners.push_back(std::move(owner)); }
+    for (auto &range : overlaps) {
+        for (auto &o : range->second.owners) { owners.push_back(std::move(o)); }
+        if (range->second.last_use) { cudaEventDestroy(range->second.last_use); }
+        stats_.registered_bytes -= range->second.end - range->first;
+        lru_.erase(range->second.lru);
+        ranges_.erase(range);
+        stats_.merges++;
+    }
+
+    lru_.push_front(begin);
+    Range &range = ranges_[begin];
+    range.end = end;
+    range.lru = lru_.begin();
+    range.owners = std::move(owners);
+    stats_.registered_bytes += range_bytes;
+    return true;
+}
+
+bool HostRegisterCache::acquire(const void *ptr, size_t bytes, std::shared_ptr<void> owner) {
+    std::lock_guard<std::mutex> guard(lock_);
+    return acquire_locked(ptr, bytes, std::move(owner));
+}
+
+bool HostRegisterCache::acquire(const cv::Mat &mat) {
+    std::lock_guard<std::mutex> guard(lock_);
+    return acquire_locked(mat.datastart, mat_bytes(mat), mat_owner(mat));
+}
+
+void HostRegisterCache::forget(const void *ptr, size_t bytes) {
+    if (ptr == nullptr) { return; }
+    uintptr_t begin = (uintptr_t)ptr;
+    uintptr_t end = begin + std::max<size_t>(bytes, 1);
+
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = ranges_.upper_bound(begin);
+    if (it != ranges_.begin() && std::prev(it)->second.end > begin) { --it; }
+    while (it != ranges_.end() && it->first < end) {
+        it = unregister_locked(it);
+    }
+}
+
+void HostRegisterCache::clear() {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = ranges_.begin();
+    while (it != ranges_.end()) {
+        it = unregister_locked(it);
+    }
+}
+
+bool HostRegisterCache::contains(const void *ptr, size_t bytes) const {
+    std::lock_guard<std::mutex> guard(lock_);
+    uintptr_t begin = (uintptr_t)ptr;
+    uintptr_t end = begin + bytes;
+    auto it = ranges_.upper_bound(begin);
+    if (it == ranges_.begin()) { return false; }
+    --it;
+    return end <= it->second.end;
+}
+
+cudaError_t HostRegisterCache::copy_locked(void *dst, const void *src, size_t bytes, cudaMemcpyKind kind,
+                                           cudaStream_t stream, std::shared_ptr<void> owner) {
+    const void *host = kind == cudaMemcpyHostToDevice ? src : kind == cudaMemcpyDeviceToHost ? dst : nullptr;
+    bool pinned = host && acquire_locked(host, bytes, std::move(owner));
+
+    // 持有锁直到记录完事件，其他线程不会在拷贝入队和记录之间把这段内存注销
+    cudaError_t code = cudaMemcpyAsync(dst, src, bytes, kind, stream);
+    if (code != cudaSuccess || !pinned) { return code; }
+
+    uintptr_t begin = (uintptr_t)host;
+    auto it = find_locked(begin, begin + bytes);
+    if (it == ranges_.end()) { return code; } // 用户自己注册过的内存
+    Range &range = it->second;
+    if (range.last_use == nullptr) {
+        code = cudaEventCreateWithFlags(&range.last_use, cudaEventDisableTiming);
+        if (code != cudaSuccess) {
+            range.last_use = nullptr;
+            return code;
+        }
+    }
+    return cudaEventRecord(range.last_use, stream);
+}
+
+cudaError_t HostRegisterCache::memcpy_async(void *dst, const void *src, size_t bytes, cudaMemcpyKind kind,
+                                            cudaStream_t stream) {
+    std::lock_guard<std::mutex> guard(lock_);
+    return copy_locked(dst, src, bytes, kind, stream, nullptr);
+}
+
+cudaError_t HostRegisterCache::memcpy_async(void *dst, const cv::Mat &src, cudaStream_t stream) {
+    if (!src.isContinuous()) { return cudaErrorInvalidValue; }
+    std::lock_guard<std::mutex> guard(lock_);
+    return copy_locked(dst, src.data, src.total() * src.elemSize(), cudaMemcpyHostToDevice, stream, mat_owner(src));
+}
+
+cudaError_t HostRegisterCache::memcpy_async(cv::Mat &dst, const void *src, cudaStream_t stream) {
+    if (!dst.isContinuous()) { return cudaErrorInvalidValue; }
+    std::lock_guard<std::mutex> guard(lock_);
+    return copy_locked(dst.data, src, dst.total() * dst.elemSize(), cudaMemcpyDeviceToHost, stream, mat_owner(dst));
+}
+
+HostRegisterCacheStats HostRegisterCache::stats() const {
+    std::lock_guard<std::mutex> guard(lock_);
+    HostRegisterCacheStats stats = stats_;
+    stats.entries = ranges_.size();
+    return stats;
+}
@@ -0,0 +1,97 @@
+#ifndef HOST_REGISTER_CACHE_H
+#define HOST_REGISTER_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cuda_runtime.h>
+#include <opencv2/opencv.hpp>
+
+/*
+ * 主机内存的注册缓存：
+ * cudaHostRegister 把用户已有的内存（cv::Mat 的 data 等）锁页，之后的 cudaMemcpyAsync 可以直接 DMA、真正异步，
+ * 但注册本身要逐页锁定、建立 IOMMU 映射，一帧 1080p 的图像注册 + 注销比拷贝本身还慢。
+ * 每帧都用同一批缓冲区时，注册一次、之后复用才划算：
+ *   - 按地址范围记录注册过的内存（按页对齐、互不重叠的区间，std::map 以起始地址为 key），落在已注册区间内的请求直接命中；
+ *   - 新的范围与已注册的区间重叠时（同一块内存的不同子范围、malloc 出的相邻小块共用一页），
+ *     注销重叠的区间，注册它们的并集（cudaHostRegister 不允许同一页注册两次）；
+ *   - 注册的总量超过预算时按 LRU 注销最久没用的区间；
+ *   - 内存被释放之后地址可能被重新分配给别的缓冲区，旧的注册就失效了。所以注册期间持有 owner
+ *     （cv::Mat 的重载持有一份 Mat 的引用），内存在注销之前不会被释放；没有 owner 的裸指针在释放前必须调用 forget。
+ *   - 通过 memcpy_async 发起的拷贝会在区间上记录事件，注销之前等待它完成，不会注销正在 DMA 的内存。
+ * 小于 min_bytes 的缓冲区不注册，驱动拷贝可分页内存的开销比注册还小。线程安全。
+ */
+struct HostRegisterCacheConfig {
+    size_t budget_bytes = (size_t)1 << 30;
+    size_t min_bytes = 256 << 10;
+    unsigned int flags = cudaHostRegisterPortable;
+};
+
+struct HostRegisterCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;       // 需要调用 cudaHostRegister 的次数
+    uint64_t merges = 0;       // 因为重叠被合并掉的区间数
+    uint64_t evictions = 0;    // 超出预算被注销的区间数
+    uint64_t failures = 0;     // 注册失败或者超过预算而没有注册的请求（太小的不计入）
+    size_t registered_bytes = 0;
+    size_t entries = 0;
+};
+
+class HostRegisterCache {
+public:
+    explicit HostRegisterCache(const HostRegisterCacheConfig &config = HostRegisterCacheConfig());
+    // 注销所有区间，调用前 CUDA 上下文必须还在
+    ~HostRegisterCache();
+    HostRegisterCache(const HostRegisterCache &) = delete;
+    HostRegisterCache &operator=(const HostRegisterCache &) = delete;
+
+    // 进程内共享的缓存，不析构（进程退出时 CUDA 上下文可能已经销毁）
+    static HostRegisterCache &global();
+
+    /*
+     * 确保 [ptr, ptr + bytes) 已经锁页，返回 false 表示没有注册（太小、超过预算、注册失败），
+     * 此时仍然可以照常拷贝，只是按可分页内存处理。owner 在区间注销之前一直被持有。
+     */
+    bool acquire(const void *ptr, size_t bytes, std::shared_ptr<void> owner = nullptr);
+    // 注册 mat 的整个数据区并持有一份引用，用户释放或者重新 create 之后旧的内存也要等注销之后才释放。
+    // mat 包装的是外部内存（没有引用计数）时不能持有，与裸指针一样需要 forget
+    bool acquire(const cv::Mat &mat);
+
+    // 注销与 [ptr, ptr + bytes) 重叠的所有区间，裸指针的内存释放之前调用
+    void forget(const void *ptr, size_t bytes = 1);
+    void clear();
+    bool contains(const void *ptr, size_t bytes) const;
+
+    // 对主机端的一侧 acquire 之后 cudaMemcpyAsync，并在区间上记录事件。Mat 必须是连续的
+    cudaError_t memcpy_async(void *dst, const void *src, size_t bytes, cudaMemcpyKind kind, cudaStream_t stream);
+    cudaError_t memcpy_async(void *dst, const cv::Mat &src, cudaStream_t stream);
+    cudaError_t memcpy_async(cv::Mat &dst, const void *src, cudaStream_t stream);
+
+    HostRegisterCacheStats stats() const;
+
+private:
+    struct Range {
+        uintptr_t end = 0;
+        std::list<uintptr_t>::iterator lru;
+        std::vector<std::shared_ptr<void>> owners;
+        cudaEvent_t last_use = nullptr; // 最后一次 memcpy_async 之后记录的事件
+    };
+
+    bool acquire_locked(const void *ptr, size_t bytes, std::shared_ptr<void> owner);
+    std::map<uintptr_t, Range>::iterator find_locked(uintptr_t begin, uintptr_t end);
+    std::map<uintptr_t, Range>::iterator unregister_locked(std::map<uintptr_t, Range>::iterator it);
+    cudaError_t copy_locked(void *dst, const void *src, size_t bytes, cudaMemcpyKind kind, cudaStream_t stream,
+                            std::shared_ptr<void> owner);
+
+    HostRegisterCacheConfig config_;
+    mutable std::mutex lock_;
+    std::map<uintptr_t, Range> ranges_; // key 为起始地址
+    std::list<uintptr_t> lru_;          // 表头是最近使用的区间
+    HostRegisterCacheStats stats_;
+};
+
+#endif // HOST_REGISTER_CACHE_H
@@ -0,0 +1,331 @@
+#include "huge-page.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cuda_runtime.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char *huge_page_backing_name(HugePageBacking backing) {
+    switch (backing) {
+    case HugePageBacking::Explicit: return "hugetlb";
+    case HugePageBacking::Transparent: return "thp";
+    default: return "4k";
+    }
+}
+
+size_t huge_page_size() {
+#ifdef __linux__
+    static size_t size = []() -> size_t {
+        FILE *f = fopen("/proc/meminfo", "rb");
+        if (f == nullptr) { return 0; }
+        char line[256];
+        size_t kb = 0;
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "Hugepagesize: %zu kB", &kb) == 1) { break; }
+        }
+        fclose(f);
+        return kb * 1024;
+    }();
+    return size;
+#else
+    return 0;
+#endif
+}
+
+std::string transparent_huge_page_mode() {
+#ifdef __linux__
+    // 格式为 "always [madvise] never"，方括号中的是当前的设置
+    FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "rb");
+    if (f == nullptr) { return ""; }
+    char line[256] = {0};
+    bool ok = fgets(line, sizeof(line), f) != nullptr;
+    fclose(f);
+    const char *begin = ok ? strchr(line, '[') : nullptr;
+    const char *end = begin ? strchr(begin, ']') : nullptr;
+    if (end == nullptr) { return ""; }
+    return std::string(begin + 1, end);
+#else
+    return "";
+#endif
+}
+
+#ifdef __linux__
+static size_t round_up(size_t value, size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+// 多映射一个大页，再把首尾不对齐的部分 munmap 掉，THP 只能用在 2 MB 对齐的地址上
+static void *mmap_aligned(size_t length, size_t align) {
+    size_t padded = length + align;
+    void *mem = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) { return nullptr; }
+    uintptr_t begin = (uintptr_t)mem;
+    uintptr_t aligned = round_up(begin, align);
+    if (aligned > begin) { munmap(mem, aligned - begin); }
+    size_t tail = begin + padded - (aligned + length);
+    if (tail > 0) { munmap((void *)(aligned + length), tail); }
+    return (void *)aligned;
+}
+#endif
+
+void *huge_page_alloc(size_t bytes, HugePageMode mode, HugePageBacking *backing, size_t *mapped_bytes) {
+    if (backing) { *backing = HugePageBacking::Normal; }
+    if (mapped_bytes) { *mapped_bytes = 0; }
+    bytes = std::max<size_t>(bytes, 1);
+
+#ifdef __linux__
+    size_t huge = huge_page_size();
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (huge == 0) { mode = HugePageMode::Off; }
+
+    if (mode == HugePageMode::Explicit || mode == HugePageMode::Auto) {
+        size_t length = round_up(bytes, huge);
+        void *mem = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED) {
+            if (backing) { *backing = HugePageBacking::Explicit; }
+            if (mapped_bytes) { *mapped_bytes = length; }
+            return mem;
+        }
+        if (mode == HugePageMode::Explicit) { return nullptr; }
+    }
+
+    if (mode == HugePageMode::Transparent || mode == HugePageMode::Auto) {
+        size_t length = round_up(bytes, huge);
+        void *mem = mmap_aligned(length, huge);
+        if (mem != nullptr) {
+            // THP 为 never 时 madvise 也会成功，但不会有大页，这里如实返回 Normal
+            bool advised = madvise(mem, length, MADV_HUGEPAGE) == 0 && transparent_huge_page_mode() != "never";
+            if (backing) { *backing = advised ? HugePageBacking::Transparent : HugePageBacking::Normal; }
+            if (mapped_bytes) { *mapped_bytes = length; }
+            return mem;
+        }
+        if (mode == HugePageMode::Transparent) { return nullptr; }
+    }
+
+    size_t length = round_up(bytes, page);
+    void *mem = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) { return nullptr; }
+    // THP 为 always 时普通的映射也可能是大页，Off 明确要求 4 KB 的页（对比测试时作为基准）
+    if (mode == HugePageMode::Off) { madvise(mem, length, MADV_NOHUGEPAGE); }
+    if (mapped_bytes) { *mapped_bytes = length; }
+    return mem;
+#else
+    if (mode == HugePageMode::Explicit || mode == HugePageMode::Transparent) { return nullptr; }
+    void *mem = calloc(1, bytes);
+    if (mem != nullptr && mapped_bytes) { *mapped_bytes = bytes; }
+    return mem;
+#endif
+}
+
+void huge_page_free(void *ptr, size_t mapped_bytes) {
+    if (ptr == nullptr) { return; }
+#ifdef __linux__
+    munmap(ptr, mapped_bytes);
+#else
+    free(ptr);
+#endif
+}
+
+size_t transparent_huge_page_bytes(const void *ptr, size_t bytes) {
+#ifdef __linux__
+    // smaps 中每个映射以 "起始-结束 权限 ..." 开头，后面是 "Key: value" 形式的统计，累加与 [ptr, ptr + bytes) 重叠的映射
+    FILE *f = fopen("/proc/self/smaps", "rb");
+    if (f == nullptr) { return 0; }
+    uintptr_t begin = (uintptr_t)ptr, end = begin + bytes;
+    bool overlap = false;
+    size_t total = 0, kb = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long lo = 0, hi = 0;
+        if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2) {
+            overlap = lo < end && hi > begin;
+        } else if (overlap && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) {
+            total += kb * 1024;
+        }
+    }
+    fclose(f);
+    return total;
+#else
+    return 0;
+#endif
+}
+
+/* ------------------------------------------ HostArena ------------------------------------------ */
+
+HostArena::HostArena(size_t block_bytes, HugePageMode mode, bool pinned)
+    : block_bytes_(std::max<size_t>(block_bytes, 1)), mode_(mode), pinned_(pinned) {
+}
+
+HostArena::~HostArena() {
+    for (auto &block : blocks_) {
+        if (pinned_) { cudaHostUnregister(block.base); }
+        huge_page_free(block.base, block.bytes);
+    }
+}
+
+void *HostArena::allocate(size_t bytes, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) { return nullptr; }
+
+    // 从当前块开始找放得下的块，reset 之后前面的块会被重新使用
+    for (; current_ < blocks_.size(); ++current_) {
+        Block &block = blocks_[current_];
+        size_t offset = (block.used + alignment - 1) & ~(alignment - 1);
+        if (offset + bytes <= block.bytes) {
+            block.used = offset + bytes;
+            return block.base + offset;
+        }
+    }
+
+    // mmap 的地址至少按页对齐，alignment 不超过页大小时块的开头就是对齐的
+    Block block;
+    size_t mapped = 0;
+    block.base = (uint8_t *)huge_page_alloc(std::max(block_bytes_, bytes + alignment), mode_, &block.backing, &mapped);
+    if (block.base == nullptr) { return nullptr; }
+    block.bytes = mapped;
+    if (pinned_ && cudaHostRegister(block.base, block.bytes, cudaHostRegisterPortable) != cudaSuccess) {
+        cudaGetLastError();
+        huge_page_free(block.base, block.bytes);
+        return nullptr;
+    }
+    blocks_.push_back(block);
+    current_ = blocks_.size() - 1;
+    return allocate(bytes, alignment);
+}
+
+void HostArena::reset() {
+    for (auto &block : blocks_) { block.used = 0; }
+    current_ = 0;
+}
+
+size_t HostArena::capacity() const {
+    size_t total = 0;
+    for (auto &block : blocks_) { total += block.bytes; }
+    return total;
+}
+
+size_t HostArena::used() const {
+    size_t total = 0;
+    for (auto &block : blocks_) { total += block.used; }
+    return total;
+}
+
+HugePageBacking HostArena::backing() const {
+    if (blocks_.empty()) { return HugePageBacking::Normal; }
+    HugePageBacking worst = HugePageBacking::Explicit;
+    for (auto &block : blocks_) { worst = std::min(worst, block.backing); }
+    return worst;
+}
+
+/* ------------------------------------------ MappedFile ------------------------------------------ */
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        mapped_bytes_ = other.mapped_bytes_;
+        backing_ = other.backing_;
+        file_mapping_ = other.file_mapping_;
+        other.data_ = nullptr;
+        other.size_ = other.mapped_bytes_ = 0;
+        other.backing_ = HugePageBacking::Normal;
+        other.file_mapping_ = false;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &file, HugePageMode mode) {
+    close();
+#ifdef __linux__
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return false; }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    if (mode != HugePageMode::Off && huge_page_size() > 0 && size >= huge_page_size()) {
+        data_ = (uint8_t *)huge_page_alloc(size, mode, &backing_, &mapped_bytes_);
+        size_t offset = 0;
+        while (data_ != nullptr && offset < size) {
+            ssize_t n = pread(fd, data_ + offset, size - offset, (off_t)offset);
+            if (n <= 0) {
+                huge_page_free(data_, mapped_bytes_);
+                data_ = nullptr;
+                mapped_bytes_ = 0;
+                backing_ = HugePageBacking::Normal;
+            } else {
+                offset += (size_t)n;
+            }
+        }
+    }
+
+    if (data_ == nullptr) {
+        void *mem = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mem == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        madvise(mem, size, MADV_WILLNEED);
+        data_ = (uint8_t *)mem;
+        mapped_bytes_ = size;
+        file_mapping_ = true;
+    }
+    ::close(fd);
+    size_ = size;
+    return true;
+#else
+    FILE *f = fopen(file.c_str(), "rb");
+    if (f == nullptr) { return false; }
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (length > 0) {
+        data_ = (uint8_t *)malloc(length);
+        if (data_ == nullptr || fread(data_, 1, length, f) != (size_t)length) {
+            free(data_);
+            data_ = nullptr;
+            fclose(f);
+            return false;
+        }
+        size_ = mapped_bytes_ = (size_t)length;
+    }
+    fclose(f);
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+    if (data_ != nullptr) {
+#ifdef __linux__
+        munmap(data_, mapped_bytes_);
+#else
+        free(data_);
+#endif
+    }
+    data_ = nullptr;
+    size_ = mapped_bytes_ = 0;
+    backing_ = HugePageBacking::Normal;
+    file_mapping_ = false;
+}
@@ -0,0 +1,124 @@
+#ifndef HUGE_PAGE_H
+#define HUGE_PAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * 大页内存。predict.data、标定的 batch、模型权重这类几十到几百 MB 的主机缓冲区按 4 KB 分页时，
+ * 解码和权重转换的循环会频繁 TLB miss（128 MB 需要 32768 个页表项，L2 TLB 通常只有一两千项），
+ * 改用 2 MB 的大页后页表项减少到 64 个。Linux 上有两种大页：
+ *   - Explicit：mmap(MAP_HUGETLB)，从 hugetlbfs 的预留池中分配（vm.nr_hugepages），预留不足时失败；
+ *   - Transparent：普通的 mmap 之后 madvise(MADV_HUGEPAGE)，由内核尽量用大页（THP 为 madvise 或 always 时生效），
+ *     内存碎片多时仍然可能是 4 KB 的页，不会失败。
+ * Auto 依次尝试 Explicit、Transparent，最后退化为普通页；Off 只用普通页；其他系统上只有普通页。
+ */
+enum class HugePageMode : int {
+    Off = 0,
+    Transparent = 1,
+    Explicit = 2,
+    Auto = 3
+};
+
+// 实际得到的页，Transparent 只表示已经 madvise，是否真的是大页由内核决定
+enum class HugePageBacking : int {
+    Normal = 0,
+    Transparent = 1,
+    Explicit = 2
+};
+
+const char *huge_page_backing_name(HugePageBacking backing);
+
+// 大页的大小（/proc/meminfo 中的 Hugepagesize），不支持时返回 0
+size_t huge_page_size();
+// /sys/kernel/mm/transparent_hugepage/enabled 中选中的一项：always、madvise、never，不支持时为空
+std::string transparent_huge_page_mode();
+
+/*
+ * 按页分配 bytes 字节（长度向上取整到大页），内容为 0。
+ * mapped_bytes 返回实际映射的长度，释放时原样传给 huge_page_free。失败时返回 nullptr。
+ */
+void *huge_page_alloc(size_t bytes, HugePageMode mode, HugePageBacking *backing = nullptr, size_t *mapped_bytes = nullptr);
+void huge_page_free(void *ptr, size_t mapped_bytes);
+
+// 映射的地址范围中有多少字节是透明大页（/proc/self/smaps 中的 AnonHugePages），用于确认 THP 是否生效
+size_t transparent_huge_page_bytes(const void *ptr, size_t bytes);
+
+/*
+ * 主机端的内存池：向系统申请 block_bytes 大小的大页块，allocate 在块内顺序分配，reset 之后重新使用，
+ * 块只在析构时释放。适合每个 batch 都要分配的临时张量（解码的中间结果、标定的输入）。
+ * pinned 为 true 时每个块都用 cudaHostRegister 锁页，可以直接用于 cudaMemcpyAsync。
+ * 不是线程安全的，每个线程（或每个流水线阶段）使用自己的 HostArena。
+ */
+class HostArena {
+public:
+    explicit HostArena(size_t block_bytes = 64 << 20, HugePageMode mode = HugePageMode::Auto, bool pinned = false);
+    ~HostArena();
+    HostArena(const HostArena &) = delete;
+    HostArena &operator=(const HostArena &) = delete;
+
+    // alignment 必须是 2 的幂，失败时返回 nullptr
+    void *allocate(size_t bytes, size_t alignment = 256);
+    template <typename T>
+    T *allocate_array(size_t count) {
+        return (T *)allocate(count * sizeof(T), alignof(T) > 256 ? alignof(T) : 256);
+    }
+    void reset();
+
+    size_t capacity() const;
+    size_t used() const;
+    // 所有块中最差的一种，没有块时为 Normal
+    HugePageBacking backing() const;
+
+private:
+    struct Block {
+        uint8_t *base = nullptr;
+        size_t bytes = 0;
+        size_t used = 0;
+        HugePageBacking backing = HugePageBacking::Normal;
+    };
+
+    size_t block_bytes_;
+    HugePageMode mode_;
+    bool pinned_;
+    std::vector<Block> blocks_;
+    size_t current_ = 0;
+};
+
+/*
+ * 只读地加载整个文件，代替 load_file 返回的 std::vector<uint8_t>。
+ *   - mode 为 Off 或者文件小于一个大页：直接 mmap 文件（MAP_PRIVATE，按需读入，不拷贝）；
+ *   - 否则读入大页内存中。文件映射的页不能 madvise 成大页（只有 tmpfs 和开启了 READ_ONLY_THP_FOR_FS 的内核支持），
+ *     对于反复遍历的权重、数据，多一次拷贝换来后面的 TLB 命中是值得的。
+ * 非 Linux 系统上读入普通内存。
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &file, HugePageMode mode = HugePageMode::Auto);
+    void close();
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    HugePageBacking backing() const { return backing_; }
+    // true 表示直接映射的文件，false 表示读入的内存
+    bool is_file_mapping() const { return file_mapping_; }
+
+private:
+    uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+    size_t mapped_bytes_ = 0;
+    HugePageBacking backing_ = HugePageBacking::Normal;
+    bool file_mapping_ = false;
+};
+
+#endif // HUGE_PAGE_H
@@ -0,0 +1,96 @@
+#include "cuda-runtime-api.h"
+
+void conv2d_naive(const float *input, const float *weight, const float *bias, float *output, const ConvParams &p) {
+    int group_in = p.in_channels / p.groups;
+    int group_out = p.out_channels / p.groups;
+    for (int n = 0; n < p.batch; ++n) {
+        for (int oc = 0; oc < p.out_channels; ++oc) {
+            int group = oc / group_out;
+            for (int oh = 0; oh < p.out_h(); ++oh) {
+                for (int ow = 0; ow < p.out_w(); ++ow) {
+                    float sum = bias ? bias[oc] : 0.0f;
+                    for (int ic = 0; ic < group_in; ++ic) {
+                        for (int kh = 0; kh < p.kernel_h; ++kh) {
+                            for (int kw = 0; kw < p.kernel_w; ++kw) {
+                                int ih = oh * p.stride_h - p.pad_h + kh * p.dilation_h;
+                                int iw = ow * p.stride_w - p.pad_w + kw * p.dilation_w;
+                                if (ih < 0 || ih >= p.in_h || iw < 0 || iw >= p.in_w) { continue; }
+                                float w = weight[((oc * group_in + ic) * p.kernel_h + kh) * p.kernel_w + kw];
+                                sum += w * input[p.input_index(n, group * group_in + ic, ih, iw)];
+                            }
+                        }
+                    }
+                    output[p.output_index(n, oc, oh, ow)] = sum;
+                }
+            }
+        }
+    }
+}
+
+// 缓存块的大小：B 块为 CONV_BLOCK_K x CONV_BLOCK_N 个 float（32 KB），累加块为 M x CONV_BLOCK_N
+#define CONV_BLOCK_N 64
+#define CONV_BLOCK_K 128
+
+void conv2d_cpu(const float *input, const float *weight, const float *bias, float *output, const ConvParams &p, int num_threads) {
+    const int M = p.gemm_m(), K = p.gemm_k(), N = p.gemm_n();
+    const int kernel_area = p.kernel_h * p.kernel_w;
+    const int group_in = p.in_channels / p.groups;
+    const int column_blocks = (N + CONV_BLOCK_N - 1) / CONV_BLOCK_N;
+    const int num_tasks = p.groups * column_blocks;
+
+    // 每个任务是一个分组里的 CONV_BLOCK_N 列，打包缓冲区按调用分配，一次调用处理 grain 个任务
+    parallel_for(0, num_tasks, [&](int64_t first, int64_t last) {
+        std::vector<float> packed(CONV_BLOCK_K * CONV_BLOCK_N);
+        std::vector<float> acc(M * CONV_BLOCK_N);
+        ConvColumn columns[CONV_BLOCK_N];
+        for (int task = (int)first; task < (int)last; ++task) {
+            int group = task / column_blocks;
+            int col_begin = (task % column_blocks) * CONV_BLOCK_N;
+            int cols = std::min(CONV_BLOCK_N, N - col_begin);
+            for (int j = 0; j < cols; ++j) { columns[j] = conv_column(p, col_begin + j); }
+            const float *group_weight = weight + (size_t)group * M * K;
+            std::fill(acc.begin(), acc.end(), 0.0f);
+
+            for (int k_begin = 0; k_begin < K; k_begin += CONV_BLOCK_K) {
+                int ks = std::min(CONV_BLOCK_K, K - k_begin);
+
+                // 展开当前块的 im2col，取值与 conv_im2col_value 相同，只是把每一行的 (c, kh, kw) 提到列循环之外
+                for (int kk = 0; kk < ks; ++kk) {
+                    int k = k_begin + kk;
+                    int c = group * group_in + k / kernel_area;
+                    int kh = (k % kernel_area) / p.kernel_w;
+                    int kw = k % p.kernel_w;
+                    float *prow = packed.data() + kk * CONV_BLOCK_N;
+                    for (int j = 0; j < cols; ++j) {
+                        int ih = columns[j].ih0 + kh * p.dilation_h;
+                        int iw = columns[j].iw0 + kw * p.dilation_w;
+                        prow[j] = ih < 0 || ih >= p.in_h || iw < 0 || iw >= p.in_w ? 0.0f : input[p.input_index(columns[j].n, c, ih, iw)];
+                    }
+                    for (int j = cols; j < CONV_BLOCK_N; ++j) { prow[j] = 0.0f; }
+                }
+
+                // acc[m][:] += W[m][k] * packed[k][:]，最内层连续且长度固定，编译器可以向量化
+                for (int m = 0; m < M; ++m) {
+                    float *pacc = acc.data() + m * CONV_BLOCK_N;
+                    const float *pweight = group_weight + (size_t)m * K + k_begin;
+                    for (int kk = 0; kk < ks; ++kk) {
+                        float a = pweight[kk];
+                        const float *prow = packed.data() + kk * CONV_BLOCK_N;
+                        for (int j = 0; j < CONV_BLOCK_N; ++j) { pacc[j] += a * prow[j]; }
+                    }
+                }
+            }
+
+            for (int m = 0; m < M; ++m) {
+                int oc = group * M + m;
+                float b = bias ? bias[oc] : 0.0f;
+                for (int j = 0; j < cols; ++j) {
+                    int col = col_begin + j;
+                    int ow = col % p.out_w();
+                    int oh = (col / p.out_w()) % p.out_h();
+                    output[p.output_index(columns[j].n, oc, oh, ow)] = acc[m * CONV_BLOCK_N + j] + b;
+                }
+            }
+        }
+    }, 1, num_threads);
+}
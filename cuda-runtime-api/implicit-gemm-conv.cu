@@ -0,0 +1,57 @@
+#include "cuda-runtime-api.h"
+
+/*
+ * 与 gemm_kernel_1 相同的共享内存分块，每个线程块计算 C 的一个 BLOCK_SIZE x BLOCK_SIZE 的 tile，blockIdx.z 为分组。
+ * A 的 tile 直接读权重；B 的 tile 不读 im2col 矩阵，而是由 conv_im2col_value 按下标从输入中取值，
+ * 每个线程负责的列固定不变，列对应的输出位置只在开始时算一次。
+ */
+template <int BLOCK_SIZE>
+__global__ void conv_implicit_gemm_kernel(const float *input, const float *weight, const float *bias, float *output, ConvParams p) {
+    __shared__ float shardM[BLOCK_SIZE][BLOCK_SIZE];
+    __shared__ float shardN[BLOCK_SIZE][BLOCK_SIZE];
+
+    int M = p.gemm_m(), K = p.gemm_k(), N = p.gemm_n();
+    int group = blockIdx.z;
+    int tx = threadIdx.x;
+    int ty = threadIdx.y;
+    int row = blockIdx.y * BLOCK_SIZE + ty;
+    int col = blockIdx.x * BLOCK_SIZE + tx;
+    const float *group_weight = weight + (size_t)group * M * K;
+    ConvColumn column = conv_column(p, col < N ? col : 0);
+    float v = 0.0;
+
+    for (int i = 0; i < (K + BLOCK_SIZE - 1) / BLOCK_SIZE; i++) {
+        // 加载权重的子矩阵到共享内存
+        if (i * BLOCK_SIZE + tx < K && row < M) {
+            shardM[ty][tx] = group_weight[row * K + i * BLOCK_SIZE + tx];
+        } else {
+            shardM[ty][tx] = 0.0;
+        }
+        // 加载 im2col 的子矩阵到共享内存，im2col 融合在这一步
+        if (i * BLOCK_SIZE + ty < K && col < N) {
+            shardN[ty][tx] = conv_im2col_value(input, p, group, i * BLOCK_SIZE + ty, column);
+        } else {
+            shardN[ty][tx] = 0.0;
+        }
+        __syncthreads();
+
+        for (int j = 0; j < BLOCK_SIZE; j++) {
+            v += shardM[ty][j] * shardN[j][tx];
+        }
+        __syncthreads();
+    }
+
+    if (row < M && col < N) {
+        int oc = group * M + row;
+        int ow = col % p.out_w();
+        int oh = (col / p.out_w()) % p.out_h();
+        output[p.output_index(column.n, oc, oh, ow)] = v + (bias ? bias[oc] : 0.0f);
+    }
+}
+
+void conv2d_implicit_gemm(const float *input, const float *weight, const float *bias, float *output,
+                          const ConvParams &params, cudaStream_t stream) {
+    dim3 block(16, 16, 1);
+    dim3 grid((params.gemm_n() + block.x - 1) / block.x, (params.gemm_m() + block.y - 1) / block.y, params.groups);
+    conv_implicit_gemm_kernel<16><<<grid, block, 0, stream>>>(input, weight, bias, output, params);
+}
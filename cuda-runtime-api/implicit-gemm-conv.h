@@ -0,0 +1,96 @@
+#ifndef IMPLICIT_GEMM_CONV_H
+#define IMPLICIT_GEMM_CONV_H
+
+#include <stddef.h>
+#include <cuda_runtime.h>
+
+/*
+ * 隐式 GEMM 卷积：把卷积看成每个分组一次矩阵乘
+ *   C[M, N] = W[M, K] x B[K, N]
+ *   M = out_channels / groups，K = in_channels / groups * kernel_h * kernel_w，N = batch * out_h * out_w
+ * B 就是 im2col 展开后的输入，但不单独生成：GPU 版本在往共享内存加载 B 的 tile 时直接按下标计算输入地址（越界补 0），
+ * CPU 版本只展开当前缓存块内的列。权重为 ONNX 的 [out_channels, in_channels / groups, kernel_h, kernel_w]，
+ * 输入输出的布局由 layout 指定，输出与输入布局相同。
+ */
+#ifdef __CUDACC__
+#define CONV_HOST_DEVICE __host__ __device__
+#else
+#define CONV_HOST_DEVICE
+#endif
+
+enum class TensorLayout : int {
+    NCHW = 0,
+    NHWC = 1,
+};
+
+struct ConvParams {
+    int batch = 1;
+    int in_channels = 0, in_h = 0, in_w = 0;
+    int out_channels = 0;
+    int kernel_h = 1, kernel_w = 1;
+    int stride_h = 1, stride_w = 1;
+    int pad_h = 0, pad_w = 0;
+    int dilation_h = 1, dilation_w = 1;
+    int groups = 1;
+    TensorLayout layout = TensorLayout::NCHW;
+
+    CONV_HOST_DEVICE int out_h() const { return (in_h + 2 * pad_h - dilation_h * (kernel_h - 1) - 1) / stride_h + 1; }
+    CONV_HOST_DEVICE int out_w() const { return (in_w + 2 * pad_w - dilation_w * (kernel_w - 1) - 1) / stride_w + 1; }
+
+    // 隐式 GEMM 的三个维度（单个分组）
+    CONV_HOST_DEVICE int gemm_m() const { return out_channels / groups; }
+    CONV_HOST_DEVICE int gemm_k() const { return in_channels / groups * kernel_h * kernel_w; }
+    CONV_HOST_DEVICE int gemm_n() const { return batch * out_h() * out_w(); }
+
+    CONV_HOST_DEVICE size_t input_index(int n, int c, int h, int w) const {
+        return layout == TensorLayout::NCHW ? (((size_t)n * in_channels + c) * in_h + h) * in_w + w
+                                            : (((size_t)n * in_h + h) * in_w + w) * in_channels + c;
+    }
+
+    CONV_HOST_DEVICE size_t output_index(int n, int c, int h, int w) const {
+        return layout == TensorLayout::NCHW ? (((size_t)n * out_channels + c) * out_h() + h) * out_w() + w
+                                            : (((size_t)n * out_h() + h) * out_w() + w) * out_channels + c;
+    }
+
+    size_t input_size() const { return (size_t)batch * in_channels * in_h * in_w; }
+    size_t output_size() const { return (size_t)batch * out_channels * out_h() * out_w(); }
+    size_t weight_size() const { return (size_t)out_channels * (in_channels / groups) * kernel_h * kernel_w; }
+};
+
+// im2col 矩阵的一列对应一个输出位置，列内所有行共用的部分只算一次
+struct ConvColumn {
+    int n;        // batch 下标
+    int ih0, iw0; // 卷积窗口左上角在输入中的位置，可能为负
+};
+
+inline CONV_HOST_DEVICE ConvColumn conv_column(const ConvParams &p, int col) {
+    int ow = col % p.out_w();
+    int oh = (col / p.out_w()) % p.out_h();
+    return {col / (p.out_w() * p.out_h()), oh * p.stride_h - p.pad_h, ow * p.stride_w - p.pad_w};
+}
+
+/*
+ * im2col 矩阵 B 在分组 group 内第 k 行、column 列的值，也就是 GPU 加载 tile、CPU 打包缓存块时读取的输入。
+ * 可变形卷积等变体只需要替换这里的取值方式（例如按偏移双线性采样）。
+ */
+inline CONV_HOST_DEVICE float conv_im2col_value(const float *input, const ConvParams &p, int group, int k, ConvColumn column) {
+    int kw = k % p.kernel_w;
+    int kh = (k / p.kernel_w) % p.kernel_h;
+    int c = group * (p.in_channels / p.groups) + k / (p.kernel_w * p.kernel_h);
+    int ih = column.ih0 + kh * p.dilation_h;
+    int iw = column.iw0 + kw * p.dilation_w;
+    if (ih < 0 || ih >= p.in_h || iw < 0 || iw >= p.in_w) { return 0.0f; }
+    return input[p.input_index(column.n, c, ih, iw)];
+}
+
+// 逐元素的直接卷积，只用来验证
+void conv2d_naive(const float *input, const float *weight, const float *bias, float *output, const ConvParams &params);
+
+// CPU 版本：按列分块展开 im2col，块内做缓存友好的 GEMM，多个分组、列块由多个线程处理。bias 可以为 nullptr
+void conv2d_cpu(const float *input, const float *weight, const float *bias, float *output, const ConvParams &params, int num_threads = 0);
+
+// GPU 版本：所有指针都在设备端，bias 可以为 nullptr
+void conv2d_implicit_gemm(const float *input, const float *weight, const float *bias, float *output,
+                          const ConvParams &params, cudaStream_t stream);
+
+#endif // IMPLICIT_GEMM_CONV_H
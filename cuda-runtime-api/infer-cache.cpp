@@ -0,0 +1,244 @@
+#include "infer-cache.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define INFER_CACHE_USE_SSE2 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace {
+const uint64_t PRIME32_1 = 0x9E3779B1ULL;
+const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+
+const int STRIPE_BYTES = 64;       // 每个 stripe 64 字节，对应 8 个 64 位累加器
+const int STRIPES_PER_BLOCK = 16;  // 每 16 个 stripe 做一次 scramble，避免累加器中的高位信息丢失
+
+// 每个累加器对应的 key，取自 xxHash 系列的常量
+const uint64_t BASE_KEYS[8] = {
+    0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+    0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL};
+
+inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 64x64 -> 128 位乘法后将高低 64 位异或折叠
+inline uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t high = 0;
+    uint64_t low = _umul128(a, b, &high);
+    return low ^ high;
+#else
+    uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+    uint64_t b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo;
+    uint64_t hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi;
+    uint64_t hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    uint64_t high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    uint64_t low = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    return low ^ high;
+#endif
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/*
+ * 累加一个 stripe：
+ * acc[i] += data[i ^ 1] + lo32(data[i] ^ key[i]) * hi32(data[i] ^ key[i])
+ * 8 个累加器之间没有依赖，SIMD 下每条 128 位指令处理两个累加器。
+ */
+inline void accumulate_stripe(uint64_t *acc, const uint8_t *p, const uint64_t *keys) {
+#ifdef INFER_CACHE_USE_SSE2
+    __m128i *xacc = (__m128i *)acc;
+    for (int i = 0; i < 4; ++i) {
+        __m128i data = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        __m128i key = _mm_loadu_si128((const __m128i *)(keys + 2 * i));
+        __m128i data_key = _mm_xor_si128(data, key);
+        // _mm_mul_epu32 取每个 64 位通道的低 32 位相乘，shuffle 把高 32 位移到低位
+        __m128i product = _mm_mul_epu32(data_key, _mm_shuffle_epi32(data_key, _MM_SHUFFLE(3, 3, 1, 1)));
+        // 交换两个 64 位通道，对应标量实现中的 data[i ^ 1]
+        __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        __m128i a = _mm_loadu_si128(xacc + i);
+        a = _mm_add_epi64(a, _mm_add_epi64(product, swapped));
+        _mm_storeu_si128(xacc + i, a);
+    }
+#else
+    for (int i = 0; i < 8; ++i) {
+        uint64_t data = read64(p + 8 * i);
+        uint64_t data_key = data ^ keys[i];
+        acc[i ^ 1] += data;
+        acc[i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+    }
+#endif
+}
+
+inline void scramble(uint64_t *acc, const uint64_t *keys) {
+#ifdef INFER_CACHE_USE_SSE2
+    __m128i *xacc = (__m128i *)acc;
+    const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+    for (int i = 0; i < 4; ++i) {
+        __m128i a = _mm_loadu_si128(xacc + i);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i *)(keys + 2 * i)));
+        // 64 位乘以 32 位常量：lo * p + (hi * p) << 32
+        __m128i product_lo = _mm_mul_epu32(a, prime);
+        __m128i product_hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+        a = _mm_add_epi64(product_lo, _mm_slli_epi64(product_hi, 32));
+        _mm_storeu_si128(xacc + i, a);
+    }
+#else
+    for (int i = 0; i < 8; ++i) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= keys[i];
+        acc[i] = a * PRIME32_1;
+    }
+#endif
+}
+} // namespace
+
+Hash128 hash_bytes_128(const void *data, size_t length, uint64_t seed) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+
+    uint64_t keys[8];
+    for (int i = 0; i < 8; ++i) {
+        // 奇偶 key 分别加减 seed，使不同 seed 之间结果独立
+        keys[i] = (i & 1) ? BASE_KEYS[i] - seed : BASE_KEYS[i] + seed;
+    }
+
+    uint64_t acc[8] = {PRIME32_1, PRIME64_1, PRIME64_2, PRIME64_3,
+                       PRIME64_1 ^ PRIME64_2, PRIME64_2 ^ PRIME64_3, PRIME64_3 ^ PRIME32_1, PRIME64_1 + PRIME32_1};
+
+    size_t num_stripes = length / STRIPE_BYTES;
+    for (size_t i = 0; i < num_stripes; ++i) {
+        accumulate_stripe(acc, p + i * STRIPE_BYTES, keys);
+        if ((i + 1) % STRIPES_PER_BLOCK == 0) { scramble(acc, keys); }
+    }
+
+    // 尾部不足 64 字节的部分补零后再累加一次，长度信息在 finalize 时混入，所以补零不会引起冲突
+    size_t tail = length - num_stripes * STRIPE_BYTES;
+    if (tail > 0) {
+        uint8_t last_stripe[STRIPE_BYTES] = {0};
+        memcpy(last_stripe, p + num_stripes * STRIPE_BYTES, tail);
+        accumulate_stripe(acc, last_stripe, keys);
+    }
+
+    Hash128 result;
+    uint64_t low = length * PRIME64_1 ^ seed;
+    uint64_t high = ~length * PRIME64_2 ^ seed;
+    for (int i = 0; i < 4; ++i) {
+        low += mul128_fold64(acc[2 * i] ^ keys[2 * i], acc[2 * i + 1] ^ keys[2 * i + 1]);
+        high += mul128_fold64(acc[2 * i] ^ keys[(2 * i + 3) & 7], acc[2 * i + 1] ^ keys[(2 * i + 6) & 7]);
+    }
+    result.low = avalanche(low);
+    result.high = avalanche(high ^ result.low);
+    return result;
+}
+
+InferResultCache::InferResultCache(size_t max_memory_bytes, int num_shards) {
+    if (num_shards < 1) { num_shards = 1; }
+    shard_capacity_bytes_ = max_memory_bytes / num_shards;
+    for (int i = 0; i < num_shards; ++i) {
+        shards_.emplace_back(new Shard());
+    }
+}
+
+InferResultCache::Shard &InferResultCache::shard_of(const InferCacheKey &key) {
+    // 用 high 部分选择 shard，与 shard 内部哈希表使用的 low 部分错开，避免桶分布不均
+    uint64_t h = key.input_hash.high ^ (key.model_id * PRIME64_2);
+    return *shards_[h % shards_.size()];
+}
+
+size_t InferResultCache::entry_bytes(const std::vector<Box> &boxes) {
+    // 条目本身 + 链表节点的前后指针 + 哈希表节点（key、迭代器、next 指针、桶指针）+ Box 数据
+    return sizeof(Entry) + 2 * sizeof(void *)
+           + sizeof(InferCacheKey) + sizeof(std::list<Entry>::iterator) + 2 * sizeof(void *)
+           + boxes.size() * sizeof(Box);
+}
+
+bool InferResultCache::get(const InferCacheKey &key, std::vector<Box> &boxes) {
+    Shard &shard = shard_of(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        shard.misses++;
+        return false;
+    }
+
+    // splice 只修改链表指针，把命中的条目移到表头，迭代器保持有效
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    boxes = it->second->boxes;
+    shard.hits++;
+    return true;
+}
+
+void InferResultCache::put(const InferCacheKey &key, const std::vector<Box> &boxes) {
+    size_t bytes = entry_bytes(boxes);
+    // 单个条目就超出 shard 容量的结果不缓存
+    if (bytes > shard_capacity_bytes_) { return; }
+
+    Shard &shard = shard_of(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.memory_bytes -= it->second->bytes;
+        it->second->boxes = boxes;
+        it->second->bytes = bytes;
+        shard.memory_bytes += bytes;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    } else {
+        shard.lru.push_front(Entry{key, boxes, bytes});
+        shard.index[key] = shard.lru.begin();
+        shard.memory_bytes += bytes;
+    }
+
+    // 超出容量时从表尾淘汰最久未使用的条目
+    while (shard.memory_bytes > shard_capacity_bytes_ && !shard.lru.empty()) {
+        Entry &victim = shard.lru.back();
+        shard.memory_bytes -= victim.bytes;
+        shard.index.erase(victim.key);
+        shard.lru.pop_back();
+        shard.evictions++;
+    }
+}
+
+void InferResultCache::clear() {
+    for (auto &shard : shards_) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        shard->lru.clear();
+        shard->index.clear();
+        shard->memory_bytes = 0;
+    }
+}
+
+InferCacheStats InferResultCache::stats() const {
+    InferCacheStats result;
+    for (auto &shard : shards_) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        result.hits += shard->hits;
+        result.misses += shard->misses;
+        result.evictions += shard->evictions;
+        result.entries += shard->lru.size();
+        result.memory_bytes += shard->memory_bytes;
+    }
+    return result;
+}
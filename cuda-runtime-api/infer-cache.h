@@ -0,0 +1,142 @@
+#ifndef INFER_CACHE_H
+#define INFER_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "utils.h"
+
+/*
+ * 推理结果缓存：
+ * 静态摄像头、重试请求等场景下会出现字节完全相同的输入帧，每一帧都走一遍 warpaffine -> enqueue -> decode 非常浪费。
+ * 这里在推理之前对输入做一次快速哈希，以 (模型, 哈希, 阈值) 作为 key 查询缓存，命中则直接返回 decode 之后的 Box，不再占用 GPU。
+ */
+
+// 128 位哈希结果，low 部分可以单独作为 64 位哈希使用
+struct Hash128 {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const Hash128 &other) const {
+        return low == other.low && high == other.high;
+    }
+};
+
+/*
+ * 按 64 字节的 stripe 处理数据，8 个 64 位累加器相互独立，
+ * 支持 SSE2 时一次处理两个累加器（_mm_mul_epu32 做 32x32->64 的乘法），否则走标量实现，两者结果完全一致。
+ */
+Hash128 hash_bytes_128(const void *data, size_t length, uint64_t seed = 0);
+
+inline uint64_t hash_bytes_64(const void *data, size_t length, uint64_t seed = 0) {
+    return hash_bytes_128(data, length, seed).low;
+}
+
+// 缓存 key：模型标识 + 输入内容哈希 + 后处理阈值，阈值不同时 decode 的结果不同，不能共用
+struct InferCacheKey {
+    uint64_t model_id = 0;
+    Hash128 input_hash;
+    float confidence_threshold = 0;
+    float nms_threshold = 0;
+
+    bool operator==(const InferCacheKey &other) const {
+        return model_id == other.model_id && input_hash == other.input_hash
+               && confidence_threshold == other.confidence_threshold && nms_threshold == other.nms_threshold;
+    }
+};
+
+struct InferCacheKeyHasher {
+    size_t operator()(const InferCacheKey &key) const {
+        // input_hash 本身已经是充分混合过的值，这里只需要把其余字段揉进去
+        uint64_t h = key.input_hash.low ^ (key.model_id * 0x9E3779B185EBCA87ULL);
+        uint32_t conf_bits, nms_bits;
+        memcpy(&conf_bits, &key.confidence_threshold, sizeof(conf_bits));
+        memcpy(&nms_bits, &key.nms_threshold, sizeof(nms_bits));
+        h ^= ((uint64_t)conf_bits << 32 | nms_bits) * 0xC2B2AE3D27D4EB4FULL;
+        return (size_t)(h ^ (h >> 29));
+    }
+};
+
+struct InferCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t memory_bytes = 0; // 缓存条目 + Box 数据估算出的内存占用
+
+    double hit_rate() const {
+        uint64_t total = hits + misses;
+        return total == 0 ? 0.0 : (double)hits / total;
+    }
+};
+
+/*
+ * 分片的并发 LRU 缓存：
+ * key 的哈希决定落在哪个 shard，每个 shard 有自己的锁、链表和哈希表，不同 shard 之间互不阻塞。
+ * 每个 shard 的容量上限为 max_memory_bytes / num_shards，超出后淘汰最久未使用的条目。
+ */
+class InferResultCache {
+public:
+    InferResultCache(size_t max_memory_bytes = 64 << 20, int num_shards = 16);
+
+    // 命中返回 true 并把结果拷贝到 boxes
+    bool get(const InferCacheKey &key, std::vector<Box> &boxes);
+
+    void put(const InferCacheKey &key, const std::vector<Box> &boxes);
+
+    void clear();
+
+    InferCacheStats stats() const;
+
+private:
+    struct Entry {
+        InferCacheKey key;
+        std::vector<Box> boxes;
+        size_t bytes;
+    };
+
+    struct Shard {
+        mutable std::mutex lock;
+        std::list<Entry> lru; // 表头是最近使用的条目
+        std::unordered_map<InferCacheKey, std::list<Entry>::iterator, InferCacheKeyHasher> index;
+        size_t memory_bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    Shard &shard_of(const InferCacheKey &key);
+    static size_t entry_bytes(const std::vector<Box> &boxes);
+
+    size_t shard_capacity_bytes_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+/*
+ * 带缓存的推理入口：先对输入帧做哈希，命中直接返回；未命中时调用 infer 完成完整的推理 + decode，并写入缓存。
+ * infer 是无参的可调用对象，返回 std::vector<Box>，一般是包装了 gpu_decode/cpu_decode 的 lambda。
+ */
+template <typename InferFunc>
+std::vector<Box> cached_infer(InferResultCache &cache, uint64_t model_id,
+                              const void *frame, size_t frame_bytes,
+                              float confidence_threshold, float nms_threshold, InferFunc &&infer) {
+    InferCacheKey key;
+    key.model_id = model_id;
+    key.input_hash = hash_bytes_128(frame, frame_bytes);
+    key.confidence_threshold = confidence_threshold;
+    key.nms_threshold = nms_threshold;
+
+    std::vector<Box> boxes;
+    if (cache.get(key, boxes)) { return boxes; }
+
+    boxes = infer();
+    cache.put(key, boxes);
+    return boxes;
+}
+
+#endif // INFER_CACHE_H
@@ -0,0 +1,118 @@
+#include "cuda-runtime-api.h"
+
+void gemm_cpu(const float *A, const float *B, float *C, int m, int n, int k) {
+    // i-p-j 的循环顺序，最内层连续访问 B 和 C，编译器可以向量化；累加顺序与 gemm_1 相同
+    for (int i = 0; i < m; ++i) {
+        float *crow = C + i * k;
+        std::fill(crow, crow + k, 0.0f);
+        for (int p = 0; p < n; ++p) {
+            float a = A[i * n + p];
+            const float *brow = B + p * k;
+            for (int j = 0; j < k; ++j) { crow[j] += a * brow[j]; }
+        }
+    }
+}
+
+int InstanceMask::area() const {
+    int count = 0;
+    for (uint32_t word : bits) {
+        for (; word; word &= word - 1) { ++count; }
+    }
+    return count;
+}
+
+InstanceMask make_instance_mask(const Box &box, const MaskAssemblyParams &params) {
+    const float *d2i = params.affine.d2i;
+    InstanceMask mask;
+    mask.box = box;
+    mask.box.left = d2i[0] * box.left + d2i[1] * box.top + d2i[2];
+    mask.box.top = d2i[3] * box.left + d2i[4] * box.top + d2i[5];
+    mask.box.right = d2i[0] * box.right + d2i[1] * box.bottom + d2i[2];
+    mask.box.bottom = d2i[3] * box.right + d2i[4] * box.bottom + d2i[5];
+
+    int left = std::max(0, (int)floorf(mask.box.left));
+    int top = std::max(0, (int)floorf(mask.box.top));
+    int right = std::min(params.image_width, (int)ceilf(mask.box.right));
+    int bottom = std::min(params.image_height, (int)ceilf(mask.box.bottom));
+    mask.left = left;
+    mask.top = top;
+    mask.width = std::max(0, right - left);
+    mask.height = std::max(0, bottom - top);
+    mask.bits.assign(mask.height * mask.row_words(), 0);
+    return mask;
+}
+
+float mask_logit_threshold(float mask_threshold) {
+    return logf(mask_threshold / (1.0f - mask_threshold));
+}
+
+std::vector<InstanceMask> cpu_assemble_masks(const std::vector<Box> &boxes, const float *coefficients,
+                                             const float *prototypes, const MaskAssemblyParams &params) {
+    int num_boxes = boxes.size();
+    int mask_area = params.mask_width * params.mask_height;
+    std::vector<InstanceMask> masks;
+    if (num_boxes == 0) { return masks; }
+
+    // [N, num_protos] x [num_protos, mask_area] = [N, mask_area]，一次 GEMM 得到所有框的 mask
+    std::vector<float> logits(num_boxes * mask_area);
+    gemm_cpu(coefficients, prototypes, logits.data(), num_boxes, params.num_protos, mask_area);
+
+    float scale_x = params.mask_width / (float)params.input_width;
+    float scale_y = params.mask_height / (float)params.input_height;
+    float logit_threshold = mask_logit_threshold(params.mask_threshold);
+    masks.reserve(num_boxes);
+    for (int i = 0; i < num_boxes; ++i) {
+        InstanceMask mask = make_instance_mask(boxes[i], params);
+        const float *plogits = logits.data() + i * mask_area;
+        int row_words = mask.row_words();
+        for (int y = 0; y < mask.height; ++y) {
+            for (int x = 0; x < mask.width; ++x) {
+                if (mask_pixel(plogits, params.affine.i2d, mask.left + x, mask.top + y, params.mask_width, params.mask_height,
+                               scale_x, scale_y, logit_threshold)) {
+                    mask.bits[y * row_words + x / 32] |= 1u << (x % 32);
+                }
+            }
+        }
+        masks.emplace_back(std::move(mask));
+    }
+    return masks;
+}
+
+std::vector<uint32_t> mask_to_rle(const InstanceMask &mask) {
+    std::vector<uint32_t> rle;
+    bool current = false;
+    uint32_t run = 0;
+    for (int y = 0; y < mask.height; ++y) {
+        for (int x = 0; x < mask.width; ++x) {
+            if (mask.at(x, y) != current) {
+                rle.push_back(run);
+                current = !current;
+                run = 0;
+            }
+            ++run;
+        }
+    }
+    rle.push_back(run);
+    return rle;
+}
+
+InstanceMask mask_from_rle(const std::vector<uint32_t> &rle, int left, int top, int width, int height) {
+    InstanceMask mask;
+    mask.left = left;
+    mask.top = top;
+    mask.width = width;
+    mask.height = height;
+    mask.bits.assign(height * mask.row_words(), 0);
+
+    int position = 0;
+    for (size_t i = 0; i < rle.size(); ++i) {
+        if (i % 2 == 1) {
+            for (uint32_t k = 0; k < rle[i]; ++k) {
+                int x = (position + k) % width, y = (position + k) / width;
+                mask.bits[y * mask.row_words() + x / 32] |= 1u << (x % 32);
+            }
+        }
+        position += rle[i];
+    }
+    return mask;
+}
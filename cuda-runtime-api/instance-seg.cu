@@ -0,0 +1,97 @@
+#include "cuda-runtime-api.h"
+
+// 单个框的 mask 区域在位图缓冲中的位置
+struct MaskROI {
+    int left, top, width, row_words;
+    int offset; // 在位图缓冲中的起始字
+};
+
+/*
+ * 所有框的位图连续存放，每个线程生成一个 32 位的字，也就是一行中连续的 32 个像素，
+ * 所有框在一次 launch 中完成。线程通过二分查找 offsets 确定自己属于哪个框。
+ */
+__global__ void mask_bits_kernel(const float *logits, int mask_width, int mask_height, const MaskROI *rois, int num_boxes,
+                                 int total_words, AffineMatrix affine, float scale_x, float scale_y,
+                                 float logit_threshold, uint32_t *bits) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= total_words) { return; }
+
+    int lo = 0, hi = num_boxes - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (rois[mid].offset <= position) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    MaskROI roi = rois[lo];
+    int local = position - roi.offset;
+    int y = local / roi.row_words;
+    int x_begin = (local % roi.row_words) * 32;
+    int x_end = min(x_begin + 32, roi.width);
+
+    const float *mask = logits + (size_t)lo * mask_width * mask_height;
+    uint32_t word = 0;
+    for (int x = x_begin; x < x_end; ++x) {
+        if (mask_pixel(mask, affine.i2d, roi.left + x, roi.top + y, mask_width, mask_height, scale_x, scale_y, logit_threshold)) {
+            word |= 1u << (x - x_begin);
+        }
+    }
+    bits[position] = word;
+}
+
+std::vector<InstanceMask> gpu_assemble_masks(const std::vector<Box> &boxes, const float *coefficients,
+                                             const float *prototypes_device, const MaskAssemblyParams &params,
+                                             cudaStream_t stream) {
+    int num_boxes = boxes.size();
+    int mask_area = params.mask_width * params.mask_height;
+    std::vector<InstanceMask> masks;
+    if (num_boxes == 0) { return masks; }
+
+    std::vector<MaskROI> rois(num_boxes);
+    int total_words = 0;
+    masks.reserve(num_boxes);
+    for (int i = 0; i < num_boxes; ++i) {
+        masks.emplace_back(make_instance_mask(boxes[i], params));
+        auto &mask = masks.back();
+        rois[i] = {mask.left, mask.top, mask.width, mask.row_words(), total_words};
+        total_words += mask.bits.size();
+    }
+    if (total_words == 0) { return masks; }
+
+    float *coefficients_device = nullptr;
+    float *logits_device = nullptr;
+    MaskROI *rois_device = nullptr;
+    uint32_t *bits_device = nullptr;
+    checkRuntime(cudaMalloc(&coefficients_device, num_boxes * params.num_protos * sizeof(float)));
+    checkRuntime(cudaMalloc(&logits_device, (size_t)num_boxes * mask_area * sizeof(float)));
+    checkRuntime(cudaMalloc(&rois_device, num_boxes * sizeof(MaskROI)));
+    checkRuntime(cudaMalloc(&bits_device, total_words * sizeof(uint32_t)));
+
+    checkRuntime(cudaMemcpyAsync(coefficients_device, coefficients, num_boxes * params.num_protos * sizeof(float), cudaMemcpyHostToDevice, stream));
+    checkRuntime(cudaMemcpyAsync(rois_device, rois.data(), num_boxes * sizeof(MaskROI), cudaMemcpyHostToDevice, stream));
+
+    // [N, num_protos] x [num_protos, mask_area] = [N, mask_area]，所有框共用一次 GEMM
+    gemm_1(coefficients_device, prototypes_device, logits_device, num_boxes, params.num_protos, mask_area, stream);
+
+    auto block = total_words > 256 ? 256 : total_words;
+    auto grid = (total_words + block - 1) / block;
+    mask_bits_kernel<<<grid, block, 0, stream>>>(
+        logits_device, params.mask_width, params.mask_height, rois_device, num_boxes, total_words, params.affine,
+        params.mask_width / (float)params.input_width, params.mask_height / (float)params.input_height,
+        mask_logit_threshold(params.mask_threshold), bits_device);
+
+    std::vector<uint32_t> bits(total_words);
+    checkRuntime(cudaMemcpyAsync(bits.data(), bits_device, total_words * sizeof(uint32_t), cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaStreamSynchronize(stream));
+    for (int i = 0; i < num_boxes; ++i) {
+        std::copy(bits.begin() + rois[i].offset, bits.begin() + rois[i].offset + masks[i].bits.size(), masks[i].bits.begin());
+    }
+
+    checkRuntime(cudaFree(coefficients_device));
+    checkRuntime(cudaFree(logits_device));
+    checkRuntime(cudaFree(rois_device));
+    checkRuntime(cudaFree(bits_device));
+    return masks;
+}
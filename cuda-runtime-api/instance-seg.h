@@ -0,0 +1,95 @@
+#ifndef INSTANCE_SEG_H
+#define INSTANCE_SEG_H
+
+#include <stdint.h>
+#include <vector>
+#include "utils.h"
+#include "affine-matrix.h"
+
+/*
+ * yolov5/yolov8-seg 的 mask 组装：
+ *   每个保留下来的框带有 num_protos（通常 32）个 mask 系数，模型另外输出一个 [num_protos, mask_height, mask_width] 的原型张量；
+ *   mask = sigmoid(系数 x 原型)，所有框的系数拼成 [N, num_protos] 的矩阵，和原型做一次 GEMM 得到全部框的 mask；
+ *   再把 mask 通过仿射变换映射回原图，裁剪到框内，按阈值二值化，输出紧凑的位图。
+ */
+struct InstanceMask {
+    Box box;                    // 原图坐标下的框
+    int left = 0, top = 0;      // mask 区域在原图中的位置，即框取整并裁剪到图像内
+    int width = 0, height = 0;
+    std::vector<uint32_t> bits; // 按行存储的位图，每行 (width + 31) / 32 个字，低位在左
+
+    int row_words() const { return (width + 31) / 32; }
+
+    bool at(int x, int y) const {
+        return (bits[y * row_words() + x / 32] >> (x % 32)) & 1;
+    }
+
+    int area() const;
+};
+
+struct MaskAssemblyParams {
+    int num_protos = 32;
+    int mask_width = 160, mask_height = 160;   // 原型张量的空间尺寸
+    int input_width = 640, input_height = 640; // 网络输入尺寸，框的坐标在这个尺度下
+    int image_width = 0, image_height = 0;     // 原图尺寸
+    AffineMatrix affine;                       // compute(原图尺寸, 网络输入尺寸)，i2d 为原图到网络输入
+    float mask_threshold = 0.5f;
+};
+
+#ifdef __CUDACC__
+#define SEG_HOST_DEVICE __host__ __device__
+#else
+#define SEG_HOST_DEVICE
+#endif
+
+/*
+ * 原图像素 (x, y) 对应的 mask 值，mask 为单个框的 [mask_height, mask_width]，双线性插值，边缘取最近值。
+ * sigmoid 单调，sigmoid(v) > mask_threshold 等价于 v > logit(mask_threshold)，逐像素不需要再算 exp。
+ * CPU 和 GPU 共用，保证两边的采样完全一致。
+ */
+inline SEG_HOST_DEVICE bool mask_pixel(const float *mask, const float *i2d, int x, int y, int mask_width, int mask_height,
+                                       float mask_scale_x, float mask_scale_y, float logit_threshold) {
+    float nx = i2d[0] * x + i2d[1] * y + i2d[2];
+    float ny = i2d[3] * x + i2d[4] * y + i2d[5];
+    float px = (nx + 0.5f) * mask_scale_x - 0.5f;
+    float py = (ny + 0.5f) * mask_scale_y - 0.5f;
+    px = px < 0 ? 0 : (px > mask_width - 1 ? mask_width - 1 : px);
+    py = py < 0 ? 0 : (py > mask_height - 1 ? mask_height - 1 : py);
+
+    int x0 = (int)px, y0 = (int)py;
+    int x1 = x0 + 1 < mask_width ? x0 + 1 : x0;
+    int y1 = y0 + 1 < mask_height ? y0 + 1 : y0;
+    float lx = px - x0, ly = py - y0;
+    float hx = 1 - lx, hy = 1 - ly;
+    float value = hy * (hx * mask[y0 * mask_width + x0] + lx * mask[y0 * mask_width + x1])
+                  + ly * (hx * mask[y1 * mask_width + x0] + lx * mask[y1 * mask_width + x1]);
+    return value > logit_threshold;
+}
+
+/*
+ * boxes 为网络输入坐标下 NMS 之后的框，coefficients 为对应的 [N, num_protos] 系数（主机端），
+ * prototypes 为 [num_protos, mask_height * mask_width] 的原型张量。
+ * CPU 版本 prototypes 在主机端；GPU 版本 prototypes 在设备端（直接使用模型输出），在 stream 上完成并同步。
+ */
+// 把网络输入坐标下的框映射回原图（d2i），确定 mask 区域并分配位图，CPU 和 GPU 版本共用
+InstanceMask make_instance_mask(const Box &box, const MaskAssemblyParams &params);
+
+// sigmoid 阈值对应的 logit 阈值
+float mask_logit_threshold(float mask_threshold);
+
+std::vector<InstanceMask> cpu_assemble_masks(const std::vector<Box> &boxes, const float *coefficients,
+                                             const float *prototypes, const MaskAssemblyParams &params);
+
+std::vector<InstanceMask> gpu_assemble_masks(const std::vector<Box> &boxes, const float *coefficients,
+                                             const float *prototypes_device, const MaskAssemblyParams &params,
+                                             cudaStream_t stream = nullptr);
+
+/*
+ * 行优先的游程编码：[0 的个数, 1 的个数, 0 的个数, ……]，第一个游程总是 0，因此可能为 0。
+ * 游程之和为 width * height。
+ */
+std::vector<uint32_t> mask_to_rle(const InstanceMask &mask);
+
+InstanceMask mask_from_rle(const std::vector<uint32_t> &rle, int left, int top, int width, int height);
+
+#endif // INSTANCE_SEG_H
@@ -0,0 +1,294 @@
+#include "iou-tracker.h"
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IOU_TRACKER_USE_SSE2 1
+#endif
+
+void iou_matrix(const std::vector<Box> &a, const std::vector<Box> &b, bool match_label, std::vector<float> &out) {
+    int na = a.size();
+    int nb = b.size();
+    out.resize(na * nb);
+    if (na == 0 || nb == 0) { return; }
+
+    // b 转成 SoA 布局，长度补齐到 4 的倍数，内层循环就可以整段向量化
+    int nb_pad = (nb + 3) / 4 * 4;
+    std::vector<float> soa(nb_pad * 6, 0.0f);
+    float *bl = soa.data();
+    float *bt = bl + nb_pad;
+    float *br = bt + nb_pad;
+    float *bb = br + nb_pad;
+    float *barea = bb + nb_pad;
+    float *blabel = barea + nb_pad;
+    for (int j = 0; j < nb; ++j) {
+        bl[j] = b[j].left;
+        bt[j] = b[j].top;
+        br[j] = b[j].right;
+        bb[j] = b[j].bottom;
+        barea[j] = std::max(0.0f, b[j].right - b[j].left) * std::max(0.0f, b[j].bottom - b[j].top);
+        blabel[j] = (float)b[j].label;
+    }
+    // 补齐的部分标签设为 -1，面积为 0，不会和任何框产生 IoU
+    for (int j = nb; j < nb_pad; ++j) { blabel[j] = -1; }
+
+    std::vector<float> row(nb_pad);
+    for (int i = 0; i < na; ++i) {
+        const Box &ai = a[i];
+        float aarea = std::max(0.0f, ai.right - ai.left) * std::max(0.0f, ai.bottom - ai.top);
+        int j = 0;
+#ifdef IOU_TRACKER_USE_SSE2
+        const __m128 zero = _mm_setzero_ps();
+        __m128 al = _mm_set1_ps(ai.left), at = _mm_set1_ps(ai.top);
+        __m128 ar = _mm_set1_ps(ai.right), ab = _mm_set1_ps(ai.bottom);
+        __m128 aa = _mm_set1_ps(aarea), alabel = _mm_set1_ps((float)ai.label);
+        for (; j < nb_pad; j += 4) {
+            __m128 cl = _mm_max_ps(al, _mm_loadu_ps(bl + j));
+            __m128 ct = _mm_max_ps(at, _mm_loadu_ps(bt + j));
+            __m128 cr = _mm_min_ps(ar, _mm_loadu_ps(br + j));
+            __m128 cb = _mm_min_ps(ab, _mm_loadu_ps(bb + j));
+            __m128 inter = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(cr, cl), zero), _mm_max_ps(_mm_sub_ps(cb, ct), zero));
+            __m128 uni = _mm_sub_ps(_mm_add_ps(aa, _mm_loadu_ps(barea + j)), inter);
+            // 并集为 0 时用 1 代替做除法，此时交集一定也是 0，结果为 0
+            __m128 uni_safe = _mm_or_ps(_mm_and_ps(_mm_cmpgt_ps(uni, zero), uni), _mm_andnot_ps(_mm_cmpgt_ps(uni, zero), _mm_set1_ps(1.0f)));
+            __m128 iou = _mm_div_ps(inter, uni_safe);
+            if (match_label) { iou = _mm_and_ps(iou, _mm_cmpeq_ps(alabel, _mm_loadu_ps(blabel + j))); }
+            _mm_storeu_ps(row.data() + j, iou);
+        }
+#else
+        for (; j < nb_pad; ++j) {
+            float cl = std::max(ai.left, bl[j]);
+            float ct = std::max(ai.top, bt[j]);
+            float cr = std::min(ai.right, br[j]);
+            float cb = std::min(ai.bottom, bb[j]);
+            float inter = std::max(0.0f, cr - cl) * std::max(0.0f, cb - ct);
+            float uni = aarea + barea[j] - inter;
+            float iou = uni > 0 ? inter / uni : 0.0f;
+            if (match_label && blabel[j] != (float)ai.label) { iou = 0; }
+            row[j] = iou;
+        }
+#endif
+        std::copy(row.begin(), row.begin() + nb, out.begin() + i * nb);
+    }
+}
+
+std::vector<std::pair<int, int>> greedy_assign(const std::vector<float> &iou, int rows, int cols, float iou_threshold) {
+    // 收集所有超过阈值的候选对，按 IoU 从大到小排序
+    std::vector<std::pair<float, int>> candidates;
+    for (int i = 0; i < rows * cols; ++i) {
+        if (iou[i] >= iou_threshold && iou[i] > 0) { candidates.emplace_back(iou[i], i); }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const std::pair<float, int> &a, const std::pair<float, int> &b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+
+    std::vector<bool> row_used(rows), col_used(cols);
+    std::vector<std::pair<int, int>> matches;
+    for (auto &item : candidates) {
+        int r = item.second / cols;
+        int c = item.second % cols;
+        if (row_used[r] || col_used[c]) { continue; }
+        row_used[r] = col_used[c] = true;
+        matches.emplace_back(r, c);
+    }
+    return matches;
+}
+
+std::vector<std::pair<int, int>> hungarian_assign(const std::vector<float> &iou, int rows, int cols, float iou_threshold) {
+    std::vector<std::pair<int, int>> matches;
+    if (rows == 0 || cols == 0) { return matches; }
+
+    // 算法要求 n <= m，行比列多时转置后再求解
+    bool transposed = rows > cols;
+    int n = transposed ? cols : rows;
+    int m = transposed ? rows : cols;
+    auto cost = [&](int i, int j) {
+        float v = transposed ? iou[j * cols + i] : iou[i * cols + j];
+        return 1.0f - v;
+    };
+
+    // 势函数 u, v 与增广路，下标从 1 开始，0 作为虚拟列
+    const float INF = std::numeric_limits<float>::max();
+    std::vector<float> u(n + 1, 0), v(m + 1, 0), minv(m + 1);
+    std::vector<int> p(m + 1, 0), way(m + 1, 0);
+    std::vector<char> used(m + 1);
+    for (int i = 1; i <= n; ++i) {
+        p[0] = i;
+        int j0 = 0;
+        std::fill(minv.begin(), minv.end(), INF);
+        std::fill(used.begin(), used.end(), 0);
+        do {
+            used[j0] = 1;
+            int i0 = p[j0];
+            int j1 = 0;
+            float delta = INF;
+            for (int j = 1; j <= m; ++j) {
+                if (used[j]) { continue; }
+                float cur = cost(i0 - 1, j - 1) - u[i0] - v[j];
+                if (cur < minv[j]) {
+                    minv[j] = cur;
+                    way[j] = j0;
+                }
+                if (minv[j] < delta) {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= m; ++j) {
+                if (used[j]) {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                } else {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+
+        // 沿增广路回溯，更新匹配
+        do {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    for (int j = 1; j <= m; ++j) {
+        if (p[j] == 0) { continue; }
+        int r = transposed ? j - 1 : p[j] - 1;
+        int c = transposed ? p[j] - 1 : j - 1;
+        float value = iou[r * cols + c];
+        if (value >= iou_threshold && value > 0) { matches.emplace_back(r, c); }
+    }
+    return matches;
+}
+
+IoUTracker::IoUTracker(const TrackerConfig &config) :
+    config_(config) {
+}
+
+void IoUTracker::step(Track &track) {
+    // 匀速模型：中心点和宽高各自按速度外推一帧
+    Box &box = track.box;
+    float cx = (box.left + box.right) * 0.5f + track.vcx;
+    float cy = (box.top + box.bottom) * 0.5f + track.vcy;
+    float w = std::max(1.0f, box.right - box.left + track.vw);
+    float h = std::max(1.0f, box.bottom - box.top + track.vh);
+    box.left = cx - w * 0.5f;
+    box.top = cy - h * 0.5f;
+    box.right = cx + w * 0.5f;
+    box.bottom = cy + h * 0.5f;
+
+    track.confidence *= config_.confidence_decay;
+    box.confidence = track.confidence;
+    track.age++;
+    track.time_since_update++;
+}
+
+const std::vector<Track> &IoUTracker::predict() {
+    for (auto &track : tracks_) { step(track); }
+    return tracks_;
+}
+
+const std::vector<Track> &IoUTracker::update(const std::vector<Box> &detections) {
+    predicted_.clear();
+    for (auto &track : tracks_) {
+        step(track);
+        predicted_.push_back(track.box);
+    }
+
+    int rows = tracks_.size();
+    int cols = detections.size();
+    iou_matrix(predicted_, detections, config_.match_label, iou_);
+    auto matches = config_.use_hungarian ? hungarian_assign(iou_, rows, cols, config_.iou_threshold)
+                                         : greedy_assign(iou_, rows, cols, config_.iou_threshold);
+
+    std::vector<bool> det_used(cols);
+    for (auto &match : matches) {
+        Track &track = tracks_[match.first];
+        const Box &det = detections[match.second];
+        det_used[match.second] = true;
+
+        /*
+         * 预测值 = 上次更新的值 + v * dt，所以 (观测 - 上次更新) / dt = v + (观测 - 预测) / dt，
+         * 速度的指数平滑可以直接用 "观测 - 预测" 的残差来写，不需要保存上一次的框。
+         */
+        float dt = (float)std::max(track.time_since_update, 1);
+        const Box &pred = track.box;
+        float dcx = ((det.left + det.right) - (pred.left + pred.right)) * 0.5f;
+        float dcy = ((det.top + det.bottom) - (pred.top + pred.bottom)) * 0.5f;
+        float dw = (det.right - det.left) - (pred.right - pred.left);
+        float dh = (det.bottom - det.top) - (pred.bottom - pred.top);
+        // 第二次观测时才第一次有速度，直接用观测值初始化
+        float alpha = track.hits == 1 ? 1.0f : config_.velocity_smoothing;
+        track.vcx += alpha * dcx / dt;
+        track.vcy += alpha * dcy / dt;
+        track.vw += alpha * dw / dt;
+        track.vh += alpha * dh / dt;
+
+        track.box = det;
+        track.confidence = det.confidence;
+        track.hits++;
+        track.time_since_update = 0;
+    }
+
+    // 长时间没有匹配到检测框的轨迹删除
+    tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(), [&](const Track &track) {
+                      return track.time_since_update > config_.max_age;
+                  }),
+                  tracks_.end());
+
+    // 没有匹配上的检测框新建轨迹
+    for (int j = 0; j < cols; ++j) {
+        if (det_used[j]) { continue; }
+        Track track;
+        track.id = next_id_++;
+        track.box = detections[j];
+        track.confidence = detections[j].confidence;
+        track.hits = 1;
+        tracks_.push_back(track);
+    }
+    return tracks_;
+}
+
+std::vector<Box> IoUTracker::boxes() const {
+    std::vector<Box> result;
+    result.reserve(tracks_.size());
+    for (auto &track : tracks_) {
+        Box box = track.box;
+        box.confidence = track.confidence;
+        result.push_back(box);
+    }
+    return result;
+}
+
+float IoUTracker::mean_confidence() const {
+    if (tracks_.empty()) { return 0.0f; }
+    float sum = 0;
+    for (auto &track : tracks_) { sum += track.confidence; }
+    return sum / tracks_.size();
+}
+
+void IoUTracker::reset() {
+    tracks_.clear();
+    next_id_ = 1;
+}
+
+DetectScheduler::DetectScheduler(int interval, float min_confidence, const TrackerConfig &config) :
+    tracker_(config), interval_(std::max(interval, 1)), min_confidence_(min_confidence) {
+}
+
+bool DetectScheduler::need_detect() const {
+    if (detected_frames_ == 0) { return true; }
+    if (frames_since_detect_ + 1 >= interval_) { return true; }
+    // 没有轨迹时不因置信度触发检测，否则空场景会退化成每帧检测
+    return !tracker_.tracks().empty() && tracker_.mean_confidence() < min_confidence_;
+}
+
+MotionGate::Extrapolator make_track_extrapolator(IoUTracker &tracker) {
+    return [&tracker](const std::vector<Box> &, int) {
+        tracker.predict();
+        return tracker.boxes();
+    };
+}
@@ -0,0 +1,129 @@
+#ifndef IOU_TRACKER_H
+#define IOU_TRACKER_H
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "utils.h"
+#include "motion-gate.h"
+
+/*
+ * 轻量级 IoU 跟踪器：
+ * 30 fps 的视频没必要每帧都跑检测，检测器每 N 帧运行一次，中间的帧由跟踪器按匀速模型外推。
+ * 检测帧上用 IoU 代价矩阵 + 贪心或匈牙利匹配把新的检测框关联到已有的轨迹上。
+ * 全部在 CPU 上完成，不依赖 GPU。
+ */
+struct Track {
+    int id = 0;
+    Box box;                   // 当前（预测或更新后）的框
+    float vcx = 0, vcy = 0;    // 中心点速度，像素/帧
+    float vw = 0, vh = 0;      // 宽高变化速度，像素/帧
+    float confidence = 0;      // 轨迹置信度，外推时逐帧衰减，匹配到检测框时重置为检测置信度
+    int hits = 0;              // 累计匹配到的次数
+    int age = 0;               // 轨迹存在的帧数
+    int time_since_update = 0; // 距离上一次匹配到检测框经过的帧数
+};
+
+struct TrackerConfig {
+    float iou_threshold = 0.3f;      // IoU 低于该值的匹配视为无效
+    bool match_label = true;         // 只在同类别之间匹配
+    bool use_hungarian = false;      // false 使用贪心匹配，true 使用匈牙利算法求全局最优
+    float velocity_smoothing = 0.6f; // 速度的指数平滑系数，越大越相信最新的观测
+    float confidence_decay = 0.95f;  // 每外推一帧轨迹置信度乘以该系数
+    int max_age = 30;                // 连续这么多帧没有匹配到检测框则删除轨迹
+};
+
+/*
+ * IoU 矩阵：out[i * nb + j] = iou(a[i], b[j])，标签不同且 match_label 为 true 时为 0。
+ * 内部把框转成 SoA 布局，SSE 下一次计算 4 个 IoU。
+ */
+void iou_matrix(const std::vector<Box> &a, const std::vector<Box> &b, bool match_label, std::vector<float> &out);
+
+// 贪心匹配：按 IoU 从大到小依次取未被占用的行列，返回 (row, col) 对
+std::vector<std::pair<int, int>> greedy_assign(const std::vector<float> &iou, int rows, int cols, float iou_threshold);
+
+// 匈牙利算法：最小化 sum(1 - iou)，O(n^3)，匹配后再过滤掉 IoU 低于阈值的对
+std::vector<std::pair<int, int>> hungarian_assign(const std::vector<float> &iou, int rows, int cols, float iou_threshold);
+
+class IoUTracker {
+public:
+    IoUTracker(const TrackerConfig &config = TrackerConfig());
+
+    // 检测帧：先把所有轨迹外推一帧，再与检测框匹配，未匹配的检测框新建轨迹
+    const std::vector<Track> &update(const std::vector<Box> &detections);
+
+    // 跳过检测的帧：所有轨迹按匀速模型外推一帧
+    const std::vector<Track> &predict();
+
+    // 当前所有轨迹的框，confidence 为轨迹置信度
+    std::vector<Box> boxes() const;
+
+    const std::vector<Track> &tracks() const {
+        return tracks_;
+    }
+
+    // 所有轨迹的平均置信度，没有轨迹时返回 0
+    float mean_confidence() const;
+
+    void reset();
+
+private:
+    void step(Track &track);
+
+    TrackerConfig config_;
+    std::vector<Track> tracks_;
+    std::vector<Box> predicted_; // update 时的临时缓冲
+    std::vector<float> iou_;
+    int next_id_ = 1;
+};
+
+/*
+ * 检测调度：每 interval 帧运行一次检测，或者轨迹平均置信度低于 min_confidence 时提前检测，
+ * 其余帧只做跟踪外推。
+ */
+class DetectScheduler {
+public:
+    DetectScheduler(int interval = 5, float min_confidence = 0.3f, const TrackerConfig &config = TrackerConfig());
+
+    template <typename DetectFunc>
+    std::vector<Box> process(DetectFunc &&detect) {
+        if (need_detect()) {
+            tracker_.update(detect());
+            frames_since_detect_ = 0;
+            detected_frames_++;
+        } else {
+            tracker_.predict();
+            frames_since_detect_++;
+            tracked_frames_++;
+        }
+        return tracker_.boxes();
+    }
+
+    bool need_detect() const;
+
+    IoUTracker &tracker() {
+        return tracker_;
+    }
+    uint64_t detected_frames() const {
+        return detected_frames_;
+    }
+    uint64_t tracked_frames() const {
+        return tracked_frames_;
+    }
+
+private:
+    IoUTracker tracker_;
+    int interval_;
+    float min_confidence_;
+    int frames_since_detect_ = 0;
+    uint64_t detected_frames_ = 0;
+    uint64_t tracked_frames_ = 0;
+};
+
+/*
+ * 与 MotionGate 配合：门控跳过的帧由跟踪器外推。
+ * 推理帧需要在 infer 回调中调用 tracker.update(boxes)，外推器只负责 predict。
+ */
+MotionGate::Extrapolator make_track_extrapolator(IoUTracker &tracker);
+
+#endif // IOU_TRACKER_H
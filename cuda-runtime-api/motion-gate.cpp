@@ -0,0 +1,133 @@
+#include "motion-gate.h"
+#include <stdlib.h>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MOTION_GATE_USE_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MOTION_GATE_USE_NEON 1
+#endif
+
+// 16 位掩码中 1 的个数，避免依赖编译器内建函数
+static inline int popcount16(int mask) {
+    mask = mask - ((mask >> 1) & 0x5555);
+    mask = (mask & 0x3333) + ((mask >> 2) & 0x3333);
+    mask = (mask + (mask >> 4)) & 0x0F0F;
+    return (mask + (mask >> 8)) & 0x1F;
+}
+
+// BT.601 亮度的定点近似：Y = (29 * B + 150 * G + 77 * R) >> 8
+static inline int luma_of(const uint8_t *pixel) {
+    return (29 * pixel[0] + 150 * pixel[1] + 77 * pixel[2]) >> 8;
+}
+
+void luma_thumbnail(const uint8_t *bgr, int width, int height, int line_size,
+                    int downsample, std::vector<uint8_t> &thumbnail, int &thumb_width, int &thumb_height) {
+    if (downsample < 2) { downsample = 2; }
+    thumb_width = width / downsample;
+    thumb_height = height / downsample;
+    thumbnail.resize(thumb_width * thumb_height);
+
+    // 块中心 2x2 像素的左上角相对于块起点的偏移
+    int offset = downsample / 2 - 1;
+    for (int ty = 0; ty < thumb_height; ++ty) {
+        const uint8_t *row0 = bgr + (ty * downsample + offset) * line_size;
+        const uint8_t *row1 = row0 + line_size;
+        uint8_t *pout = thumbnail.data() + ty * thumb_width;
+        for (int tx = 0; tx < thumb_width; ++tx) {
+            int x = (tx * downsample + offset) * 3;
+            int sum = luma_of(row0 + x) + luma_of(row0 + x + 3) + luma_of(row1 + x) + luma_of(row1 + x + 3);
+            pout[tx] = (uint8_t)((sum + 2) >> 2);
+        }
+    }
+}
+
+MotionDelta luma_delta(const uint8_t *a, const uint8_t *b, int count, int pixel_delta_threshold) {
+    MotionDelta delta;
+    if (count <= 0) { return delta; }
+
+    uint64_t sad = 0;
+    int changed = 0;
+    int i = 0;
+    uint8_t threshold = (uint8_t)std::min(std::max(pixel_delta_threshold, 0), 255);
+
+#if defined(MOTION_GATE_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vthreshold = _mm_set1_epi8((char)threshold);
+    __m128i vsad = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        // _mm_sad_epu8 对 16 个字节的绝对差求和，结果放在两个 64 位通道里
+        vsad = _mm_add_epi64(vsad, _mm_sad_epu8(va, vb));
+
+        // |a - b| = sat(a - b) | sat(b - a)，再减去阈值，结果非零的就是超过阈值的像素
+        __m128i absdiff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        __m128i over = _mm_subs_epu8(absdiff, vthreshold);
+        int not_changed_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(over, zero));
+        changed += 16 - popcount16(not_changed_mask);
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, vsad);
+    sad = lanes[0] + lanes[1];
+#elif defined(MOTION_GATE_USE_NEON)
+    const uint8x16_t vthreshold = vdupq_n_u8(threshold);
+    uint64x2_t vsad = vdupq_n_u64(0);
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t va = vld1q_u8(a + i);
+        uint8x16_t vb = vld1q_u8(b + i);
+        uint8x16_t absdiff = vabdq_u8(va, vb);
+        // 逐级两两相加：u8 -> u16 -> u32 -> u64
+        vsad = vaddq_u64(vsad, vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(absdiff))));
+        // 超过阈值的通道为 0xFF，右移 7 位变成 1 后累加
+        uint8x16_t over = vshrq_n_u8(vcgtq_u8(absdiff, vthreshold), 7);
+        changed += vaddvq_u8(over);
+    }
+    sad = vgetq_lane_u64(vsad, 0) + vgetq_lane_u64(vsad, 1);
+#endif
+
+    // 剩余不足 16 个的像素走标量实现
+    for (; i < count; ++i) {
+        int d = abs((int)a[i] - (int)b[i]);
+        sad += d;
+        if (d > threshold) { changed++; }
+    }
+
+    delta.mean_delta = (float)sad / count;
+    delta.changed_ratio = (float)changed / count;
+    return delta;
+}
+
+MotionGate::MotionGate(const MotionGateConfig &config) :
+    config_(config) {
+}
+
+bool MotionGate::need_infer(const uint8_t *bgr, int width, int height, int line_size) {
+    luma_thumbnail(bgr, width, height, line_size, config_.downsample, current_, thumb_width_, thumb_height_);
+
+    // 没有参考帧（第一帧或 reset 之后）或者分辨率发生变化，必须推理
+    if (reference_.empty() || reference_.size() != current_.size()) {
+        last_delta_ = MotionDelta();
+        return true;
+    }
+
+    last_delta_ = luma_delta(current_.data(), reference_.data(), current_.size(), config_.pixel_delta_threshold);
+    if (frames_since_infer_ >= config_.max_skip_frames) { return true; }
+    return last_delta_.mean_delta > config_.mean_delta_threshold
+           || last_delta_.changed_ratio > config_.changed_ratio_threshold;
+}
+
+void MotionGate::commit_reference() {
+    // 参考帧始终是 "上一次推理的帧"，跳过的帧不更新参考，避免缓慢的渐变被逐帧吃掉
+    reference_.swap(current_);
+    frames_since_infer_ = 0;
+    inferred_frames_++;
+}
+
+void MotionGate::reset() {
+    reference_.clear();
+    frames_since_infer_ = 0;
+    last_boxes_.clear();
+}
@@ -0,0 +1,97 @@
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+#include "utils.h"
+
+/*
+ * 运动门控：
+ * 视频流中相邻帧往往几乎没有变化，这时没必要每帧都跑检测。
+ * 在预处理之前，把当前帧下采样成亮度缩略图，与上一次推理时的缩略图做差，
+ * 变化量低于阈值则跳过推理，直接复用上一次的检测结果（可选地交给跟踪器外推），
+ * 同时限制最大连续跳过帧数，保证结果不会无限期地陈旧。
+ */
+struct MotionGateConfig {
+    int downsample = 8;                     // 缩略图下采样倍数，每个 downsample x downsample 的块对应缩略图的一个像素
+    float mean_delta_threshold = 2.0f;      // 缩略图平均亮度差（0~255）超过该值认为画面有变化
+    int pixel_delta_threshold = 25;         // 单个缩略图像素亮度差超过该值记为 "变化的像素"
+    float changed_ratio_threshold = 0.002f; // 变化像素占比超过该值认为画面有变化，用于捕捉小目标的运动
+    int max_skip_frames = 10;               // 最多连续跳过的帧数，达到后强制推理一次
+};
+
+struct MotionDelta {
+    float mean_delta = 0;    // 平均亮度差
+    float changed_ratio = 0; // 变化像素占比
+};
+
+// 把 BGR 图像下采样为亮度缩略图，每个块取中心 2x2 像素的平均亮度
+void luma_thumbnail(const uint8_t *bgr, int width, int height, int line_size,
+                    int downsample, std::vector<uint8_t> &thumbnail, int &thumb_width, int &thumb_height);
+
+// 计算两张同尺寸缩略图之间的差异，SSE2/NEON 下每次处理 16 个像素
+MotionDelta luma_delta(const uint8_t *a, const uint8_t *b, int count, int pixel_delta_threshold);
+
+class MotionGate {
+public:
+    // frames_since_infer 是距离上一次推理经过的帧数，返回外推后的检测结果
+    typedef std::function<std::vector<Box>(const std::vector<Box> &last_boxes, int frames_since_infer)> Extrapolator;
+
+    MotionGate(const MotionGateConfig &config = MotionGateConfig());
+
+    // 仅做判断：返回 true 表示当前帧需要推理。会更新 last_delta()，但不改变参考帧
+    bool need_infer(const uint8_t *bgr, int width, int height, int line_size);
+
+    /*
+     * 门控后的推理入口：需要推理时调用 infer() 并把当前帧设为新的参考帧，
+     * 否则复用上一次的结果，设置了 extrapolator 时交给它外推。
+     */
+    template <typename InferFunc>
+    std::vector<Box> process(const uint8_t *bgr, int width, int height, int line_size, InferFunc &&infer) {
+        if (need_infer(bgr, width, height, line_size)) {
+            last_boxes_ = infer();
+            commit_reference();
+            return last_boxes_;
+        }
+
+        skipped_frames_++;
+        frames_since_infer_++;
+        if (extrapolator_) { return extrapolator_(last_boxes_, frames_since_infer_); }
+        return last_boxes_;
+    }
+
+    void set_extrapolator(const Extrapolator &extrapolator) {
+        extrapolator_ = extrapolator;
+    }
+
+    // 丢弃参考帧，下一帧一定会推理，用于切换视频源等场景
+    void reset();
+
+    uint64_t skipped_frames() const {
+        return skipped_frames_;
+    }
+    uint64_t inferred_frames() const {
+        return inferred_frames_;
+    }
+    const MotionDelta &last_delta() const {
+        return last_delta_;
+    }
+
+private:
+    void commit_reference();
+
+    MotionGateConfig config_;
+    std::vector<uint8_t> reference_; // 上一次推理时的缩略图
+    std::vector<uint8_t> current_;   // 当前帧的缩略图
+    int thumb_width_ = 0;
+    int thumb_height_ = 0;
+    int frames_since_infer_ = 0;
+    uint64_t skipped_frames_ = 0;
+    uint64_t inferred_frames_ = 0;
+    MotionDelta last_delta_;
+    std::vector<Box> last_boxes_;
+    Extrapolator extrapolator_;
+};
+
+#endif // MOTION_GATE_H
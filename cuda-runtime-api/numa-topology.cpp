@@ -0,0 +1,319 @@
+#include "numa-topology.h"
+#include "huge-page.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+// 与 <numaif.h> 中的定义相同，这里不依赖 libnuma
+#define NUMA_MPOL_BIND 2
+#define NUMA_MPOL_F_NODE (1 << 0)
+#define NUMA_MPOL_F_ADDR (1 << 1)
+#define NUMA_MAX_NODES 1024
+#endif
+
+static std::string trim(const std::string &text) {
+    size_t begin = 0, end = text.size();
+    while (begin < end && isspace((unsigned char)text[begin])) { ++begin; }
+    while (end > begin && isspace((unsigned char)text[end - 1])) { --end; }
+    return text.substr(begin, end - begin);
+}
+
+#ifdef __linux__
+static bool read_text(const std::string &path, std::string *text) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == nullptr) { return false; }
+    char buffer[4096];
+    size_t n = fread(buffer, 1, sizeof(buffer), f);
+    fclose(f);
+    *text = trim(std::string(buffer, n));
+    return true;
+}
+
+static std::vector<std::string> list_dir(const std::string &path) {
+    std::vector<std::string> names;
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr) { return names; }
+    while (dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') { names.push_back(entry->d_name); }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+#endif
+
+bool parse_cpu_list(const std::string &text, std::vector<int> *cpus) {
+    cpus->clear();
+    std::string list = trim(text);
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t comma = list.find(',', pos);
+        std::string item = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? list.size() : comma + 1;
+
+        // 每一项是 "a-b" 或者 "a"，%c 用来拒绝后面多余的字符
+        int first = 0, last = 0;
+        char tail = 0;
+        int matched = sscanf(item.c_str(), "%d-%d%c", &first, &last, &tail);
+        if (matched == 1 && sscanf(item.c_str(), "%d%c", &first, &tail) == 1) {
+            last = first;
+        } else if (matched != 2) {
+            return false;
+        }
+        if (first < 0 || last < first) { return false; }
+        for (int cpu = first; cpu <= last; ++cpu) { cpus->push_back(cpu); }
+    }
+    return true;
+}
+
+std::string normalize_pci_bus_id(const std::string &bus_id) {
+    std::string id = trim(bus_id);
+    for (auto &c : id) { c = (char)tolower((unsigned char)c); }
+    size_t colons = std::count(id.begin(), id.end(), ':');
+    if (colons == 1) { return "0000:" + id; }
+
+    // nvidia-smi 的 domain 是 8 位（00000000:3b:00.0），sysfs 中是 4 位
+    size_t first = id.find(':');
+    if (colons == 2 && first > 4) {
+        std::string domain = id.substr(0, first);
+        if (domain.find_first_not_of('0') >= first - 4) { id = id.substr(first - 4); }
+    }
+    return id;
+}
+
+NumaTopology NumaTopology::discover(const std::string &sysfs_root) {
+    NumaTopology topology;
+#ifdef __linux__
+    std::string node_root = sysfs_root + "/devices/system/node";
+    for (auto &name : list_dir(node_root)) {
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 || !isdigit((unsigned char)name[4])) { continue; }
+        NumaNode node;
+        node.id = atoi(name.c_str() + 4);
+        std::string cpulist;
+        if (!read_text(node_root + "/" + name + "/cpulist", &cpulist) || !parse_cpu_list(cpulist, &node.cpus)) { continue; }
+        topology.nodes_.push_back(node);
+    }
+    std::sort(topology.nodes_.begin(), topology.nodes_.end(), [](const NumaNode &a, const NumaNode &b) { return a.id < b.id; });
+
+    std::string pci_root = sysfs_root + "/bus/pci/devices";
+    for (auto &name : list_dir(pci_root)) {
+        std::string cls, vendor, numa_node;
+        if (!read_text(pci_root + "/" + name + "/class", &cls)) { continue; }
+        read_text(pci_root + "/" + name + "/vendor", &vendor);
+        unsigned long class_code = strtoul(cls.c_str(), nullptr, 16);
+        unsigned long vendor_id = strtoul(vendor.c_str(), nullptr, 16);
+
+        PciDeviceInfo device;
+        // 只关心 NVIDIA 的显示/3D 控制器（BMC 的 VGA 也是 0x03）和网卡
+        if ((class_code >> 16) == 0x03 && vendor_id == 0x10de) {
+            device.kind = "gpu";
+        } else if ((class_code >> 16) == 0x02) {
+            device.kind = "nic";
+        } else {
+            continue;
+        }
+        device.bus_id = normalize_pci_bus_id(name);
+        if (read_text(pci_root + "/" + name + "/numa_node", &numa_node)) { device.numa_node = atoi(numa_node.c_str()); }
+        topology.devices_.push_back(device);
+    }
+
+    // /sys/class/net/<name>/device 是指向 PCI 设备目录的链接，虚拟网卡（lo、docker0）没有
+    std::string net_root = sysfs_root + "/class/net";
+    for (auto &name : list_dir(net_root)) {
+        char target[1024];
+        ssize_t n = readlink((net_root + "/" + name + "/device").c_str(), target, sizeof(target) - 1);
+        if (n <= 0) { continue; }
+        target[n] = 0;
+        const char *base = strrchr(target, '/');
+        std::string bus_id = normalize_pci_bus_id(base ? base + 1 : target);
+        for (auto &device : topology.devices_) {
+            if (device.bus_id == bus_id && device.net_name.empty()) { device.net_name = name; }
+        }
+    }
+#endif
+
+    if (topology.nodes_.empty()) {
+        NumaNode node;
+        int count = (int)std::max(1u, std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < count; ++cpu) { node.cpus.push_back(cpu); }
+        topology.nodes_.push_back(node);
+    }
+    return topology;
+}
+
+const NumaTopology &NumaTopology::system() {
+    static NumaTopology topology = discover();
+    return topology;
+}
+
+const NumaNode *NumaTopology::node(int id) const {
+    for (auto &node : nodes_) {
+        if (node.id == id) { return &node; }
+    }
+    return nullptr;
+}
+
+int NumaTopology::node_of_cpu(int cpu) const {
+    for (auto &node : nodes_) {
+        if (std::find(node.cpus.begin(), node.cpus.end(), cpu) != node.cpus.end()) { return node.id; }
+    }
+    return -1;
+}
+
+int NumaTopology::node_of_pci(const std::string &bus_id) const {
+    std::string id = normalize_pci_bus_id(bus_id);
+    for (auto &device : devices_) {
+        if (device.bus_id == id) { return device.numa_node; }
+    }
+    return -1;
+}
+
+int NumaTopology::node_of_nic(const std::string &net_name) const {
+    for (auto &device : devices_) {
+        if (device.net_name == net_name) { return device.numa_node; }
+    }
+    return -1;
+}
+
+int NumaTopology::node_of_gpu(int device) const {
+    char bus_id[64] = {0};
+    if (cudaDeviceGetPCIBusId(bus_id, sizeof(bus_id), device) != cudaSuccess) {
+        cudaGetLastError();
+        return -1;
+    }
+    return node_of_pci(bus_id);
+}
+
+bool pin_current_thread_to_node(const NumaTopology &topology, int node_id) {
+#ifdef __linux__
+    const NumaNode *node = topology.node(node_id);
+    if (node == nullptr || node->cpus.empty()) { return false; }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : node->cpus) {
+        if (cpu < CPU_SETSIZE) { CPU_SET(cpu, &set); }
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+/* ------------------------------------------ 锁页内存 ------------------------------------------ */
+
+namespace {
+struct NumaAllocation {
+    size_t bytes = 0;    // huge_page_alloc 映射的长度
+    bool mapped = false; // false 表示由 cudaMallocHost 分配
+};
+
+std::mutex allocations_lock;
+std::unordered_map<void *, NumaAllocation> allocations;
+} // namespace
+
+#ifdef __linux__
+static bool bind_to_node(void *ptr, size_t bytes, int node) {
+    if (node < 0 || node >= NUMA_MAX_NODES) { return false; }
+    unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+    mask[node / (8 * sizeof(unsigned long))] = 1ul << (node % (8 * sizeof(unsigned long)));
+    return syscall(SYS_mbind, ptr, bytes, NUMA_MPOL_BIND, mask, NUMA_MAX_NODES + 1, 0) == 0;
+}
+
+// 逐页写一次，让内核在写入线程所在的节点上分配物理页
+static void touch_pages(void *ptr, size_t bytes) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    volatile char *p = (volatile char *)ptr;
+    for (size_t offset = 0; offset < bytes; offset += page) { p[offset] = 0; }
+}
+#endif
+
+cudaError_t numa_malloc_host(void **ptr, size_t bytes, int node) {
+    *ptr = nullptr;
+    const NumaTopology &topology = NumaTopology::system();
+    if (node == NUMA_NODE_AUTO) {
+        int device = 0;
+        node = cudaGetDevice(&device) == cudaSuccess ? topology.node_of_gpu(device) : -1;
+    }
+
+#ifdef __linux__
+    // 需要绑定节点，或者大到值得用大页时自己映射；否则（小的缓冲区、单节点）与 cudaMallocHost 没有区别
+    bool bind = topology.is_numa() && topology.node(node) != nullptr;
+    if (bind || (huge_page_size() > 0 && bytes >= huge_page_size())) {
+        // 只为绑定节点而映射的小缓冲区用普通页，不值得占用一个大页
+        size_t length = 0;
+        HugePageMode mode = huge_page_size() > 0 && bytes >= huge_page_size() ? HugePageMode::Auto : HugePageMode::Off;
+        void *mem = huge_page_alloc(bytes, mode, nullptr, &length);
+        if (mem == nullptr) { return cudaErrorMemoryAllocation; }
+
+        if (!bind || bind_to_node(mem, length, node)) {
+            touch_pages(mem, length);
+        } else {
+            // mbind 被禁止时用 first-touch：由绑定到目标节点的线程完成第一次写入
+            std::thread toucher([&]() {
+                pin_current_thread_to_node(topology, node);
+                touch_pages(mem, length);
+            });
+            toucher.join();
+        }
+
+        cudaError_t error = cudaHostRegister(mem, length, cudaHostRegisterPortable);
+        if (error != cudaSuccess) {
+            huge_page_free(mem, length);
+            return error;
+        }
+        std::lock_guard<std::mutex> lock(allocations_lock);
+        NumaAllocation allocation;
+        allocation.bytes = length;
+        allocation.mapped = true;
+        allocations[mem] = allocation;
+        *ptr = mem;
+        return cudaSuccess;
+    }
+#endif
+
+    cudaError_t error = cudaMallocHost(ptr, bytes);
+    if (error == cudaSuccess) {
+        std::lock_guard<std::mutex> lock(allocations_lock);
+        allocations[*ptr] = NumaAllocation();
+    }
+    return error;
+}
+
+cudaError_t numa_free_host(void *ptr) {
+    if (ptr == nullptr) { return cudaSuccess; }
+    NumaAllocation allocation;
+    {
+        std::lock_guard<std::mutex> lock(allocations_lock);
+        auto it = allocations.find(ptr);
+        if (it == allocations.end()) { return cudaErrorInvalidValue; }
+        allocation = it->second;
+        allocations.erase(it);
+    }
+
+#ifdef __linux__
+    if (allocation.mapped) {
+        cudaError_t error = cudaHostUnregister(ptr);
+        huge_page_free(ptr, allocation.bytes);
+        return error;
+    }
+#endif
+    return cudaFreeHost(ptr);
+}
+
+int numa_node_of_address(const void *ptr) {
+#ifdef __linux__
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0, ptr, NUMA_MPOL_F_NODE | NUMA_MPOL_F_ADDR) == 0) { return node; }
+#endif
+    return -1;
+}
@@ -0,0 +1,83 @@
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <cuda_runtime.h>
+
+/*
+ * 双路服务器上，cudaMallocHost 的锁页内存和 CPU 工作线程可能落在离 GPU 较远的 NUMA 节点，
+ * H2D/D2H 要多跨一次 CPU 之间的互联，预处理线程访问远端内存也更慢。
+ * 这里从 sysfs 读取拓扑（不依赖 libnuma）：
+ *   /sys/devices/system/node/node<N>/cpulist         节点的 CPU
+ *   /sys/bus/pci/devices/<bus id>/{class,vendor,numa_node}   GPU（class 0x03xxxx）、网卡（class 0x02xxxx）所在的节点
+ *   /sys/class/net/<name>/device                     网卡名到 PCI 设备
+ * 根目录可以指定，测试时指向一个假的 sysfs 目录树。非 Linux 系统上只有一个节点。
+ */
+
+struct NumaNode {
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+struct PciDeviceInfo {
+    std::string bus_id; // 小写，例如 0000:3b:00.0
+    std::string kind;   // "gpu"、"nic"
+    std::string net_name; // 网卡的接口名，没有时为空
+    int numa_node = -1;   // sysfs 中为 -1（BIOS 没有提供）时保持 -1
+};
+
+class NumaTopology {
+public:
+    // sysfs_root 为 sysfs 的挂载点，读取失败时退化为一个包含所有 CPU 的节点
+    static NumaTopology discover(const std::string &sysfs_root = "/sys");
+    // 当前机器的拓扑，第一次调用时读取
+    static const NumaTopology &system();
+
+    const std::vector<NumaNode> &nodes() const { return nodes_; }
+    const std::vector<PciDeviceInfo> &devices() const { return devices_; }
+    bool is_numa() const { return nodes_.size() > 1; }
+
+    const NumaNode *node(int id) const;
+    int node_of_cpu(int cpu) const;
+    // bus id 不区分大小写，可以省略 domain（"3b:00.0"），找不到或者未知时返回 -1
+    int node_of_pci(const std::string &bus_id) const;
+    int node_of_nic(const std::string &net_name) const;
+    // CUDA 设备所在的节点，通过 cudaDeviceGetPCIBusId 查找
+    int node_of_gpu(int device) const;
+
+private:
+    std::vector<NumaNode> nodes_;
+    std::vector<PciDeviceInfo> devices_;
+};
+
+// 解析 "0-3,8-11" 这样的 CPU 列表，格式错误时返回 false
+bool parse_cpu_list(const std::string &text, std::vector<int> *cpus);
+// 规范化 PCI bus id：小写，补全 domain
+std::string normalize_pci_bus_id(const std::string &bus_id);
+
+// 把当前线程绑定到节点的所有 CPU 上（节点内由系统调度），不支持或者失败时返回 false
+bool pin_current_thread_to_node(const NumaTopology &topology, int node);
+
+/*
+ * NUMA 本地的锁页内存，用法与 cudaMallocHost / cudaFreeHost 相同，可以直接放在 checkRuntime 中。
+ * node 为 NUMA_NODE_AUTO 时取当前 CUDA 设备所在的节点。
+ * Linux 上用 huge_page_alloc 映射（huge-page.h，不小于一个大页时用大页）之后用 mbind 绑定到节点（直接调用系统调用），
+ * mbind 不可用时（容器中常被禁止）由绑定到该节点的线程首次写入（first-touch），最后用 cudaHostRegister 锁页；
+ * 其他系统上退化为 cudaMallocHost。
+ */
+#define NUMA_NODE_AUTO -2
+
+cudaError_t numa_malloc_host(void **ptr, size_t bytes, int node = NUMA_NODE_AUTO);
+cudaError_t numa_free_host(void *ptr);
+
+template <typename T>
+cudaError_t numa_malloc_host(T **ptr, size_t bytes, int node = NUMA_NODE_AUTO) {
+    return numa_malloc_host((void **)ptr, bytes, node);
+}
+
+// numa_malloc_host 分配的内存实际所在的节点（由 get_mempolicy 查询第一页），未知时返回 -1
+int numa_node_of_address(const void *ptr);
+
+#endif // NUMA_TOPOLOGY_H
@@ -0,0 +1,118 @@
+#include "cuda-runtime-api.h"
+
+// 每个线程块一次搬进共享内存的候选框数量，与 nms 的 block 大小一致
+#define OBB_NMS_TILE 256
+
+__global__ void decode_obb_kernel(float *predict, int num_bboxes, int num_classes, float confidence_threshold,
+                                  float *parray, int max_objects, int NUM_BOX_ELEMENT) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= num_bboxes) { return; }
+
+    // 每一行为 [cx, cy, width, height, angle, objectness, class1, class2, ……]
+    float *pitem = predict + (6 + num_classes) * position;
+    float objectness = pitem[5];
+    if (objectness < confidence_threshold) { return; }
+
+    float *class_confidence = pitem + 6;
+    float confidence = *class_confidence++;
+    int label = 0;
+    for (int i = 1; i < num_classes; ++i, ++class_confidence) {
+        if (*class_confidence > confidence) {
+            confidence = *class_confidence;
+            label = i;
+        }
+    }
+    confidence *= objectness;
+    if (confidence < confidence_threshold) { return; }
+
+    int index = atomicAdd(parray, 1);
+    if (index >= max_objects) { return; }
+
+    // cx, cy, width, height, angle, confidence, class, keepflag
+    float *pout_item = parray + 1 + index * NUM_BOX_ELEMENT;
+    *pout_item++ = pitem[0];
+    *pout_item++ = pitem[1];
+    *pout_item++ = pitem[2];
+    *pout_item++ = pitem[3];
+    *pout_item++ = pitem[4];
+    *pout_item++ = confidence;
+    *pout_item++ = label;
+    *pout_item++ = 1; // 1 = keep, 0 = ignore
+}
+
+/*
+ * 与 fast_nms_kernel 相同的思路：每个线程负责一个框，只要存在同类别、置信度更高且 IoU 超过阈值的框就把自己标记为删除。
+ * 区别在于旋转框的 IoU 计算量大得多，所以：
+ *   1. 候选框按 tile 搬进共享内存，整个 block 共用，减少重复的全局内存读取；
+ *   2. 每个框的外接矩形在搬运时算好，先用外接矩形排除不相交的框，只有少数框对需要做多边形裁剪。
+ * 因为要配合 __syncthreads，已经被删除的线程不能提前 return，只是不再做计算。
+ */
+__global__ void fast_nms_obb_kernel(float *bboxes, int max_objects, float threshold, int NUM_BOX_ELEMENT) {
+    __shared__ float tile_box[OBB_NMS_TILE][5];
+    __shared__ float tile_aabb[OBB_NMS_TILE][4];
+    __shared__ float tile_score[OBB_NMS_TILE];
+    __shared__ int tile_label[OBB_NMS_TILE];
+
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    int count = min((int)*bboxes, max_objects);
+
+    bool active = position < count;
+    float *pcurrent = bboxes + 1 + position * NUM_BOX_ELEMENT;
+    float current[5] = {0, 0, 0, 0, 0};
+    float current_score = 0, cl = 0, ct = 0, cr = 0, cb = 0;
+    int current_label = -1;
+    if (active) {
+        for (int k = 0; k < 5; ++k) { current[k] = pcurrent[k]; }
+        current_score = pcurrent[5];
+        current_label = (int)pcurrent[6];
+        rotated_box_aabb(current[0], current[1], current[2], current[3], current[4], &cl, &ct, &cr, &cb);
+    }
+
+    for (int base = 0; base < count; base += OBB_NMS_TILE) {
+        int load = base + threadIdx.x;
+        if (threadIdx.x < OBB_NMS_TILE && load < count) {
+            float *pitem = bboxes + 1 + load * NUM_BOX_ELEMENT;
+            for (int k = 0; k < 5; ++k) { tile_box[threadIdx.x][k] = pitem[k]; }
+            tile_score[threadIdx.x] = pitem[5];
+            tile_label[threadIdx.x] = (int)pitem[6];
+            rotated_box_aabb(pitem[0], pitem[1], pitem[2], pitem[3], pitem[4],
+                             &tile_aabb[threadIdx.x][0], &tile_aabb[threadIdx.x][1],
+                             &tile_aabb[threadIdx.x][2], &tile_aabb[threadIdx.x][3]);
+        }
+        __syncthreads();
+
+        int tile_size = min(OBB_NMS_TILE, count - base);
+        for (int t = 0; t < tile_size && active; ++t) {
+            int i = base + t;
+            if (i == position || tile_label[t] != current_label) { continue; }
+            if (tile_score[t] < current_score) { continue; }
+            // 置信度相同时只让下标小的框删除下标大的框，避免两者互相删除
+            if (tile_score[t] == current_score && i > position) { continue; }
+
+            if (tile_aabb[t][0] >= cr || cl >= tile_aabb[t][2] || tile_aabb[t][1] >= cb || ct >= tile_aabb[t][3]) { continue; }
+
+            if (rotated_box_iou_exact(current, tile_box[t]) > threshold) {
+                pcurrent[7] = 0;
+                active = false;
+            }
+        }
+        __syncthreads();
+    }
+}
+
+void decode_obb_kernel_invoker(
+    float *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float nms_threshold, float *parray, int max_objects, int NUM_BOX_ELEMENT, cudaStream_t stream) {
+    auto block = num_bboxes > 512 ? 512 : num_bboxes;
+    auto grid = (num_bboxes + block - 1) / block;
+
+    // [cx, cy, width, height, angle, objectness, class1, class2, ……] ---> [cx, cy, width, height, angle, confidence, label, nms_symbol]
+    decode_obb_kernel<<<grid, block, 0, stream>>>(
+        predict, num_bboxes, num_classes, confidence_threshold,
+        parray, max_objects, NUM_BOX_ELEMENT);
+
+    // nms 的 block 大小必须等于 tile 大小，保证每个线程负责搬运一个框
+    block = OBB_NMS_TILE;
+    grid = (max_objects + block - 1) / block;
+    fast_nms_obb_kernel<<<grid, block, 0, stream>>>(parray, max_objects, nms_threshold, NUM_BOX_ELEMENT);
+}
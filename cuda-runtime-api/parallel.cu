@@ -22,13 +22,9 @@ const int girds = (num_element + blocks - 1) / blocks;
 const int ntry = 1000;
 
 void async() {
-    cudaEvent_t event_start1, event_stop1;
-    cudaEvent_t event_start2, event_stop2;
-    // 创建事件
-    checkRuntime(cudaEventCreate(&event_start1));
-    checkRuntime(cudaEventCreate(&event_stop1));
-    checkRuntime(cudaEventCreate(&event_start2));
-    checkRuntime(cudaEventCreate(&event_stop2));
+    // 从池中借出计时用的事件，函数返回时自动归还，重复调用不会每次创建、也不会泄漏
+    PooledEvent event_start1 = EventPool::global().acquire(true), event_stop1 = EventPool::global().acquire(true);
+    PooledEvent event_start2 = EventPool::global().acquire(true), event_stop2 = EventPool::global().acquire(true);
 
     auto tic = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
     // 记录事件开始时间，在 stream1 中加入 event_start1
@@ -58,9 +54,7 @@ void async() {
 }
 
 void sync() {
-    cudaEvent_t event_start1, event_stop1;
-    checkRuntime(cudaEventCreate(&event_start1));
-    checkRuntime(cudaEventCreate(&event_stop1));
+    PooledEvent event_start1 = EventPool::global().acquire(true), event_stop1 = EventPool::global().acquire(true);
 
     auto tic = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
     checkRuntime(cudaEventRecord(event_start1, stream1));
@@ -97,8 +91,8 @@ void multi_stream_async() {
      * step3 需要 stepa 的输出：通过 cudaStreamWaitEvent，确保 step3 的执行是在 stepa 完成之后。stream1 在等待 event_async 事件之前会暂停，直到 stepa 完成并触发事件 event_async。
      */
 
-    cudaEvent_t event_async;
-    checkRuntime(cudaEventCreate(&event_async));
+    // 只用于流之间的同步，不需要计时
+    PooledEvent event_async = EventPool::global().acquire();
 
     // 依次执行 step1 --> step2
     step1<<<girds, blocks, 0, stream1>>>(a, b, c1, num_element);
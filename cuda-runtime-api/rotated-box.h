@@ -0,0 +1,144 @@
+#ifndef ROTATED_BOX_H
+#define ROTATED_BOX_H
+
+#include <math.h>
+
+/*
+ * 旋转框（OBB, oriented bounding box）的几何计算。
+ * 这些函数同时被 CPU 和 GPU 代码使用，nvcc 编译时加上 __host__ __device__，普通的 C++ 编译器编译时为空。
+ */
+#ifdef __CUDACC__
+#define OBB_HOST_DEVICE __host__ __device__
+#else
+#define OBB_HOST_DEVICE
+#endif
+
+// 裁剪过程中多边形的最大顶点数：四边形被 4 条边各裁一次，每次最多增加 1 个顶点
+#define OBB_MAX_POLYGON 16
+
+struct RotatedBox {
+    float cx, cy, width, height, angle, confidence; // angle 为弧度，绕中心顺时针（图像坐标系 y 轴向下）
+    int label;
+
+    RotatedBox() = default;
+    RotatedBox(float cx, float cy, float width, float height, float angle, float confidence, int label) :
+        cx(cx), cy(cy), width(width), height(height), angle(angle), confidence(confidence), label(label) {
+    }
+};
+
+// 旋转框的 4 个角点，pts = [x0, y0, x1, y1, x2, y2, x3, y3]
+OBB_HOST_DEVICE inline void rotated_box_corners(float cx, float cy, float width, float height, float angle, float *pts) {
+    float c = cosf(angle);
+    float s = sinf(angle);
+    float hw = width * 0.5f;
+    float hh = height * 0.5f;
+    const float dx[4] = {-hw, hw, hw, -hw};
+    const float dy[4] = {-hh, -hh, hh, hh};
+    for (int i = 0; i < 4; ++i) {
+        pts[2 * i + 0] = cx + dx[i] * c - dy[i] * s;
+        pts[2 * i + 1] = cy + dx[i] * s + dy[i] * c;
+    }
+}
+
+// 旋转框的轴对齐外接矩形，用于快速排除不可能相交的框
+OBB_HOST_DEVICE inline void rotated_box_aabb(float cx, float cy, float width, float height, float angle,
+                                             float *left, float *top, float *right, float *bottom) {
+    float c = fabsf(cosf(angle));
+    float s = fabsf(sinf(angle));
+    float hw = (width * c + height * s) * 0.5f;
+    float hh = (width * s + height * c) * 0.5f;
+    *left = cx - hw;
+    *top = cy - hh;
+    *right = cx + hw;
+    *bottom = cy + hh;
+}
+
+// 鞋带公式计算多边形的有向面积，顶点顺序相反时符号相反
+OBB_HOST_DEVICE inline float polygon_signed_area(const float *pts, int n) {
+    float area = 0;
+    for (int i = 0; i < n; ++i) {
+        int j = (i + 1) % n;
+        area += pts[2 * i] * pts[2 * j + 1] - pts[2 * j] * pts[2 * i + 1];
+    }
+    return area * 0.5f;
+}
+
+/*
+ * Sutherland–Hodgman 裁剪：用直线 (ax, ay) -> (bx, by) 裁剪凸多边形，保留 orientation * cross >= 0 的一侧。
+ * 返回裁剪后的顶点数。
+ */
+OBB_HOST_DEVICE inline int clip_polygon(const float *poly, int n, float ax, float ay, float bx, float by,
+                                        float orientation, float *out) {
+    int count = 0;
+    float ex = bx - ax;
+    float ey = by - ay;
+    for (int i = 0; i < n; ++i) {
+        int j = (i + 1) % n;
+        float px = poly[2 * i], py = poly[2 * i + 1];
+        float qx = poly[2 * j], qy = poly[2 * j + 1];
+        float side_p = orientation * (ex * (py - ay) - ey * (px - ax));
+        float side_q = orientation * (ex * (qy - ay) - ey * (qx - ax));
+
+        if (side_p >= 0) {
+            out[2 * count] = px;
+            out[2 * count + 1] = py;
+            count++;
+        }
+        // p、q 位于直线两侧，加入交点
+        if ((side_p >= 0) != (side_q >= 0)) {
+            float t = side_p / (side_p - side_q);
+            out[2 * count] = px + t * (qx - px);
+            out[2 * count + 1] = py + t * (qy - py);
+            count++;
+        }
+        if (count >= OBB_MAX_POLYGON) { break; }
+    }
+    return count;
+}
+
+// 两个旋转框的交集面积：用 b 的 4 条边依次裁剪 a 的多边形
+OBB_HOST_DEVICE inline float rotated_box_intersection(const float *a_pts, const float *b_pts) {
+    float buffer0[2 * OBB_MAX_POLYGON];
+    float buffer1[2 * OBB_MAX_POLYGON];
+    for (int i = 0; i < 8; ++i) { buffer0[i] = a_pts[i]; }
+
+    float orientation = polygon_signed_area(b_pts, 4) >= 0 ? 1.0f : -1.0f;
+    float *src = buffer0;
+    float *dst = buffer1;
+    int n = 4;
+    for (int e = 0; e < 4 && n > 0; ++e) {
+        int f = (e + 1) % 4;
+        n = clip_polygon(src, n, b_pts[2 * e], b_pts[2 * e + 1], b_pts[2 * f], b_pts[2 * f + 1], orientation, dst);
+        float *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (n < 3) { return 0.0f; }
+    return fabsf(polygon_signed_area(src, n));
+}
+
+// a、b 为 [cx, cy, w, h, angle]，不做外接矩形预检查，调用方已经筛选过时使用
+OBB_HOST_DEVICE inline float rotated_box_iou_exact(const float *a, const float *b) {
+    float a_pts[8], b_pts[8];
+    rotated_box_corners(a[0], a[1], a[2], a[3], a[4], a_pts);
+    rotated_box_corners(b[0], b[1], b[2], b[3], b[4], b_pts);
+    float inter = rotated_box_intersection(a_pts, b_pts);
+    if (inter <= 0.0f) { return 0.0f; }
+
+    float a_area = a[2] * a[3];
+    float b_area = b[2] * b[3];
+    float uni = a_area + b_area - inter;
+    return uni > 0.0f ? inter / uni : 0.0f;
+}
+
+// a、b 为 [cx, cy, w, h, angle]
+OBB_HOST_DEVICE inline float rotated_box_iou(const float *a, const float *b) {
+    // 外接矩形不相交时交集一定为 0，绝大多数框对在这里就返回了
+    float al, at, ar, ab, bl, bt, br, bb;
+    rotated_box_aabb(a[0], a[1], a[2], a[3], a[4], &al, &at, &ar, &ab);
+    rotated_box_aabb(b[0], b[1], b[2], b[3], b[4], &bl, &bt, &br, &bb);
+    if (al >= br || bl >= ar || at >= bb || bt >= ab) { return 0.0f; }
+    return rotated_box_iou_exact(a, b);
+}
+
+#endif // ROTATED_BOX_H
@@ -0,0 +1,97 @@
+#include "cuda-runtime-api.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SEMSEG_USE_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SEMSEG_USE_NEON 1
+#endif
+
+// vrow[w] = hy * row0[w] + ly * row1[w]，先在纵向插值出一行
+static void blend_rows(const float *row0, const float *row1, float hy, float ly, float *vrow, int width) {
+    int w = 0;
+#if defined(SEMSEG_USE_SSE2)
+    __m128 vhy = _mm_set1_ps(hy), vly = _mm_set1_ps(ly);
+    for (; w + 4 <= width; w += 4) {
+        _mm_storeu_ps(vrow + w, _mm_add_ps(_mm_mul_ps(vhy, _mm_loadu_ps(row0 + w)), _mm_mul_ps(vly, _mm_loadu_ps(row1 + w))));
+    }
+#elif defined(SEMSEG_USE_NEON)
+    float32x4_t vhy = vdupq_n_f32(hy), vly = vdupq_n_f32(ly);
+    for (; w + 4 <= width; w += 4) {
+        vst1q_f32(vrow + w, vaddq_f32(vmulq_f32(vhy, vld1q_f32(row0 + w)), vmulq_f32(vly, vld1q_f32(row1 + w))));
+    }
+#endif
+    for (; w < width; ++w) { vrow[w] = hy * row0[w] + ly * row1[w]; }
+}
+
+// value > best 的位置更新 best 和 label，label 用 int32 存放，与 float 的 lane 对齐
+static void update_argmax(const float *value, float *best, int32_t *label, int c, int width) {
+    int x = 0;
+#if defined(SEMSEG_USE_SSE2)
+    __m128i vc = _mm_set1_epi32(c);
+    for (; x + 4 <= width; x += 4) {
+        __m128 v = _mm_loadu_ps(value + x);
+        __m128 b = _mm_loadu_ps(best + x);
+        __m128i greater = _mm_castps_si128(_mm_cmpgt_ps(v, b));
+        __m128i l = _mm_loadu_si128((const __m128i *)(label + x));
+        _mm_storeu_ps(best + x, _mm_max_ps(v, b));
+        _mm_storeu_si128((__m128i *)(label + x), _mm_or_si128(_mm_and_si128(greater, vc), _mm_andnot_si128(greater, l)));
+    }
+#elif defined(SEMSEG_USE_NEON)
+    int32x4_t vc = vdupq_n_s32(c);
+    for (; x + 4 <= width; x += 4) {
+        float32x4_t v = vld1q_f32(value + x);
+        float32x4_t b = vld1q_f32(best + x);
+        uint32x4_t greater = vcgtq_f32(v, b);
+        vst1q_f32(best + x, vbslq_f32(greater, v, b));
+        vst1q_s32(label + x, vbslq_s32(greater, vc, vld1q_s32(label + x)));
+    }
+#endif
+    for (; x < width; ++x) {
+        if (value[x] > best[x]) {
+            best[x] = value[x];
+            label[x] = c;
+        }
+    }
+}
+
+void cpu_semantic_argmax(const float *logits, const SemanticSegParams &params, uint8_t *labels, int num_threads) {
+    const int width = params.image_width, height = params.image_height;
+    const int lw = params.logit_width, lh = params.logit_height;
+    const float *i2d = params.affine.i2d;
+    float scale_x = lw / (float)params.input_width;
+    float scale_y = lh / (float)params.input_height;
+
+    // 每一列的横向插值位置只算一次
+    std::vector<int> x0(width), x1(width);
+    std::vector<float> lx(width), hx(width);
+    for (int x = 0; x < width; ++x) {
+        semantic_axis(i2d[0], i2d[2], x, scale_x, lw, &x0[x], &x1[x], &lx[x]);
+        hx[x] = 1 - lx[x];
+    }
+
+    parallel_for(0, height, [&](int64_t begin, int64_t end) {
+        std::vector<float> vrow(lw), value(width), best(width);
+        std::vector<int32_t> label(width);
+        for (int y = (int)begin; y < (int)end; ++y) {
+            int y0, y1;
+            float ly;
+            semantic_axis(i2d[4], i2d[5], y, scale_y, lh, &y0, &y1, &ly);
+            float hy = 1 - ly;
+            for (int c = 0; c < params.num_classes; ++c) {
+                const float *plane = logits + (size_t)c * lw * lh;
+                blend_rows(plane + y0 * lw, plane + y1 * lw, hy, ly, vrow.data(), lw);
+                float *pvalue = c == 0 ? best.data() : value.data();
+                for (int x = 0; x < width; ++x) { pvalue[x] = hx[x] * vrow[x0[x]] + lx[x] * vrow[x1[x]]; }
+                if (c == 0) {
+                    std::fill(label.begin(), label.end(), 0);
+                } else {
+                    update_argmax(value.data(), best.data(), label.data(), c, width);
+                }
+            }
+            uint8_t *prow = labels + (size_t)y * width;
+            for (int x = 0; x < width; ++x) { prow[x] = (uint8_t)label[x]; }
+        }
+    }, 8, num_threads);
+}
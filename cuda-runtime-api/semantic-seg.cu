@@ -0,0 +1,63 @@
+#include "cuda-runtime-api.h"
+
+/*
+ * 每个线程处理原图的一个像素：对每个类别在 logits 上双线性插值，保留最大值的类别。
+ * 插值顺序与 CPU 版本相同：先纵向插值出两列的值，再横向插值。
+ * logits 按 [C, H, W] 存放，相邻线程读相邻的位置，访存是合并的。
+ * T 为 float、__half 或 int8_t，读出后转成 float 计算。
+ */
+template <typename T>
+__global__ void semantic_argmax_kernel(const T *logits, int num_classes, int logit_width, int logit_height,
+                                       int image_width, int image_height, AffineMatrix affine,
+                                       float scale_x, float scale_y, uint8_t *labels) {
+    int dx = blockDim.x * blockIdx.x + threadIdx.x;
+    int dy = blockDim.y * blockIdx.y + threadIdx.y;
+    if (dx >= image_width || dy >= image_height) { return; }
+
+    int x0, x1, y0, y1;
+    float lx, ly;
+    semantic_axis(affine.i2d[0], affine.i2d[2], dx, scale_x, logit_width, &x0, &x1, &lx);
+    semantic_axis(affine.i2d[4], affine.i2d[5], dy, scale_y, logit_height, &y0, &y1, &ly);
+    float hx = 1 - lx, hy = 1 - ly;
+
+    int plane_size = logit_width * logit_height;
+    const T *p00 = logits + y0 * logit_width + x0;
+    const T *p01 = logits + y0 * logit_width + x1;
+    const T *p10 = logits + y1 * logit_width + x0;
+    const T *p11 = logits + y1 * logit_width + x1;
+
+    float best = 0;
+    int label = 0;
+    for (int c = 0; c < num_classes; ++c) {
+        int offset = c * plane_size;
+        float v0 = hy * load_as_float(p00[offset]) + ly * load_as_float(p10[offset]);
+        float v1 = hy * load_as_float(p01[offset]) + ly * load_as_float(p11[offset]);
+        float value = hx * v0 + lx * v1;
+        if (c == 0 || value > best) {
+            best = value;
+            label = c;
+        }
+    }
+    labels[dy * image_width + dx] = label;
+}
+
+template <typename T>
+static void launch_semantic_argmax(const T *logits, const SemanticSegParams &params, uint8_t *labels, cudaStream_t stream) {
+    dim3 block(32, 8);
+    dim3 grid((params.image_width + block.x - 1) / block.x, (params.image_height + block.y - 1) / block.y);
+    semantic_argmax_kernel<<<grid, block, 0, stream>>>(
+        logits, params.num_classes, params.logit_width, params.logit_height, params.image_width, params.image_height,
+        params.affine, params.logit_width / (float)params.input_width, params.logit_height / (float)params.input_height, labels);
+}
+
+void semantic_argmax_invoker(const float *logits, const SemanticSegParams &params, uint8_t *labels, cudaStream_t stream) {
+    launch_semantic_argmax(logits, params, labels, stream);
+}
+
+void semantic_argmax_invoker(const __half *logits, const SemanticSegParams &params, uint8_t *labels, cudaStream_t stream) {
+    launch_semantic_argmax(logits, params, labels, stream);
+}
+
+void semantic_argmax_invoker(const int8_t *logits, const SemanticSegParams &params, uint8_t *labels, cudaStream_t stream) {
+    launch_semantic_argmax(logits, params, labels, stream);
+}
@@ -0,0 +1,56 @@
+#ifndef SEMANTIC_SEG_H
+#define SEMANTIC_SEG_H
+
+#include <stdint.h>
+#include <cuda_fp16.h>
+#include "affine-matrix.h"
+
+/*
+ * 语义分割输出的后处理：网络输出 [C, H, W] 的 logits，H、W 可以小于网络输入（下采样的 stride）。
+ * 对原图的每个像素，用 i2d 映射到网络输入坐标，再映射到 logits 坐标，对每个类别双线性插值后取 argmax，
+ * 得到原图分辨率的 uint8 类别图。GPU 版本在设备端完成，只需要拷回 image_width * image_height 字节。
+ *
+ * AffineMatrix::compute 生成的 letterbox 变换只有缩放和平移，x、y 两个方向互相独立，
+ * 所以每一列、每一行的插值位置可以分别计算，CPU 版本按行复用。
+ */
+#ifdef __CUDACC__
+#define SEMSEG_HOST_DEVICE __host__ __device__
+#else
+#define SEMSEG_HOST_DEVICE
+#endif
+
+struct SemanticSegParams {
+    int num_classes = 21;                      // 不超过 256
+    int logit_width = 160, logit_height = 160; // logits 的空间尺寸
+    int input_width = 640, input_height = 640; // 网络输入尺寸
+    int image_width = 0, image_height = 0;     // 原图尺寸，也就是输出类别图的尺寸
+    AffineMatrix affine;                       // compute(原图尺寸, 网络输入尺寸)
+};
+
+/*
+ * 原图坐标 pos 在一个方向上对应的两个 logits 下标和插值权重，scale、offset 为 i2d 在这个方向上的缩放和平移，
+ * logit_scale 为 logits 尺寸 / 网络输入尺寸。CPU 和 GPU 共用，保证两边的采样位置一致。
+ */
+inline SEMSEG_HOST_DEVICE void semantic_axis(float scale, float offset, int pos, float logit_scale, int size,
+                                             int *i0, int *i1, float *weight) {
+    float p = (scale * pos + offset + 0.5f) * logit_scale - 0.5f;
+    p = p < 0 ? 0 : (p > size - 1 ? size - 1 : p);
+    *i0 = (int)p;
+    *i1 = *i0 + 1 < size ? *i0 + 1 : *i0;
+    *weight = p - *i0;
+}
+
+/*
+ * logits 相同时取编号小的类别，与 std::max_element 一致。
+ * labels 为 image_height * image_width 的类别图，num_threads <= 0 时使用全部核心。
+ */
+void cpu_semantic_argmax(const float *logits, const SemanticSegParams &params, uint8_t *labels, int num_threads = 0);
+
+// logits、labels 都在设备端
+void semantic_argmax_invoker(const float *logits, const SemanticSegParams &params, uint8_t *labels, cudaStream_t stream);
+
+// FP16 / INT8 输出的 logits 直接在设备端读取，int8 的 scale 为正数，不影响插值后的 argmax，不需要传入
+void semantic_argmax_invoker(const __half *logits, const SemanticSegParams &params, uint8_t *labels, cudaStream_t stream);
+void semantic_argmax_invoker(const int8_t *logits, const SemanticSegParams &params, uint8_t *labels, cudaStream_t stream);
+
+#endif // SEMANTIC_SEG_H
@@ -0,0 +1,134 @@
+#include "soft-nms.h"
+#include <algorithm>
+
+static inline float box_iou(const Box &a, const Box &b) {
+    float cross_left = std::max(a.left, b.left);
+    float cross_top = std::max(a.top, b.top);
+    float cross_right = std::min(a.right, b.right);
+    float cross_bottom = std::min(a.bottom, b.bottom);
+    if (cross_right <= cross_left || cross_bottom <= cross_top) { return 0.0f; }
+    float cross_area = (cross_right - cross_left) * (cross_bottom - cross_top);
+    float union_area = (a.right - a.left) * (a.bottom - a.top) + (b.right - b.left) * (b.bottom - b.top) - cross_area;
+    return union_area > 0 ? cross_area / union_area : 0.0f;
+}
+
+std::vector<Box> soft_nms(const std::vector<Box> &boxes, const SoftNMSConfig &config) {
+    struct Entry {
+        float score;
+        int index;
+        int applied; // 已经应用过的同类别选中框数量
+    };
+    // 置信度相同时下标小的优先，保证结果确定
+    auto less = [](const Entry &a, const Entry &b) { return a.score < b.score || (a.score == b.score && a.index > b.index); };
+
+    int max_label = 0;
+    std::vector<Entry> heap;
+    heap.reserve(boxes.size());
+    for (int i = 0; i < (int)boxes.size(); ++i) {
+        if (boxes[i].confidence < config.score_threshold) { continue; }
+        heap.push_back({boxes[i].confidence, i, 0});
+        max_label = std::max(max_label, boxes[i].label);
+    }
+    std::make_heap(heap.begin(), heap.end(), less);
+
+    // 按类别记录已经选中的框，衰减只发生在同类别之间
+    std::vector<std::vector<int>> selected(max_label + 1);
+    std::vector<Box> box_result;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), less);
+        Entry entry = heap.back();
+        heap.pop_back();
+        // 堆顶是所有剩余框置信度的上界，低于阈值时提前结束
+        if (entry.score < config.score_threshold) { break; }
+
+        const Box &box = boxes[entry.index];
+        auto &same_label = selected[box.label];
+        for (int k = entry.applied; k < (int)same_label.size() && entry.score >= config.score_threshold; ++k) {
+            float iou = box_iou(box, boxes[same_label[k]]);
+            entry.score *= soft_nms_decay(config.method, iou, config.sigma, config.iou_threshold);
+        }
+        entry.applied = same_label.size();
+        if (entry.score < config.score_threshold) { continue; }
+
+        // 补上衰减之后不再是最大值，放回堆中等待下一次出堆
+        if (!heap.empty() && less(entry, heap.front())) {
+            heap.push_back(entry);
+            std::push_heap(heap.begin(), heap.end(), less);
+            continue;
+        }
+
+        box_result.emplace_back(box.left, box.top, box.right, box.bottom, entry.score, box.label);
+        same_label.push_back(entry.index);
+    }
+    return box_result;
+}
+
+std::vector<Box> weighted_box_fusion(const std::vector<std::vector<Box>> &model_boxes,
+                                     const std::vector<float> &weights, const WBFConfig &config) {
+    int num_models = model_boxes.size();
+    float weight_sum = 0;
+    for (int m = 0; m < num_models; ++m) { weight_sum += weights.empty() ? 1.0f : weights[m]; }
+
+    // 所有模型的框放在一起，置信度乘以模型权重
+    std::vector<Box> candidates;
+    int max_label = 0;
+    for (int m = 0; m < num_models; ++m) {
+        float weight = weights.empty() ? 1.0f : weights[m];
+        for (auto &box : model_boxes[m]) {
+            float score = box.confidence * weight;
+            if (score < config.skip_threshold) { continue; }
+            candidates.emplace_back(box.left, box.top, box.right, box.bottom, score, box.label);
+            max_label = std::max(max_label, box.label);
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Box &a, const Box &b) { return a.confidence > b.confidence; });
+
+    struct Cluster {
+        float sum_left = 0, sum_top = 0, sum_right = 0, sum_bottom = 0, sum_confidence = 0;
+        int count = 0;
+        Box fused;
+
+        void add(const Box &box) {
+            sum_left += box.left * box.confidence;
+            sum_top += box.top * box.confidence;
+            sum_right += box.right * box.confidence;
+            sum_bottom += box.bottom * box.confidence;
+            sum_confidence += box.confidence;
+            count++;
+            fused = Box(sum_left / sum_confidence, sum_top / sum_confidence, sum_right / sum_confidence,
+                        sum_bottom / sum_confidence, sum_confidence / count, box.label);
+        }
+    };
+
+    // 每个类别一组聚类，候选框只与同类别的融合框比较
+    std::vector<std::vector<Cluster>> clusters(max_label + 1);
+    for (auto &box : candidates) {
+        auto &same_label = clusters[box.label];
+        int best = -1;
+        float best_iou = config.iou_threshold;
+        for (int k = 0; k < (int)same_label.size(); ++k) {
+            float iou = box_iou(same_label[k].fused, box);
+            if (iou > best_iou) {
+                best_iou = iou;
+                best = k;
+            }
+        }
+        if (best < 0) {
+            same_label.emplace_back();
+            best = same_label.size() - 1;
+        }
+        same_label[best].add(box);
+    }
+
+    std::vector<Box> box_result;
+    for (auto &same_label : clusters) {
+        for (auto &cluster : same_label) {
+            Box box = cluster.fused;
+            // 只被少数模型检测到的框降低置信度
+            box.confidence = box.confidence * std::min(num_models, cluster.count) / weight_sum;
+            box_result.emplace_back(box);
+        }
+    }
+    std::stable_sort(box_result.begin(), box_result.end(), [](const Box &a, const Box &b) { return a.confidence > b.confidence; });
+    return box_result;
+}
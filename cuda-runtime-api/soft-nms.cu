@@ -0,0 +1,239 @@
+#include "cuda-runtime-api.h"
+#include <thrust/execution_policy.h>
+#include <thrust/functional.h>
+#include <thrust/sort.h>
+
+// Soft-NMS 和 WBF 都在单个线程块内完成，块大小固定
+#define SOFT_NMS_BLOCK 512
+
+static __device__ float soft_box_iou(float aleft, float atop, float aright, float abottom,
+                                     float bleft, float btop, float bright, float bbottom) {
+    float cleft = max(aleft, bleft);
+    float ctop = max(atop, btop);
+    float cright = min(aright, bright);
+    float cbottom = min(abottom, bbottom);
+    if (cright <= cleft || cbottom <= ctop) { return 0.0f; }
+    float c_area = (cright - cleft) * (cbottom - ctop);
+    float u_area = (aright - aleft) * (abottom - atop) + (bright - bleft) * (bbottom - btop) - c_area;
+    return u_area > 0 ? c_area / u_area : 0.0f;
+}
+
+// 块内求 (score, index) 的最大值，置信度相同时下标小的优先，结果在 s_score[0]、s_index[0]
+static __device__ void block_argmax(float *s_score, int *s_index, float score, int index) {
+    s_score[threadIdx.x] = score;
+    s_index[threadIdx.x] = index;
+    __syncthreads();
+    for (int stride = blockDim.x / 2; stride > 0; stride >>= 1) {
+        if (threadIdx.x < stride) {
+            float other_score = s_score[threadIdx.x + stride];
+            int other_index = s_index[threadIdx.x + stride];
+            if (other_score > s_score[threadIdx.x] || (other_score == s_score[threadIdx.x] && other_index < s_index[threadIdx.x])) {
+                s_score[threadIdx.x] = other_score;
+                s_index[threadIdx.x] = other_index;
+            }
+        }
+        __syncthreads();
+    }
+}
+
+/*
+ * parray = [count, box1, box2, ……]，box = [left, top, right, bottom, confidence, label, keepflag]
+ * keepflag 复用为状态：1 表示已选中；0 且置信度不低于阈值表示仍在候选中；置信度低于阈值表示已丢弃。
+ */
+__global__ void soft_nms_kernel(float *parray, int max_objects, int NUM_BOX_ELEMENT,
+                                NMSMethod method, float sigma, float iou_threshold, float score_threshold) {
+    __shared__ float s_score[SOFT_NMS_BLOCK];
+    __shared__ int s_index[SOFT_NMS_BLOCK];
+    __shared__ float s_selected[6];
+
+    int count = min((int)*parray, max_objects);
+    float *boxes = parray + 1;
+    for (int i = threadIdx.x; i < count; i += blockDim.x) { boxes[i * NUM_BOX_ELEMENT + 6] = 0; }
+    __syncthreads();
+
+    for (;;) {
+        float best_score = -1;
+        int best_index = count;
+        for (int i = threadIdx.x; i < count; i += blockDim.x) {
+            float *pitem = boxes + i * NUM_BOX_ELEMENT;
+            if (pitem[6] != 0 || pitem[4] < score_threshold) { continue; }
+            if (pitem[4] > best_score) {
+                best_score = pitem[4];
+                best_index = i;
+            }
+        }
+        block_argmax(s_score, s_index, best_score, best_index);
+        if (s_score[0] < score_threshold) { break; }
+
+        if (threadIdx.x == 0) {
+            float *pselected = boxes + s_index[0] * NUM_BOX_ELEMENT;
+            pselected[6] = 1;
+            for (int k = 0; k < 6; ++k) { s_selected[k] = pselected[k]; }
+        }
+        __syncthreads();
+
+        for (int i = threadIdx.x; i < count; i += blockDim.x) {
+            float *pitem = boxes + i * NUM_BOX_ELEMENT;
+            if (pitem[6] != 0 || pitem[4] < score_threshold || pitem[5] != s_selected[5]) { continue; }
+            float iou = soft_box_iou(s_selected[0], s_selected[1], s_selected[2], s_selected[3],
+                                     pitem[0], pitem[1], pitem[2], pitem[3]);
+            pitem[4] *= soft_nms_decay(method, iou, sigma, iou_threshold);
+        }
+        // 下一轮 block_argmax 写共享内存之前，所有线程必须已经读完 s_score[0] 和 s_selected
+        __syncthreads();
+    }
+}
+
+void soft_nms_kernel_invoker(float *parray, int max_objects, int NUM_BOX_ELEMENT,
+                             const SoftNMSConfig &config, cudaStream_t stream) {
+    soft_nms_kernel<<<1, SOFT_NMS_BLOCK, 0, stream>>>(parray, max_objects, NUM_BOX_ELEMENT, config.method,
+                                                      config.sigma, config.iou_threshold, config.score_threshold);
+}
+
+// WBF 的中间数据布局，所有数组都放在调用方提供的 workspace 中
+struct WBFWorkspace {
+    int *count;       // 收集到的候选框数量
+    float *candidate; // [left, top, right, bottom, score, label]
+    float *keys;      // 排序用的置信度，空位为 -1
+    int *order;       // 排序后的候选框下标
+    float *cluster;   // [sum_left, sum_top, sum_right, sum_bottom, sum_confidence, count, label, 0]
+
+    __host__ __device__ static size_t align(size_t size) {
+        return (size + 255) / 256 * 256;
+    }
+
+    WBFWorkspace(void *workspace, int capacity) {
+        char *ptr = (char *)workspace;
+        count = (int *)ptr;
+        ptr += align(sizeof(int));
+        candidate = (float *)ptr;
+        ptr += align(capacity * 6 * sizeof(float));
+        keys = (float *)ptr;
+        ptr += align(capacity * sizeof(float));
+        order = (int *)ptr;
+        ptr += align(capacity * sizeof(int));
+        cluster = (float *)ptr;
+    }
+
+    static size_t size(int capacity) {
+        return align(sizeof(int)) + align(capacity * 6 * sizeof(float)) + align(capacity * sizeof(float))
+               + align(capacity * sizeof(int)) + align(capacity * 8 * sizeof(float));
+    }
+};
+
+size_t weighted_box_fusion_workspace_size(int num_models, int max_objects) {
+    return WBFWorkspace::size(num_models * max_objects);
+}
+
+__global__ void wbf_reset_kernel(float *keys, int *order, int capacity) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= capacity) { return; }
+    keys[position] = -1;
+    order[position] = position;
+}
+
+__global__ void wbf_gather_kernel(const float *parray, int max_objects, int NUM_BOX_ELEMENT, float weight,
+                                  float skip_threshold, int *count, float *candidate, float *keys) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    int num = min((int)*parray, max_objects);
+    if (position >= num) { return; }
+
+    const float *pitem = parray + 1 + position * NUM_BOX_ELEMENT;
+    if (pitem[6] == 0) { return; }
+    float score = pitem[4] * weight;
+    if (score < skip_threshold) { return; }
+
+    int index = atomicAdd(count, 1);
+    float *pout = candidate + index * 6;
+    for (int k = 0; k < 4; ++k) { pout[k] = pitem[k]; }
+    pout[4] = score;
+    pout[5] = pitem[5];
+    keys[index] = score;
+}
+
+/*
+ * 按置信度从高到低依次处理候选框：块内并行地在同类别聚类中找 IoU 最大的一个，
+ * 由 0 号线程把候选框累加进去（或者新建聚类）。聚类之间的依赖决定了这一步只能按顺序进行。
+ */
+__global__ void wbf_cluster_kernel(const int *count, const float *candidate, const int *order, float *cluster,
+                                   float iou_threshold, int num_models, float weight_sum,
+                                   float *output, int max_output, int NUM_BOX_ELEMENT) {
+    __shared__ float s_score[SOFT_NMS_BLOCK];
+    __shared__ int s_index[SOFT_NMS_BLOCK];
+    __shared__ int s_num_clusters;
+
+    int num = *count;
+    if (threadIdx.x == 0) { s_num_clusters = 0; }
+    __syncthreads();
+
+    for (int i = 0; i < num; ++i) {
+        const float *pcand = candidate + order[i] * 6;
+        float best_iou = iou_threshold;
+        int best_index = -1;
+        for (int k = threadIdx.x; k < s_num_clusters; k += blockDim.x) {
+            float *pcluster = cluster + k * 8;
+            if (pcluster[6] != pcand[5]) { continue; }
+            float iou = soft_box_iou(pcluster[0] / pcluster[4], pcluster[1] / pcluster[4], pcluster[2] / pcluster[4],
+                                     pcluster[3] / pcluster[4], pcand[0], pcand[1], pcand[2], pcand[3]);
+            if (iou > best_iou) {
+                best_iou = iou;
+                best_index = k;
+            }
+        }
+        // 没有匹配到聚类的线程提交 -1，IoU 相同时 block_argmax 选下标小（先建立）的聚类，与 CPU 版本一致
+        block_argmax(s_score, s_index, best_index >= 0 ? best_iou : -1.0f, best_index >= 0 ? best_index : 0x7fffffff);
+
+        if (threadIdx.x == 0) {
+            float *pcluster = cluster + s_index[0] * 8;
+            if (s_score[0] <= iou_threshold) {
+                pcluster = cluster + (s_num_clusters++) * 8;
+                for (int e = 0; e < 8; ++e) { pcluster[e] = 0; }
+                pcluster[6] = pcand[5];
+            }
+            float score = pcand[4];
+            for (int e = 0; e < 4; ++e) { pcluster[e] += pcand[e] * score; }
+            pcluster[4] += score;
+            pcluster[5] += 1;
+        }
+        __syncthreads();
+    }
+
+    int num_clusters = min(s_num_clusters, max_output);
+    for (int k = threadIdx.x; k < num_clusters; k += blockDim.x) {
+        float *pcluster = cluster + k * 8;
+        float *pout = output + 1 + k * NUM_BOX_ELEMENT;
+        for (int e = 0; e < 4; ++e) { pout[e] = pcluster[e] / pcluster[4]; }
+        pout[4] = pcluster[4] / pcluster[5] * min((float)num_models, pcluster[5]) / weight_sum;
+        pout[5] = pcluster[6];
+        pout[6] = 1;
+    }
+    if (threadIdx.x == 0) { *output = num_clusters; }
+}
+
+void weighted_box_fusion_invoker(float *const *parrays, const float *weights, int num_models, int max_objects,
+                                 int NUM_BOX_ELEMENT, const WBFConfig &config, float *output, int max_output,
+                                 void *workspace, cudaStream_t stream) {
+    int capacity = num_models * max_objects;
+    WBFWorkspace ws(workspace, capacity);
+
+    auto block = capacity > 512 ? 512 : capacity;
+    auto grid = (capacity + block - 1) / block;
+    checkRuntime(cudaMemsetAsync(ws.count, 0, sizeof(int), stream));
+    wbf_reset_kernel<<<grid, block, 0, stream>>>(ws.keys, ws.order, capacity);
+
+    float weight_sum = 0;
+    block = max_objects > 512 ? 512 : max_objects;
+    grid = (max_objects + block - 1) / block;
+    for (int m = 0; m < num_models; ++m) {
+        float weight = weights ? weights[m] : 1.0f;
+        weight_sum += weight;
+        wbf_gather_kernel<<<grid, block, 0, stream>>>(parrays[m], max_objects, NUM_BOX_ELEMENT, weight,
+                                                      config.skip_threshold, ws.count, ws.candidate, ws.keys);
+    }
+
+    // 空位的 key 为 -1，排在所有候选框之后，不需要把数量拷回主机
+    thrust::stable_sort_by_key(thrust::cuda::par.on(stream), ws.keys, ws.keys + capacity, ws.order, thrust::greater<float>());
+
+    wbf_cluster_kernel<<<1, SOFT_NMS_BLOCK, 0, stream>>>(ws.count, ws.candidate, ws.order, ws.cluster, config.iou_threshold,
+                                                         num_models, weight_sum, output, max_output, NUM_BOX_ELEMENT);
+}
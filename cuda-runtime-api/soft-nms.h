@@ -0,0 +1,80 @@
+#ifndef SOFT_NMS_H
+#define SOFT_NMS_H
+
+#include <math.h>
+#include <vector>
+#include "utils.h"
+
+/*
+ * 除了硬 NMS 之外的两种后处理：
+ *   Soft-NMS：不直接删除重叠框，而是按 IoU 衰减它的置信度，密集、互相遮挡的目标召回更高；
+ *   WBF（weighted box fusion）：把多个模型（集成、TTA）的输出按 IoU 聚类，坐标按置信度加权平均。
+ * CPU 和 GPU 版本都工作在 decode 之后的候选框上，GPU 版本直接使用 decode_kernel 输出的 [count, box1, box2, ……] 缓冲。
+ */
+enum class NMSMethod : int {
+    Hard = 0,     // 标准 NMS，IoU >= iou_threshold 的框置信度直接置 0
+    Linear = 1,   // IoU >= iou_threshold 时置信度乘以 (1 - IoU)
+    Gaussian = 2, // 置信度乘以 exp(-IoU^2 / sigma)
+};
+
+struct SoftNMSConfig {
+    NMSMethod method = NMSMethod::Gaussian;
+    float sigma = 0.5f;             // Gaussian 衰减的参数
+    float iou_threshold = 0.3f;     // Hard、Linear 衰减的 IoU 阈值
+    float score_threshold = 0.001f; // 衰减后的置信度低于该值的框丢弃
+};
+
+// 衰减系数，CPU 和 GPU 共用同一个公式
+#ifdef __CUDACC__
+__host__ __device__
+#endif
+inline float soft_nms_decay(NMSMethod method, float iou, float sigma, float iou_threshold) {
+    switch (method) {
+    case NMSMethod::Linear: return iou >= iou_threshold ? 1.0f - iou : 1.0f;
+    case NMSMethod::Gaussian: return expf(-(iou * iou) / sigma);
+    default: return iou >= iou_threshold ? 0.0f : 1.0f;
+    }
+}
+
+/*
+ * Soft-NMS，只在同类别之间衰减，返回的框按被选中的顺序排列，confidence 为衰减后的置信度。
+ * 衰减只会让置信度变小，所以用最大堆 + 惰性更新：
+ * 堆里的置信度是上界，出堆时才补上自上次更新以来新选中的框带来的衰减，补完仍然是最大值才选中，否则放回堆中。
+ * 堆顶低于 score_threshold 时剩余的框都不可能再被选中，直接结束。结果与逐轮全量衰减的朴素实现完全一致。
+ */
+std::vector<Box> soft_nms(const std::vector<Box> &boxes, const SoftNMSConfig &config = SoftNMSConfig());
+
+struct WBFConfig {
+    float iou_threshold = 0.55f; // 与聚类的融合框 IoU 超过该值时归入该聚类
+    float skip_threshold = 0.0f; // 置信度低于该值的输入框直接忽略
+};
+
+/*
+ * 加权框融合：model_boxes[m] 为第 m 个模型的输出，weights[m] 为它的权重（为空时全部为 1）。
+ * 每个输入框的置信度先乘以模型权重，按置信度从高到低依次归入 IoU 最大的同类别聚类，
+ * 融合框的坐标为聚类内按置信度加权的平均，置信度为平均置信度乘以 min(模型数, 聚类大小) / 权重之和。
+ */
+std::vector<Box> weighted_box_fusion(const std::vector<std::vector<Box>> &model_boxes,
+                                     const std::vector<float> &weights = {}, const WBFConfig &config = WBFConfig());
+
+/*
+ * GPU 版本的 Soft-NMS：对 parray = [count, box1, box2, ……] 原地处理，单个线程块内完成。
+ * 每轮块内归约找出当前置信度最高的框，再并行衰减其余同类别的框。
+ * 处理后 confidence 为衰减后的置信度，keepflag 为 1 表示被选中。
+ */
+void soft_nms_kernel_invoker(float *parray, int max_objects, int NUM_BOX_ELEMENT,
+                             const SoftNMSConfig &config, cudaStream_t stream);
+
+/*
+ * GPU 版本的 WBF：parrays 是主机端数组，parrays[m] 为第 m 个模型 decode 之后的设备端缓冲，只使用 keepflag 为 1 的框；
+ * weights 是主机端数组，为 nullptr 时全部为 1。
+ * 融合结果写入设备端的 output = [count, box1, box2, ……]，每个框 NUM_BOX_ELEMENT 个 float，keepflag 恒为 1。
+ * workspace 至少需要 weighted_box_fusion_workspace_size 字节。
+ */
+size_t weighted_box_fusion_workspace_size(int num_models, int max_objects);
+
+void weighted_box_fusion_invoker(float *const *parrays, const float *weights, int num_models, int max_objects,
+                                 int NUM_BOX_ELEMENT, const WBFConfig &config, float *output, int max_output,
+                                 void *workspace, cudaStream_t stream);
+
+#endif // SOFT_NMS_H
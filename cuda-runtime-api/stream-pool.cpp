@@ -0,0 +1,49 @@
+#include "stream-pool.h"
+
+static cudaError_t create_stream(cudaStream_t *stream, int priority, unsigned int flags) {
+    return cudaStreamCreateWithPriority(stream, flags, priority);
+}
+
+static cudaError_t create_event(cudaEvent_t *event, int timing, unsigned int flags) {
+    return cudaEventCreateWithFlags(event, timing ? flags : flags | cudaEventDisableTiming);
+}
+
+StreamPool::StreamPool(unsigned int flags, size_t max_idle)
+    : CudaObjectPool<cudaStream_t>("StreamPool", create_stream, cudaStreamDestroy, flags, max_idle) {}
+
+StreamPool &StreamPool::global() {
+    static StreamPool *pool = new StreamPool();
+    return *pool;
+}
+
+int StreamPool::clamp_priority(int priority) {
+    int device = 0;
+    cudaGetDevice(&device);
+    std::lock_guard<std::mutex> lock(range_lock_);
+    auto it = priority_range_.find(device);
+    if (it == priority_range_.end()) {
+        int least = 0, greatest = 0;
+        if (cudaDeviceGetStreamPriorityRange(&least, &greatest) != cudaSuccess) { least = greatest = 0; }
+        it = priority_range_.emplace(device, std::make_pair(greatest, least)).first;
+    }
+    // greatest 是数值最小的（最高优先级），例如 [-5, 0]
+    if (priority < it->second.first) { return it->second.first; }
+    if (priority > it->second.second) { return it->second.second; }
+    return priority;
+}
+
+StreamPool::Handle StreamPool::acquire(int priority) {
+    return acquire_variant(clamp_priority(priority));
+}
+
+EventPool::EventPool(size_t max_idle)
+    : CudaObjectPool<cudaEvent_t>("EventPool", create_event, cudaEventDestroy, cudaEventDefault, max_idle) {}
+
+EventPool &EventPool::global() {
+    static EventPool *pool = new EventPool();
+    return *pool;
+}
+
+EventPool::Handle EventPool::acquire(bool timing) {
+    return acquire_variant(timing ? 1 : 0);
+}
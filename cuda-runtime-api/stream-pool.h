@@ -0,0 +1,236 @@
+#ifndef STREAM_POOL_H
+#define STREAM_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <cuda_runtime.h>
+
+/*
+ * 流和事件的回收池：
+ * cudaStreamCreate / cudaEventCreate 要进驱动、可能加锁，每次调用都创建销毁（gpu_decode 每次一个流，
+ * parallel.cu 的 async 每次四个事件还忘了销毁）既慢又容易泄漏。这里用完不销毁，放回池中给下一次使用：
+ *   - acquire 返回 RAII 的句柄，析构时还回池中，不需要手动销毁，也不会漏掉；
+ *   - 按 (设备, 变体) 分开存放：流的变体是优先级，事件的变体是是否计时（不计时的 cudaEventDisableTiming 更轻，
+ *     只用于同步时应该用它）；
+ *   - 记录创建、借出、归还的次数和借出未还的数量，池析构时还有没归还的句柄会打印出来（泄漏）。
+ * 注意：
+ *   - 归还时不同步，流上还没完成的工作会留给下一个使用者，下一次的工作排在它们后面（结果正确，只是可能多等一会儿）；
+ *   - 事件归还之后可能马上被别人重新 record，归还之前要用完（ElapsedTime、Synchronize），cudaStreamWaitEvent 已经排入的等待不受影响；
+ *   - 句柄不能比池活得久，global() 的池不析构；
+ *   - 创建失败时句柄 valid() 为 false，get() 为 nullptr（默认流），照常使用只是失去并行。
+ * 线程安全。
+ */
+struct CudaPoolStats {
+    uint64_t created = 0;
+    uint64_t destroyed = 0;
+    uint64_t acquires = 0;
+    uint64_t reuses = 0;      // acquire 中直接从池里拿到的次数
+    uint64_t releases = 0;
+    uint64_t failures = 0;    // 创建失败的次数
+    size_t in_use = 0;        // 借出未还的数量，程序结束时不为 0 就是泄漏
+    size_t peak_in_use = 0;
+    size_t idle = 0;
+};
+
+template <typename T>
+class CudaObjectPool {
+public:
+    typedef cudaError_t (*CreateFunc)(T *object, int variant, unsigned int flags);
+    typedef cudaError_t (*DestroyFunc)(T object);
+
+    // 借出的对象，析构或者 release 时归还
+    class Handle {
+    public:
+        Handle() = default;
+        Handle(CudaObjectPool *pool, int device, int variant, T object)
+            : pool_(pool), device_(device), variant_(variant), object_(object) {}
+        Handle(Handle &&other) noexcept
+            : pool_(std::exchange(other.pool_, nullptr)), device_(other.device_), variant_(other.variant_),
+              object_(std::exchange(other.object_, nullptr)) {}
+        Handle &operator=(Handle &&other) noexcept {
+            if (this != &other) {
+                release();
+                pool_ = std::exchange(other.pool_, nullptr);
+                device_ = other.device_;
+                variant_ = other.variant_;
+                object_ = std::exchange(other.object_, nullptr);
+            }
+            return *this;
+        }
+        Handle(const Handle &) = delete;
+        Handle &operator=(const Handle &) = delete;
+        ~Handle() { release(); }
+
+        T get() const { return object_; }
+        operator T() const { return object_; }
+        bool valid() const { return pool_ != nullptr; }
+
+        void release() {
+            if (pool_ != nullptr) { std::exchange(pool_, nullptr)->give_back(device_, variant_, std::exchange(object_, nullptr)); }
+        }
+
+    private:
+        CudaObjectPool *pool_ = nullptr;
+        int device_ = 0;
+        int variant_ = 0;
+        T object_ = nullptr;
+    };
+
+    /*
+     * name 用于泄漏报告。每个 (设备, 变体) 最多缓存 max_idle 个空闲对象，超出的归还时直接销毁，
+     * 偶尔的并发高峰不会让池一直占着大量的流和事件。
+     */
+    CudaObjectPool(const char *name, CreateFunc create, DestroyFunc destroy, unsigned int flags, size_t max_idle)
+        : name_(name), create_(create), destroy_(destroy), flags_(flags), max_idle_(max_idle) {}
+
+    // 销毁所有空闲对象，调用前 CUDA 上下文必须还在
+    ~CudaObjectPool() {
+        trim();
+        std::lock_guard<std::mutex> lock(lock_);
+        if (stats_.in_use > 0) { printf("%s: %zu handles still in use at destruction, leaked.\n", name_, stats_.in_use); }
+    }
+    CudaObjectPool(const CudaObjectPool &) = delete;
+    CudaObjectPool &operator=(const CudaObjectPool &) = delete;
+
+    // 销毁所有空闲对象，借出的不受影响
+    void trim() {
+        std::map<std::pair<int, int>, std::vector<T>> idle;
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            idle.swap(idle_);
+            stats_.idle = 0;
+        }
+        if (idle.empty()) { return; }
+        int current = 0;
+        cudaGetDevice(&current);
+        uint64_t destroyed = 0;
+        for (auto &item : idle) {
+            cudaSetDevice(item.first.first);
+            for (T object : item.second) {
+                destroy_(object);
+                destroyed++;
+            }
+        }
+        cudaSetDevice(current);
+        std::lock_guard<std::mutex> lock(lock_);
+        stats_.destroyed += destroyed;
+    }
+
+    CudaPoolStats stats() const {
+        std::lock_guard<std::mutex> lock(lock_);
+        return stats_;
+    }
+
+protected:
+    // 在当前设备上借出一个 variant 的对象，没有空闲的就创建
+    Handle acquire_variant(int variant) {
+        int device = 0;
+        cudaGetDevice(&device);
+        auto key = std::make_pair(device, variant);
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            stats_.acquires++;
+            auto it = idle_.find(key);
+            if (it != idle_.end() && !it->second.empty()) {
+                T object = it->second.back();
+                it->second.pop_back();
+                stats_.reuses++;
+                stats_.idle--;
+                note_acquired_locked();
+                return Handle(this, device, variant, object);
+            }
+        }
+
+        // 创建在锁外进行，不阻塞其他线程的借还
+        T object = nullptr;
+        cudaError_t code = create_(&object, variant, flags_);
+        std::lock_guard<std::mutex> lock(lock_);
+        if (code != cudaSuccess) {
+            stats_.failures++;
+            printf("%s: create failed, %s: %s\n", name_, cudaGetErrorName(code), cudaGetErrorString(code));
+            return Handle();
+        }
+        stats_.created++;
+        note_acquired_locked();
+        return Handle(this, device, variant, object);
+    }
+
+private:
+    void note_acquired_locked() {
+        stats_.in_use++;
+        if (stats_.in_use > stats_.peak_in_use) { stats_.peak_in_use = stats_.in_use; }
+    }
+
+    void give_back(int device, int variant, T object) {
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            stats_.releases++;
+            stats_.in_use--;
+            auto &idle = idle_[std::make_pair(device, variant)];
+            if (idle.size() < max_idle_) {
+                idle.push_back(object);
+                stats_.idle++;
+                return;
+            }
+            stats_.destroyed++;
+        }
+        // 对象属于 device，销毁时切换过去
+        int current = 0;
+        cudaGetDevice(&current);
+        if (current != device) { cudaSetDevice(device); }
+        destroy_(object);
+        if (current != device) { cudaSetDevice(current); }
+    }
+
+    const char *name_;
+    CreateFunc create_;
+    DestroyFunc destroy_;
+    unsigned int flags_;
+    size_t max_idle_;
+    mutable std::mutex lock_;
+    std::map<std::pair<int, int>, std::vector<T>> idle_;
+    CudaPoolStats stats_;
+};
+
+/*
+ * 流的池，flags 默认 cudaStreamNonBlocking（不与默认流隐式同步）。
+ * priority 数值越小优先级越高，超出设备范围（cudaDeviceGetStreamPriorityRange）的按边界处理，同一优先级的流才会互相复用。
+ */
+class StreamPool : public CudaObjectPool<cudaStream_t> {
+public:
+    explicit StreamPool(unsigned int flags = cudaStreamNonBlocking, size_t max_idle = 64);
+
+    // 进程内共享的池，不析构（进程退出时 CUDA 上下文可能已经销毁）
+    static StreamPool &global();
+
+    Handle acquire(int priority = 0);
+
+private:
+    int clamp_priority(int priority);
+
+    std::mutex range_lock_;
+    std::map<int, std::pair<int, int>> priority_range_; // device -> (greatest, least)
+};
+
+/*
+ * 事件的池：timing 为 false 时创建 cudaEventDisableTiming 的事件，只能用于同步，
+ * 需要 cudaEventElapsedTime 计时的才用 timing 为 true。两种分开存放，不会混用。
+ */
+class EventPool : public CudaObjectPool<cudaEvent_t> {
+public:
+    explicit EventPool(size_t max_idle = 256);
+
+    static EventPool &global();
+
+    Handle acquire(bool timing = false);
+};
+
+typedef StreamPool::Handle PooledStream;
+typedef EventPool::Handle PooledEvent;
+
+#endif // STREAM_POOL_H
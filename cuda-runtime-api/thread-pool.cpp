@@ -0,0 +1,369 @@
+#include "thread-pool.h"
+#include <stdio.h>
+#include <chrono>
+#include "numa-topology.h"
+
+// 当前线程属于哪个线程池的第几个工作线程，池外线程 pool 为 nullptr
+struct ThreadPoolLocal {
+    ThreadPool *pool = nullptr;
+    int index = -1;
+    uint32_t seed = 0;
+};
+static thread_local ThreadPoolLocal tls_worker;
+
+static uint32_t next_random(uint32_t &seed) {
+    if (seed == 0) { seed = (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id()) | 1; }
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+WorkStealingDeque::WorkStealingDeque(int64_t capacity) : top_(0), bottom_(0) {
+    int64_t n = 1;
+    while (n < capacity) { n <<= 1; }
+    arrays_.emplace_back(new Array(n));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+}
+
+WorkStealingDeque::~WorkStealingDeque() = default;
+
+void WorkStealingDeque::push(ThreadPoolTask *task) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Array *array = array_.load(std::memory_order_relaxed);
+    if (bottom - top > array->capacity - 1) {
+        Array *bigger = new Array(array->capacity * 2);
+        for (int64_t i = top; i < bottom; ++i) { bigger->put(i, array->get(i)); }
+        arrays_.emplace_back(bigger);
+        array_.store(bigger, std::memory_order_release);
+        array = bigger;
+    }
+    array->put(bottom, task);
+    bottom_.store(bottom + 1, std::memory_order_release);
+}
+
+ThreadPoolTask *WorkStealingDeque::pop() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Array *array = array_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    ThreadPoolTask *task = array->get(bottom);
+    if (top == bottom) {
+        // 只剩最后一个，与窃取的线程竞争 top
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) { task = nullptr; }
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+ThreadPoolTask *WorkStealingDeque::steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) { return nullptr; }
+
+    Array *array = array_.load(std::memory_order_acquire);
+    ThreadPoolTask *task = array->get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) { return nullptr; }
+    return task;
+}
+
+TaskGroup::TaskGroup(ThreadPool &pool) : pool_(pool) {}
+
+TaskGroup::TaskGroup() : pool_(ThreadPool::global()) {}
+
+TaskGroup::~TaskGroup() {
+    // 提前退出（例如调用线程上的部分抛出异常）时也要等子任务结束，它们引用了这里的状态
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+void TaskGroup::run(std::function<void()> fn) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    pool_.submit(new ThreadPoolTask{std::move(fn), this});
+}
+
+void TaskGroup::wait() {
+    int self = pool_.in_worker() ? tls_worker.index : -1;
+    int idle = 0;
+    while (pending_.load(std::memory_order_acquire) > 0) {
+        ThreadPoolTask *task = pool_.find_task(self);
+        if (task != nullptr) {
+            pool_.execute(task);
+            idle = 0;
+        } else if (++idle < 64) {
+            std::this_thread::yield();
+        } else {
+            // 剩下的任务都在其他线程上执行，没有可以帮忙的
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(error_lock_);
+        std::swap(error, error_);
+    }
+    if (error) { std::rethrow_exception(error); }
+}
+
+ThreadPool::ThreadPool(int num_workers) {
+    if (num_workers < 0) { num_workers = (int)std::max(1u, std::thread::hardware_concurrency()) - 1; }
+    for (int i = 0; i < num_workers; ++i) { workers_.emplace_back(new Worker()); }
+
+    // 第 i 个工作线程对应第 i + 1 个 CPU（第 0 个留给调用线程），这样各节点的线程数与 CPU 数成比例
+    const NumaTopology &topology = NumaTopology::system();
+    if (topology.is_numa()) {
+        std::vector<int> cpu_nodes;
+        for (auto &node : topology.nodes()) { cpu_nodes.insert(cpu_nodes.end(), node.cpus.size(), node.id); }
+        for (int i = 0; i < num_workers && !cpu_nodes.empty(); ++i) { workers_[i]->node = cpu_nodes[(i + 1) % cpu_nodes.size()]; }
+    }
+    for (int i = 0; i < num_workers; ++i) {
+        for (int j = 0; j < num_workers; ++j) {
+            if (j == i) { continue; }
+            auto &victims = workers_[j]->node == workers_[i]->node ? workers_[i]->local_victims : workers_[i]->remote_victims;
+            victims.push_back(j);
+        }
+    }
+    // 所有 Worker 都创建好之后再启动线程，窃取时会访问其他线程的队列
+    for (int i = 0; i < num_workers; ++i) { workers_[i]->thread = std::thread(&ThreadPool::worker_loop, this, i); }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_lock_);
+        stop_.store(true);
+    }
+    sleep_cv_.notify_all();
+    for (auto &worker : workers_) { worker->thread.join(); }
+    for (auto task : injected_) { delete task; }
+}
+
+ThreadPool &ThreadPool::global() {
+    // 故意不释放：静态对象析构时（尤其是 Windows 上卸载 DLL 时）join 线程可能死锁，进程退出时线程都在休眠
+    static ThreadPool *pool = new ThreadPool();
+    return *pool;
+}
+
+bool ThreadPool::in_worker() const {
+    return tls_worker.pool == this;
+}
+
+ThreadPool::Stats ThreadPool::stats() const {
+    Stats stats;
+    stats.executed = executed_.load(std::memory_order_relaxed);
+    stats.stolen = stolen_.load(std::memory_order_relaxed);
+    stats.injected = injected_count_.load(std::memory_order_relaxed);
+    stats.sleeps = sleeps_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ThreadPool::submit(ThreadPoolTask *task) {
+    if (in_worker()) {
+        workers_[tls_worker.index]->deque.push(task);
+    } else {
+        std::lock_guard<std::mutex> lock(inject_lock_);
+        injected_.push_back(task);
+        injected_size_.fetch_add(1, std::memory_order_relaxed);
+        injected_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    notify();
+}
+
+void ThreadPool::notify() {
+    // 与 worker_loop 中的 sleeping_、epoch_ 配合：要么这里看到有线程在休眠并唤醒它，要么休眠的线程看到新的 epoch
+    epoch_.fetch_add(1);
+    if (sleeping_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleep_lock_);
+        sleep_cv_.notify_one();
+    }
+}
+
+void ThreadPool::post(std::function<void()> fn) {
+    if (workers_.empty()) {
+        try {
+            fn();
+        } catch (...) {
+            printf("ThreadPool: exception in posted task ignored.\n");
+        }
+        return;
+    }
+    submit(new ThreadPoolTask{std::move(fn), nullptr});
+}
+
+void ThreadPool::execute(ThreadPoolTask *task) {
+    try {
+        task->fn();
+    } catch (...) {
+        if (task->group == nullptr) {
+            printf("ThreadPool: exception in posted task ignored.\n");
+        } else {
+            std::lock_guard<std::mutex> lock(task->group->error_lock_);
+            if (!task->group->error_) { task->group->error_ = std::current_exception(); }
+        }
+    }
+    executed_.fetch_add(1, std::memory_order_relaxed);
+
+    // 计数减到 0 后 group 可能马上被销毁，所以先释放任务
+    TaskGroup *group = task->group;
+    delete task;
+    if (group != nullptr) { group->pending_.fetch_sub(1, std::memory_order_acq_rel); }
+}
+
+ThreadPoolTask *ThreadPool::find_task(int self) {
+    if (self >= 0) {
+        ThreadPoolTask *task = workers_[self]->deque.pop();
+        if (task != nullptr) { return task; }
+    }
+
+    if (injected_size_.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(inject_lock_);
+        if (!injected_.empty()) {
+            ThreadPoolTask *task = injected_.front();
+            injected_.pop_front();
+            injected_size_.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+
+    // 从随机的位置开始轮流窃取，避免所有线程同时抢同一个队列；工作线程先找同一节点的，池外线程没有偏好
+    int n = (int)workers_.size();
+    if (n == 0) { return nullptr; }
+    uint32_t random = next_random(self >= 0 ? workers_[self]->seed : tls_worker.seed);
+    if (self >= 0) {
+        ThreadPoolTask *task = steal_from(workers_[self]->local_victims, random);
+        return task != nullptr ? task : steal_from(workers_[self]->remote_victims, random);
+    }
+    for (int i = 0; i < n; ++i) {
+        ThreadPoolTask *task = workers_[(random + i) % n]->deque.steal();
+        if (task != nullptr) {
+            stolen_.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+ThreadPoolTask *ThreadPool::steal_from(const std::vector<int> &victims, uint32_t random) {
+    size_t n = victims.size();
+    for (size_t i = 0; i < n; ++i) {
+        ThreadPoolTask *task = workers_[victims[(random + i) % n]]->deque.steal();
+        if (task != nullptr) {
+            stolen_.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+bool ThreadPool::has_work() const {
+    if (injected_size_.load() > 0) { return true; }
+    for (auto &worker : workers_) {
+        if (worker->deque.size() > 0) { return true; }
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(int index) {
+    tls_worker.pool = this;
+    tls_worker.index = index;
+    workers_[index]->seed = (uint32_t)index * 2654435761u + 1;
+    if (workers_[index]->node >= 0) { pin_current_thread_to_node(NumaTopology::system(), workers_[index]->node); }
+
+    int idle = 0;
+    while (!stop_.load(std::memory_order_acquire)) {
+        ThreadPoolTask *task = find_task(index);
+        if (task != nullptr) {
+            execute(task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < 64) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_lock_);
+        sleeping_.fetch_add(1);
+        uint64_t epoch = epoch_.load();
+        if (!has_work() && !stop_.load()) {
+            sleeps_.fetch_add(1, std::memory_order_relaxed);
+            sleep_cv_.wait(lock, [&]() { return epoch_.load() != epoch || stop_.load(); });
+        }
+        sleeping_.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+void ThreadPool::parallel_range(TaskGroup &group, int64_t begin, int64_t end, int64_t grain,
+                                const std::function<void(int64_t, int64_t)> &fn) {
+    int self = in_worker() ? tls_worker.index : -1;
+    while (end - begin > grain) {
+        // 自己的队列空了才拆分；池外线程没有队列，以注入队列为空作为条件
+        bool hungry = self >= 0 ? workers_[self]->deque.size() == 0 : injected_size_.load(std::memory_order_relaxed) == 0;
+        if (hungry) {
+            int64_t mid = begin + (end - begin) / 2;
+            group.run([this, &group, mid, end, grain, &fn]() { parallel_range(group, mid, end, grain, fn); });
+            end = mid;
+        } else {
+            fn(begin, begin + grain);
+            begin += grain;
+        }
+    }
+    fn(begin, end);
+}
+
+TaskGraph::Node TaskGraph::add(std::function<void()> fn) {
+    nodes_.emplace_back(new NodeData());
+    nodes_.back()->fn = std::move(fn);
+    return (Node)nodes_.size() - 1;
+}
+
+void TaskGraph::precede(Node before, Node after) {
+    nodes_[before]->successors.push_back(after);
+    nodes_[after]->num_predecessors++;
+}
+
+bool TaskGraph::run(ThreadPool &pool) {
+    // 先做一遍拓扑排序检查环，有环的图提交后永远等不到结束
+    int n = (int)nodes_.size();
+    std::vector<int> in_degree(n);
+    std::vector<Node> order;
+    for (int i = 0; i < n; ++i) {
+        in_degree[i] = nodes_[i]->num_predecessors;
+        if (in_degree[i] == 0) { order.push_back(i); }
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (Node next : nodes_[order[i]]->successors) {
+            if (--in_degree[next] == 0) { order.push_back(next); }
+        }
+    }
+    if ((int)order.size() != n) { return false; }
+
+    for (auto &node : nodes_) { node->pending.store(node->num_predecessors, std::memory_order_relaxed); }
+    TaskGroup group(pool);
+    for (int i = 0; i < n; ++i) {
+        if (nodes_[i]->num_predecessors == 0) { launch(group, i); }
+    }
+    group.wait();
+    return true;
+}
+
+void TaskGraph::launch(TaskGroup &group, Node node) {
+    group.run([this, &group, node]() {
+        NodeData &data = *nodes_[node];
+        data.fn();
+        for (Node next : data.successors) {
+            if (nodes_[next]->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) { launch(group, next); }
+        }
+    });
+}
@@ -0,0 +1,222 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * 所有 CPU 路径共用的工作窃取线程池，各个功能不再自己创建线程。
+ *   - 每个工作线程有一个 Chase-Lev 双端队列：自己从底部压入、弹出（LIFO，缓存友好），其他线程从顶部窃取（FIFO，拿走较大的块）；
+ *   - 池外线程提交的任务放入一个加锁的注入队列；
+ *   - TaskGroup::wait 不阻塞，等待的线程（包括池外的调用线程）一直取任务执行，
+ *     所以任务里再调用 parallel_for 只是把子任务压入当前线程的队列，不会创建新线程，也不会超额订阅；
+ *   - 池中有 hardware_concurrency - 1 个工作线程，加上等待中的调用线程正好占满所有核心；
+ *   - 多个 NUMA 节点时（numa-topology.h）工作线程按各节点的 CPU 数分配并绑定到所在节点，窃取时先找同一节点的线程。
+ */
+struct ThreadPoolTask;
+
+// Chase-Lev 双端队列（Lê 等人 2013 年的 C11 内存模型版本），容量不够时倍增，旧数组在析构时释放
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(int64_t capacity = 256);
+    ~WorkStealingDeque();
+
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    // 只能由所有者线程调用
+    void push(ThreadPoolTask *task);
+    ThreadPoolTask *pop();
+    // 任意线程调用，失败（为空或者与其他线程竞争失败）时返回 nullptr
+    ThreadPoolTask *steal();
+
+    int64_t size() const {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        return bottom > top ? bottom - top : 0;
+    }
+
+private:
+    struct Array {
+        int64_t capacity;
+        std::unique_ptr<std::atomic<ThreadPoolTask *>[]> items;
+
+        explicit Array(int64_t n) : capacity(n), items(new std::atomic<ThreadPoolTask *>[n]) {}
+        ThreadPoolTask *get(int64_t i) const { return items[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void put(int64_t i, ThreadPoolTask *task) { items[i & (capacity - 1)].store(task, std::memory_order_relaxed); }
+    };
+
+    // top_ 由窃取的线程修改，bottom_ 由所有者修改，分开放在不同的缓存行
+    std::atomic<int64_t> top_;
+    char padding_[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> bottom_;
+    std::atomic<Array *> array_;
+    std::vector<std::unique_ptr<Array>> arrays_; // 窃取的线程可能还在读旧数组，不能立即释放
+};
+
+class ThreadPool;
+
+// 一组任务，wait 返回时组内（包括任务中再提交到这个组的）任务都已完成，任务抛出的第一个异常在 wait 中重新抛出
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool &pool);
+    TaskGroup();
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    void run(std::function<void()> fn);
+    void wait();
+
+    ThreadPool &pool() const { return pool_; }
+
+private:
+    friend class ThreadPool;
+    ThreadPool &pool_;
+    std::atomic<int64_t> pending_{0};
+    std::mutex error_lock_;
+    std::exception_ptr error_;
+};
+
+struct ThreadPoolTask {
+    std::function<void()> fn;
+    TaskGroup *group = nullptr; // post 提交的任务不属于任何组
+};
+
+class ThreadPool {
+public:
+    // num_workers < 0 时使用 hardware_concurrency - 1 个工作线程，0 表示所有任务都由等待的线程执行
+    explicit ThreadPool(int num_workers = -1);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // 进程内共用的线程池，第一次使用时创建
+    static ThreadPool &global();
+
+    int num_workers() const { return (int)workers_.size(); }
+    // 可以同时执行任务的线程数（工作线程 + 调用线程）
+    int concurrency() const { return num_workers() + 1; }
+    // 当前线程是否是这个池的工作线程
+    bool in_worker() const;
+    // 工作线程绑定的 NUMA 节点，没有绑定时为 -1
+    int worker_node(int index) const { return workers_[index]->node; }
+
+    struct Stats {
+        uint64_t executed = 0, stolen = 0, injected = 0, sleeps = 0;
+    };
+    Stats stats() const;
+
+    /*
+     * fn(begin, end) 处理 [begin, end)，grain 为一次调用的最小元素数，0 时按线程数自动选择。
+     * 自适应的划分（lazy binary splitting）：当前线程的队列为空（说明其他线程可能没有活干）时，
+     * 把剩余区间的后一半压入队列供窃取，否则按 grain 顺序处理，任务数随负载变化，而不是固定切成 N 份。
+     * max_parallelism > 0 时区间最多分成这么多块，1 表示在调用线程上直接执行。
+     */
+    template <typename Fn>
+    void parallel_for(int64_t begin, int64_t end, Fn &&fn, int64_t grain = 0, int max_parallelism = 0);
+
+    /*
+     * 提交一个不需要等待的任务（例如恢复协程），异常被打印后忽略。
+     * 没有工作线程时（单核的机器）没有线程会去执行，直接在调用线程上执行。析构之前提交的任务要执行完。
+     */
+    void post(std::function<void()> fn);
+
+private:
+    friend class TaskGroup;
+    struct Worker {
+        WorkStealingDeque deque;
+        std::thread thread;
+        uint32_t seed = 0;
+        int node = -1;
+        std::vector<int> local_victims, remote_victims; // 窃取的对象，同一节点的在前
+    };
+
+    void submit(ThreadPoolTask *task);
+    void execute(ThreadPoolTask *task);
+    // 依次尝试：自己的队列、注入队列、窃取其他线程；self < 0 表示池外线程
+    ThreadPoolTask *find_task(int self);
+    ThreadPoolTask *steal_from(const std::vector<int> &victims, uint32_t random);
+    bool has_work() const;
+    void worker_loop(int index);
+    void notify();
+    void parallel_range(TaskGroup &group, int64_t begin, int64_t end, int64_t grain,
+                        const std::function<void(int64_t, int64_t)> &fn);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex inject_lock_;
+    std::deque<ThreadPoolTask *> injected_;
+    std::atomic<int64_t> injected_size_{0};
+
+    std::mutex sleep_lock_;
+    std::condition_variable sleep_cv_;
+    std::atomic<int> sleeping_{0};
+    std::atomic<uint64_t> epoch_{0};
+    std::atomic<bool> stop_{false};
+
+    std::atomic<uint64_t> executed_{0}, stolen_{0}, injected_count_{0}, sleeps_{0};
+};
+
+template <typename Fn>
+void ThreadPool::parallel_for(int64_t begin, int64_t end, Fn &&fn, int64_t grain, int max_parallelism) {
+    int64_t n = end - begin;
+    if (n <= 0) { return; }
+    if (grain <= 0) { grain = std::max<int64_t>(1, n / (concurrency() * 16)); }
+    if (max_parallelism > 0) { grain = std::max(grain, (n + max_parallelism - 1) / max_parallelism); }
+    if (grain >= n || (num_workers() == 0 && !in_worker())) {
+        fn(begin, end);
+        return;
+    }
+
+    std::function<void(int64_t, int64_t)> body = [&fn](int64_t b, int64_t e) { fn(b, e); };
+    TaskGroup group(*this);
+    parallel_range(group, begin, end, grain, body);
+    group.wait();
+}
+
+// 使用全局线程池，num_threads 与原来各个 CPU 函数的参数含义相同：1 表示单线程，<= 0 表示使用全部核心
+template <typename Fn>
+void parallel_for(int64_t begin, int64_t end, Fn &&fn, int64_t grain = 0, int num_threads = 0) {
+    ThreadPool::global().parallel_for(begin, end, std::forward<Fn>(fn), grain, num_threads);
+}
+
+/*
+ * 任务图：节点之间有依赖关系，一个节点的所有前驱完成后才会提交，没有依赖关系的节点并行执行。
+ * 节点中可以再调用 parallel_for。run 可以重复调用，每次都按完整的图执行一遍。
+ */
+class TaskGraph {
+public:
+    typedef int Node;
+
+    Node add(std::function<void()> fn);
+    // before 完成之后才执行 after
+    void precede(Node before, Node after);
+    size_t size() const { return nodes_.size(); }
+
+    // 图中有环时不执行任何节点，返回 false
+    bool run(ThreadPool &pool = ThreadPool::global());
+
+private:
+    struct NodeData {
+        std::function<void()> fn;
+        std::vector<Node> successors;
+        int num_predecessors = 0;
+        std::atomic<int> pending{0};
+    };
+    void launch(TaskGroup &group, Node node);
+
+    std::vector<std::unique_ptr<NodeData>> nodes_;
+};
+
+#endif // THREAD_POOL_H
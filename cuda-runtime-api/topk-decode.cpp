@@ -0,0 +1,42 @@
+#include "topk-decode.h"
+#include <algorithm>
+
+std::vector<Box> cpu_decode_topk_candidates(float *predict, int rows, int cols, float confidence_threshold, int max_objects) {
+    struct Candidate {
+        float confidence;
+        int row;
+        int label;
+    };
+    std::vector<Candidate> candidates;
+    int num_classes = cols - 5;
+    for (int i = 0; i < rows; ++i) {
+        float *pitem = predict + i * cols;
+        float objness = pitem[4];
+        if (objness < confidence_threshold) { continue; }
+
+        float *pclass = pitem + 5;
+        int label = std::max_element(pclass, pclass + num_classes) - pclass;
+        float confidence = pclass[label] * objness;
+        if (confidence < confidence_threshold) { continue; }
+        candidates.push_back({confidence, i, label});
+    }
+
+    // 与 GPU 的 key 顺序一致：置信度从高到低，置信度相同时行号小的优先
+    auto greater = [](const Candidate &a, const Candidate &b) {
+        return a.confidence > b.confidence || (a.confidence == b.confidence && a.row < b.row);
+    };
+    if ((int)candidates.size() > max_objects) {
+        std::nth_element(candidates.begin(), candidates.begin() + max_objects, candidates.end(), greater);
+        candidates.resize(max_objects);
+    }
+    std::sort(candidates.begin(), candidates.end(), greater);
+
+    std::vector<Box> boxes;
+    boxes.reserve(candidates.size());
+    for (auto &item : candidates) {
+        float *pitem = predict + item.row * cols;
+        float cx = pitem[0], cy = pitem[1], width = pitem[2], height = pitem[3];
+        boxes.emplace_back(cx - width * 0.5f, cy - height * 0.5f, cx + width * 0.5f, cy + height * 0.5f, item.confidence, item.label);
+    }
+    return boxes;
+}
@@ -0,0 +1,191 @@
+#include "cuda-runtime-api.h"
+
+// 基数选择的状态，全部放在设备端，各个 kernel 之间不需要同步回主机
+struct TopKState {
+    unsigned long long prefix; // 已经确定的第 K 大 key 的高位
+    int remaining;             // 在与 prefix 高位相同的 key 中，还需要选出第几大的
+    int take_all;              // 通过阈值的候选框不超过 K 个时全部保留
+};
+
+static __device__ void affine_project(const float *matrix, float x, float y, float *ox, float *oy) {
+    *ox = matrix[0] * x + matrix[1] * y + matrix[2];
+    *oy = matrix[3] * x + matrix[4] * y + matrix[5];
+}
+
+// 与 decode_kernel 相同的置信度和类别计算
+static __device__ float topk_row_confidence(const float *pitem, int num_classes, float confidence_threshold, int *plabel) {
+    float objectness = pitem[4];
+    if (objectness < confidence_threshold) { return -1; }
+
+    const float *class_confidence = pitem + 5;
+    float confidence = *class_confidence++;
+    int label = 0;
+    for (int i = 1; i < num_classes; ++i, ++class_confidence) {
+        if (*class_confidence > confidence) {
+            confidence = *class_confidence;
+            label = i;
+        }
+    }
+    confidence *= objectness;
+    if (confidence < confidence_threshold) { return -1; }
+    *plabel = label;
+    return confidence;
+}
+
+// 每一行生成 64 位 key，0 表示未通过阈值；同时统计第一轮（最高字节）的直方图
+__global__ void topk_key_kernel(float *predict, int num_bboxes, int num_classes, float confidence_threshold,
+                                int index_bits, unsigned long long *keys, int *histogram) {
+    __shared__ int s_hist[TOPK_RADIX_BINS];
+    for (int i = threadIdx.x; i < TOPK_RADIX_BINS; i += blockDim.x) { s_hist[i] = 0; }
+    __syncthreads();
+
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position < num_bboxes) {
+        int label = 0;
+        float confidence = topk_row_confidence(predict + (5 + num_classes) * position, num_classes, confidence_threshold, &label);
+        unsigned long long key = 0;
+        if (confidence >= confidence_threshold) {
+            // +1 让合法的 key 不为 0；反转行号让行号小的 key 更大
+            unsigned long long score = confidence > 0 ? __float_as_uint(confidence) + 1ull : 1ull;
+            unsigned long long inverted = ((1ull << index_bits) - 1) - position;
+            key = (score << index_bits) | inverted;
+            atomicAdd(&s_hist[(key >> (32 + index_bits - TOPK_RADIX_BITS)) & (TOPK_RADIX_BINS - 1)], 1);
+        }
+        keys[position] = key;
+    }
+    __syncthreads();
+
+    for (int i = threadIdx.x; i < TOPK_RADIX_BINS; i += blockDim.x) {
+        if (s_hist[i]) { atomicAdd(&histogram[i], s_hist[i]); }
+    }
+}
+
+// 只统计高位与 prefix 相同的 key，shift 为本轮字节的位置
+__global__ void topk_histogram_kernel(const unsigned long long *keys, int num_bboxes, int shift,
+                                      const TopKState *state, int *histogram) {
+    __shared__ int s_hist[TOPK_RADIX_BINS];
+    if (state->take_all) { return; }
+    for (int i = threadIdx.x; i < TOPK_RADIX_BINS; i += blockDim.x) { s_hist[i] = 0; }
+    __syncthreads();
+
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position < num_bboxes) {
+        unsigned long long key = keys[position];
+        if (key != 0 && (key >> (shift + TOPK_RADIX_BITS)) == (state->prefix >> (shift + TOPK_RADIX_BITS))) {
+            atomicAdd(&s_hist[(key >> shift) & (TOPK_RADIX_BINS - 1)], 1);
+        }
+    }
+    __syncthreads();
+
+    for (int i = threadIdx.x; i < TOPK_RADIX_BINS; i += blockDim.x) {
+        if (s_hist[i]) { atomicAdd(&histogram[i], s_hist[i]); }
+    }
+}
+
+// 从大到小累加直方图，找到第 remaining 大的 key 所在的桶，只有 256 个桶，单线程即可
+__global__ void topk_select_kernel(const int *histogram, int shift, int first_pass, int max_objects, TopKState *state) {
+    if (first_pass) {
+        int total = 0;
+        for (int i = 0; i < TOPK_RADIX_BINS; ++i) { total += histogram[i]; }
+        state->prefix = 0;
+        state->remaining = max_objects;
+        state->take_all = total <= max_objects;
+    }
+    if (state->take_all) { return; }
+
+    int cumulative = 0;
+    for (int bin = TOPK_RADIX_BINS - 1; bin >= 0; --bin) {
+        if (cumulative + histogram[bin] >= state->remaining) {
+            state->prefix |= (unsigned long long)bin << shift;
+            state->remaining -= cumulative;
+            return;
+        }
+        cumulative += histogram[bin];
+    }
+}
+
+// 所有轮次结束后 prefix 就是第 K 大的 key，key 互不相同，所以不小于它的正好 K 个
+__global__ void topk_gather_kernel(float *predict, int num_bboxes, int num_classes, const unsigned long long *keys,
+                                   const TopKState *state, float *invert_affine_matrix, float *parray, int max_objects,
+                                   int NUM_BOX_ELEMENT) {
+    int position = blockDim.x * blockIdx.x + threadIdx.x;
+    if (position >= num_bboxes) { return; }
+
+    unsigned long long key = keys[position];
+    if (key == 0 || (!state->take_all && key < state->prefix)) { return; }
+
+    int index = atomicAdd(parray, 1);
+    if (index >= max_objects) { return; }
+
+    float *pitem = predict + (5 + num_classes) * position;
+    int label = 0;
+    float confidence = topk_row_confidence(pitem, num_classes, -INFINITY, &label);
+    float cx = pitem[0];
+    float cy = pitem[1];
+    float width = pitem[2];
+    float height = pitem[3];
+
+    // xywh to xyxy，有逆矩阵时从网络输入的坐标映射回原图
+    float left = cx - width * 0.5f;
+    float top = cy - height * 0.5f;
+    float right = cx + width * 0.5f;
+    float bottom = cy + height * 0.5f;
+    if (invert_affine_matrix != nullptr) {
+        affine_project(invert_affine_matrix, left, top, &left, &top);
+        affine_project(invert_affine_matrix, right, bottom, &right, &bottom);
+    }
+
+    float *pout_item = parray + 1 + index * NUM_BOX_ELEMENT;
+    *pout_item++ = left;
+    *pout_item++ = top;
+    *pout_item++ = right;
+    *pout_item++ = bottom;
+    *pout_item++ = confidence;
+    *pout_item++ = label;
+    *pout_item++ = 1; // 用于nms的标志位，1 = keep, 0 = ignore
+}
+
+static size_t topk_align(size_t size) {
+    return (size + 255) / 256 * 256;
+}
+
+static int topk_num_passes(int num_bboxes) {
+    return (32 + topk_index_bits(num_bboxes)) / TOPK_RADIX_BITS;
+}
+
+size_t decode_topk_workspace_size(int num_bboxes) {
+    return topk_align(num_bboxes * sizeof(unsigned long long))
+           + topk_align(topk_num_passes(num_bboxes) * TOPK_RADIX_BINS * sizeof(int) + sizeof(TopKState));
+}
+
+void decode_topk_candidates_invoker(
+    float *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float *invert_affine_matrix, float *parray, int max_objects, int NUM_BOX_ELEMENT, void *workspace, cudaStream_t stream) {
+    int index_bits = topk_index_bits(num_bboxes);
+    int total_bits = 32 + index_bits;
+    int num_passes = topk_num_passes(num_bboxes);
+
+    // workspace = [keys][每一轮的直方图][TopKState]，直方图和状态一次清零
+    char *ptr = (char *)workspace;
+    auto keys = (unsigned long long *)ptr;
+    ptr += topk_align(num_bboxes * sizeof(unsigned long long));
+    auto histogram = (int *)ptr;
+    auto state = (TopKState *)(histogram + num_passes * TOPK_RADIX_BINS);
+    checkRuntime(cudaMemsetAsync(histogram, 0, num_passes * TOPK_RADIX_BINS * sizeof(int) + sizeof(TopKState), stream));
+    checkRuntime(cudaMemsetAsync(parray, 0, sizeof(float), stream));
+
+    auto block = num_bboxes > 512 ? 512 : num_bboxes;
+    auto grid = (num_bboxes + block - 1) / block;
+    topk_key_kernel<<<grid, block, 0, stream>>>(predict, num_bboxes, num_classes, confidence_threshold, index_bits, keys, histogram);
+    topk_select_kernel<<<1, 1, 0, stream>>>(histogram, total_bits - TOPK_RADIX_BITS, 1, max_objects, state);
+
+    for (int pass = 1; pass < num_passes; ++pass) {
+        int shift = total_bits - TOPK_RADIX_BITS * (pass + 1);
+        int *pass_histogram = histogram + pass * TOPK_RADIX_BINS;
+        topk_histogram_kernel<<<grid, block, 0, stream>>>(keys, num_bboxes, shift, state, pass_histogram);
+        topk_select_kernel<<<1, 1, 0, stream>>>(pass_histogram, shift, 0, max_objects, state);
+    }
+
+    topk_gather_kernel<<<grid, block, 0, stream>>>(predict, num_bboxes, num_classes, keys, state, invert_affine_matrix,
+                                                 parray, max_objects, NUM_BOX_ELEMENT);
+}
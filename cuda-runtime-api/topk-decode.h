@@ -0,0 +1,43 @@
+#ifndef TOPK_DECODE_H
+#define TOPK_DECODE_H
+
+#include <stdint.h>
+#include <vector>
+#include "utils.h"
+
+/*
+ * decode_kernel 在通过阈值的候选框超过 max_objects 时，谁先抢到 atomicAdd 谁留下，高置信度的框会被随机丢掉。
+ * 这里的 decode 保证留下的是置信度最高的 max_objects 个候选框（置信度相同时行号小的优先）：
+ *   1. 每一行算出置信度，和行号拼成一个 64 位的唯一 key：高位是置信度的位模式，低位是反转的行号；
+ *   2. 对 key 做基数选择（radix select），每一轮统计 8 位的直方图，确定第 K 大 key 的一个字节，全程不需要回到主机；
+ *   3. key 不小于第 K 大 key 的行写出候选框，正好 K 个。
+ * 非负 float 的位模式作为无符号整数时与数值大小顺序一致，所以可以直接按位比较。
+ */
+#define TOPK_RADIX_BITS 8
+#define TOPK_RADIX_BINS (1 << TOPK_RADIX_BITS)
+
+// 行号占用的位数，按 TOPK_RADIX_BITS 向上取整，保证每一轮正好处理一个字节
+inline int topk_index_bits(int num_bboxes) {
+    int bits = TOPK_RADIX_BITS;
+    while (bits < 32 && (1u << bits) < (unsigned)num_bboxes) { bits += TOPK_RADIX_BITS; }
+    return bits;
+}
+
+/*
+ * CPU 参考实现：与 GPU 版本得到完全相同的候选框集合，按置信度从高到低、行号从小到大排列。
+ * 行的格式与 cpu_decode 相同：[cx, cy, width, height, objectness, class1, class2, ……]
+ */
+std::vector<Box> cpu_decode_topk_candidates(float *predict, int rows, int cols, float confidence_threshold, int max_objects);
+
+/*
+ * GPU 版本，输出格式与 decode_candidates_invoker 相同：parray = [count, box1, box2, ……]，count 不超过 max_objects。
+ * invert_affine_matrix 为 device 上 3x2 的逆仿射矩阵（AffineMatrix::d2i），把框映射回原图坐标，为 nullptr 时保持网络输入的坐标。
+ * workspace 至少需要 decode_topk_workspace_size(num_bboxes) 字节，可以在多次调用之间复用。
+ */
+size_t decode_topk_workspace_size(int num_bboxes);
+
+void decode_topk_candidates_invoker(
+    float *predict, int num_bboxes, int num_classes, float confidence_threshold,
+    float *invert_affine_matrix, float *parray, int max_objects, int NUM_BOX_ELEMENT, void *workspace, cudaStream_t stream);
+
+#endif // TOPK_DECODE_H
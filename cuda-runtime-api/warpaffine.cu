@@ -5,90 +5,6 @@
 // typedef <existing_type> <new_name>; 用于给已存在的类型起别名
 typedef unsigned char uint8_t;
 
-/*
- * 旋转变换：
- * [x'] = [ cos(delta), sin(delta)] [x]
- * [y'] = [-sin(delta), cos(delta)] [y]
- * 缩放变换：
- * [x'] = [scale, 0] [x]
- * [y'] = [0, scale] [y]
- * 平移变换：
- * [x'] = [1, 0] [x] + [ox]
- * [y'] = [0, 1] [y] + [oy]
- * 旋转 + 缩放：
- * [x'] = [ cos(delta)*scale, sin(delta)*scale] [x]
- * [y'] = [-sin(delta)*scale, cos(delta)*scale] [y]
- * 旋转 + 缩放 + 平移：
- * [x'] = [ cos(delta)*scale, sin(delta)*scale, ox] [x]
- * [y'] = [-sin(delta)*scale, cos(delta)*scale, oy] [y]
- * [w'] = [        0        ,        0        ,  1] [1]
- */
-
-struct AffineMatrix {
-    float i2d[6];
-    float d2i[6];
-
-    /*
-     * 求解imat的逆矩阵，仿射变换推导过程中第三行为[0, 0, 1]，所以此处简写为 3x2 的矩阵；
-     */
-    void invertAffineTransfrom(float imat[6], float omat[6]) {
-        float i00 = imat[0];
-        float i01 = imat[1];
-        float i02 = imat[2];
-        float i10 = imat[3];
-        float i11 = imat[4];
-        float i12 = imat[5];
-
-        // 行列式计算，用于判断矩阵是否可逆，如果行列式为0，该矩阵不可逆。否则，计算其倒数
-        float D = i00 * i11 - i01 * i10;
-        D = D != 0 ? 1.0 / D : D;
-
-        // 计算剩余的伴随矩阵除以行列式
-        float A11 = i11 * D;
-        float A22 = i00 * D;
-        float A12 = -i01 * D;
-        float A21 = -i10 * D;
-
-        // 计算新的平移分量 b1 和 b2：
-        float b1 = -A11 * i02 - A12 * i12;
-        float b2 = -A21 * i02 - A22 * i12;
-
-        // 结果输出
-        omat[0] = A11;
-        omat[1] = A12;
-        omat[2] = b1;
-        omat[3] = A21;
-        omat[4] = A22;
-        omat[5] = b2;
-    }
-
-    /*
-     * 该函数包含：缩放变换，两次平移变换。
-     * 缩放是将输入的from图像，等比缩放scale倍，缩放到到to尺度下
-     * 第一次平移是将图像的原点，从左上角，移动到缩放(scale)后图像的中心上
-     * 第二次平移是将图像从原点移动到目标（to）图的中心上
-     * [x'] = [scale,   0  , -scale * from.width  * 0.5 + to.width  * 0.5] [x]
-     * [y'] = [  0  , scale, -scale * from.height * 0.5 + to.height * 0.5] [y]
-     * [z'] = [  0  ,   0  ,                      1                      ] [1]
-     * '+ scale * 0.5 - 0.5' 的原因是使得中心更加对齐，下采样不明显，但是上采样时会比较明显；
-     */
-    void compute(const cv::Size &from, const cv::Size &to) {
-        // 宽与高 放大或者缩小的比例系数
-        float scale_x = to.width / (float)from.width;
-        float scale_y = to.height / (float)from.height;
-
-        float scale = min(scale_x, scale_y);
-
-        i2d[0] = scale;
-        i2d[1] = 0;
-        i2d[2] = -scale * from.width * 0.5 + to.width * 0.5 + scale * 0.5 - 0.5;
-        i2d[3] = 0;
-        i2d[4] = scale;
-        i2d[5] = -scale * from.height * 0.5 + to.height * 0.5 + scale * 0.5 - 0.5;
-        invertAffineTransfrom(i2d, d2i);
-    }
-};
-
 __device__ void affine_project(float *matrix, int x, int y, float *proj_x, float *proj_y) {
     /*
      * 在 CUDA 中，内核函数参数是通过指针传递的，因为内核函数在设备上执行，而数据可能位于设备内存中。
@@ -66,3 +66,9 @@ void cuda_tensorrt_basic_api_6_onnx_plugin();
 void cuda_tensorrt_basic_api_7_integrate_easyplugin();
 
 void cuda_tensorrt_basic_api_8_quantization();
+
+void cuda_tensorrt_basic_api_9_fused_attention();
+void cuda_tensorrt_basic_api_10_fused_norm();
+void cuda_tensorrt_basic_api_11_pattern_rewriter();
+void cuda_tensorrt_basic_api_12_yolo_nms_plugin();
+void cuda_tensorrt_basic_api_13_warmup();
@@ -0,0 +1,290 @@
+#include "cuda-tensorrt-api.h"
+#include "../../cuda-runtime-api/utils.h"
+#include "../../../3rd_third/onnx-tensorrt/NvOnnxParser.h"
+#include "fused-norm.hpp"
+#include <chrono>
+
+// 通过智能指针管理nv返回的指针参数，内存自动释放，避免泄漏
+template <typename _T>
+static std::shared_ptr<_T> make_nvshared(_T *ptr) {
+    return std::shared_ptr<_T>(ptr, [](_T *p) { p->destroy(); });
+}
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static std::vector<float> random_vector(size_t size, uint32_t seed, float offset = 0.0f) {
+    std::vector<float> data(size);
+    for (auto &value : data) {
+        seed = seed * 1664525u + 1013904223u;
+        value = (seed >> 8) / 16777216.0f * 2.0f - 1.0f + offset;
+    }
+    return data;
+}
+
+static const char *norm_name(NormKind kind) {
+    switch (kind) {
+    case NormKind::LayerNorm: return "LayerNorm";
+    case NormKind::RMSNorm: return "RMSNorm";
+    default: return "GroupNorm";
+    }
+}
+
+// 先求均值再求方差的两遍实现，用 double 累加作为参考
+static void reference_norm(const float *x, const float *gamma, const float *beta, float *y, const NormParams &p) {
+    for (int row = 0; row < p.rows; ++row) {
+        const float *xrow = x + (size_t)row * p.cols;
+        double mean = 0, var = 0;
+        if (p.kind != NormKind::RMSNorm) {
+            for (int i = 0; i < p.cols; ++i) { mean += xrow[i]; }
+            mean /= p.cols;
+        }
+        for (int i = 0; i < p.cols; ++i) { var += (xrow[i] - mean) * (xrow[i] - mean); }
+        double rstd = 1.0 / sqrt(var / p.cols + p.epsilon);
+        for (int i = 0; i < p.cols; ++i) {
+            int c = p.affine_index(row, i);
+            y[(size_t)row * p.cols + i] = (float)((xrow[i] - mean) * rstd * (gamma ? gamma[c] : 1.0f) + (beta ? beta[c] : 0.0f));
+        }
+    }
+}
+
+static float max_abs_error(const std::vector<float> &a, const std::vector<float> &b) {
+    float error = 0;
+    for (size_t i = 0; i < a.size(); ++i) { error = std::max(error, fabsf(a[i] - b[i])); }
+    return error;
+}
+
+/*
+ * 拆开导入时每个元素在显存中被读写的次数（只算 [rows, cols] 大小的张量）：
+ * LayerNorm：ReduceMean 读 1，Sub 读写 2，Pow 读写 2，ReduceMean 读 1，Div 读写 2，Mul 读写 2，Add 读写 2，共 12；
+ * RMSNorm：Pow 2，ReduceMean 1，Div 2，Mul 2，共 7；GroupNorm：InstanceNormalization 至少 3，Mul 2，Add 2，共 7。
+ * 融合后读 1 写 1，行太长放不进共享内存时再多读 1。
+ */
+static int decomposed_passes(NormKind kind) {
+    return kind == NormKind::LayerNorm ? 12 : 7;
+}
+
+struct NormCase {
+    const char *name;
+    NormKind kind;
+    int dims[4];
+    int rank;
+    int groups;
+    bool gamma, beta;
+    float offset; // 输入整体加上的偏移，均值远大于方差时检查 Welford 的数值稳定性
+};
+
+// 直接调用 kernel，与两遍的 double 实现、CPU Welford 实现比较
+static bool check_fused_norm_kernel() {
+    const NormCase cases[] = {
+        {"ln [4,77,768]", NormKind::LayerNorm, {4, 77, 768}, 3, 1, true, true, 0.0f},
+        {"ln mean 1000", NormKind::LayerNorm, {64, 1024}, 2, 1, true, true, 1000.0f},
+        {"ln [8,12288] uncached", NormKind::LayerNorm, {8, 12288}, 2, 1, true, true, 0.0f},
+        {"rms [8,4096]", NormKind::RMSNorm, {8, 4096}, 2, 1, true, false, 0.0f},
+        {"rms [33,100] no affine", NormKind::RMSNorm, {33, 100}, 2, 1, false, false, 0.5f},
+        {"gn [2,64,16,16] g32", NormKind::GroupNorm, {2, 64, 16, 16}, 4, 32, true, true, 0.0f},
+        {"gn [1,320,32,32] g32 uncached", NormKind::GroupNorm, {1, 320, 32, 32}, 4, 32, true, true, 0.0f},
+    };
+    bool all_ok = true;
+    printf("%-30s %9s %9s %9s %9s %10s %10s\n", "case", "cpu(ms)", "gpu(ms)", "chain MB", "fused MB", "cpu err", "gpu err");
+    for (auto &item : cases) {
+        NormParams params;
+        params.kind = item.kind;
+        params.groups = item.groups;
+        params.epsilon = item.kind == NormKind::RMSNorm ? 1e-6f : 1e-5f;
+        int channels = item.kind == NormKind::GroupNorm ? item.dims[1] : item.dims[item.rank - 1];
+        if (!norm_setup(item.dims, item.rank, item.gamma ? channels : 0, &params)) {
+            printf("%-30s setup FAILED\n", item.name);
+            all_ok = false;
+            continue;
+        }
+
+        size_t size = (size_t)params.rows * params.cols;
+        auto x = random_vector(size, 1u, item.offset);
+        auto gamma = random_vector(channels, 2u, 1.0f), beta = random_vector(channels, 3u);
+        const float *gamma_host = item.gamma ? gamma.data() : nullptr;
+        const float *beta_host = item.beta ? beta.data() : nullptr;
+
+        std::vector<float> reference(size), cpu(size), gpu(size);
+        reference_norm(x.data(), gamma_host, beta_host, reference.data(), params);
+        double t0 = now_ms();
+        cpu_fused_norm(x.data(), gamma_host, beta_host, cpu.data(), params);
+        double t1 = now_ms();
+
+        float *x_device = nullptr, *y_device = nullptr, *gamma_device = nullptr, *beta_device = nullptr;
+        checkRuntime(cudaMalloc(&x_device, size * sizeof(float)));
+        checkRuntime(cudaMalloc(&y_device, size * sizeof(float)));
+        checkRuntime(cudaMalloc(&gamma_device, channels * sizeof(float)));
+        checkRuntime(cudaMalloc(&beta_device, channels * sizeof(float)));
+        checkRuntime(cudaMemcpy(x_device, x.data(), size * sizeof(float), cudaMemcpyHostToDevice));
+        checkRuntime(cudaMemcpy(gamma_device, gamma.data(), channels * sizeof(float), cudaMemcpyHostToDevice));
+        checkRuntime(cudaMemcpy(beta_device, beta.data(), channels * sizeof(float), cudaMemcpyHostToDevice));
+
+        cudaEvent_t start, stop;
+        checkRuntime(cudaEventCreate(&start));
+        checkRuntime(cudaEventCreate(&stop));
+        checkRuntime(cudaEventRecord(start));
+        fused_norm_invoker(x_device, item.gamma ? gamma_device : nullptr, item.beta ? beta_device : nullptr, y_device, params, nullptr);
+        checkRuntime(cudaEventRecord(stop));
+        checkRuntime(cudaEventSynchronize(stop));
+        checkRuntime(cudaPeekAtLastError());
+        float gpu_ms = 0;
+        checkRuntime(cudaEventElapsedTime(&gpu_ms, start, stop));
+        checkRuntime(cudaMemcpy(gpu.data(), y_device, size * sizeof(float), cudaMemcpyDeviceToHost));
+
+        double mb = size * sizeof(float) / 1024.0 / 1024.0;
+        int fused_passes = params.cols <= NORM_CACHE_COLS ? 2 : 3;
+        float cpu_error = max_abs_error(cpu, reference);
+        float gpu_error = max_abs_error(gpu, reference);
+        bool ok = cpu_error < 1e-3f && gpu_error < 1e-3f;
+        printf("%-30s %9.3f %9.3f %9.2f %9.2f %10.2e %10.2e %s\n", item.name, t1 - t0, gpu_ms, mb * decomposed_passes(item.kind),
+               mb * fused_passes, cpu_error, gpu_error, ok ? "OK" : "FAILED");
+        all_ok &= ok;
+
+        checkRuntime(cudaEventDestroy(start));
+        checkRuntime(cudaEventDestroy(stop));
+        checkRuntime(cudaFree(x_device));
+        checkRuntime(cudaFree(y_device));
+        checkRuntime(cudaFree(gamma_device));
+        checkRuntime(cudaFree(beta_device));
+    }
+    return all_ok;
+}
+
+/*
+ * generate-onnx-10.py 导出的模型：x [b, 64, 8, 8] -> GroupNorm(8) -> [b, 64, 64] -> LayerNorm -> RMSNorm，
+ * opset 13 下 LayerNorm、RMSNorm 被拆成 ReduceMean/Sub/Pow/... ，GroupNorm 被拆成 Reshape/InstanceNormalization/Reshape/Mul/Add，
+ * 解析时被 PluginFusion 替换成 FusedGroupNorm、FusedLayerNorm、FusedRMSNorm 三个插件层。
+ */
+static bool build_norm_model() {
+    TRTLogger logger;
+    auto builder = make_nvshared(nvinfer1::createInferBuilder(logger));
+    auto config = make_nvshared(builder->createBuilderConfig());
+    auto network = make_nvshared(builder->createNetworkV2(1));
+
+    auto parser = make_nvshared(nvonnxparser::createParser(*network, logger));
+    if (!parser->parseFromFile("../src/cuda-tensorrt-basic-api/static/fused_norm_demo.onnx", 1)) {
+        printf("Failed to parse fused_norm_demo.onnx\n");
+        return false;
+    }
+
+    int num_plugins = 0;
+    for (int i = 0; i < network->getNbLayers(); ++i) {
+        auto layer = network->getLayer(i);
+        printf("layer %d: %s\n", i, layer->getName());
+        num_plugins += layer->getType() == nvinfer1::LayerType::kPLUGIN_V2;
+    }
+    printf("%d layers, %d plugin layers\n", network->getNbLayers(), num_plugins);
+    if (num_plugins != 3) {
+        printf("The normalization subgraphs were not fused.\n");
+        return false;
+    }
+
+    int maxBatchSize = 8;
+    config->setMaxWorkspaceSize(1 << 28);
+    auto profile = builder->createOptimizationProfile();
+    auto input_dims = network->getInput(0)->getDimensions();
+    input_dims.d[0] = 1;
+    profile->setDimensions(network->getInput(0)->getName(), nvinfer1::OptProfileSelector::kMIN, input_dims);
+    profile->setDimensions(network->getInput(0)->getName(), nvinfer1::OptProfileSelector::kOPT, input_dims);
+    input_dims.d[0] = maxBatchSize;
+    profile->setDimensions(network->getInput(0)->getName(), nvinfer1::OptProfileSelector::kMAX, input_dims);
+    config->addOptimizationProfile(profile);
+
+    auto engine = make_nvshared(builder->buildEngineWithConfig(*network, *config));
+    if (engine == nullptr) {
+        printf("Build engine failed.\n");
+        return false;
+    }
+
+    auto model_data = make_nvshared(engine->serialize());
+    FILE *f = fopen("../src/cuda-tensorrt-basic-api/static/fused_norm_demo.trtmodel", "wb");
+    fwrite(model_data->data(), 1, model_data->size(), f);
+    fclose(f);
+    printf("Done.\n");
+    return true;
+}
+
+// 与 generate-onnx-10.py 中 init_affine 相同的 gamma、beta
+static void init_affine(int size, std::vector<float> *gamma, std::vector<float> *beta) {
+    gamma->resize(size);
+    beta->resize(size);
+    for (int i = 0; i < size; ++i) {
+        (*gamma)[i] = 1.0f + 0.1f * sinf((float)i);
+        (*beta)[i] = 0.1f * cosf((float)i);
+    }
+}
+
+// 用 engine 推理，与按相同顺序调用 CPU 实现的结果比较
+static bool infer_norm_model() {
+    TRTLogger logger;
+    auto engine_data = CTA::load_file("../src/cuda-tensorrt-basic-api/static/fused_norm_demo.trtmodel");
+    auto runtime = make_nvshared(nvinfer1::createInferRuntime(logger));
+    auto engine = make_nvshared(runtime->deserializeCudaEngine(engine_data.data(), engine_data.size()));
+    if (engine == nullptr) {
+        printf("Deserialize cuda engine failed.\n");
+        return false;
+    }
+    auto execution_context = make_nvshared(engine->createExecutionContext());
+
+    const int batch = 2, channels = 64, height = 8, width = 8, groups = 8;
+    const int tokens = height * width;
+    size_t size = (size_t)batch * channels * tokens;
+    auto x = random_vector(size, 21u);
+    std::vector<float> output(size);
+
+    float *x_device = nullptr, *y_device = nullptr;
+    cudaStream_t stream = nullptr;
+    checkRuntime(cudaStreamCreate(&stream));
+    checkRuntime(cudaMalloc(&x_device, size * sizeof(float)));
+    checkRuntime(cudaMalloc(&y_device, size * sizeof(float)));
+    checkRuntime(cudaMemcpyAsync(x_device, x.data(), size * sizeof(float), cudaMemcpyHostToDevice, stream));
+    execution_context->setBindingDimensions(0, nvinfer1::Dims4(batch, channels, height, width));
+    void *bindings[] = {x_device, y_device};
+    bool success = execution_context->enqueueV2(bindings, stream, nullptr);
+    checkRuntime(cudaMemcpyAsync(output.data(), y_device, size * sizeof(float), cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaStreamSynchronize(stream));
+
+    // GroupNorm -> flatten(2).transpose(1, 2) -> LayerNorm -> RMSNorm
+    std::vector<float> gamma, beta, y(size), t(size), reference(size);
+    NormParams gn, ln, rms;
+    gn.kind = NormKind::GroupNorm;
+    gn.groups = groups;
+    int x_dims[] = {batch, channels, height, width};
+    norm_setup(x_dims, 4, channels, &gn);
+    init_affine(channels, &gamma, &beta);
+    cpu_fused_norm(x.data(), gamma.data(), beta.data(), y.data(), gn);
+    for (int b = 0; b < batch; ++b) {
+        for (int c = 0; c < channels; ++c) {
+            for (int i = 0; i < tokens; ++i) { t[((size_t)b * tokens + i) * channels + c] = y[((size_t)b * channels + c) * tokens + i]; }
+        }
+    }
+    int t_dims[] = {batch, tokens, channels};
+    ln.kind = NormKind::LayerNorm;
+    norm_setup(t_dims, 3, channels, &ln);
+    cpu_fused_norm(t.data(), gamma.data(), beta.data(), y.data(), ln);
+    rms.kind = NormKind::RMSNorm;
+    rms.epsilon = 1e-6f;
+    norm_setup(t_dims, 3, channels, &rms);
+    cpu_fused_norm(y.data(), gamma.data(), nullptr, reference.data(), rms);
+
+    float error = max_abs_error(output, reference);
+    bool ok = success && error < 1e-3f;
+    printf("engine vs cpu max error %.2e  %s\n", error, ok ? "OK" : "FAILED");
+
+    checkRuntime(cudaStreamDestroy(stream));
+    checkRuntime(cudaFree(x_device));
+    checkRuntime(cudaFree(y_device));
+    return ok;
+}
+
+void cuda_tensorrt_basic_api_10_fused_norm() {
+    bool all_ok = check_fused_norm_kernel();
+    if (build_norm_model()) {
+        all_ok &= infer_norm_model();
+    } else {
+        all_ok = false;
+    }
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
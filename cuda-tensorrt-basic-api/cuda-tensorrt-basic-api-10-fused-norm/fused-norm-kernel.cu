@@ -0,0 +1,85 @@
+#include "fused-norm.hpp"
+#include <math.h>
+
+#define FULL_MASK 0xffffffff
+
+// Welford 的部分统计：元素个数、均值、二阶中心矩。RMSNorm 时 mean 始终为 0，m2 是平方和
+struct Welford {
+    float count, mean, m2;
+};
+
+// 两段统计合并（Chan 等人的并行算法），mean 都为 0 时退化为 m2 直接相加
+static __device__ Welford welford_merge(Welford a, Welford b) {
+    float count = a.count + b.count;
+    if (count == 0) { return a; }
+    float delta = b.mean - a.mean;
+    float ratio = b.count / count;
+    return {count, a.mean + delta * ratio, a.m2 + b.m2 + delta * delta * a.count * ratio};
+}
+
+/*
+ * grid = rows，block = NORM_THREADS，一个 block 负责一行。
+ * 第一遍：每个线程按步长 blockDim.x 做 Welford 更新，warp 内用 __shfl_xor_sync 合并，
+ * 每个 warp 的结果写入共享内存由线程 0 合并；cached 时顺便把整行放进 row_cache，第二遍不再读显存。
+ * 第二遍：y = (x - mean) * rstd * gamma + beta。
+ */
+template <bool RMS>
+static __global__ void fused_norm_kernel(const float *x, const float *gamma, const float *beta, float *y, NormParams p, bool cached) {
+    extern __shared__ float row_cache[];
+    __shared__ Welford warp_stats[NORM_THREADS / 32];
+    __shared__ float row_mean, row_rstd;
+
+    int row = blockIdx.x;
+    const float *xrow = x + (size_t)row * p.cols;
+    float *yrow = y + (size_t)row * p.cols;
+
+    Welford stats = {0, 0, 0};
+    for (int i = threadIdx.x; i < p.cols; i += blockDim.x) {
+        float value = xrow[i];
+        if (cached) { row_cache[i] = value; }
+        stats.count += 1;
+        if (RMS) {
+            stats.m2 += value * value;
+        } else {
+            float delta = value - stats.mean;
+            stats.mean += delta / stats.count;
+            stats.m2 += delta * (value - stats.mean);
+        }
+    }
+    for (int offset = 16; offset > 0; offset /= 2) {
+        Welford other = {__shfl_xor_sync(FULL_MASK, stats.count, offset), __shfl_xor_sync(FULL_MASK, stats.mean, offset),
+                         __shfl_xor_sync(FULL_MASK, stats.m2, offset)};
+        stats = welford_merge(stats, other);
+    }
+
+    int warp = threadIdx.x / 32, lane = threadIdx.x % 32;
+    if (lane == 0) { warp_stats[warp] = stats; }
+    __syncthreads();
+    if (threadIdx.x == 0) {
+        Welford total = warp_stats[0];
+        for (int i = 1; i < blockDim.x / 32; ++i) { total = welford_merge(total, warp_stats[i]); }
+        row_mean = total.mean;
+        row_rstd = rsqrtf(total.m2 / p.cols + p.epsilon);
+    }
+    __syncthreads();
+
+    float mean = row_mean, rstd = row_rstd;
+    for (int i = threadIdx.x; i < p.cols; i += blockDim.x) {
+        int c = p.affine_index(row, i);
+        float value = ((cached ? row_cache[i] : xrow[i]) - mean) * rstd;
+        if (gamma) { value *= gamma[c]; }
+        if (beta) { value += beta[c]; }
+        yrow[i] = value;
+    }
+}
+
+void fused_norm_invoker(const float *x, const float *gamma, const float *beta, float *y, const NormParams &params, cudaStream_t stream) {
+    if (params.rows == 0 || params.cols == 0) { return; }
+    bool cached = params.cols <= NORM_CACHE_COLS;
+    size_t shared_bytes = cached ? params.cols * sizeof(float) : 0;
+    if (params.kind == NormKind::RMSNorm) {
+        fused_norm_kernel<true><<<params.rows, NORM_THREADS, shared_bytes, stream>>>(x, gamma, beta, y, params, cached);
+    } else {
+        fused_norm_kernel<false><<<params.rows, NORM_THREADS, shared_bytes, stream>>>(x, gamma, beta, y, params, cached);
+    }
+}
@@ -0,0 +1,71 @@
+#include "../../../3rd_third/onnx-tensorrt/onnxplugin.hpp"
+#include "fused-norm.hpp"
+
+using namespace ONNXPlugin;
+
+/*
+ * info 由 PluginFusion 匹配归一化子图时生成，例如 {"epsilon": 1e-05, "groups": 1}，
+ * 也可以在导出时直接写 Plugin 节点（name_s="FusedLayerNorm" / "FusedRMSNorm" / "FusedGroupNorm"）。
+ */
+struct FusedNormConfig : public LayerConfig {
+    float epsilon = 1e-5f;
+    int groups = 1;
+
+    virtual void init() override {
+        epsilon = info_float(info_, "epsilon", 1e-5f);
+        groups = (int)info_float(info_, "groups", 1);
+    }
+};
+
+// 三种归一化只是统计方式和 gamma 的对齐不同，共用一个实现。输入 x，常量 gamma、beta 由 Plugin 导入函数放在 weights 中
+class FusedNormBase : public TRTPlugin {
+public:
+    virtual NormKind kind() const = 0;
+
+    virtual std::shared_ptr<LayerConfig> new_config() override {
+        return std::shared_ptr<LayerConfig>(new FusedNormConfig());
+    }
+
+    int enqueue(const std::vector<GTensor> &inputs, std::vector<GTensor> &outputs, const std::vector<GTensor> &weights, void *workspace, cudaStream_t stream) override {
+        auto config = static_cast<FusedNormConfig *>(config_.get());
+        const GTensor *gamma = weights.size() > 0 ? &weights[0] : nullptr;
+        const GTensor *beta = weights.size() > 1 ? &weights[1] : nullptr;
+
+        NormParams params;
+        params.kind = kind();
+        params.groups = config->groups;
+        params.epsilon = config->epsilon;
+        const auto &x = inputs[0].shape_;
+        int gamma_size = gamma ? gamma->count() : 0;
+        if (!norm_setup(x.data(), x.size(), gamma_size, &params) || (beta && beta->count() != gamma_size)) {
+            printf("%s: unsupported shapes, gamma/beta must match the normalized channels\n", getPluginType());
+            return -1;
+        }
+
+        fused_norm_invoker(inputs[0].ptr<float>(), gamma ? gamma->ptr<float>() : nullptr, beta ? beta->ptr<float>() : nullptr,
+                           outputs[0].ptr<float>(), params, stream);
+        return cudaGetLastError() == cudaSuccess ? 0 : -1;
+    }
+};
+
+class FusedLayerNorm : public FusedNormBase {
+public:
+    SetupPlugin(FusedLayerNorm);
+    virtual NormKind kind() const override { return NormKind::LayerNorm; }
+};
+
+class FusedRMSNorm : public FusedNormBase {
+public:
+    SetupPlugin(FusedRMSNorm);
+    virtual NormKind kind() const override { return NormKind::RMSNorm; }
+};
+
+class FusedGroupNorm : public FusedNormBase {
+public:
+    SetupPlugin(FusedGroupNorm);
+    virtual NormKind kind() const override { return NormKind::GroupNorm; }
+};
+
+RegisterPlugin(FusedLayerNorm);
+RegisterPlugin(FusedRMSNorm);
+RegisterPlugin(FusedGroupNorm);
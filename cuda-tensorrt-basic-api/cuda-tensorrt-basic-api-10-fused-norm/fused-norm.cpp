@@ -0,0 +1,78 @@
+#include "fused-norm.hpp"
+#include <math.h>
+
+bool norm_setup(const int *dims, int rank, int gamma_size, NormParams *params) {
+    NormParams &p = *params;
+    if (rank < 1) { return false; }
+
+    size_t total = 1;
+    for (int i = 0; i < rank; ++i) { total *= dims[i]; }
+    if (p.kind == NormKind::GroupNorm) {
+        // [N, C, ...]，通道数要能被组数整除
+        if (rank < 2 || p.groups < 1 || dims[1] % p.groups != 0) { return false; }
+        int channels = dims[1];
+        p.spatial = (int)(total / ((size_t)dims[0] * channels));
+        p.rows = dims[0] * p.groups;
+        p.cols = channels / p.groups * p.spatial;
+        return gamma_size == 0 || gamma_size == channels;
+    }
+
+    p.groups = 1;
+    p.spatial = 1;
+    p.cols = dims[rank - 1];
+    p.rows = (int)(total / p.cols);
+    return gamma_size == 0 || gamma_size == p.cols;
+}
+
+struct Welford {
+    float count, mean, m2;
+};
+
+static Welford welford_merge(Welford a, Welford b) {
+    float count = a.count + b.count;
+    if (count == 0) { return a; }
+    float delta = b.mean - a.mean;
+    float ratio = b.count / count;
+    return {count, a.mean + delta * ratio, a.m2 + b.m2 + delta * delta * a.count * ratio};
+}
+
+void cpu_fused_norm(const float *x, const float *gamma, const float *beta, float *y, const NormParams &p) {
+    bool rms = p.kind == NormKind::RMSNorm;
+    Welford stats[NORM_THREADS];
+    for (int row = 0; row < p.rows; ++row) {
+        const float *xrow = x + (size_t)row * p.cols;
+        float *yrow = y + (size_t)row * p.cols;
+
+        // 与 GPU 相同：按 NORM_THREADS 的步长分段做 Welford，每 32 段按树形合并，再依次合并各个 warp 的结果。
+        // 树形合并每一步的两边元素个数相近，输入整体偏离 0 很远时均值的舍入误差比逐个更新一整行小得多
+        for (int lane = 0; lane < NORM_THREADS; ++lane) {
+            Welford &s = stats[lane];
+            s = {0, 0, 0};
+            for (int i = lane; i < p.cols; i += NORM_THREADS) {
+                s.count += 1;
+                if (rms) {
+                    s.m2 += xrow[i] * xrow[i];
+                } else {
+                    float delta = xrow[i] - s.mean;
+                    s.mean += delta / s.count;
+                    s.m2 += delta * (xrow[i] - s.mean);
+                }
+            }
+        }
+        for (int offset = 1; offset < 32; offset *= 2) {
+            for (int lane = 0; lane < NORM_THREADS; lane += 2 * offset) { stats[lane] = welford_merge(stats[lane], stats[lane + offset]); }
+        }
+        Welford total = stats[0];
+        for (int warp = 1; warp < NORM_THREADS / 32; ++warp) { total = welford_merge(total, stats[warp * 32]); }
+        float mean = total.mean, m2 = total.m2;
+        float rstd = 1.0f / sqrtf(m2 / p.cols + p.epsilon);
+
+        for (int i = 0; i < p.cols; ++i) {
+            int c = p.affine_index(row, i);
+            float value = (xrow[i] - mean) * rstd;
+            if (gamma) { value *= gamma[c]; }
+            if (beta) { value += beta[c]; }
+            yrow[i] = value;
+        }
+    }
+}
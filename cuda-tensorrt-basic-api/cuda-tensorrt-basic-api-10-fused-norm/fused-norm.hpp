@@ -0,0 +1,49 @@
+#ifndef FUSED_NORM_HPP
+#define FUSED_NORM_HPP
+
+#include <stddef.h>
+#include <cuda_runtime.h>
+
+/*
+ * 融合的 LayerNorm、RMSNorm、GroupNorm。拆开导入时 ReduceMean/Sub/Pow/ReduceMean/Add/Sqrt/Div/Mul/Add 每一层都要读写一次显存，
+ * 这里一个 block 负责一行，用 Welford 算法一遍得到均值和方差（warp 内 __shfl_xor_sync 合并，warp 之间经共享内存合并），
+ * 第二遍归一化并乘 gamma、加 beta。行不超过 NORM_CACHE_COLS 时第一遍把整行留在共享内存中，x 只从显存读一次。
+ *
+ * LayerNorm、RMSNorm 在最后一维上归一化：rows = 前面维度之积，cols = 最后一维，gamma/beta 长度为 cols。
+ * GroupNorm 输入 [N, C, ...]：每个 (n, g) 是一行，cols = C / groups * spatial，gamma/beta 长度为 C。
+ */
+#ifdef __CUDACC__
+#define NORM_HOST_DEVICE __host__ __device__
+#else
+#define NORM_HOST_DEVICE
+#endif
+
+#define NORM_THREADS 256
+#define NORM_CACHE_COLS 8192 // 32KB 共享内存
+
+enum class NormKind : int { LayerNorm = 0, RMSNorm = 1, GroupNorm = 2 };
+
+struct NormParams {
+    NormKind kind = NormKind::LayerNorm;
+    int rows = 0, cols = 0;
+    int groups = 1;  // GroupNorm 的组数，其他为 1
+    int spatial = 1; // GroupNorm 每个通道的元素数，其他为 1
+    float epsilon = 1e-5f;
+
+    // 行内第 i 个元素对应的 gamma/beta 下标
+    NORM_HOST_DEVICE int affine_index(int row, int i) const { return (row % groups) * (cols / spatial) + i / spatial; }
+};
+
+/*
+ * 由输入形状填写 params 的 rows、cols、spatial，kind、groups 需要先填好。
+ * gamma_size 为 gamma/beta 的元素数，没有仿射变换时传 0。形状不匹配时返回 false。
+ */
+bool norm_setup(const int *dims, int rank, int gamma_size, NormParams *params);
+
+// 与 GPU 相同的 Welford 一遍统计，用于验证和 CPU 上的回退，gamma、beta 可以为 nullptr
+void cpu_fused_norm(const float *x, const float *gamma, const float *beta, float *y, const NormParams &params);
+
+// 所有指针在设备端
+void fused_norm_invoker(const float *x, const float *gamma, const float *beta, float *y, const NormParams &params, cudaStream_t stream);
+
+#endif // FUSED_NORM_HPP
@@ -0,0 +1,69 @@
+import torch
+import torch.nn as nn
+import torch.onnx
+
+
+def init_affine(weight, bias=None):
+    """
+    gamma = 1 + 0.1 * sin(i)，beta = 0.1 * cos(i)，cuda-tensorrt-basic-api-10-fused-norm.cpp 用相同的公式计算 CPU 参考结果。
+    """
+    index = torch.arange(weight.numel(), dtype=torch.float32)
+    with torch.no_grad():
+        weight.copy_(1 + 0.1 * torch.sin(index))
+        if bias is not None:
+            bias.copy_(0.1 * torch.cos(index))
+
+
+class RMSNorm(nn.Module):
+    def __init__(self, dim, eps=1e-6):
+        super().__init__()
+        self.eps = eps
+        self.weight = nn.Parameter(torch.ones(dim))
+
+    def forward(self, x):
+        return self.weight * (x / torch.sqrt(x.pow(2).mean(-1, keepdim=True) + self.eps))
+
+
+class Norms(nn.Module):
+    """
+    GroupNorm -> LayerNorm -> RMSNorm，opset 13 下都被拆成 ReduceMean/Sub/Pow/Sqrt/Div 或 Reshape/InstanceNormalization 等小算子，
+    解析时被 PluginFusion 匹配并替换成 FusedGroupNorm、FusedLayerNorm、FusedRMSNorm 三个插件层。
+    """
+    def __init__(self, channels=64, groups=8):
+        super().__init__()
+        self.group_norm = nn.GroupNorm(groups, channels)
+        self.layer_norm = nn.LayerNorm(channels)
+        self.rms_norm = RMSNorm(channels)
+        init_affine(self.group_norm.weight, self.group_norm.bias)
+        init_affine(self.layer_norm.weight, self.layer_norm.bias)
+        init_affine(self.rms_norm.weight)
+
+    def forward(self, x):
+        x = self.group_norm(x)
+        x = x.flatten(2).transpose(1, 2)
+        return self.rms_norm(self.layer_norm(x))
+
+
+if __name__ == "__main__":
+
+    model = Norms().eval()
+    x = torch.randn(2, 64, 8, 8)
+    output = model(x)
+    print(f"output shape = {output.shape}")
+
+    torch.onnx.export(
+        model,
+        (x,),
+        "./src/cuda-tensorrt-basic-api/static/fused_norm_demo.onnx",
+        verbose=False,
+        input_names=["x"],
+        output_names=["output"],
+        # opset 17 起 LayerNorm 导出为 LayerNormalization，同样会被替换成 FusedLayerNorm
+        opset_version=13,
+        dynamic_axes={
+            "x": {0: "batch"},
+            "output": {0: "batch"},
+        }
+    )
+
+    print("Done.!")
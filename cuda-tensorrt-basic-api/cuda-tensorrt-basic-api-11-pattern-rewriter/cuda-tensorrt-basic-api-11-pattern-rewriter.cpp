@@ -0,0 +1,265 @@
+#include "cuda-tensorrt-api.h"
+#include "../../../3rd_third/onnx-tensorrt/PatternRewriter.hpp"
+#include <chrono>
+
+/*
+ * PatternRewriter 只依赖 protobuf，这里不创建 builder，直接在 C++ 中构造 GraphProto 调用 planPluginFusion，
+ * 检查哪些节点被替换成了 Plugin 节点、Plugin 节点的输入和 info 是否正确。
+ */
+using namespace onnx2trt;
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static ::onnx::NodeProto *add_node(::onnx::GraphProto &graph, const char *op_type, const std::vector<std::string> &inputs,
+                                   const std::string &output) {
+    auto *node = graph.add_node();
+    node->set_op_type(op_type);
+    node->set_name(output + "_node");
+    for (const auto &input : inputs) {
+        node->add_input(input);
+    }
+    node->add_output(output);
+    return node;
+}
+
+static void add_initializer(::onnx::GraphProto &graph, const std::string &name, const std::vector<int64_t> &dims,
+                            const std::vector<float> &values) {
+    auto *tensor = graph.add_initializer();
+    tensor->set_name(name);
+    tensor->set_data_type(::onnx::TensorProto::FLOAT);
+    for (auto dim : dims) {
+        tensor->add_dims(dim);
+    }
+    for (auto value : values) {
+        tensor->add_float_data(value);
+    }
+}
+
+static void add_axes_initializer(::onnx::GraphProto &graph, const std::string &name, int64_t axis) {
+    auto *tensor = graph.add_initializer();
+    tensor->set_name(name);
+    tensor->set_data_type(::onnx::TensorProto::INT64);
+    tensor->add_dims(1);
+    tensor->add_int64_data(axis);
+}
+
+static void add_axes_attribute(::onnx::NodeProto *node, int64_t axis) {
+    auto *attribute = node->add_attribute();
+    attribute->set_name("axes");
+    attribute->set_type(::onnx::AttributeProto::INTS);
+    attribute->add_ints(axis);
+}
+
+static const std::string &node_attribute(const ::onnx::NodeProto &node, const char *name) {
+    static const std::string empty;
+    auto *attribute = findAttribute(node, name);
+    return attribute ? attribute->s() : empty;
+}
+
+static bool expect(const char *name, const FusionPlan &plan, size_t replaced, const char *plugin = nullptr, const char *info = nullptr) {
+    bool ok = plan.replaced.size() == replaced;
+    printf("%-44s replaced %zu removed %zu", name, plan.replaced.size(), plan.removed.size());
+    if (ok && replaced == 1) {
+        const auto &node = plan.replaced.begin()->second;
+        printf("  %s %s", node_attribute(node, "name").c_str(), node_attribute(node, "info").c_str());
+        ok = (!plugin || node_attribute(node, "name") == plugin) && (!info || node_attribute(node, "info") == info);
+    }
+    printf("  %s\n", ok ? "OK" : "FAILED");
+    return ok;
+}
+
+static const PluginAvailable all_available = [](const std::string &) { return true; };
+
+// 插件注册自己的模式：x * Sigmoid(x) 替换为 SiLU，Mul 的两种输入顺序都能匹配
+static bool check_registered_pattern() {
+    registerPluginPattern(PatternBuilder("SiLU")
+                              .input("x")
+                              .node("Sigmoid", "sigmoid", {"x"})
+                              .node("Mul", "y", {"x", "sigmoid"})
+                              .build("y"));
+
+    // LeakyRelu 的 alpha 没有写时按 ONNX 默认值 0.01 比较
+    registerPluginPattern(PatternBuilder("LeakyRelu001")
+                              .input("x")
+                              .node("LeakyRelu", "y", {"x"})
+                              .attrFloat("alpha", 0.01f)
+                              .capture("alpha", "y", "alpha")
+                              .build("y"));
+
+    bool ok = true;
+    for (int order = 0; order < 2; ++order) {
+        ::onnx::GraphProto graph;
+        graph.add_input()->set_name("x");
+        graph.add_output()->set_name("y");
+        add_node(graph, "Sigmoid", {"x"}, "s");
+        add_node(graph, "Mul", order ? std::vector<std::string>{"s", "x"} : std::vector<std::string>{"x", "s"}, "y");
+        ok &= expect(order ? "SiLU, Mul(sigmoid, x)" : "SiLU, Mul(x, sigmoid)", planPluginFusion(graph, 13, all_available), 1, "SiLU", "{}");
+    }
+    {
+        // Sigmoid 的输入不是 Mul 的另一个输入，不是 SiLU
+        ::onnx::GraphProto graph;
+        graph.add_input()->set_name("x");
+        graph.add_input()->set_name("gate");
+        graph.add_output()->set_name("y");
+        add_node(graph, "Sigmoid", {"gate"}, "s");
+        add_node(graph, "Mul", {"x", "s"}, "y");
+        ok &= expect("GLU, Mul(x, sigmoid(gate))", planPluginFusion(graph, 13, all_available), 0);
+    }
+    {
+        // Sigmoid 的输出还被图外使用，不能删掉
+        ::onnx::GraphProto graph;
+        graph.add_input()->set_name("x");
+        graph.add_output()->set_name("y");
+        graph.add_output()->set_name("s");
+        add_node(graph, "Sigmoid", {"x"}, "s");
+        add_node(graph, "Mul", {"x", "s"}, "y");
+        ok &= expect("SiLU, sigmoid is a graph output", planPluginFusion(graph, 13, all_available), 0);
+    }
+    for (int with_alpha = 0; with_alpha < 2; ++with_alpha) {
+        ::onnx::GraphProto graph;
+        graph.add_input()->set_name("x");
+        graph.add_output()->set_name("y");
+        auto *node = add_node(graph, "LeakyRelu", {"x"}, "y");
+        if (with_alpha) {
+            auto *alpha = node->add_attribute();
+            alpha->set_name("alpha");
+            alpha->set_type(::onnx::AttributeProto::FLOAT);
+            alpha->set_f(0.2f);
+        }
+        ok &= expect(with_alpha ? "LeakyRelu alpha=0.2" : "LeakyRelu default alpha", planPluginFusion(graph, 13, all_available),
+                     with_alpha ? 0 : 1, "LeakyRelu001");
+    }
+    {
+        // 插件没有注册时不替换
+        ::onnx::GraphProto graph;
+        graph.add_input()->set_name("x");
+        graph.add_output()->set_name("y");
+        add_node(graph, "Sigmoid", {"x"}, "s");
+        add_node(graph, "Mul", {"x", "s"}, "y");
+        ok &= expect("SiLU, plugin not available", planPluginFusion(graph, 13, [](const std::string &name) { return name != "SiLU"; }), 0);
+    }
+    return ok;
+}
+
+// 内置的模式在不同 opset 下的写法
+static bool check_opset() {
+    bool ok = true;
+    // Softmax 不写 axis 时，opset 13 以前默认是 1（把后面的维度展平），不是按最后一维的注意力
+    for (int opset : {11, 13}) {
+        ::onnx::GraphProto graph;
+        for (auto name : {"q", "k", "v"}) {
+            graph.add_input()->set_name(name);
+        }
+        graph.add_output()->set_name("out");
+        add_node(graph, "MatMul", {"q", "k"}, "scores");
+        add_node(graph, "Softmax", {"scores"}, "prob");
+        add_node(graph, "MatMul", {"prob", "v"}, "out");
+        ok &= expect(opset == 11 ? "attention, Softmax default axis, opset 11" : "attention, Softmax default axis, opset 13",
+                     planPluginFusion(graph, opset, all_available), opset == 11 ? 0 : 1, "FusedAttention");
+    }
+
+    // RMSNorm，opset 13 中 axes 是属性，opset 18 中是常数输入
+    for (int opset : {13, 18}) {
+        for (int64_t axis : {-1, 1}) {
+            ::onnx::GraphProto graph;
+            graph.add_input()->set_name("x");
+            graph.add_output()->set_name("out");
+            add_initializer(graph, "two", {}, {2.0f});
+            add_initializer(graph, "eps", {}, {1e-6f});
+            add_initializer(graph, "gamma", {8}, std::vector<float>(8, 1.0f));
+            add_node(graph, "Pow", {"x", "two"}, "square");
+            if (opset >= 18) {
+                add_axes_initializer(graph, "axes", axis);
+                add_node(graph, "ReduceMean", {"square", "axes"}, "mean_square");
+            } else {
+                add_axes_attribute(add_node(graph, "ReduceMean", {"square"}, "mean_square"), axis);
+            }
+            add_node(graph, "Add", {"mean_square", "eps"}, "var_eps");
+            add_node(graph, "Sqrt", {"var_eps"}, "rms");
+            add_node(graph, "Div", {"x", "rms"}, "normalized");
+            add_node(graph, "Mul", {"normalized", "gamma"}, "out");
+
+            char name[64];
+            snprintf(name, sizeof(name), "RMSNorm, axes=[%d], opset %d", (int)axis, opset);
+            ok &= expect(name, planPluginFusion(graph, opset, all_available), axis == -1 ? 1 : 0, "FusedRMSNorm");
+        }
+    }
+    return ok;
+}
+
+// 用 generate-onnx-11.py 保存的模板，与 check_registered_pattern 中的 SiLU 相同，插件名为 SiLUFromFile
+static bool check_pattern_file() {
+    SubgraphPattern pattern;
+    std::string error;
+    if (!loadPattern("../src/cuda-tensorrt-basic-api/static/silu_pattern.onnx", &pattern, &error)) {
+        printf("%s, run generate-onnx-11.py first  FAILED\n", error.c_str());
+        return false;
+    }
+    PatternRewriter rewriter(13);
+    if (!rewriter.add(pattern, &error)) {
+        printf("invalid pattern %s  FAILED\n", error.c_str());
+        return false;
+    }
+
+    ::onnx::GraphProto graph;
+    graph.add_input()->set_name("x");
+    graph.add_output()->set_name("y");
+    add_node(graph, "Sigmoid", {"x"}, "s");
+    add_node(graph, "Mul", {"s", "x"}, "y");
+    GraphIndex index(graph);
+    FusionPlan plan;
+    rewriter.run(index, &plan);
+    return expect("SiLU from silu_pattern.onnx", plan, 1, pattern.pluginName.c_str());
+}
+
+// 链式的 LayerNorm 块，节点数增加 16 倍，匹配时间应该大致也是 16 倍
+static bool check_linear_time() {
+    bool ok = true;
+    double first_us_per_node = 0;
+    for (int blocks : {1000, 4000, 16000}) {
+        ::onnx::GraphProto graph;
+        graph.add_input()->set_name("t0");
+        add_initializer(graph, "two", {}, {2.0f});
+        add_initializer(graph, "eps", {}, {1e-5f});
+        add_initializer(graph, "gamma", {8}, std::vector<float>(8, 1.0f));
+        add_initializer(graph, "beta", {8}, std::vector<float>(8, 0.0f));
+        for (int i = 0; i < blocks; ++i) {
+            std::string p = "b" + std::to_string(i) + "_", x = "t" + std::to_string(i), y = "t" + std::to_string(i + 1);
+            add_axes_attribute(add_node(graph, "ReduceMean", {x}, p + "mean"), -1);
+            add_node(graph, "Sub", {x, p + "mean"}, p + "diff");
+            add_node(graph, "Pow", {p + "diff", "two"}, p + "square");
+            add_axes_attribute(add_node(graph, "ReduceMean", {p + "square"}, p + "var"), -1);
+            add_node(graph, "Add", {p + "var", "eps"}, p + "var_eps");
+            add_node(graph, "Sqrt", {p + "var_eps"}, p + "std");
+            add_node(graph, "Div", {p + "diff", p + "std"}, p + "normalized");
+            add_node(graph, "Mul", {p + "normalized", "gamma"}, p + "scaled");
+            add_node(graph, "Add", {p + "scaled", "beta"}, p + "shifted");
+            add_node(graph, "Relu", {p + "shifted"}, y);
+        }
+        graph.add_output()->set_name("t" + std::to_string(blocks));
+
+        double begin = now_ms();
+        FusionPlan plan = planPluginFusion(graph, 13, all_available);
+        double elapsed = now_ms() - begin;
+        double us_per_node = elapsed * 1000 / graph.node_size();
+        if (first_us_per_node == 0) {
+            first_us_per_node = us_per_node;
+        }
+        // 允许 4 倍的波动（哈希表变大后缓存命中率下降），平方复杂度在 16 倍节点时会差 16 倍
+        bool block_ok = (int)plan.replaced.size() == blocks && us_per_node < first_us_per_node * 4;
+        printf("%6d LayerNorm blocks, %6d nodes: replaced %5zu in %8.2f ms, %.2f us/node  %s\n", blocks, graph.node_size(),
+               plan.replaced.size(), elapsed, us_per_node, block_ok ? "OK" : "FAILED");
+        ok &= block_ok;
+    }
+    return ok;
+}
+
+void cuda_tensorrt_basic_api_11_pattern_rewriter() {
+    bool all_ok = check_registered_pattern();
+    all_ok &= check_opset();
+    all_ok &= check_pattern_file();
+    all_ok &= check_linear_time();
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
@@ -0,0 +1,36 @@
+import onnx
+import onnx.helper as helper
+
+
+def make_silu_pattern():
+    """
+    SiLU 的模板 y = x * Sigmoid(x)，由 PatternRewriter 的 loadPattern 读取：
+        graph.input        通配的张量，可以绑定到原图中任意张量
+        graph.initializer  必须绑定到原图中的常数，只写名字不写数据时任意常数都可以
+        graph.output       只有一个，产生它的节点是锚点，匹配到的区域替换成一个 Plugin 节点
+    插件名写在 metadata_props 的 plugin 中，需要写进 info 的属性写成 capture.<key> = <节点名>:<属性名> 或者 <常数名>。
+    """
+    nodes = [
+        helper.make_node(name="sigmoid", op_type="Sigmoid", inputs=["x"], outputs=["s"]),
+        helper.make_node(name="mul", op_type="Mul", inputs=["x", "s"], outputs=["y"]),
+    ]
+
+    # 模板只用来比较结构，形状不需要写
+    graph = helper.make_graph(
+        nodes=nodes,
+        name="silu_pattern",
+        inputs=[helper.make_tensor_value_info("x", onnx.TensorProto.FLOAT, None)],
+        outputs=[helper.make_tensor_value_info("y", onnx.TensorProto.FLOAT, None)],
+    )
+
+    model = helper.make_model(graph, opset_imports=[helper.make_opsetid("", 13)])
+    helper.set_model_props(model, {"plugin": "SiLUFromFile"})
+    return model
+
+
+if __name__ == "__main__":
+
+    model = make_silu_pattern()
+    onnx.checker.check_model(model)
+    onnx.save(model, "./src/cuda-tensorrt-basic-api/static/silu_pattern.onnx")
+    print("Done.!")
@@ -0,0 +1,257 @@
+#include "cuda-tensorrt-api.h"
+#include "../../cuda-runtime-api/utils.h"
+#include "../../../3rd_third/onnx-tensorrt/NvOnnxParser.h"
+#include "yolo-nms.hpp"
+#include <chrono>
+#include <string.h>
+
+// 通过智能指针管理nv返回的指针参数，内存自动释放，避免泄漏
+template <typename _T>
+static std::shared_ptr<_T> make_nvshared(_T *ptr) {
+    return std::shared_ptr<_T>(ptr, [](_T *p) { p->destroy(); });
+}
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static float random_uniform(uint32_t &seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) / 16777216.0f;
+}
+
+/*
+ * 模拟检测头的输出：num_objects 个目标，每个目标附近有若干个 anchor 预测出抖动的框（NMS 要去掉的重复框），
+ * 其余 anchor 的 objectness 很低。类别分数中目标类别最高。
+ */
+static std::vector<float> synthetic_predict(int anchors, int classes, int num_objects, uint32_t seed) {
+    int cols = 5 + classes;
+    std::vector<float> predict((size_t)anchors * cols);
+    for (int i = 0; i < anchors; ++i) {
+        float *pitem = &predict[(size_t)i * cols];
+        pitem[0] = random_uniform(seed) * 640;
+        pitem[1] = random_uniform(seed) * 640;
+        pitem[2] = 10 + random_uniform(seed) * 100;
+        pitem[3] = 10 + random_uniform(seed) * 100;
+        pitem[4] = random_uniform(seed) * 0.2f;
+        for (int c = 0; c < classes; ++c) { pitem[5 + c] = random_uniform(seed); }
+    }
+    for (int o = 0; o < num_objects; ++o) {
+        float cx = random_uniform(seed) * 640, cy = random_uniform(seed) * 640;
+        float width = 20 + random_uniform(seed) * 200, height = 20 + random_uniform(seed) * 200;
+        int label = (int)(random_uniform(seed) * classes);
+        int duplicates = 1 + (int)(random_uniform(seed) * 12);
+        for (int d = 0; d < duplicates; ++d) {
+            float *pitem = &predict[(size_t)(seed % anchors) * cols];
+            random_uniform(seed);
+            pitem[0] = cx + (random_uniform(seed) - 0.5f) * width * 0.1f;
+            pitem[1] = cy + (random_uniform(seed) - 0.5f) * height * 0.1f;
+            pitem[2] = width * (0.9f + random_uniform(seed) * 0.2f);
+            pitem[3] = height * (0.9f + random_uniform(seed) * 0.2f);
+            pitem[4] = 0.5f + random_uniform(seed) * 0.5f;
+            for (int c = 0; c < classes; ++c) { pitem[5 + c] = random_uniform(seed) * 0.3f; }
+            pitem[5 + label] = 0.6f + random_uniform(seed) * 0.4f;
+        }
+    }
+    return predict;
+}
+
+// 逐张图比较 count 和前 count 个框
+static bool same_detections(const std::vector<float> &a, const std::vector<float> &b, const YoloNMSParams &p, float *max_error) {
+    *max_error = 0;
+    for (int i = 0; i < p.batch; ++i) {
+        const float *pa = &a[(size_t)i * p.output_stride()];
+        const float *pb = &b[(size_t)i * p.output_stride()];
+        if (pa[0] != pb[0]) { return false; }
+        for (int k = 0; k < (int)pa[0] * YOLO_NMS_BOX_ELEMENT; ++k) { *max_error = std::max(*max_error, fabsf(pa[1 + k] - pb[1 + k])); }
+    }
+    return *max_error < 1e-3f;
+}
+
+static bool check_yolo_nms_kernel() {
+    struct Case {
+        const char *name;
+        int batch, anchors, classes, objects;
+        float confidence_threshold;
+        int max_objects;
+    };
+    Case cases[] = {
+        {"1 x 25200 x 80, 30 objects", 1, 25200, 80, 30, 0.25f, 1000},
+        {"8 x 25200 x 80, 30 objects", 8, 25200, 80, 30, 0.25f, 1000},
+        {"4 x 8400 x 3, 300 objects", 4, 8400, 3, 300, 0.25f, 1000},
+        {"4 x 8400 x 3, max_objects 20", 4, 8400, 3, 300, 0.25f, 20},
+        {"2 x 25200 x 80, nothing above 0.99", 2, 25200, 80, 30, 0.99f, 1000},
+    };
+
+    printf("%-36s %9s %9s %8s %10s %s\n", "case", "cpu ms", "gpu ms", "boxes", "max error", "");
+    bool all_ok = true;
+    for (const auto &item : cases) {
+        YoloNMSParams params;
+        params.confidence_threshold = item.confidence_threshold;
+        params.max_objects = item.max_objects;
+        int dims[] = {item.batch, item.anchors, 5 + item.classes};
+        yolo_nms_setup(dims, 3, &params);
+
+        std::vector<float> predict;
+        for (int b = 0; b < item.batch; ++b) {
+            auto image = synthetic_predict(item.anchors, item.classes, item.objects, 100u + b);
+            predict.insert(predict.end(), image.begin(), image.end());
+        }
+        size_t output_size = (size_t)item.batch * params.output_stride();
+        std::vector<float> cpu(output_size), gpu(output_size);
+        double t0 = now_ms();
+        cpu_yolo_decode_nms(predict.data(), cpu.data(), params);
+        double t1 = now_ms();
+
+        float *predict_device = nullptr, *output_device = nullptr;
+        void *workspace = nullptr;
+        checkRuntime(cudaMalloc(&predict_device, predict.size() * sizeof(float)));
+        checkRuntime(cudaMalloc(&output_device, output_size * sizeof(float)));
+        checkRuntime(cudaMalloc(&workspace, yolo_nms_workspace_size(item.batch, params.max_candidates)));
+        checkRuntime(cudaMemcpy(predict_device, predict.data(), predict.size() * sizeof(float), cudaMemcpyHostToDevice));
+
+        cudaEvent_t start, stop;
+        checkRuntime(cudaEventCreate(&start));
+        checkRuntime(cudaEventCreate(&stop));
+        checkRuntime(cudaEventRecord(start));
+        yolo_decode_nms_invoker(predict_device, output_device, workspace, params, nullptr);
+        checkRuntime(cudaEventRecord(stop));
+        checkRuntime(cudaEventSynchronize(stop));
+        checkRuntime(cudaPeekAtLastError());
+        float gpu_ms = 0;
+        checkRuntime(cudaEventElapsedTime(&gpu_ms, start, stop));
+        checkRuntime(cudaMemcpy(gpu.data(), output_device, output_size * sizeof(float), cudaMemcpyDeviceToHost));
+
+        int boxes = 0;
+        for (int b = 0; b < item.batch; ++b) { boxes += (int)cpu[(size_t)b * params.output_stride()]; }
+        float error = 0;
+        bool ok = same_detections(cpu, gpu, params, &error);
+        printf("%-36s %9.3f %9.3f %8d %10.2e %s\n", item.name, t1 - t0, gpu_ms, boxes, error, ok ? "OK" : "FAILED");
+        all_ok &= ok;
+
+        checkRuntime(cudaEventDestroy(start));
+        checkRuntime(cudaEventDestroy(stop));
+        checkRuntime(cudaFree(predict_device));
+        checkRuntime(cudaFree(output_device));
+        checkRuntime(cudaFree(workspace));
+    }
+    return all_ok;
+}
+
+/*
+ * generate-onnx-12.py 导出的模型：输入检测头的原始输出 predict [b, 25200, 85]，经过 Plugin 节点 YoloDecodeNMS，
+ * 输出 [b, 1 + 1000 * 6]。实际使用时 Plugin 节点接在 yolov5 的检测头之后，engine 直接输出最终的框。
+ */
+static bool build_yolo_nms_model() {
+    TRTLogger logger;
+    auto builder = make_nvshared(nvinfer1::createInferBuilder(logger));
+    auto config = make_nvshared(builder->createBuilderConfig());
+    auto network = make_nvshared(builder->createNetworkV2(1));
+
+    auto parser = make_nvshared(nvonnxparser::createParser(*network, logger));
+    if (!parser->parseFromFile("../src/cuda-tensorrt-basic-api/static/yolo_nms_demo.onnx", 1)) {
+        printf("Failed to parse yolo_nms_demo.onnx\n");
+        return false;
+    }
+
+    int maxBatchSize = 8;
+    config->setMaxWorkspaceSize(1 << 28);
+    auto profile = builder->createOptimizationProfile();
+    auto input_dims = network->getInput(0)->getDimensions();
+    input_dims.d[0] = 1;
+    profile->setDimensions(network->getInput(0)->getName(), nvinfer1::OptProfileSelector::kMIN, input_dims);
+    profile->setDimensions(network->getInput(0)->getName(), nvinfer1::OptProfileSelector::kOPT, input_dims);
+    input_dims.d[0] = maxBatchSize;
+    profile->setDimensions(network->getInput(0)->getName(), nvinfer1::OptProfileSelector::kMAX, input_dims);
+    config->addOptimizationProfile(profile);
+
+    auto engine = make_nvshared(builder->buildEngineWithConfig(*network, *config));
+    if (engine == nullptr) {
+        printf("Build engine failed.\n");
+        return false;
+    }
+
+    auto model_data = make_nvshared(engine->serialize());
+    FILE *f = fopen("../src/cuda-tensorrt-basic-api/static/yolo_nms_demo.trtmodel", "wb");
+    fwrite(model_data->data(), 1, model_data->size(), f);
+    fclose(f);
+    printf("Done.\n");
+    return true;
+}
+
+/*
+ * 用 cuda-runtime-api 12 课的 predict.data（一张图的 [25200, 85]）组成 batch 2，第二张图的 objectness 减半，
+ * engine 的输出与 CPU 实现比较。只需要读回 2 x (1 + 6000) 个 float，原来需要读回 2 x 25200 x 85 个。
+ */
+static bool infer_yolo_nms_model() {
+    TRTLogger logger;
+    auto engine_data = CTA::load_file("../src/cuda-tensorrt-basic-api/static/yolo_nms_demo.trtmodel");
+    auto runtime = make_nvshared(nvinfer1::createInferRuntime(logger));
+    auto engine = make_nvshared(runtime->deserializeCudaEngine(engine_data.data(), engine_data.size()));
+    if (engine == nullptr) {
+        printf("Deserialize cuda engine failed.\n");
+        return false;
+    }
+    auto execution_context = make_nvshared(engine->createExecutionContext());
+
+    auto data = CTA::load_file("../src/cuda-runtime-api/static/predict.data");
+    const int batch = 2, cols = 85;
+    int anchors = (int)(data.size() / sizeof(float) / cols);
+    if (anchors == 0) {
+        printf("Failed to load predict.data\n");
+        return false;
+    }
+    size_t image_size = (size_t)anchors * cols;
+    std::vector<float> predict(batch * image_size);
+    memcpy(predict.data(), data.data(), image_size * sizeof(float));
+    memcpy(predict.data() + image_size, data.data(), image_size * sizeof(float));
+    for (int i = 0; i < anchors; ++i) { predict[image_size + (size_t)i * cols + 4] *= 0.5f; }
+
+    YoloNMSParams params;
+    int dims[] = {batch, anchors, cols};
+    yolo_nms_setup(dims, 3, &params);
+    size_t output_size = (size_t)batch * params.output_stride();
+    std::vector<float> output(output_size), reference(output_size);
+
+    float *predict_device = nullptr, *output_device = nullptr;
+    cudaStream_t stream = nullptr;
+    checkRuntime(cudaStreamCreate(&stream));
+    checkRuntime(cudaMalloc(&predict_device, predict.size() * sizeof(float)));
+    checkRuntime(cudaMalloc(&output_device, output_size * sizeof(float)));
+    checkRuntime(cudaMemcpyAsync(predict_device, predict.data(), predict.size() * sizeof(float), cudaMemcpyHostToDevice, stream));
+    execution_context->setBindingDimensions(0, nvinfer1::Dims3(batch, anchors, cols));
+    void *bindings[] = {predict_device, output_device};
+    bool success = execution_context->enqueueV2(bindings, stream, nullptr);
+    checkRuntime(cudaMemcpyAsync(output.data(), output_device, output_size * sizeof(float), cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaStreamSynchronize(stream));
+
+    cpu_yolo_decode_nms(predict.data(), reference.data(), params);
+    float error = 0;
+    bool ok = success && same_detections(output, reference, params, &error);
+    for (int b = 0; b < batch; ++b) {
+        const float *pout = &output[(size_t)b * params.output_stride()];
+        printf("image %d: %d boxes", b, (int)pout[0]);
+        for (int i = 0; i < std::min((int)pout[0], 3); ++i) {
+            const float *box = pout + 1 + i * YOLO_NMS_BOX_ELEMENT;
+            printf("  [%.0f %.0f %.0f %.0f %.2f %d]", box[0], box[1], box[2], box[3], box[4], (int)box[5]);
+        }
+        printf("\n");
+    }
+    printf("output %.1f KB instead of %.1f MB, engine vs cpu max error %.2e  %s\n", output_size * sizeof(float) / 1024.0,
+           predict.size() * sizeof(float) / 1024.0 / 1024.0, error, ok ? "OK" : "FAILED");
+
+    checkRuntime(cudaStreamDestroy(stream));
+    checkRuntime(cudaFree(predict_device));
+    checkRuntime(cudaFree(output_device));
+    return ok;
+}
+
+void cuda_tensorrt_basic_api_12_yolo_nms_plugin() {
+    bool all_ok = check_yolo_nms_kernel();
+    if (build_yolo_nms_model()) {
+        all_ok &= infer_yolo_nms_model();
+    } else {
+        all_ok = false;
+    }
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
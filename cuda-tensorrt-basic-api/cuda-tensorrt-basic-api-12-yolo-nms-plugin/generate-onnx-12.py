@@ -0,0 +1,66 @@
+import json
+import torch
+import torch.nn as nn
+import torch.onnx
+
+
+class YoloDecodeNMSImpl(torch.autograd.Function):
+    """
+    导出为 Plugin 节点，由 builtin_op_importers.cpp 的 Plugin 导入函数创建 YoloDecodeNMS 插件，
+    阈值写在 info 中，engine 的输出为 [batch, 1 + max_objects * 6]，每张图为 [count, box1, box2, ...]。
+    """
+    @staticmethod
+    def forward(ctx, predict, confidence_threshold, nms_threshold, max_objects):
+        # 只需要输出形状正确，导出时不会用到这里的值
+        return torch.zeros(predict.size(0), 1 + max_objects * 6)
+
+    @staticmethod
+    def symbolic(g, predict, confidence_threshold, nms_threshold, max_objects):
+        return g.op("Plugin", predict,
+                    name_s="YoloDecodeNMS",
+                    info_s=json.dumps(dict(
+                        confidence_threshold=confidence_threshold,
+                        nms_threshold=nms_threshold,
+                        max_objects=max_objects), ensure_ascii=False)
+                    )
+
+
+class YoloWithNMS(nn.Module):
+    """
+    在检测器之后接上 decode + NMS。这里的检测器是 nn.Identity，输入直接是检测头的原始输出 [b, 25200, 85]，
+    可以用 cuda-runtime-api 12 课的 predict.data 测试；实际使用时换成 yolov5 的模型即可。
+    """
+    def __init__(self, detector, confidence_threshold=0.25, nms_threshold=0.45, max_objects=1000):
+        super().__init__()
+        self.detector = detector
+        self.confidence_threshold = confidence_threshold
+        self.nms_threshold = nms_threshold
+        self.max_objects = max_objects
+
+    def forward(self, x):
+        predict = self.detector(x)
+        return YoloDecodeNMSImpl.apply(predict, self.confidence_threshold, self.nms_threshold, self.max_objects)
+
+
+if __name__ == "__main__":
+
+    model = YoloWithNMS(nn.Identity()).eval()
+    predict = torch.rand(1, 25200, 85)
+    output = model(predict)
+    print(f"output shape = {output.shape}")
+
+    torch.onnx.export(
+        model,
+        (predict,),
+        "./src/cuda-tensorrt-basic-api/static/yolo_nms_demo.onnx",
+        verbose=False,
+        input_names=["predict"],
+        output_names=["detections"],
+        opset_version=11,
+        dynamic_axes={
+            "predict": {0: "batch"},
+            "detections": {0: "batch"},
+        }
+    )
+
+    print("Done.!")
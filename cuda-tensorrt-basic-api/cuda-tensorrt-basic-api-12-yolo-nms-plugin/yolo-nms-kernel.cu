@@ -0,0 +1,132 @@
+#include "yolo-nms.hpp"
+#include <limits.h>
+#include <math.h>
+
+static __device__ int *candidate_counts(void *workspace) {
+    return (int *)workspace;
+}
+
+static __device__ float *candidate_boxes(void *workspace, const YoloNMSParams &p, int b) {
+    size_t counts = (p.batch * sizeof(int) + 255) / 256 * 256;
+    return (float *)((char *)workspace + counts) + (size_t)b * p.max_candidates * YOLO_NMS_CANDIDATE_ELEMENT;
+}
+
+/*
+ * grid = (ceil(anchors / 256), batch)，一个线程一个 anchor，与 gpu-decode.cu 中的 decode_kernel 相同，
+ * 只是按 blockIdx.y 分图，候选框额外保存 anchor 下标。
+ */
+static __global__ void yolo_decode_kernel(const float *predict, void *workspace, YoloNMSParams p) {
+    int b = blockIdx.y;
+    int anchor = blockDim.x * blockIdx.x + threadIdx.x;
+    if (anchor >= p.num_anchors) { return; }
+
+    const float *pitem = predict + ((size_t)b * p.num_anchors + anchor) * (5 + p.num_classes);
+    float objectness = pitem[4];
+    if (objectness < p.confidence_threshold) { return; }
+
+    const float *class_confidence = pitem + 5;
+    float confidence = class_confidence[0];
+    int label = 0;
+    for (int i = 1; i < p.num_classes; ++i) {
+        if (class_confidence[i] > confidence) {
+            confidence = class_confidence[i];
+            label = i;
+        }
+    }
+    confidence *= objectness;
+    if (confidence < p.confidence_threshold) { return; }
+
+    int index = atomicAdd(candidate_counts(workspace) + b, 1);
+    if (index >= p.max_candidates) { return; }
+
+    float cx = pitem[0], cy = pitem[1], width = pitem[2], height = pitem[3];
+    float *pout = candidate_boxes(workspace, p, b) + index * YOLO_NMS_CANDIDATE_ELEMENT;
+    pout[0] = cx - width * 0.5f;
+    pout[1] = cy - height * 0.5f;
+    pout[2] = cx + width * 0.5f;
+    pout[3] = cy + height * 0.5f;
+    pout[4] = confidence;
+    pout[5] = label;
+    pout[6] = anchor;
+}
+
+// 排序后位置 x 上的框是否应该排在 y 之前：置信度高的在前，相同时 anchor 下标小的在前，补齐的位置在最后
+static __device__ bool sorts_before(const float *scores, const int *order, const float *boxes, int x, int y) {
+    if (scores[x] != scores[y]) { return scores[x] > scores[y]; }
+    int ax = order[x] < 0 ? INT_MAX : (int)boxes[order[x] * YOLO_NMS_CANDIDATE_ELEMENT + 6];
+    int ay = order[y] < 0 ? INT_MAX : (int)boxes[order[y] * YOLO_NMS_CANDIDATE_ELEMENT + 6];
+    return ax < ay;
+}
+
+/*
+ * grid = batch，block = YOLO_NMS_THREADS，一个 block 一张图。
+ * 候选框的置信度和下标放在共享内存中双调排序，补齐到 2 的幂，补齐的位置置信度为 -inf。
+ * 然后按顺序贪心 NMS：每一轮所有线程读到相同的 removed[i]，分支是一致的，保留时由线程 0 写输出，
+ * 所有线程并行检查后面的框，__syncthreads 之后进入下一轮。
+ */
+static __global__ void yolo_nms_kernel(void *workspace, float *output, YoloNMSParams p) {
+    __shared__ float scores[YOLO_NMS_MAX_CANDIDATES];
+    __shared__ int order[YOLO_NMS_MAX_CANDIDATES];
+    __shared__ unsigned char removed[YOLO_NMS_MAX_CANDIDATES];
+
+    int b = blockIdx.x;
+    const float *boxes = candidate_boxes(workspace, p, b);
+    int count = min(candidate_counts(workspace)[b], p.max_candidates);
+    int size = 1;
+    while (size < count) { size *= 2; }
+
+    for (int i = threadIdx.x; i < size; i += blockDim.x) {
+        scores[i] = i < count ? boxes[i * YOLO_NMS_CANDIDATE_ELEMENT + 4] : -INFINITY;
+        order[i] = i < count ? i : -1;
+        removed[i] = 0;
+    }
+    __syncthreads();
+
+    for (int k = 2; k <= size; k *= 2) {
+        for (int j = k / 2; j > 0; j /= 2) {
+            for (int i = threadIdx.x; i < size; i += blockDim.x) {
+                int partner = i ^ j;
+                if (partner <= i) { continue; }
+                bool forward = (i & k) == 0;
+                bool swap = forward ? sorts_before(scores, order, boxes, partner, i) : sorts_before(scores, order, boxes, i, partner);
+                if (swap) {
+                    float score = scores[i];
+                    scores[i] = scores[partner];
+                    scores[partner] = score;
+                    int index = order[i];
+                    order[i] = order[partner];
+                    order[partner] = index;
+                }
+            }
+            __syncthreads();
+        }
+    }
+
+    float *pout = output + (size_t)b * p.output_stride();
+    int kept = 0;
+    for (int i = 0; i < count && kept < p.max_objects; ++i) {
+        if (removed[i]) { continue; }
+
+        const float *ibox = boxes + order[i] * YOLO_NMS_CANDIDATE_ELEMENT;
+        if (threadIdx.x == 0) {
+            for (int e = 0; e < YOLO_NMS_BOX_ELEMENT; ++e) { pout[1 + kept * YOLO_NMS_BOX_ELEMENT + e] = ibox[e]; }
+        }
+        ++kept;
+        for (int j = i + 1 + threadIdx.x; j < count; j += blockDim.x) {
+            const float *jbox = boxes + order[j] * YOLO_NMS_CANDIDATE_ELEMENT;
+            if (!removed[j] && jbox[5] == ibox[5] && yolo_box_iou(ibox, jbox) > p.nms_threshold) { removed[j] = 1; }
+        }
+        __syncthreads();
+    }
+    if (threadIdx.x == 0) { pout[0] = kept; }
+}
+
+void yolo_decode_nms_invoker(const float *predict, float *output, void *workspace, const YoloNMSParams &params, cudaStream_t stream) {
+    if (params.batch == 0) { return; }
+    cudaMemsetAsync(workspace, 0, params.batch * sizeof(int), stream);
+    if (params.num_anchors > 0) {
+        dim3 grid((params.num_anchors + 255) / 256, params.batch);
+        yolo_decode_kernel<<<grid, 256, 0, stream>>>(predict, workspace, params);
+    }
+    yolo_nms_kernel<<<params.batch, YOLO_NMS_THREADS, 0, stream>>>(workspace, output, params);
+}
@@ -0,0 +1,62 @@
+#include "../../../3rd_third/onnx-tensorrt/onnxplugin.hpp"
+#include "yolo-nms.hpp"
+#include <algorithm>
+
+using namespace ONNXPlugin;
+
+/*
+ * 导出时在检测头之后写 Plugin 节点（name_s="YoloDecodeNMS"），阈值写在 info 中，例如
+ * {"confidence_threshold": 0.25, "nms_threshold": 0.45, "max_objects": 1000}，没有写的项取默认值。
+ */
+struct YoloDecodeNMSConfig : public LayerConfig {
+    YoloNMSParams params;
+
+    virtual void init() override {
+        params.confidence_threshold = info_float(info_, "confidence_threshold", 0.25f);
+        params.nms_threshold = info_float(info_, "nms_threshold", 0.45f);
+        params.max_objects = (int)info_float(info_, "max_objects", 1000);
+        params.max_candidates = (int)info_float(info_, "max_candidates", YOLO_NMS_MAX_CANDIDATES);
+    }
+};
+
+// 输入 predict [batch, anchors, 5 + classes]，输出 [batch, 1 + max_objects * 6]
+class YoloDecodeNMS : public TRTPlugin {
+public:
+    SetupPlugin(YoloDecodeNMS);
+
+    virtual std::shared_ptr<LayerConfig> new_config() override {
+        return std::shared_ptr<LayerConfig>(new YoloDecodeNMSConfig());
+    }
+
+    virtual nvinfer1::DimsExprs getOutputDimensions(
+        int32_t outputIndex, const nvinfer1::DimsExprs *inputs, int32_t nbInputs, nvinfer1::IExprBuilder &exprBuilder) noexcept override {
+        auto config = static_cast<YoloDecodeNMSConfig *>(config_.get());
+        nvinfer1::DimsExprs output;
+        output.nbDims = 2;
+        output.d[0] = inputs[0].d[0];
+        output.d[1] = exprBuilder.constant(config->params.output_stride());
+        return output;
+    }
+
+    // 工作空间与最大 batch 有关，configurePlugin 拿到 profile 的最大形状之后再计算
+    virtual void config_finish() override {
+        auto config = static_cast<YoloDecodeNMSConfig *>(config_.get());
+        int max_candidates = std::max(1, std::min(config->params.max_candidates, YOLO_NMS_MAX_CANDIDATES));
+        config->workspace_size_ = yolo_nms_workspace_size(config->max_batch_size_, max_candidates);
+    }
+
+    int enqueue(const std::vector<GTensor> &inputs, std::vector<GTensor> &outputs, const std::vector<GTensor> &weights, void *workspace, cudaStream_t stream) override {
+        auto config = static_cast<YoloDecodeNMSConfig *>(config_.get());
+        YoloNMSParams params = config->params;
+        const auto &dims = inputs[0].shape_;
+        if (!yolo_nms_setup(dims.data(), dims.size(), &params) || params.batch > config->max_batch_size_) {
+            printf("%s: unsupported input, predict must be [batch, anchors, 5 + classes]\n", getPluginType());
+            return -1;
+        }
+
+        yolo_decode_nms_invoker(inputs[0].ptr<float>(), outputs[0].ptr<float>(), workspace, params, stream);
+        return cudaGetLastError() == cudaSuccess ? 0 : -1;
+    }
+};
+
+RegisterPlugin(YoloDecodeNMS);
@@ -0,0 +1,69 @@
+#include "yolo-nms.hpp"
+#include <algorithm>
+#include <vector>
+
+bool yolo_nms_setup(const int *dims, int rank, YoloNMSParams *params) {
+    if (rank != 3 || dims[2] < 6) { return false; }
+    params->batch = dims[0];
+    params->num_anchors = dims[1];
+    params->num_classes = dims[2] - 5;
+    params->max_candidates = std::max(1, std::min(params->max_candidates, YOLO_NMS_MAX_CANDIDATES));
+    return params->max_objects > 0;
+}
+
+size_t yolo_nms_workspace_size(int max_batch, int max_candidates) {
+    // 计数放在前面，按 256 字节对齐后放候选框
+    size_t counts = (max_batch * sizeof(int) + 255) / 256 * 256;
+    return counts + (size_t)max_batch * max_candidates * YOLO_NMS_CANDIDATE_ELEMENT * sizeof(float);
+}
+
+void cpu_yolo_decode_nms(const float *predict, float *output, const YoloNMSParams &p) {
+    int cols = 5 + p.num_classes;
+    std::vector<float> candidates;
+    std::vector<int> order;
+    std::vector<bool> removed;
+    for (int b = 0; b < p.batch; ++b) {
+        // decode，与 GPU 相同：objectness 和 confidence 两次过滤，类别取第一个最大值
+        candidates.clear();
+        const float *pbatch = predict + (size_t)b * p.num_anchors * cols;
+        for (int anchor = 0; anchor < p.num_anchors; ++anchor) {
+            const float *pitem = pbatch + (size_t)anchor * cols;
+            float objectness = pitem[4];
+            if (objectness < p.confidence_threshold) { continue; }
+
+            const float *pclass = pitem + 5;
+            int label = (int)(std::max_element(pclass, pclass + p.num_classes) - pclass);
+            float confidence = pclass[label] * objectness;
+            if (confidence < p.confidence_threshold) { continue; }
+            if ((int)(candidates.size() / YOLO_NMS_CANDIDATE_ELEMENT) >= p.max_candidates) { break; }
+
+            float cx = pitem[0], cy = pitem[1], width = pitem[2], height = pitem[3];
+            float box[YOLO_NMS_CANDIDATE_ELEMENT] = {cx - width * 0.5f, cy - height * 0.5f, cx + width * 0.5f, cy + height * 0.5f,
+                                                     confidence, (float)label, (float)anchor};
+            candidates.insert(candidates.end(), box, box + YOLO_NMS_CANDIDATE_ELEMENT);
+        }
+
+        // 候选框已经按 anchor 下标排列，稳定排序后置信度相同的按下标
+        int count = (int)(candidates.size() / YOLO_NMS_CANDIDATE_ELEMENT);
+        order.resize(count);
+        for (int i = 0; i < count; ++i) { order[i] = i; }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return candidates[a * YOLO_NMS_CANDIDATE_ELEMENT + 4] > candidates[b * YOLO_NMS_CANDIDATE_ELEMENT + 4];
+        });
+
+        float *pout = output + (size_t)b * p.output_stride();
+        int kept = 0;
+        removed.assign(count, false);
+        for (int i = 0; i < count && kept < p.max_objects; ++i) {
+            if (removed[i]) { continue; }
+            const float *ibox = &candidates[order[i] * YOLO_NMS_CANDIDATE_ELEMENT];
+            std::copy(ibox, ibox + YOLO_NMS_BOX_ELEMENT, pout + 1 + kept * YOLO_NMS_BOX_ELEMENT);
+            ++kept;
+            for (int j = i + 1; j < count; ++j) {
+                const float *jbox = &candidates[order[j] * YOLO_NMS_CANDIDATE_ELEMENT];
+                if (!removed[j] && jbox[5] == ibox[5] && yolo_box_iou(ibox, jbox) > p.nms_threshold) { removed[j] = true; }
+            }
+        }
+        pout[0] = (float)kept;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef YOLO_NMS_HPP
+#define YOLO_NMS_HPP
+
+#include <stddef.h>
+#include <cuda_runtime.h>
+
+/*
+ * YOLOv5 的后处理（decode + NMS）放进 engine：输入检测头的原始输出 predict [batch, anchors, 5 + classes]，
+ * 每行为 cx, cy, w, h, objectness, class scores...，输出 [batch, 1 + max_objects * YOLO_NMS_BOX_ELEMENT]，
+ * 每张图为 [count, box1, box2, ...]，box 为 left, top, right, bottom, confidence, label，按置信度从高到低排列。
+ * 这样 engine 的输出只有几十 KB，不需要把 25200 x 85 的原始输出读回来，也不需要在 enqueueV2 之后再启动后处理的 kernel。
+ *
+ * GPU 上分两步：
+ *   1. decode：一个线程一个 anchor，过阈值的框用 atomicAdd 追加到工作空间中这张图的候选列表；
+ *   2. nms：一个 block 一张图，候选框在共享内存中做双调排序（置信度相同按 anchor 下标），
+ *      再按顺序贪心 NMS：保留第 i 个框时，block 内的线程并行地去掉后面同类且 IoU > nms_threshold 的框。
+ * atomicAdd 的顺序不确定，排序之后结果是确定的，与 cpu_yolo_decode_nms 相同。
+ */
+#ifdef __CUDACC__
+#define YOLO_NMS_HOST_DEVICE __host__ __device__
+#else
+#define YOLO_NMS_HOST_DEVICE
+#endif
+
+#define YOLO_NMS_BOX_ELEMENT 6        // 输出的 left, top, right, bottom, confidence, label
+#define YOLO_NMS_CANDIDATE_ELEMENT 7  // 候选框另外保存 anchor 下标，用于排序
+#define YOLO_NMS_THREADS 1024
+#define YOLO_NMS_MAX_CANDIDATES 4096  // 一张图最多的候选框数，排序在共享内存中进行，需要是 2 的幂
+
+struct YoloNMSParams {
+    int batch = 1, num_anchors = 0, num_classes = 0;
+    float confidence_threshold = 0.25f;
+    float nms_threshold = 0.45f;
+    int max_objects = 1000;                         // 每张图最多输出的框数
+    int max_candidates = YOLO_NMS_MAX_CANDIDATES;   // 每张图最多的候选框数，超出时 GPU 上保留哪些候选框不确定
+
+    YOLO_NMS_HOST_DEVICE int output_stride() const { return 1 + max_objects * YOLO_NMS_BOX_ELEMENT; }
+};
+
+YOLO_NMS_HOST_DEVICE inline float yolo_box_iou(const float *a, const float *b) {
+    float cross_left = a[0] > b[0] ? a[0] : b[0];
+    float cross_top = a[1] > b[1] ? a[1] : b[1];
+    float cross_right = a[2] < b[2] ? a[2] : b[2];
+    float cross_bottom = a[3] < b[3] ? a[3] : b[3];
+    float cross_width = cross_right - cross_left, cross_height = cross_bottom - cross_top;
+    if (cross_width <= 0 || cross_height <= 0) { return 0.0f; }
+
+    float cross_area = cross_width * cross_height;
+    float union_area = (a[2] - a[0]) * (a[3] - a[1]) + (b[2] - b[0]) * (b[3] - b[1]) - cross_area;
+    return union_area > 0 ? cross_area / union_area : 0.0f;
+}
+
+// 由 predict 的形状 [batch, anchors, 5 + classes] 填写 params，形状不对时返回 false
+bool yolo_nms_setup(const int *dims, int rank, YoloNMSParams *params);
+
+// GPU 实现需要的工作空间：每张图的候选框计数和候选框
+size_t yolo_nms_workspace_size(int max_batch, int max_candidates);
+
+// 与 GPU 相同的阈值、排序和贪心 NMS，用于验证和 CPU 上的回退
+void cpu_yolo_decode_nms(const float *predict, float *output, const YoloNMSParams &params);
+
+// 所有指针在设备端，workspace 至少 yolo_nms_workspace_size(params.batch, params.max_candidates) 字节
+void yolo_decode_nms_invoker(const float *predict, float *output, void *workspace, const YoloNMSParams &params, cudaStream_t stream);
+
+#endif // YOLO_NMS_HPP
@@ -0,0 +1,161 @@
+#include "cuda-tensorrt-api.h"
+#include "../../cuda-runtime-api/utils.h"
+#include "warmup.hpp"
+#include <cuda.h>
+#include <memory>
+
+// 通过智能指针管理nv返回的指针参数，内存自动释放，避免泄漏
+template <typename _T>
+static std::shared_ptr<_T> make_nvshared(_T *ptr) {
+    return std::shared_ptr<_T>(ptr, [](_T *p) { p->destroy(); });
+}
+
+/*
+ * 两层 3x3 卷积 + relu 的动态形状模型，两个 profile：
+ *   profile 0：小图，batch 1 ~ 8，32 ~ 256
+ *   profile 1：大图，batch 1 ~ 4，256 ~ 640
+ * 服务中通常每个 profile 一个执行上下文，两个上下文可以同时推理。
+ */
+static bool build_warmup_model(const char *file) {
+    TRTLogger logger;
+    auto builder = make_nvshared(nvinfer1::createInferBuilder(logger));
+    auto config = make_nvshared(builder->createBuilderConfig());
+    auto network = make_nvshared(builder->createNetworkV2(1));
+
+    const int channels[] = {3, 16, 16};
+    std::vector<std::vector<float>> weights(2), biases(2);
+    uint32_t seed = 1;
+    nvinfer1::ITensor *tensor = network->addInput("image", nvinfer1::DataType::kFLOAT, nvinfer1::Dims4(-1, 3, -1, -1));
+    for (int layer = 0; layer < 2; ++layer) {
+        weights[layer].resize(channels[layer + 1] * channels[layer] * 9);
+        biases[layer].resize(channels[layer + 1], 0.01f);
+        for (auto &value : weights[layer]) {
+            seed = seed * 1664525u + 1013904223u;
+            value = ((seed >> 8) / 16777216.0f - 0.5f) * 0.2f;
+        }
+        auto conv = network->addConvolution(*tensor, channels[layer + 1], nvinfer1::DimsHW(3, 3),
+                                            CTA::make_weights(weights[layer].data(), weights[layer].size()),
+                                            CTA::make_weights(biases[layer].data(), biases[layer].size()));
+        conv->setPadding(nvinfer1::DimsHW(1, 1));
+        tensor = network->addActivation(*conv->getOutput(0), nvinfer1::ActivationType::kRELU)->getOutput(0);
+    }
+    tensor->setName("feature");
+    network->markOutput(*tensor);
+    config->setMaxWorkspaceSize(1 << 28);
+
+    int shapes[2][3][2] = {{{1, 32}, {4, 128}, {8, 256}}, {{1, 256}, {2, 512}, {4, 640}}};
+    nvinfer1::OptProfileSelector selectors[] = {nvinfer1::OptProfileSelector::kMIN, nvinfer1::OptProfileSelector::kOPT,
+                                                nvinfer1::OptProfileSelector::kMAX};
+    for (int p = 0; p < 2; ++p) {
+        auto profile = builder->createOptimizationProfile();
+        for (int s = 0; s < 3; ++s) {
+            int batch = shapes[p][s][0], size = shapes[p][s][1];
+            profile->setDimensions("image", selectors[s], nvinfer1::Dims4(batch, 3, size, size));
+        }
+        config->addOptimizationProfile(profile);
+    }
+
+    auto engine = make_nvshared(builder->buildEngineWithConfig(*network, *config));
+    if (engine == nullptr) {
+        printf("Build engine failed.\n");
+        return false;
+    }
+    auto model_data = make_nvshared(engine->serialize());
+    FILE *f = fopen(file, "wb");
+    if (f == nullptr) {
+        printf("Open %s failed.\n", file);
+        return false;
+    }
+    fwrite(model_data->data(), 1, model_data->size(), f);
+    fclose(f);
+    printf("Done.\n");
+    return true;
+}
+
+/*
+ * 模拟服务启动：cuInit -> 创建 CUDA 上下文 -> 读 engine 文件 -> 反序列化 -> 创建执行上下文 -> 预热 -> ready，
+ * 每一步记录到时间线。预热前后比较同一个形状第一次推理与稳定时的延迟。
+ * 构建 engine 会初始化 CUDA、加载 TensorRT 的库，之后的时间线就不是冷启动了。所以 engine 文件不存在时只构建，
+ * 再运行一次才测量启动。
+ */
+void cuda_tensorrt_basic_api_13_warmup() {
+    const char *engine_file = "../src/cuda-tensorrt-basic-api/static/warmup_demo.trtmodel";
+    FILE *exists = fopen(engine_file, "rb");
+    if (exists == nullptr) {
+        if (build_warmup_model(engine_file)) {
+            printf("Engine %s built, run again to measure a cold start.\n", engine_file);
+        }
+        return;
+    }
+    fclose(exists);
+
+    bool ok = true;
+    TRTLogger logger;
+    StartupTimeline timeline;
+    {
+        StartupTimeline::Scope scope(timeline, "cuInit");
+        CUresult code = cuInit(0);
+        if (code != CUDA_SUCCESS) {
+            printf("cuInit failed, code = %d\n", (int)code);
+            return;
+        }
+    }
+    {
+        // 运行时 API 第一次调用时创建主上下文，cudaFree(0) 只是触发它
+        StartupTimeline::Scope scope(timeline, "cuda context");
+        checkRuntime(cudaSetDevice(0));
+        checkRuntime(cudaFree(0));
+    }
+    double read_begin = timeline.now_ms();
+    auto engine_data = CTA::load_file(engine_file);
+    timeline.add("file read", read_begin, timeline.now_ms());
+    std::shared_ptr<nvinfer1::IRuntime> runtime;
+    std::shared_ptr<nvinfer1::ICudaEngine> engine;
+    {
+        StartupTimeline::Scope scope(timeline, "deserialize");
+        runtime = make_nvshared(nvinfer1::createInferRuntime(logger));
+        engine = make_nvshared(runtime->deserializeCudaEngine(engine_data.data(), engine_data.size()));
+    }
+    if (engine == nullptr) {
+        printf("Deserialize cuda engine failed.\n");
+        return;
+    }
+
+    cudaStream_t stream = nullptr;
+    checkRuntime(cudaStreamCreate(&stream));
+    std::vector<std::shared_ptr<nvinfer1::IExecutionContext>> contexts;
+    {
+        // 第一个上下文默认使用 profile 0，之后的每个上下文选择自己的 profile
+        StartupTimeline::Scope scope(timeline, "execution contexts");
+        for (int p = 0; p < engine->getNbOptimizationProfiles(); ++p) {
+            contexts.push_back(make_nvshared(engine->createExecutionContext()));
+            if (p > 0) { contexts.back()->setOptimizationProfileAsync(p, stream); }
+        }
+        checkRuntime(cudaStreamSynchronize(stream));
+    }
+
+    WarmupConfig config;
+    WarmupManager manager(config, &timeline);
+    std::vector<nvinfer1::IExecutionContext *> raw_contexts;
+    for (auto &context : contexts) { raw_contexts.push_back(context.get()); }
+    manager.add_model("conv-demo", engine.get(), raw_contexts);
+
+    bool ready_before = manager.ready("conv-demo");
+    bool stable = manager.warmup_all(stream);
+    bool ready_after = manager.ready("conv-demo");
+
+    timeline.print();
+    manager.print_report();
+
+    auto results = manager.results();
+    bool all_ran = results.size() == contexts.size() * 3;
+    for (auto &result : results) { all_ran &= result.ok; }
+    printf("%-60s %s\n", "every context warmed at kMIN / kOPT / kMAX", all_ran ? "OK" : "FAILED");
+    printf("%-60s %s\n", "model ready only after warm-up", !ready_before && ready_after ? "OK" : "FAILED");
+    printf("%-60s %s\n", "latency stabilized for every shape", stable ? "OK" : "not stable (increase max_iterations)");
+    ok &= all_ran && !ready_before && ready_after;
+
+    contexts.clear();
+    checkRuntime(cudaStreamDestroy(stream));
+    printf("%s\n", ok ? "Done no error." : "... some checks failed.");
+}
@@ -0,0 +1,318 @@
+#include "warmup.hpp"
+#include "../../cuda-runtime-api/utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+static double wall_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+const char *selector_string(nvinfer1::OptProfileSelector selector) {
+    switch (selector) {
+    case nvinfer1::OptProfileSelector::kMIN: return "kMIN";
+    case nvinfer1::OptProfileSelector::kOPT: return "kOPT";
+    case nvinfer1::OptProfileSelector::kMAX: return "kMAX";
+    default: return "unknow";
+    }
+}
+
+static std::string dims_string(const nvinfer1::Dims &dims) {
+    std::string text;
+    for (int i = 0; i < dims.nbDims; ++i) {
+        if (i > 0) { text += "x"; }
+        text += std::to_string(dims.d[i]);
+    }
+    return text;
+}
+
+static int64_t dims_volume(const nvinfer1::Dims &dims) {
+    int64_t volume = 1;
+    for (int i = 0; i < dims.nbDims; ++i) {
+        if (dims.d[i] < 0) { return -1; }
+        volume *= dims.d[i];
+    }
+    return volume;
+}
+
+static size_t element_size(nvinfer1::DataType type) {
+    switch (type) {
+    case nvinfer1::DataType::kHALF: return 2;
+    case nvinfer1::DataType::kINT8: return 1;
+    case nvinfer1::DataType::kBOOL: return 1;
+    default: return 4;
+    }
+}
+
+static float median(std::vector<float> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// 默认的合成输入：float 为 [0, 1) 的伪随机数，half 为 0.5，其他为 0
+static void default_filler(const char *, const nvinfer1::Dims &dims, nvinfer1::DataType type, void *device, cudaStream_t stream) {
+    int64_t volume = dims_volume(dims);
+    if (type == nvinfer1::DataType::kFLOAT) {
+        std::vector<float> host(volume);
+        uint32_t seed = 12345;
+        for (auto &value : host) {
+            seed = seed * 1664525u + 1013904223u;
+            value = (seed >> 8) / 16777216.0f;
+        }
+        checkRuntime(cudaMemcpyAsync(device, host.data(), host.size() * sizeof(float), cudaMemcpyHostToDevice, stream));
+        checkRuntime(cudaStreamSynchronize(stream));
+    } else if (type == nvinfer1::DataType::kHALF) {
+        std::vector<uint16_t> host(volume, 0x3800);
+        checkRuntime(cudaMemcpyAsync(device, host.data(), host.size() * sizeof(uint16_t), cudaMemcpyHostToDevice, stream));
+        checkRuntime(cudaStreamSynchronize(stream));
+    } else {
+        checkRuntime(cudaMemsetAsync(device, 0, volume * element_size(type), stream));
+    }
+}
+
+StartupTimeline::StartupTimeline() : origin_ms_(wall_ms()) {}
+
+double StartupTimeline::now_ms() const {
+    return wall_ms() - origin_ms_;
+}
+
+void StartupTimeline::add(const std::string &name, double begin_ms, double end_ms) {
+    std::lock_guard<std::mutex> lock(lock_);
+    stages_.push_back({name, begin_ms, end_ms});
+}
+
+std::vector<StartupTimeline::Stage> StartupTimeline::stages() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return stages_;
+}
+
+double StartupTimeline::total_ms() const {
+    auto stages = this->stages();
+    std::sort(stages.begin(), stages.end(), [](const Stage &a, const Stage &b) { return a.begin_ms < b.begin_ms; });
+    double total = 0, covered_until = 0;
+    for (auto &stage : stages) {
+        double begin = std::max(stage.begin_ms, covered_until);
+        if (stage.end_ms > begin) {
+            total += stage.end_ms - begin;
+            covered_until = stage.end_ms;
+        }
+    }
+    return total;
+}
+
+void StartupTimeline::print() const {
+    auto stages = this->stages();
+    double end = 0;
+    for (auto &stage : stages) { end = std::max(end, stage.end_ms); }
+    printf("startup timeline: %.2f ms, stages cover %.2f ms\n", end, total_ms());
+    printf("  %-36s %10s %10s %10s\n", "stage", "begin", "end", "ms");
+
+    const int width = 40;
+    for (auto &stage : stages) {
+        char bar[width + 1];
+        int from = end > 0 ? (int)(stage.begin_ms / end * width) : 0;
+        int to = end > 0 ? (int)(stage.end_ms / end * width + 0.5) : 0;
+        to = std::max(to, from + 1);
+        for (int i = 0; i < width; ++i) { bar[i] = i >= from && i < to ? '#' : '.'; }
+        bar[width] = '\0';
+        printf("  %-36s %10.2f %10.2f %10.2f  %s\n", stage.name.c_str(), stage.begin_ms, stage.end_ms,
+               stage.end_ms - stage.begin_ms, bar);
+    }
+}
+
+StartupTimeline::Scope::Scope(StartupTimeline &timeline, const std::string &name)
+    : timeline_(timeline), name_(name), begin_ms_(timeline.now_ms()) {}
+
+StartupTimeline::Scope::~Scope() {
+    timeline_.add(name_, begin_ms_, timeline_.now_ms());
+}
+
+WarmupManager::WarmupManager(const WarmupConfig &config, StartupTimeline *timeline)
+    : config_(config), timeline_(timeline), filler_(default_filler) {
+    config_.window = std::max(config_.window, 1);
+    config_.min_iterations = std::max(config_.min_iterations, config_.window);
+    config_.max_iterations = std::max(config_.max_iterations, config_.min_iterations);
+}
+
+void WarmupManager::add_model(const std::string &name, nvinfer1::ICudaEngine *engine,
+                              const std::vector<nvinfer1::IExecutionContext *> &contexts) {
+    std::unique_ptr<Model> model(new Model());
+    model->name = name;
+    model->engine = engine;
+    model->contexts = contexts;
+    std::lock_guard<std::mutex> lock(lock_);
+    models_.push_back(std::move(model));
+}
+
+void WarmupManager::set_input_filler(InputFiller filler) {
+    filler_ = filler ? filler : InputFiller(default_filler);
+}
+
+bool WarmupManager::ready(const std::string &name) const {
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto &model : models_) {
+        if (model->name == name) { return model->ready; }
+    }
+    return false;
+}
+
+std::vector<WarmupResult> WarmupManager::results() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return results_;
+}
+
+bool WarmupManager::warmup_all(cudaStream_t stream) {
+    std::vector<Model *> models;
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        for (auto &model : models_) { models.push_back(model.get()); }
+    }
+
+    bool all_ok = true;
+    for (Model *model : models) {
+        if (model->ready) { continue; }
+        {
+            // 上一次失败的结果不再算数，重试成功后模型才能 ready
+            std::lock_guard<std::mutex> lock(lock_);
+            auto stale = [&](const WarmupResult &result) { return result.model == model->name; };
+            results_.erase(std::remove_if(results_.begin(), results_.end(), stale), results_.end());
+        }
+        double begin = timeline_ ? timeline_->now_ms() : 0;
+        bool ok = true;
+        for (int i = 0; i < (int)model->contexts.size(); ++i) { ok &= warmup_context(*model, i, stream); }
+        if (timeline_) { timeline_->add("warm-up " + model->name, begin, timeline_->now_ms()); }
+
+        // 不稳定只是预热得不够，仍然可以服务；推理失败的不能
+        std::vector<WarmupResult> results = this->results();
+        bool succeeded = true, stable = true;
+        for (auto &result : results) {
+            if (result.model != model->name) { continue; }
+            succeeded &= result.ok;
+            stable &= result.stable;
+        }
+        model->ready = ok && succeeded;
+        all_ok &= ok && succeeded && stable;
+    }
+    return all_ok;
+}
+
+bool WarmupManager::warmup_context(Model &model, int index, cudaStream_t stream) {
+    nvinfer1::ICudaEngine *engine = model.engine;
+    nvinfer1::IExecutionContext *context = model.contexts[index];
+    int num_bindings = engine->getNbBindings();
+    int num_profiles = std::max(engine->getNbOptimizationProfiles(), 1);
+    int per_profile = num_bindings / num_profiles;
+    int profile = context->getOptimizationProfile();
+    if (profile < 0 || profile >= num_profiles) {
+        // 除了第一个上下文，其他的上下文要先调用 setOptimizationProfileAsync 选择 profile
+        printf("Warm-up %s ctx %d: no optimization profile selected.\n", model.name.c_str(), index);
+        return false;
+    }
+    int first = profile * per_profile;
+
+    for (int i = first; i < first + per_profile; ++i) {
+        if (engine->isShapeBinding(i)) {
+            printf("Warm-up %s: shape tensor input %s is not supported.\n", model.name.c_str(), engine->getBindingName(i));
+            return false;
+        }
+    }
+
+    // 按 kMAX 分配所有绑定的显存，三种形状共用
+    for (int i = first; i < first + per_profile; ++i) {
+        if (engine->bindingIsInput(i)) {
+            context->setBindingDimensions(i, engine->getProfileDimensions(i, profile, nvinfer1::OptProfileSelector::kMAX));
+        }
+    }
+    std::vector<void *> bindings(num_bindings, nullptr);
+    bool ok = context->allInputDimensionsSpecified();
+    for (int i = first; ok && i < first + per_profile; ++i) {
+        int64_t volume = dims_volume(context->getBindingDimensions(i));
+        if (volume < 0) {
+            printf("Warm-up %s: binding %s has unknown dimensions.\n", model.name.c_str(), engine->getBindingName(i));
+            ok = false;
+            break;
+        }
+        ok = checkRuntime(cudaMalloc(&bindings[i], std::max<int64_t>(volume, 1) * element_size(engine->getBindingDataType(i))));
+    }
+
+    nvinfer1::OptProfileSelector selectors[] = {nvinfer1::OptProfileSelector::kMIN, nvinfer1::OptProfileSelector::kOPT,
+                                                nvinfer1::OptProfileSelector::kMAX};
+    for (auto selector : selectors) {
+        if (!ok) { break; }
+        WarmupResult result;
+        result.model = model.name;
+        result.context = index;
+        result.profile = profile;
+        result.selector = selector;
+
+        double begin = timeline_ ? timeline_->now_ms() : 0;
+        for (int i = first; i < first + per_profile; ++i) {
+            if (!engine->bindingIsInput(i)) { continue; }
+            nvinfer1::Dims dims = engine->getProfileDimensions(i, profile, selector);
+            context->setBindingDimensions(i, dims);
+            if (result.shape.empty()) { result.shape = dims_string(dims); }
+            filler_(engine->getBindingName(i), dims, engine->getBindingDataType(i), bindings[i], stream);
+        }
+        ok = run_until_stable(model, index, profile, selector, bindings, stream, &result);
+        if (timeline_) {
+            char name[128];
+            snprintf(name, sizeof(name), "  %s ctx %d %s %s", model.name.c_str(), index, selector_string(selector), result.shape.c_str());
+            timeline_->add(name, begin, timeline_->now_ms());
+        }
+
+        std::lock_guard<std::mutex> lock(lock_);
+        results_.push_back(result);
+    }
+
+    for (void *pointer : bindings) {
+        if (pointer != nullptr) { checkRuntime(cudaFree(pointer)); }
+    }
+    return ok;
+}
+
+bool WarmupManager::run_until_stable(Model &model, int index, int profile, nvinfer1::OptProfileSelector selector,
+                                     std::vector<void *> &bindings, cudaStream_t stream, WarmupResult *result) {
+    nvinfer1::IExecutionContext *context = model.contexts[index];
+    std::vector<float> latencies;
+    for (int i = 0; i < config_.max_iterations; ++i) {
+        double begin = wall_ms();
+        bool success = context->enqueueV2(bindings.data(), stream, nullptr);
+        cudaError_t code = cudaStreamSynchronize(stream);
+        float elapsed = (float)(wall_ms() - begin);
+        if (!success || code != cudaSuccess) {
+            printf("Warm-up %s ctx %d profile %d %s: inference failed, %s\n", model.name.c_str(), index, profile,
+                   selector_string(selector), success ? cudaGetErrorString(code) : "enqueueV2 returned false");
+            result->ok = false;
+            return false;
+        }
+
+        latencies.push_back(elapsed);
+        result->iterations = i + 1;
+        if (i == 0) { result->first_ms = elapsed; }
+        if ((int)latencies.size() < config_.min_iterations) { continue; }
+
+        std::vector<float> window(latencies.end() - config_.window, latencies.end());
+        float middle = median(window);
+        float spread = *std::max_element(window.begin(), window.end()) - *std::min_element(window.begin(), window.end());
+        result->stable_ms = middle;
+        if (spread <= std::max(middle * config_.tolerance, config_.abs_tolerance_ms)) {
+            result->stable = true;
+            break;
+        }
+    }
+    result->ok = true;
+    return true;
+}
+
+void WarmupManager::print_report() const {
+    auto results = this->results();
+    printf("%-12s %4s %8s %-5s %-18s %6s %10s %10s %8s %s\n", "model", "ctx", "profile", "", "shape", "iters", "first ms",
+           "stable ms", "speedup", "");
+    for (auto &result : results) {
+        printf("%-12s %4d %8d %-5s %-18s %6d %10.3f %10.3f %7.1fx %s\n", result.model.c_str(), result.context, result.profile,
+               selector_string(result.selector), result.shape.c_str(), result.iterations, result.first_ms, result.stable_ms,
+               result.stable_ms > 0 ? result.first_ms / result.stable_ms : 0.0f,
+               !result.ok ? "FAILED" : result.stable ? "stable" : "not stable");
+    }
+}
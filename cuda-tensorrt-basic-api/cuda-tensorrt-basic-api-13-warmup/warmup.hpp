@@ -0,0 +1,136 @@
+#ifndef WARMUP_HPP
+#define WARMUP_HPP
+
+#include <NvInfer.h>
+#include <cuda_runtime.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * 启动时间线：记录服务启动的每一步（cuInit、创建上下文、读文件、反序列化、预热……）的起止时间，
+ * 最后打印成一张表和按比例的条形图，一眼看出启动时间花在哪里。时间以构造时刻为 0，单位 ms。
+ */
+class StartupTimeline {
+public:
+    struct Stage {
+        std::string name;
+        double begin_ms, end_ms;
+    };
+
+    // 作用域内的一段：构造时开始，析构时结束
+    class Scope {
+    public:
+        Scope(StartupTimeline &timeline, const std::string &name);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        StartupTimeline &timeline_;
+        std::string name_;
+        double begin_ms_;
+    };
+
+    StartupTimeline();
+
+    double now_ms() const;
+    void add(const std::string &name, double begin_ms, double end_ms);
+    std::vector<Stage> stages() const;
+    // 所有阶段都加起来的时间（重叠部分不重复计算）
+    double total_ms() const;
+    void print() const;
+
+private:
+    double origin_ms_;
+    mutable std::mutex lock_;
+    std::vector<Stage> stages_;
+};
+
+/*
+ * 判断延迟是否稳定：至少跑 min_iterations 次，并且最近 window 次的 (最大 - 最小) 不超过
+ * 中位数的 tolerance 或者 abs_tolerance_ms（很快的模型相对抖动大，用绝对值兜底）。
+ * 跑满 max_iterations 还不稳定就停下，结果中记为不稳定。
+ */
+struct WarmupConfig {
+    int min_iterations = 5;
+    int max_iterations = 100;
+    int window = 5;
+    float tolerance = 0.1f;
+    float abs_tolerance_ms = 0.05f;
+};
+
+// 一个执行上下文在一个形状（kMIN / kOPT / kMAX）上的预热结果
+struct WarmupResult {
+    std::string model;
+    int context = 0;
+    int profile = 0;
+    nvinfer1::OptProfileSelector selector = nvinfer1::OptProfileSelector::kOPT;
+    std::string shape;    // 第一个输入的形状，例如 4x3x224x224
+    int iterations = 0;
+    float first_ms = 0;   // 第一次推理的延迟，冷启动的代价
+    float stable_ms = 0;  // 稳定之后最近 window 次的中位数
+    bool stable = false;
+    bool ok = false;      // 推理是否成功
+};
+
+/*
+ * 模型预热：服务启动后每个 engine / 执行上下文的第一次推理比稳定时慢 10 ~ 100 倍（懒分配显存、加载 kernel 模块、
+ * 选择 tactic 的缓存……），第一个请求不应该承担这个代价。
+ * 对注册的每个模型的每个执行上下文，取它当前使用的 profile（getOptimizationProfile），依次设置 kMIN、kOPT、kMAX 形状的输入，
+ * 用合成的数据反复推理直到延迟稳定，全部完成后才把模型标记为 ready（服务的健康检查查询 ready）。
+ * 每一步都记录到 StartupTimeline。
+ * 形状张量（isShapeBinding）的输入不支持，这样的模型预热失败。延迟是 enqueueV2 到 cudaStreamSynchronize 的主机端时间，也就是请求看到的时间。
+ */
+class WarmupManager {
+public:
+    /*
+     * 合成输入的填充函数，默认 float 为 [0, 1) 的伪随机数、half 为 0.5、整数为 0。
+     * 模型对输入的内容敏感时（例如 NMS 的 plugin，全零输入走的是最快的分支）传入自己的，在 stream 上异步填充 device 即可。
+     */
+    typedef std::function<void(const char *binding_name, const nvinfer1::Dims &dims, nvinfer1::DataType type, void *device,
+                                cudaStream_t stream)>
+        InputFiller;
+
+    explicit WarmupManager(const WarmupConfig &config = WarmupConfig(), StartupTimeline *timeline = nullptr);
+
+    /*
+     * 注册模型，contexts 的 profile 已经选好（setOptimizationProfileAsync），预热时不会切换。
+     * engine 和 contexts 由调用者管理，要比 WarmupManager 的使用活得久。
+     */
+    void add_model(const std::string &name, nvinfer1::ICudaEngine *engine, const std::vector<nvinfer1::IExecutionContext *> &contexts);
+    void set_input_filler(InputFiller filler);
+
+    // 预热所有还没有 ready 的模型，返回是否全部成功并且稳定。推理失败的模型不会 ready
+    bool warmup_all(cudaStream_t stream);
+    bool ready(const std::string &name) const;
+    // 每个模型只保留最近一次预热的结果
+    std::vector<WarmupResult> results() const;
+    void print_report() const;
+
+private:
+    struct Model {
+        std::string name;
+        nvinfer1::ICudaEngine *engine;
+        std::vector<nvinfer1::IExecutionContext *> contexts;
+        std::atomic<bool> ready{false};
+    };
+
+    bool warmup_context(Model &model, int index, cudaStream_t stream);
+    bool run_until_stable(Model &model, int index, int profile, nvinfer1::OptProfileSelector selector,
+                          std::vector<void *> &bindings, cudaStream_t stream, WarmupResult *result);
+
+    WarmupConfig config_;
+    StartupTimeline *timeline_;
+    InputFiller filler_;
+    mutable std::mutex lock_;
+    std::vector<std::unique_ptr<Model>> models_;
+    std::vector<WarmupResult> results_;
+};
+
+const char *selector_string(nvinfer1::OptProfileSelector selector);
+
+#endif // WARMUP_HPP
@@ -0,0 +1,292 @@
+#include "cuda-tensorrt-api.h"
+#include "../../cuda-runtime-api/utils.h"
+#include "../../../3rd_third/onnx-tensorrt/NvOnnxParser.h"
+#include "fused-attention.hpp"
+#include <chrono>
+
+// 通过智能指针管理nv返回的指针参数，内存自动释放，避免泄漏
+template <typename _T>
+static std::shared_ptr<_T> make_nvshared(_T *ptr) {
+    return std::shared_ptr<_T>(ptr, [](_T *p) { p->destroy(); });
+}
+
+static double now_ms() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static std::vector<float> random_vector(size_t size, uint32_t seed) {
+    std::vector<float> data(size);
+    for (auto &value : data) {
+        seed = seed * 1664525u + 1013904223u;
+        value = (seed >> 8) / 16777216.0f * 2.0f - 1.0f;
+    }
+    return data;
+}
+
+// 先算出完整的 [Sq, Sk] 分数矩阵再做 softmax，也就是 MatMul/Softmax/MatMul 拆开执行时的计算方式
+static void naive_attention(const float *q, const float *k, const float *v, const float *mask, float *output, const AttentionParams &p) {
+    std::vector<float> scores(p.seq_k);
+    for (int b = 0; b < p.batch(); ++b) {
+        for (int row = 0; row < p.seq_q; ++row) {
+            float max_score = -INFINITY;
+            for (int key = 0; key < p.seq_k; ++key) {
+                float dot = 0;
+                for (int d = 0; d < p.head_dim; ++d) {
+                    float kv = p.key_transposed ? k[((size_t)b * p.head_dim + d) * p.seq_k + key] : k[((size_t)b * p.seq_k + key) * p.head_dim + d];
+                    dot += q[((size_t)b * p.seq_q + row) * p.head_dim + d] * kv;
+                }
+                float s = dot * p.scale + (mask ? mask[p.mask_offset(b, row) + key * p.mask_stride[3]] : 0.0f);
+                scores[key] = p.visible(row, key) ? s : -INFINITY;
+                max_score = std::max(max_score, scores[key]);
+            }
+            float sum = 0;
+            for (int key = 0; key < p.seq_k; ++key) {
+                scores[key] = max_score == -INFINITY ? 0.0f : expf(scores[key] - max_score);
+                sum += scores[key];
+            }
+            for (int d = 0; d < p.value_dim; ++d) {
+                float value = 0;
+                for (int key = 0; key < p.seq_k; ++key) { value += scores[key] * v[((size_t)b * p.seq_k + key) * p.value_dim + d]; }
+                output[((size_t)b * p.seq_q + row) * p.value_dim + d] = sum > 0 ? value / sum : 0.0f;
+            }
+        }
+    }
+}
+
+static float max_abs_error(const std::vector<float> &a, const std::vector<float> &b) {
+    float error = 0;
+    for (size_t i = 0; i < a.size(); ++i) { error = std::max(error, fabsf(a[i] - b[i])); }
+    return error;
+}
+
+struct AttentionCase {
+    const char *name;
+    int dims[4];          // [outer, inner, Sq, Sk]
+    int head_dim, value_dim;
+    int mask_dims[4];     // 全 0 表示没有掩码
+    int key_transposed, causal;
+};
+
+// 直接调用 kernel，与朴素实现、CPU 分块实现比较
+static bool check_fused_attention_kernel() {
+    const AttentionCase cases[] = {
+        {"b2 h4 s100 d64", {2, 4, 100, 100}, 64, 64, {0}, 0, 0},
+        {"padding mask [b,1,1,s]", {2, 4, 77, 77}, 64, 64, {2, 1, 1, 77}, 0, 0},
+        {"causal", {1, 8, 129, 129}, 32, 32, {0}, 0, 1},
+        {"causal, kv cache sq < sk", {1, 2, 5, 70}, 64, 64, {0}, 0, 1},
+        {"key transposed, mask [sq,sk]", {1, 3, 40, 51}, 40, 80, {1, 1, 40, 51}, 1, 0},
+        {"head dim 128", {1, 2, 64, 300}, 128, 128, {0}, 0, 0},
+    };
+    bool all_ok = true;
+    printf("%-32s %10s %10s %10s %10s %10s\n", "case", "naive(ms)", "cpu(ms)", "gpu(ms)", "cpu err", "gpu err");
+    for (auto &item : cases) {
+        int rank = 4;
+        int q_dims[] = {item.dims[0], item.dims[1], item.dims[2], item.head_dim};
+        int k_dims[] = {item.dims[0], item.dims[1], item.key_transposed ? item.head_dim : item.dims[3], item.key_transposed ? item.dims[3] : item.head_dim};
+        int v_dims[] = {item.dims[0], item.dims[1], item.dims[3], item.value_dim};
+        bool has_mask = item.mask_dims[0] != 0;
+
+        AttentionParams params;
+        params.scale = 1.0f / sqrtf(item.head_dim);
+        params.key_transposed = item.key_transposed;
+        params.causal = item.causal;
+        if (!attention_setup(q_dims, k_dims, v_dims, rank, has_mask ? item.mask_dims : nullptr, 4, &params)) {
+            printf("%-32s setup FAILED\n", item.name);
+            all_ok = false;
+            continue;
+        }
+
+        size_t q_size = (size_t)params.batch() * params.seq_q * params.head_dim;
+        size_t k_size = (size_t)params.batch() * params.seq_k * params.head_dim;
+        size_t v_size = (size_t)params.batch() * params.seq_k * params.value_dim;
+        size_t o_size = (size_t)params.batch() * params.seq_q * params.value_dim;
+        size_t mask_size = has_mask ? (size_t)item.mask_dims[0] * item.mask_dims[1] * item.mask_dims[2] * item.mask_dims[3] : 0;
+        auto q = random_vector(q_size, 1u), k = random_vector(k_size, 2u), v = random_vector(v_size, 3u);
+        std::vector<float> mask(mask_size);
+        // 每个 batch 遮住最后 (b + 1) * 7 个 key，第一个 batch 的最后一行全部遮住
+        for (size_t i = 0; i < mask_size; ++i) {
+            int key = i % item.dims[3];
+            int b = item.mask_dims[0] > 1 ? i / (mask_size / item.mask_dims[0]) : 0;
+            mask[i] = key >= item.dims[3] - (b + 1) * 7 ? -INFINITY : 0.0f;
+        }
+        if (has_mask && item.mask_dims[2] > 1) {
+            std::fill(mask.end() - item.dims[3], mask.end(), -INFINITY);
+        }
+
+        std::vector<float> reference(o_size), cpu(o_size), gpu(o_size);
+        const float *mask_host = has_mask ? mask.data() : nullptr;
+        double t0 = now_ms();
+        naive_attention(q.data(), k.data(), v.data(), mask_host, reference.data(), params);
+        double t1 = now_ms();
+        cpu_fused_attention(q.data(), k.data(), v.data(), mask_host, cpu.data(), params);
+        double t2 = now_ms();
+
+        float *q_device = nullptr, *k_device = nullptr, *v_device = nullptr, *mask_device = nullptr, *o_device = nullptr;
+        checkRuntime(cudaMalloc(&q_device, q_size * sizeof(float)));
+        checkRuntime(cudaMalloc(&k_device, k_size * sizeof(float)));
+        checkRuntime(cudaMalloc(&v_device, v_size * sizeof(float)));
+        checkRuntime(cudaMalloc(&o_device, o_size * sizeof(float)));
+        checkRuntime(cudaMemcpy(q_device, q.data(), q_size * sizeof(float), cudaMemcpyHostToDevice));
+        checkRuntime(cudaMemcpy(k_device, k.data(), k_size * sizeof(float), cudaMemcpyHostToDevice));
+        checkRuntime(cudaMemcpy(v_device, v.data(), v_size * sizeof(float), cudaMemcpyHostToDevice));
+        if (has_mask) {
+            checkRuntime(cudaMalloc(&mask_device, mask_size * sizeof(float)));
+            checkRuntime(cudaMemcpy(mask_device, mask.data(), mask_size * sizeof(float), cudaMemcpyHostToDevice));
+        }
+
+        cudaEvent_t start, stop;
+        checkRuntime(cudaEventCreate(&start));
+        checkRuntime(cudaEventCreate(&stop));
+        checkRuntime(cudaEventRecord(start));
+        fused_attention_invoker(q_device, k_device, v_device, mask_device, o_device, params, nullptr);
+        checkRuntime(cudaEventRecord(stop));
+        checkRuntime(cudaEventSynchronize(stop));
+        checkRuntime(cudaPeekAtLastError());
+        float gpu_ms = 0;
+        checkRuntime(cudaEventElapsedTime(&gpu_ms, start, stop));
+        checkRuntime(cudaMemcpy(gpu.data(), o_device, o_size * sizeof(float), cudaMemcpyDeviceToHost));
+
+        float cpu_error = max_abs_error(cpu, reference);
+        float gpu_error = max_abs_error(gpu, reference);
+        bool ok = cpu_error < 1e-4f && gpu_error < 1e-4f;
+        printf("%-32s %10.3f %10.3f %10.3f %10.2e %10.2e %s\n", item.name, t1 - t0, t2 - t1, gpu_ms, cpu_error, gpu_error, ok ? "OK" : "FAILED");
+        all_ok &= ok;
+
+        checkRuntime(cudaEventDestroy(start));
+        checkRuntime(cudaEventDestroy(stop));
+        checkRuntime(cudaFree(q_device));
+        checkRuntime(cudaFree(k_device));
+        checkRuntime(cudaFree(v_device));
+        checkRuntime(cudaFree(o_device));
+        if (mask_device) { checkRuntime(cudaFree(mask_device)); }
+    }
+    return all_ok;
+}
+
+/*
+ * generate-onnx-9.py 导出的模型只包含注意力的计算：输入 q、k、v [b, 8, s, 64] 和 mask [b, 1, 1, s]，
+ * 导出后是 Transpose/MatMul/Div/Add/Softmax/MatMul，解析时被 PluginFusion 替换成一个 FusedAttention 插件层。
+ */
+static bool build_attention_model() {
+    TRTLogger logger;
+    auto builder = make_nvshared(nvinfer1::createInferBuilder(logger));
+    auto config = make_nvshared(builder->createBuilderConfig());
+    auto network = make_nvshared(builder->createNetworkV2(1));
+
+    auto parser = make_nvshared(nvonnxparser::createParser(*network, logger));
+    if (!parser->parseFromFile("../src/cuda-tensorrt-basic-api/static/fused_attention_demo.onnx", 1)) {
+        printf("Failed to parse fused_attention_demo.onnx\n");
+        return false;
+    }
+
+    // 融合成功时网络中只有插件层，否则能看到 MatMul、Softmax 等多个层
+    int num_plugins = 0;
+    for (int i = 0; i < network->getNbLayers(); ++i) {
+        auto layer = network->getLayer(i);
+        printf("layer %d: %s\n", i, layer->getName());
+        num_plugins += layer->getType() == nvinfer1::LayerType::kPLUGIN_V2;
+    }
+    printf("%d layers, %d plugin layers\n", network->getNbLayers(), num_plugins);
+    if (num_plugins != 1) {
+        printf("The attention subgraph was not fused.\n");
+        return false;
+    }
+
+    int maxBatchSize = 4;
+    config->setMaxWorkspaceSize(1 << 28);
+    auto profile = builder->createOptimizationProfile();
+    for (int i = 0; i < network->getNbInputs(); ++i) {
+        auto input = network->getInput(i);
+        auto dims = input->getDimensions();
+        // 第 0 维为 batch，最后一个动态维度为序列长度
+        auto with_shape = [&](int batch, int seq) {
+            auto shape = dims;
+            shape.d[0] = batch;
+            for (int j = 1; j < shape.nbDims; ++j) {
+                if (shape.d[j] == -1) { shape.d[j] = seq; }
+            }
+            return shape;
+        };
+        profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kMIN, with_shape(1, 1));
+        profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kOPT, with_shape(1, 128));
+        profile->setDimensions(input->getName(), nvinfer1::OptProfileSelector::kMAX, with_shape(maxBatchSize, 512));
+    }
+    config->addOptimizationProfile(profile);
+
+    auto engine = make_nvshared(builder->buildEngineWithConfig(*network, *config));
+    if (engine == nullptr) {
+        printf("Build engine failed.\n");
+        return false;
+    }
+
+    auto model_data = make_nvshared(engine->serialize());
+    FILE *f = fopen("../src/cuda-tensorrt-basic-api/static/fused_attention_demo.trtmodel", "wb");
+    fwrite(model_data->data(), 1, model_data->size(), f);
+    fclose(f);
+    printf("Done.\n");
+    return true;
+}
+
+// 用 engine 推理，与 CPU 实现比较
+static bool infer_attention_model() {
+    TRTLogger logger;
+    auto engine_data = CTA::load_file("../src/cuda-tensorrt-basic-api/static/fused_attention_demo.trtmodel");
+    auto runtime = make_nvshared(nvinfer1::createInferRuntime(logger));
+    auto engine = make_nvshared(runtime->deserializeCudaEngine(engine_data.data(), engine_data.size()));
+    if (engine == nullptr) {
+        printf("Deserialize cuda engine failed.\n");
+        return false;
+    }
+    auto execution_context = make_nvshared(engine->createExecutionContext());
+
+    const int batch = 2, heads = 8, seq = 200, head_dim = 64;
+    size_t qkv_size = (size_t)batch * heads * seq * head_dim;
+    auto q = random_vector(qkv_size, 11u), k = random_vector(qkv_size, 12u), v = random_vector(qkv_size, 13u);
+    std::vector<float> mask(batch * seq, 0.0f);
+    std::fill(mask.begin() + seq - 30, mask.begin() + seq, -INFINITY); // 第一个样本最后 30 个位置是 padding
+    std::vector<float> output(qkv_size), reference(qkv_size);
+
+    // 输入顺序与 generate-onnx-9.py 中的 input_names 相同
+    std::vector<const float *> inputs_host{q.data(), k.data(), v.data(), mask.data()};
+    std::vector<size_t> inputs_size{qkv_size, qkv_size, qkv_size, mask.size()};
+    std::vector<void *> bindings(engine->getNbBindings(), nullptr);
+    cudaStream_t stream = nullptr;
+    checkRuntime(cudaStreamCreate(&stream));
+    for (int i = 0; i < 4; ++i) {
+        checkRuntime(cudaMalloc(&bindings[i], inputs_size[i] * sizeof(float)));
+        checkRuntime(cudaMemcpyAsync(bindings[i], inputs_host[i], inputs_size[i] * sizeof(float), cudaMemcpyHostToDevice, stream));
+    }
+    checkRuntime(cudaMalloc(&bindings[4], qkv_size * sizeof(float)));
+    for (int i = 0; i < 3; ++i) { execution_context->setBindingDimensions(i, nvinfer1::Dims4(batch, heads, seq, head_dim)); }
+    execution_context->setBindingDimensions(3, nvinfer1::Dims4(batch, 1, 1, seq));
+
+    bool success = execution_context->enqueueV2(bindings.data(), stream, nullptr);
+    checkRuntime(cudaMemcpyAsync(output.data(), bindings[4], qkv_size * sizeof(float), cudaMemcpyDeviceToHost, stream));
+    checkRuntime(cudaStreamSynchronize(stream));
+
+    int q_dims[] = {batch, heads, seq, head_dim};
+    int mask_dims[] = {batch, 1, 1, seq};
+    AttentionParams params;
+    params.scale = 1.0f / sqrtf(head_dim);
+    attention_setup(q_dims, q_dims, q_dims, 4, mask_dims, 4, &params);
+    cpu_fused_attention(q.data(), k.data(), v.data(), mask.data(), reference.data(), params);
+
+    float error = max_abs_error(output, reference);
+    bool ok = success && error < 1e-4f;
+    printf("engine vs cpu max error %.2e, score matrix not stored: %.2f MB  %s\n", error,
+           (double)batch * heads * seq * seq * sizeof(float) / 1024 / 1024, ok ? "OK" : "FAILED");
+
+    checkRuntime(cudaStreamDestroy(stream));
+    for (auto ptr : bindings) { checkRuntime(cudaFree(ptr)); }
+    return ok;
+}
+
+void cuda_tensorrt_basic_api_9_fused_attention() {
+    bool all_ok = check_fused_attention_kernel();
+    if (build_attention_model()) {
+        all_ok &= infer_attention_model();
+    } else {
+        all_ok = false;
+    }
+    printf("%s\n", all_ok ? "Done no error." : "... some checks failed.");
+}
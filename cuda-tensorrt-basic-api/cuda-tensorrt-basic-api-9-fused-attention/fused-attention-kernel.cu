@@ -0,0 +1,114 @@
+#include "fused-attention.hpp"
+#include <math.h>
+
+#define FULL_MASK 0xffffffff
+
+static __device__ float warp_max(float value) {
+    for (int offset = 16; offset > 0; offset /= 2) { value = fmaxf(value, __shfl_xor_sync(FULL_MASK, value, offset)); }
+    return value;
+}
+
+static __device__ float warp_sum(float value) {
+    for (int offset = 16; offset > 0; offset /= 2) { value += __shfl_xor_sync(FULL_MASK, value, offset); }
+    return value;
+}
+
+/*
+ * grid = (ceil(seq_q / ATTENTION_WARPS), batch)，block = ATTENTION_WARPS 个 warp，每个 warp 负责一行 query。
+ * 整个 block 一起把 ATTENTION_TILE_K 行的 K、V 读入共享内存，block 内所有 query 共用。
+ * 分数：lane j 计算第 j 个 key 的点积，k_tile 每行多 1 个元素避免 bank conflict；
+ * 输出：lane 负责 d = lane + 32 * i 这几列，p_j 通过 __shfl_sync 广播。
+ */
+static __global__ void fused_attention_kernel(const float *q, const float *k, const float *v, const float *mask, float *output,
+                                              AttentionParams p) {
+    __shared__ float q_tile[ATTENTION_WARPS][ATTENTION_MAX_HEAD_DIM];
+    __shared__ float k_tile[ATTENTION_TILE_K][ATTENTION_MAX_HEAD_DIM + 1];
+    __shared__ float v_tile[ATTENTION_TILE_K][ATTENTION_MAX_HEAD_DIM];
+    const int VALUES_PER_LANE = ATTENTION_MAX_HEAD_DIM / 32;
+
+    int warp = threadIdx.x / 32;
+    int lane = threadIdx.x % 32;
+    int b = blockIdx.y;
+    int row = blockIdx.x * ATTENTION_WARPS + warp;
+    bool active = row < p.seq_q;
+
+    const float *kb = k + (size_t)b * p.seq_k * p.head_dim;
+    const float *vb = v + (size_t)b * p.seq_k * p.value_dim;
+    const float *mrow = mask && active ? mask + p.mask_offset(b, row) : nullptr;
+    if (active) {
+        const float *qrow = q + ((size_t)b * p.seq_q + row) * p.head_dim;
+        for (int d = lane; d < p.head_dim; d += 32) { q_tile[warp][d] = qrow[d]; }
+    }
+
+    // causal 时 block 内最后一行之后的 key 都看不到，不需要读
+    int last_row = min(p.seq_q, (int)(blockIdx.x + 1) * ATTENTION_WARPS) - 1;
+    int key_end = p.causal ? min(p.seq_k, last_row + p.seq_k - p.seq_q + 1) : p.seq_k;
+
+    float m = -INFINITY, l = 0;
+    float acc[VALUES_PER_LANE] = {0};
+    for (int start = 0; start < key_end; start += ATTENTION_TILE_K) {
+        int tile = min(ATTENTION_TILE_K, p.seq_k - start);
+        __syncthreads();
+        if (p.key_transposed) {
+            // K 为 [D, Sk]，让相邻线程读相邻的 key
+            for (int i = threadIdx.x; i < tile * p.head_dim; i += blockDim.x) {
+                int d = i / tile, j = i % tile;
+                k_tile[j][d] = kb[(size_t)d * p.seq_k + start + j];
+            }
+        } else {
+            for (int i = threadIdx.x; i < tile * p.head_dim; i += blockDim.x) {
+                int j = i / p.head_dim, d = i % p.head_dim;
+                k_tile[j][d] = kb[(size_t)(start + j) * p.head_dim + d];
+            }
+        }
+        for (int i = threadIdx.x; i < tile * p.value_dim; i += blockDim.x) {
+            int j = i / p.value_dim, d = i % p.value_dim;
+            v_tile[j][d] = vb[(size_t)(start + j) * p.value_dim + d];
+        }
+        __syncthreads();
+        if (!active) { continue; }
+
+        int key = start + lane;
+        float s = -INFINITY;
+        if (lane < tile && p.visible(row, key)) {
+            float dot = 0;
+            for (int d = 0; d < p.head_dim; ++d) { dot += q_tile[warp][d] * k_tile[lane][d]; }
+            s = dot * p.scale;
+            if (mrow) { s += mrow[key * p.mask_stride[3]]; }
+        }
+
+        // m_new 由 warp 内规约得到，同一个 warp 的分支一致
+        float m_new = fmaxf(m, warp_max(s));
+        if (m_new == -INFINITY) { continue; }
+
+        float alpha = expf(m - m_new);
+        float prob = expf(s - m_new);
+        l = l * alpha + warp_sum(prob);
+#pragma unroll
+        for (int i = 0; i < VALUES_PER_LANE; ++i) { acc[i] *= alpha; }
+        for (int j = 0; j < tile; ++j) {
+            float pj = __shfl_sync(FULL_MASK, prob, j);
+#pragma unroll
+            for (int i = 0; i < VALUES_PER_LANE; ++i) {
+                int d = lane + 32 * i;
+                if (d < p.value_dim) { acc[i] += pj * v_tile[j][d]; }
+            }
+        }
+        m = m_new;
+    }
+
+    if (!active) { return; }
+    float *orow = output + ((size_t)b * p.seq_q + row) * p.value_dim;
+#pragma unroll
+    for (int i = 0; i < VALUES_PER_LANE; ++i) {
+        int d = lane + 32 * i;
+        if (d < p.value_dim) { orow[d] = l > 0 ? acc[i] / l : 0.0f; }
+    }
+}
+
+void fused_attention_invoker(const float *q, const float *k, const float *v, const float *mask, float *output,
+                             const AttentionParams &params, cudaStream_t stream) {
+    dim3 block(ATTENTION_WARPS * 32);
+    dim3 grid((params.seq_q + ATTENTION_WARPS - 1) / ATTENTION_WARPS, params.batch());
+    fused_attention_kernel<<<grid, block, 0, stream>>>(q, k, v, mask, output, params);
+}
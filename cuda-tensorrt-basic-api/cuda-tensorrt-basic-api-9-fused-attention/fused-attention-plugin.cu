@@ -0,0 +1,61 @@
+#include "../../../3rd_third/onnx-tensorrt/onnxplugin.hpp"
+#include "fused-attention.hpp"
+
+using namespace ONNXPlugin;
+
+/*
+ * info 由 PluginFusion 匹配注意力子图时生成，例如 {"scale": 0.125, "key_transposed": 0, "causal": 0}，
+ * 也可以在导出时直接写 Plugin 节点（name_s="FusedAttention"）。
+ */
+struct FusedAttentionConfig : public LayerConfig {
+    float scale = 1.0f;
+    int key_transposed = 0;
+    int causal = 0;
+
+    virtual void init() override {
+        scale = info_float(info_, "scale", 1.0f);
+        key_transposed = (int)info_float(info_, "key_transposed", 0);
+        causal = (int)info_float(info_, "causal", 0);
+    }
+};
+
+// 输入 Q、K、V 和可选的加性掩码，常量掩码由 Plugin 导入函数放在 weights 中
+class FusedAttention : public TRTPlugin {
+public:
+    SetupPlugin(FusedAttention);
+
+    virtual std::shared_ptr<LayerConfig> new_config() override {
+        return std::shared_ptr<LayerConfig>(new FusedAttentionConfig());
+    }
+
+    // 输出的形状与 Q 相同，最后一维换成 V 的最后一维
+    virtual nvinfer1::DimsExprs getOutputDimensions(int32_t outputIndex, const nvinfer1::DimsExprs *inputs, int32_t nbInputs,
+                                                    nvinfer1::IExprBuilder &exprBuilder) noexcept override {
+        nvinfer1::DimsExprs dims = inputs[0];
+        dims.d[dims.nbDims - 1] = inputs[2].d[inputs[2].nbDims - 1];
+        return dims;
+    }
+
+    int enqueue(const std::vector<GTensor> &inputs, std::vector<GTensor> &outputs, const std::vector<GTensor> &weights, void *workspace, cudaStream_t stream) override {
+        auto config = static_cast<FusedAttentionConfig *>(config_.get());
+        const GTensor *mask = inputs.size() > 3 ? &inputs[3] : (weights.empty() ? nullptr : &weights[0]);
+
+        AttentionParams params;
+        params.scale = config->scale;
+        params.key_transposed = config->key_transposed;
+        params.causal = config->causal;
+        const auto &q = inputs[0].shape_, &k = inputs[1].shape_, &v = inputs[2].shape_;
+        if (k.size() != q.size() || v.size() != q.size()
+            || !attention_setup(q.data(), k.data(), v.data(), q.size(), mask ? mask->shape_.data() : nullptr,
+                                mask ? mask->shape_.size() : 0, &params)) {
+            printf("FusedAttention: unsupported shapes, head dim must be <= %d and the mask must broadcast to the scores\n", ATTENTION_MAX_HEAD_DIM);
+            return -1;
+        }
+
+        fused_attention_invoker(inputs[0].ptr<float>(), inputs[1].ptr<float>(), inputs[2].ptr<float>(),
+                                mask ? mask->ptr<float>() : nullptr, outputs[0].ptr<float>(), params, stream);
+        return cudaGetLastError() == cudaSuccess ? 0 : -1;
+    }
+};
+
+RegisterPlugin(FusedAttention);
@@ -0,0 +1,95 @@
+#include "fused-attention.hpp"
+#include <math.h>
+#include <algorithm>
+
+bool attention_setup(const int *q_dims, const int *k_dims, const int *v_dims, int rank, const int *mask_dims, int mask_rank,
+                     AttentionParams *params) {
+    if (rank < 2 || rank > 4 || mask_rank > 4) { return false; }
+
+    // 前面补 1 对齐到 4 维
+    int q[4] = {1, 1, 1, 1}, k[4] = {1, 1, 1, 1}, v[4] = {1, 1, 1, 1};
+    std::copy(q_dims, q_dims + rank, q + 4 - rank);
+    std::copy(k_dims, k_dims + rank, k + 4 - rank);
+    std::copy(v_dims, v_dims + rank, v + 4 - rank);
+
+    AttentionParams &p = *params;
+    p.outer = q[0];
+    p.inner = q[1];
+    p.seq_q = q[2];
+    p.head_dim = q[3];
+    p.seq_k = p.key_transposed ? k[3] : k[2];
+    p.value_dim = v[3];
+    int key_dim = p.key_transposed ? k[2] : k[3];
+    if (k[0] != p.outer || k[1] != p.inner || v[0] != p.outer || v[1] != p.inner) { return false; }
+    if (key_dim != p.head_dim || v[2] != p.seq_k) { return false; }
+    if (p.head_dim > ATTENTION_MAX_HEAD_DIM || p.value_dim > ATTENTION_MAX_HEAD_DIM) { return false; }
+
+    std::fill(p.mask_stride, p.mask_stride + 4, 0);
+    if (mask_dims == nullptr) { return true; }
+
+    int m[4] = {1, 1, 1, 1};
+    std::copy(mask_dims, mask_dims + mask_rank, m + 4 - mask_rank);
+    const int target[4] = {p.outer, p.inner, p.seq_q, p.seq_k};
+    size_t stride = 1;
+    for (int i = 3; i >= 0; --i) {
+        if (m[i] != 1 && m[i] != target[i]) { return false; }
+        p.mask_stride[i] = m[i] == 1 ? 0 : stride;
+        stride *= m[i];
+    }
+    return true;
+}
+
+void cpu_fused_attention(const float *q, const float *k, const float *v, const float *mask, float *output, const AttentionParams &p) {
+    float scores[ATTENTION_TILE_K];
+    float acc[ATTENTION_MAX_HEAD_DIM];
+    for (int b = 0; b < p.batch(); ++b) {
+        const float *kb = k + (size_t)b * p.seq_k * p.head_dim;
+        const float *vb = v + (size_t)b * p.seq_k * p.value_dim;
+        for (int row = 0; row < p.seq_q; ++row) {
+            const float *qrow = q + ((size_t)b * p.seq_q + row) * p.head_dim;
+            const float *mrow = mask ? mask + p.mask_offset(b, row) : nullptr;
+            float m = -INFINITY, l = 0;
+            std::fill(acc, acc + p.value_dim, 0.0f);
+
+            for (int start = 0; start < p.seq_k; start += ATTENTION_TILE_K) {
+                int tile = std::min(ATTENTION_TILE_K, p.seq_k - start);
+                float tile_max = -INFINITY;
+                for (int j = 0; j < tile; ++j) {
+                    int key = start + j;
+                    float s = -INFINITY;
+                    if (p.visible(row, key)) {
+                        float dot = 0;
+                        for (int d = 0; d < p.head_dim; ++d) {
+                            dot += qrow[d] * (p.key_transposed ? kb[(size_t)d * p.seq_k + key] : kb[(size_t)key * p.head_dim + d]);
+                        }
+                        s = dot * p.scale;
+                        if (mrow) { s += mrow[key * p.mask_stride[3]]; }
+                    }
+                    scores[j] = s;
+                    tile_max = std::max(tile_max, s);
+                }
+
+                // 到目前为止全部被遮住，这一块不改变任何状态
+                float m_new = std::max(m, tile_max);
+                if (m_new == -INFINITY) { continue; }
+
+                float alpha = expf(m - m_new);
+                float sum = 0;
+                for (int j = 0; j < tile; ++j) {
+                    scores[j] = expf(scores[j] - m_new);
+                    sum += scores[j];
+                }
+                l = l * alpha + sum;
+                for (int d = 0; d < p.value_dim; ++d) { acc[d] *= alpha; }
+                for (int j = 0; j < tile; ++j) {
+                    const float *vrow = vb + (size_t)(start + j) * p.value_dim;
+                    for (int d = 0; d < p.value_dim; ++d) { acc[d] += scores[j] * vrow[d]; }
+                }
+                m = m_new;
+            }
+
+            float *orow = output + ((size_t)b * p.seq_q + row) * p.value_dim;
+            for (int d = 0; d < p.value_dim; ++d) { orow[d] = l > 0 ? acc[d] / l : 0.0f; }
+        }
+    }
+}
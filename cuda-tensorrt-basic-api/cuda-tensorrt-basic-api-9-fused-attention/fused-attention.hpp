@@ -0,0 +1,57 @@
+#ifndef FUSED_ATTENTION_HPP
+#define FUSED_ATTENTION_HPP
+
+#include <stddef.h>
+#include <cuda_runtime.h>
+
+/*
+ * 融合的注意力 output = softmax(Q x K^T * scale + mask) x V，不在显存中保存 [Sq, Sk] 的分数矩阵。
+ * K、V 按 ATTENTION_TILE_K 行一块读入，每块计算分数后用 online softmax 更新当前的最大值 m、分母 l，
+ * 并把之前累加的输出乘以 exp(m_old - m_new) 修正，最后一块处理完再除以 l。
+ *
+ * Q [..., Sq, D]，K [..., Sk, D]（key_transposed 时为 [..., D, Sk]），V [..., Sk, Dv]，输出 [..., Sq, Dv]，
+ * 前面的维度（batch、head）最多两维，展平后作为 batch。mask 为加性掩码，按广播规则对齐到 [outer, inner, Sq, Sk]。
+ */
+#ifdef __CUDACC__
+#define ATTENTION_HOST_DEVICE __host__ __device__
+#else
+#define ATTENTION_HOST_DEVICE
+#endif
+
+#define ATTENTION_TILE_K 32       // 每次读入的 K/V 行数，GPU 上一个 warp 的每个线程负责一行
+#define ATTENTION_WARPS 8         // GPU 上一个 block 处理的 query 行数，一个 warp 一行
+#define ATTENTION_MAX_HEAD_DIM 128
+
+struct AttentionParams {
+    int outer = 1, inner = 1; // 前面的维度，例如 [batch, heads]，batch() = outer * inner
+    int seq_q = 0, seq_k = 0;
+    int head_dim = 0, value_dim = 0;
+    float scale = 1.0f;
+    int key_transposed = 0;
+    int causal = 0; // 右下角对齐：query i 只看 key j <= i + seq_k - seq_q
+    size_t mask_stride[4] = {0, 0, 0, 0}; // mask 在 outer、inner、Sq、Sk 上的步长，广播的维度为 0
+
+    ATTENTION_HOST_DEVICE int batch() const { return outer * inner; }
+
+    ATTENTION_HOST_DEVICE size_t mask_offset(int b, int row) const {
+        return (b / inner) * mask_stride[0] + (b % inner) * mask_stride[1] + row * mask_stride[2];
+    }
+
+    ATTENTION_HOST_DEVICE bool visible(int row, int key) const { return !causal || key <= row + seq_k - seq_q; }
+};
+
+/*
+ * 由 Q、K、V、mask 的形状填写 params 的维度和 mask 步长，mask_dims 为 nullptr 表示没有掩码。
+ * 形状不匹配或者超出支持范围时返回 false。
+ */
+bool attention_setup(const int *q_dims, const int *k_dims, const int *v_dims, int rank, const int *mask_dims, int mask_rank,
+                     AttentionParams *params);
+
+// 与 GPU 相同的分块、相同的 online softmax，用于验证和 CPU 上的回退
+void cpu_fused_attention(const float *q, const float *k, const float *v, const float *mask, float *output, const AttentionParams &params);
+
+// 所有指针在设备端，mask 可以为 nullptr
+void fused_attention_invoker(const float *q, const float *k, const float *v, const float *mask, float *output,
+                             const AttentionParams &params, cudaStream_t stream);
+
+#endif // FUSED_ATTENTION_HPP
@@ -0,0 +1,51 @@
+import math
+import torch
+import torch.nn as nn
+import torch.onnx
+
+
+class Attention(nn.Module):
+    """
+    只包含注意力的计算，导出后为 Transpose/MatMul/Div/Add/Softmax/MatMul，
+    解析时被 PluginFusion 匹配并替换成一个 FusedAttention 插件层，不需要像 generate-onnx-7.py 那样手写 Plugin 节点。
+    """
+    def forward(self, q, k, v, mask):
+        scores = torch.matmul(q, k.transpose(-2, -1)) / math.sqrt(q.size(-1))
+        scores = scores + mask
+        return torch.matmul(torch.softmax(scores, dim=-1), v)
+
+
+if __name__ == "__main__":
+
+    model = Attention().eval()
+    batch, heads, seq, head_dim = 2, 8, 200, 64
+    q = torch.randn(batch, heads, seq, head_dim)
+    k = torch.randn(batch, heads, seq, head_dim)
+    v = torch.randn(batch, heads, seq, head_dim)
+
+    # 加性掩码，第一个样本最后 30 个位置是 padding
+    mask = torch.zeros(batch, 1, 1, seq)
+    mask[0, :, :, seq - 30:] = float("-inf")
+
+    output = model(q, k, v, mask)
+    print(f"output shape = {output.shape}")
+
+    torch.onnx.export(
+        model,
+        (q, k, v, mask),
+        "./src/cuda-tensorrt-basic-api/static/fused_attention_demo.onnx",
+        verbose=False,
+        input_names=["q", "k", "v", "mask"],
+        output_names=["output"],
+        # Softmax 在 opset 13 之后才按单个轴计算，13 以前需要显式 axis=-1
+        opset_version=13,
+        dynamic_axes={
+            "q": {0: "batch", 2: "seq"},
+            "k": {0: "batch", 2: "seq"},
+            "v": {0: "batch", 2: "seq"},
+            "mask": {0: "batch", 3: "seq"},
+            "output": {0: "batch", 2: "seq"},
+        }
+    )
+
+    print("Done.!")